@@ -12,6 +12,9 @@ void AssemblyEmitter::GenerateAssembly() {
 
     bool IsFirstBB = true;
     for (auto &BB : Func.GetBasicBlocks()) {
+      if (BB.GetAlignment())
+        std::cout << "\t.p2align " << BB.GetAlignment() << std::endl;
+
       if (!IsFirstBB) {
         std::cout << ".L" << FunctionCounter << "_" << BB.GetName() << ":" << std::endl;
       } else
@@ -24,7 +27,7 @@ void AssemblyEmitter::GenerateAssembly() {
             TM->GetInstrDefs()->GetTargetInstr(Instr.GetOpcode());
         assert(TargetInstr != nullptr && "Something went wrong here");
 
-        std::string AssemblyTemplateStr = TargetInstr->GetAsmString();
+        std::string AssemblyTemplateStr(TargetInstr->GetAsmString());
         const auto OperandNumber = TargetInstr->GetOperandNumber();
 
         // If the target instruction has no operands, then just print it and
@@ -49,7 +52,7 @@ void AssemblyEmitter::GenerateAssembly() {
 
           // Register case
           if (CurrentOperand->IsRegister()) {
-            TargetRegister *Reg =
+            const TargetRegister *Reg =
                 TM->GetRegInfo()->GetRegisterByID(CurrentOperand->GetReg());
             std::string RegStr;
             if (Reg->GetAlias() != "")
@@ -95,8 +98,37 @@ void AssemblyEmitter::GenerateAssembly() {
     std::cout << std::endl;
     FunctionCounter++;
   }
-  if (!MIRM->GetGlobalDatas().empty())
-    std::cout << ".section .data" << std::endl;
+  bool HasData = false;
+  for (auto &GlobalData : MIRM->GetGlobalDatas())
+    if (!GlobalData.IsReadOnly() && GlobalData.GetSection().empty()) {
+      if (!HasData)
+        std::cout << ".section .data" << std::endl;
+      HasData = true;
+      GlobalData.Print();
+    }
+
+  // The data placed into its own section is made of double words
+  std::string Section;
+  for (auto &GlobalData : MIRM->GetGlobalDatas())
+    if (!GlobalData.GetSection().empty()) {
+      if (GlobalData.GetSection() != Section) {
+        Section = GlobalData.GetSection();
+        std::cout << ".section " << Section << ",\"aw\"" << std::endl;
+        std::cout << ".p2align 3" << std::endl;
+      }
+      GlobalData.Print();
+    }
+
+  // The read-only data are only jump tables for now, which hold word sized
+  // entries
+  bool HasReadOnlyData = false;
   for (auto &GlobalData : MIRM->GetGlobalDatas())
-    GlobalData.Print();
+    if (GlobalData.IsReadOnly()) {
+      if (!HasReadOnlyData) {
+        std::cout << ".section .rodata" << std::endl;
+        std::cout << ".p2align 2" << std::endl;
+      }
+      HasReadOnlyData = true;
+      GlobalData.Print();
+    }
 }
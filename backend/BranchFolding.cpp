@@ -0,0 +1,341 @@
+#include "BranchFolding.hpp"
+#include "MachineBasicBlock.hpp"
+#include "MachineFunction.hpp"
+#include "TargetInstruction.hpp"
+#include <map>
+#include <set>
+
+/// Return the label operand of @MI, or nullptr if it has none.
+static MachineOperand *GetLabelOperand(MachineInstruction &MI) {
+  for (auto &MO : MI.GetOperands())
+    if (MO.IsLabel())
+      return &MO;
+
+  return nullptr;
+}
+
+/// Return the position of the block named @Label in @Func, or the number of
+/// blocks if there is no such block.
+static size_t FindBlock(MachineFunction &Func, const std::string &Label) {
+  auto &BBs = Func.GetBasicBlocks();
+  size_t i = 0;
+  while (i < BBs.size() && BBs[i].GetName() != Label)
+    i++;
+
+  return i;
+}
+
+/// Return true if the block at @Index of @Func falls through into the block
+/// named @Label, possibly through empty blocks.
+static bool IsFallThrough(MachineFunction &Func, size_t Index,
+                          const std::string &Label) {
+  auto &BBs = Func.GetBasicBlocks();
+  for (size_t i = Index + 1; i < BBs.size(); i++) {
+    if (BBs[i].GetName() == Label)
+      return true;
+    if (!BBs[i].GetInstructions().empty())
+      return false;
+  }
+
+  return false;
+}
+
+/// Return true if an instruction of @Func refers to the block named @Label.
+static bool IsReferenced(MachineFunction &Func, const std::string &Label) {
+  for (auto &MBB : Func.GetBasicBlocks())
+    for (auto &MI : MBB.GetInstructions())
+      for (auto &MO : MI.GetOperands())
+        if (MO.IsLabel() && Label == MO.GetLabel())
+          return true;
+
+  return false;
+}
+
+/// Return the label of the block, where a jump to @Label ends up after going
+/// through the blocks only jumping further.
+static const char *GetFinalTarget(MachineFunction &Func, const char *Label) {
+  auto &BBs = Func.GetBasicBlocks();
+  std::set<std::string> Visited;
+
+  for (;;) {
+    const size_t i = FindBlock(Func, Label);
+    if (i == BBs.size())
+      return Label;
+
+    auto &Instrs = BBs[i].GetInstructions();
+    if (Instrs.size() != 1 || !Instrs.front().IsJump())
+      return Label;
+
+    // The blocks might jump to each other in a cycle
+    auto MO = GetLabelOperand(Instrs.front());
+    if (!MO || !Visited.insert(Label).second)
+      return Label;
+
+    Label = MO->GetLabel();
+  }
+}
+
+/// Return true if @A and @B are the same instruction with the same operands.
+static bool IsIdentical(MachineInstruction &A, MachineInstruction &B) {
+  if (A.GetOpcode() != B.GetOpcode() ||
+      A.GetOperandsNumber() != B.GetOperandsNumber())
+    return false;
+
+  for (size_t i = 0; i < A.GetOperandsNumber(); i++)
+    if (!(*A.GetOperand(i) == *B.GetOperand(i)))
+      return false;
+
+  return true;
+}
+
+bool BranchFolding::IsConditionalBranch(MachineInstruction &MI) {
+  auto TI = TM->GetInstrDefs()->GetTargetInstr(MI.GetOpcode());
+  return TI && TI->HasInverseBranch() && GetLabelOperand(MI);
+}
+
+const char *BranchFolding::CreateLabel(const std::string &Name) {
+  Labels.push_back(Name);
+  return Labels.back().c_str();
+}
+
+bool BranchFolding::OptimizeBranches(MachineFunction &Func) {
+  auto &BBs = Func.GetBasicBlocks();
+  bool Changed = false;
+
+  for (size_t i = 0; i < BBs.size(); i++) {
+    auto &MBB = BBs[i];
+    auto &Instrs = MBB.GetInstructions();
+
+    for (auto &MI : Instrs) {
+      if (!MI.IsJump() && !IsConditionalBranch(MI))
+        continue;
+
+      auto MO = GetLabelOperand(MI);
+      if (!MO)
+        continue;
+
+      auto Target = GetFinalTarget(Func, MO->GetLabel());
+      if (std::string(Target) != MO->GetLabel()) {
+        MO->SetLabel(Target);
+        Changed = true;
+      }
+    }
+
+    if (Instrs.empty())
+      continue;
+
+    auto &Last = Instrs.back();
+    auto LastLabel = GetLabelOperand(Last);
+    if (!LastLabel)
+      continue;
+
+    if (Last.IsJump()) {
+      if (IsFallThrough(Func, i, LastLabel->GetLabel())) {
+        MBB.Erase(&Last);
+        Changed = true;
+        continue;
+      }
+
+      auto Prev = MBB.GetPrecedingInstr(&Last);
+      if (!Prev || !IsConditionalBranch(*Prev))
+        continue;
+
+      // Both sides of the branch lead to the same block
+      auto PrevLabel = GetLabelOperand(*Prev);
+      if (std::string(PrevLabel->GetLabel()) == LastLabel->GetLabel()) {
+        MBB.Erase(Prev);
+        Changed = true;
+        continue;
+      }
+
+      // The branch over the jump is inverted to jump instead
+      if (IsFallThrough(Func, i, PrevLabel->GetLabel())) {
+        auto TI = TM->GetInstrDefs()->GetTargetInstr(Prev->GetOpcode());
+        Prev->SetOpcode(TI->GetInverseBranch());
+        PrevLabel->SetLabel(LastLabel->GetLabel());
+        MBB.Erase(&Last);
+        Changed = true;
+      }
+    } else if (IsConditionalBranch(Last)) {
+      if (IsFallThrough(Func, i, LastLabel->GetLabel())) {
+        MBB.Erase(&Last);
+        Changed = true;
+        continue;
+      }
+
+      // The block only reached by falling through from this one and only
+      // jumping further gives its jump to this one, where the branch can be
+      // inverted over it
+      size_t j = i + 1;
+      while (j < BBs.size() && BBs[j].GetInstructions().empty() &&
+             !IsReferenced(Func, BBs[j].GetName()))
+        j++;
+
+      if (j == BBs.size() || IsReferenced(Func, BBs[j].GetName()))
+        continue;
+
+      auto &NextInstrs = BBs[j].GetInstructions();
+      if (NextInstrs.size() != 1 || !NextInstrs.front().IsJump())
+        continue;
+
+      MachineInstruction Jump = NextInstrs.front();
+      Jump.SetParent(&MBB);
+      MBB.InsertInstr(Jump);
+      BBs[j].Erase(&NextInstrs.front());
+      Changed = true;
+    }
+  }
+
+  return Changed;
+}
+
+bool BranchFolding::RemoveUnreachableBlocks(MachineFunction &Func) {
+  auto &BBs = Func.GetBasicBlocks();
+  const auto Successors = Func.GetSuccessors(TM);
+
+  // The blocks referred to by the jump tables are kept, even if the table is
+  // not used anymore, since their labels are in the data
+  std::vector<bool> Reachable(BBs.size(), false);
+  std::vector<size_t> WorkList = {0};
+  for (auto &MBB : BBs)
+    for (auto &MI : MBB.GetInstructions())
+      if (!MI.IsJump() && !IsConditionalBranch(MI))
+        for (auto &MO : MI.GetOperands())
+          if (MO.IsLabel())
+            WorkList.push_back(FindBlock(Func, MO.GetLabel()));
+
+  while (!WorkList.empty()) {
+    auto i = WorkList.back();
+    WorkList.pop_back();
+    if (i >= BBs.size() || Reachable[i])
+      continue;
+
+    Reachable[i] = true;
+    WorkList.insert(WorkList.end(), Successors[i].begin(), Successors[i].end());
+  }
+
+  bool Changed = false;
+  for (size_t i = BBs.size(); i-- > 1;)
+    if (!Reachable[i]) {
+      BBs.erase(BBs.begin() + i);
+      Changed = true;
+    }
+
+  return Changed;
+}
+
+bool BranchFolding::MergeTails(MachineFunction &Func) {
+  auto &BBs = Func.GetBasicBlocks();
+
+  // The blocks ending with a jump or a return do not fall through, so their
+  // tail can be moved elsewhere. The entry has no label to jump to.
+  std::vector<size_t> Candidates;
+  for (size_t i = 1; i < BBs.size(); i++) {
+    auto &Instrs = BBs[i].GetInstructions();
+    if (!Instrs.empty() &&
+        (Instrs.back().IsJump() ||
+         TM->GetInstrDefs()->GetTargetInstr(Instrs.back().GetOpcode())
+             ->IsReturn()))
+      Candidates.push_back(i);
+  }
+
+  size_t Longest = 0, First = 0, Second = 0;
+  for (size_t a = 0; a < Candidates.size(); a++)
+    for (size_t b = a + 1; b < Candidates.size(); b++) {
+      auto &A = BBs[Candidates[a]].GetInstructions();
+      auto &B = BBs[Candidates[b]].GetInstructions();
+
+      size_t Length = 0;
+      for (auto ItA = A.rbegin(), ItB = B.rbegin();
+           ItA != A.rend() && ItB != B.rend() && IsIdentical(*ItA, *ItB);
+           ItA++, ItB++)
+        Length++;
+
+      if (Length > Longest) {
+        Longest = Length;
+        First = Candidates[a];
+        Second = Candidates[b];
+      }
+    }
+
+  if (Longest < MinTailLength)
+    return false;
+
+  // The tail is kept in a block, which consists of it only, otherwise it is
+  // split off the first block into a new one following it
+  size_t Target = First, Other = Second;
+  if (BBs[Second].GetInstructions().size() == Longest)
+    std::swap(Target, Other);
+  else if (BBs[First].GetInstructions().size() != Longest) {
+    std::string Name = BBs[First].GetName() + "_tail";
+    while (FindBlock(Func, Name) != BBs.size())
+      Name += "_tail";
+
+    BBs.insert(BBs.begin() + First + 1, MachineBasicBlock(Name, &Func));
+    Target = First + 1;
+    if (Other > First)
+      Other++;
+
+    auto &Head = BBs[First];
+    auto &Tail = BBs[Target];
+    if (Head.GetCount() && BBs[Other].GetCount())
+      Tail.SetCount(*Head.GetCount() + *BBs[Other].GetCount());
+
+    auto &HeadInstrs = Head.GetInstructions();
+    for (size_t i = 0; i < Longest; i++) {
+      Tail.InsertInstrToFront(HeadInstrs.back());
+      Head.Erase(&HeadInstrs.back());
+    }
+  }
+
+  auto &MBB = BBs[Other];
+  auto &Instrs = MBB.GetInstructions();
+  for (size_t i = 0; i < Longest; i++)
+    MBB.Erase(&Instrs.back());
+
+  MachineInstruction Jump(MachineInstruction::JUMP, &MBB);
+  Jump.AddLabel(CreateLabel(BBs[Target].GetName()));
+  TM->SelectInstruction(&Jump);
+  MBB.InsertInstr(Jump);
+
+  return true;
+}
+
+void BranchFolding::RunOnFunction(MachineFunction &Func) {
+  auto &BBs = Func.GetBasicBlocks();
+  if (BBs.empty())
+    return;
+
+  // The labels point to the names of the blocks, which move around when
+  // blocks are inserted or erased, so they are copied until the end
+  for (auto &MBB : BBs)
+    for (auto &MI : MBB.GetInstructions())
+      for (auto &MO : MI.GetOperands())
+        if (MO.IsLabel())
+          MO.SetLabel(CreateLabel(MO.GetLabel()));
+
+  // Each step opens up opportunities for the others
+  while (OptimizeBranches(Func) || RemoveUnreachableBlocks(Func) ||
+         MergeTails(Func))
+    ;
+
+  // The labels and the parents are bound to the blocks at their final place
+  std::map<std::string, MachineBasicBlock *> Blocks;
+  for (auto &MBB : BBs)
+    Blocks[MBB.GetName()] = &MBB;
+
+  for (auto &MBB : BBs)
+    for (auto &MI : MBB.GetInstructions()) {
+      MI.SetParent(&MBB);
+      for (auto &MO : MI.GetOperands())
+        if (MO.IsLabel() && Blocks.count(MO.GetLabel()))
+          MO.SetLabel(Blocks[MO.GetLabel()]->GetName().c_str());
+    }
+
+  Labels.clear();
+}
+
+void BranchFolding::Run() {
+  for (auto &Func : MIRM->GetFunctions())
+    RunOnFunction(Func);
+}
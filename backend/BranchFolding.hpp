@@ -0,0 +1,58 @@
+#ifndef BRANCH_FOLDING_HPP
+#define BRANCH_FOLDING_HPP
+
+#include "MachineIRModule.hpp"
+#include "TargetMachine.hpp"
+#include <deque>
+#include <string>
+
+/// Cleans up the branches of the final machine code, once the blocks are laid
+/// out and their instructions are not changed anymore. The jumps to the block
+/// reached by falling through anyway are removed and a conditional branch
+/// over such a jump
+///
+/// 	b.le	.L0_if_true0
+/// 	b	.L0_if_end0
+/// .L0_if_true0:
+///
+/// is replaced by the inverted branch to the target of the jump, which the
+/// target describes with TargetInstruction::GetInverseBranch. So is the
+/// branch over a block, which only jumps and is reached by falling through
+/// only. The branches to blocks, which only jump further, are redirected to
+/// the final target and the blocks not reached anymore are removed. The blocks
+/// ending with the same instructions and the same jump or return share one
+/// copy of them, the others jump to it.
+class BranchFolding {
+public:
+  BranchFolding(MachineIRModule *Module, TargetMachine *TM)
+      : MIRM(Module), TM(TM) {}
+
+  void Run();
+
+private:
+  void RunOnFunction(MachineFunction &Func);
+
+  /// Each of them returns true if it changed @Func.
+  bool OptimizeBranches(MachineFunction &Func);
+  bool RemoveUnreachableBlocks(MachineFunction &Func);
+  bool MergeTails(MachineFunction &Func);
+
+  /// Return true if @MI is a conditional branch to a block.
+  bool IsConditionalBranch(MachineInstruction &MI);
+
+  /// Return a copy of @Name, which lives until the labels are bound to the
+  /// names of the blocks again.
+  const char *CreateLabel(const std::string &Name);
+
+  /// The shared copy of a tail replaces this many instructions with a jump,
+  /// so the shorter tails are not worth it.
+  static constexpr unsigned MinTailLength = 3;
+
+  MachineIRModule *MIRM;
+  TargetMachine *TM;
+
+  /// The labels created while the blocks move around, see CreateLabel.
+  std::deque<std::string> Labels;
+};
+
+#endif
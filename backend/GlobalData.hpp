@@ -33,6 +33,12 @@ public:
 
   InfoVector &GetInitValues() { return InitValues; };
 
+  bool IsReadOnly() const { return ReadOnly; }
+  void SetReadOnly(bool RO) { ReadOnly = RO; }
+
+  const std::string &GetSection() const { return Section; }
+  void SetSection(const std::string &S) { Section = S; }
+
   void InsertAllocation(size_t ByteSize, int64_t InitVal) {
     Directives D = NONE;
     switch (ByteSize) {
@@ -51,7 +57,7 @@ public:
     default:
       if (InitVal == 0) {
         D = ZERO;
-        InitVal = Size;
+        InitVal = ByteSize;
       } else
        assert(!"Invalid size");
     }
@@ -118,6 +124,13 @@ private:
   /// initializer data. ".zero 1" allocate one byte set to zero. This is for
   /// padding in the example.
   InfoVector InitValues;
+
+  /// Read-only data, like jump tables, which is emitted into .rodata
+  bool ReadOnly = false;
+
+  /// The writable section of the data if it is not .data, like the profile
+  /// counters, which are collected by the profile runtime from their section
+  std::string Section;
 };
 
 #endif // GLOBAL_DATA_HPP
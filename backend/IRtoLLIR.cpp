@@ -6,6 +6,7 @@
 #include "MachineFunction.hpp"
 #include "MachineInstruction.hpp"
 #include "MachineOperand.hpp"
+#include <algorithm>
 #include <cassert>
 #include "Support.hpp"
 
@@ -66,7 +67,10 @@ MachineOperand IRtoLLIR::GetMachineOperandFromValue(Value *Val,
 
     if (Val->GetTypeRef().IsPTR())
       VReg.SetType(LowLevelType::CreatePTR(TM->GetPointerSize()));
-    else
+    else if (Val->GetTypeRef().IsVector()) {
+      const unsigned Lanes = Val->GetTypeRef().GetLanes();
+      VReg.SetType(LowLevelType::CreateVector(Lanes, BitWidth / Lanes));
+    } else
       VReg.SetType(LowLevelType::CreateScalar(BitWidth));
 
     return VReg;
@@ -145,6 +149,51 @@ MachineOperand IRtoLLIR::MaterializeAddress(Value *Val,
     return GetMachineOperandFromValue(Val, MBB);
 }
 
+/// Return for each of the first @Size bytes of @V whether it is known to be
+/// zero, or an empty vector if @V is not a constant. Only the initializers of
+/// the local arrays are known to be constant, see VariableDeclaration.
+static std::vector<bool> GetZeroBytes(Value *V, size_t Size) {
+  auto GV = dynamic_cast<GlobalVariable *>(V);
+  if (!GV || GV->GetName().rfind("__const.", 0) != 0 ||
+      !GV->GetTypeRef().IsArray())
+    return {};
+
+  // The elements missing from the list are zero
+  std::vector<bool> ZeroBytes(Size, true);
+  const size_t ElemSize = GV->GetTypeRef().GetBaseType().GetByteSize();
+  auto &InitList = GV->GetInitList();
+
+  for (size_t i = 0; i < InitList.size(); i++)
+    for (size_t Byte = 0; Byte < ElemSize; Byte++)
+      if (i * ElemSize + Byte < Size && (InitList[i] >> (Byte * 8)) & 0xff)
+        ZeroBytes[i * ElemSize + Byte] = false;
+
+  return ZeroBytes;
+}
+
+/// Return the LLIR opcode of @Operation. The kinds after the vector
+/// operations are not numbered like their opcodes.
+static unsigned GetOpcode(Instruction::IKind Operation) {
+  switch (Operation) {
+  case Instruction::ROTR:
+    return MachineInstruction::ROTR;
+  case Instruction::CLZ:
+    return MachineInstruction::CLZ;
+  case Instruction::CTZ:
+    return MachineInstruction::CTZ;
+  case Instruction::POPCOUNT:
+    return MachineInstruction::POPCOUNT;
+  case Instruction::BSWAP:
+    return MachineInstruction::BSWAP;
+  case Instruction::CRC32:
+    return MachineInstruction::CRC32;
+  case Instruction::SELECT:
+    return MachineInstruction::SELECT;
+  default:
+    return (unsigned)Operation + (1 << 16);
+  }
+}
+
 MachineInstruction IRtoLLIR::ConvertToMachineInstr(Instruction *Instr,
                                         MachineBasicBlock *BB,
                                         std::vector<MachineBasicBlock> &BBs) {
@@ -155,7 +204,7 @@ MachineInstruction IRtoLLIR::ConvertToMachineInstr(Instruction *Instr,
       Operation == Instruction::CMP)
     ParentFunction = BB->GetParent();
 
-  auto ResultMI = MachineInstruction((unsigned)Operation + (1 << 16), BB);
+  auto ResultMI = MachineInstruction(GetOpcode(Operation), BB);
 
   // Three address ALU instructions: INSTR Result, Op1, Op2
   if (auto I = dynamic_cast<BinaryInstruction *>(Instr); I != nullptr) {
@@ -202,6 +251,11 @@ MachineInstruction IRtoLLIR::ConvertToMachineInstr(Instruction *Instr,
      else
       Op = GetMachineOperandFromValue(I->GetOperand(), BB);
 
+    if (Operation == Instruction::SPLAT)
+      ResultMI.SetOpcode(MachineInstruction::SPLAT);
+    else if (Operation == Instruction::REDUCE_ADD)
+      ResultMI.SetOpcode(MachineInstruction::REDUCE_ADD);
+
     ResultMI.AddOperand(Result);
     ResultMI.AddOperand(Op);
   }
@@ -382,7 +436,7 @@ MachineInstruction IRtoLLIR::ConvertToMachineInstr(Instruction *Instr,
   else if (auto I = dynamic_cast<GetElementPointerInstruction *>(Instr); I != nullptr) {
     MachineInstruction GoalInstr;
     // Used for to look up GoalInstr if it was inserted
-    int GoalInstrIdx = -1;
+    MachineInstruction *InsertedGoalInstr = nullptr;
 
     auto SourceID = GetIDFromValue(I->GetSource());
     const bool IsGlobal = I->GetSource()->IsGlobalVar();
@@ -432,7 +486,7 @@ MachineInstruction IRtoLLIR::ConvertToMachineInstr(Instruction *Instr,
       if (!SourceType.IsStruct() || (SourceType.GetPointerLevel() > 2)) {
         if (!GoalInstr.IsInvalid()) {
           BB->InsertInstr(GoalInstr);
-          GoalInstrIdx = (int)BB->GetInstructions().size() - 1;
+          InsertedGoalInstr = &BB->GetInstructions().back();
         }
 
         auto Multiplier = SourceType.CalcElemSize(0);
@@ -498,7 +552,7 @@ MachineInstruction IRtoLLIR::ConvertToMachineInstr(Instruction *Instr,
         GoalInstr.GetDef()->SetReg(ParentFunction->GetNextAvailableVReg());
       // In this case the instruction was already inserted, so find it in the BB
       else
-        BB->GetInstructions()[GoalInstrIdx].GetDef()->SetReg(
+        InsertedGoalInstr->GetDef()->SetReg(
             ParentFunction->GetNextAvailableVReg());
     }
 
@@ -516,8 +570,8 @@ MachineInstruction IRtoLLIR::ConvertToMachineInstr(Instruction *Instr,
       // Otherwise (stack or global case) the base address is loaded in
       // by the preceding STACK_ADDRESS or GLOBAL_ADDRESS instruction, use
       // the Def of the GoalInstr to use the updated destination
-      ADD.AddOperand(GoalInstrIdx != -1
-                         ? *BB->GetInstructions()[GoalInstrIdx].GetDef()
+      ADD.AddOperand(InsertedGoalInstr != nullptr
+                         ? *InsertedGoalInstr->GetDef()
                          : *GoalInstr.GetDef());
 
     if (IndexIsInReg)
@@ -535,6 +589,93 @@ MachineInstruction IRtoLLIR::ConvertToMachineInstr(Instruction *Instr,
         break;
       }
   }
+  // Jump table: jt index, [label1, label2, ...]
+  //
+  // is lowered to
+  //    GLOBAL_ADDRESS  %table, .LJT
+  //    LSL             %offset, %index, 2
+  //    ADD             %entry_addr, %table, %offset
+  //    LOAD            %entry, [%entry_addr]
+  //    ADD             %target, %table, %entry
+  //    INDIRECT_JUMP   %target, label1, label2, ...
+  //
+  // where the index and the entry are sign extended to the pointer size if
+  // needed. The entries are 32 bit offsets of the labels relative to the
+  // table, so it does not need any relocation. The labels are kept as
+  // operands, so later passes know the possible targets.
+  else if (auto I = dynamic_cast<JumpTableInstruction *>(Instr); I != nullptr) {
+    const auto PtrSize = TM->GetPointerSize();
+
+    auto ExtendToPtrSize = [&](MachineOperand MO) {
+      if (MO.GetSize() >= PtrSize)
+        return MO;
+
+      auto SEXT = MachineInstruction(MachineInstruction::SEXT, BB);
+      auto Dest = MachineOperand::CreateVirtualRegister(
+          ParentFunction->GetNextAvailableVReg(), PtrSize);
+      SEXT.AddOperand(Dest);
+      SEXT.AddOperand(MO);
+      BB->InsertInstr(SEXT);
+      return Dest;
+    };
+
+    auto CreateBinary = [&](unsigned Opcode, MachineOperand LHS,
+                            MachineOperand RHS) {
+      auto MI = MachineInstruction(Opcode, BB);
+      auto Dest = MachineOperand::CreateVirtualRegister(
+          ParentFunction->GetNextAvailableVReg(), PtrSize);
+      MI.AddOperand(Dest);
+      MI.AddOperand(LHS);
+      MI.AddOperand(RHS);
+      BB->InsertInstr(MI);
+      return Dest;
+    };
+
+    // The labels are named like the assembly emitter does it
+    const auto LabelPrefix =
+        ".L" + std::to_string(TU->GetFunctions().size() - 1) + "_";
+    const auto TableName =
+        LabelPrefix + "JT" + std::to_string(JumpTableCounter++);
+
+    auto Table = GlobalData(TableName, I->GetTargets().size() * 4);
+    Table.SetReadOnly(true);
+    for (auto Target : I->GetTargets())
+      Table.InsertAllocation(LabelPrefix + Target->GetName() + "-" + TableName,
+                             GlobalData::WORD);
+    TU->AddGlobalData(Table);
+
+    auto TableAddr = MachineInstruction(MachineInstruction::GLOBAL_ADDRESS, BB);
+    auto TableReg = MachineOperand::CreateVirtualRegister(
+        ParentFunction->GetNextAvailableVReg(), PtrSize);
+    TableAddr.AddOperand(TableReg);
+    TableAddr.AddGlobalSymbol(TableName);
+    BB->InsertInstr(TableAddr);
+
+    auto Index =
+        ExtendToPtrSize(GetMachineOperandFromValue(I->GetIndex(), BB));
+    auto Offset = CreateBinary(MachineInstruction::LSL, Index,
+                               MachineOperand::CreateImmediate(2, PtrSize));
+    auto EntryAddr = CreateBinary(MachineInstruction::ADD, TableReg, Offset);
+
+    auto Load = MachineInstruction(MachineInstruction::LOAD, BB);
+    auto Entry = MachineOperand::CreateVirtualRegister(
+        ParentFunction->GetNextAvailableVReg(), 32);
+    Load.AddOperand(Entry);
+    Load.AddMemory(EntryAddr.GetReg(), PtrSize);
+    BB->InsertInstr(Load);
+
+    auto Target =
+        CreateBinary(MachineInstruction::ADD, TableReg, ExtendToPtrSize(Entry));
+
+    ResultMI.SetOpcode(MachineInstruction::INDIRECT_JUMP);
+    ResultMI.AddOperand(Target);
+    for (auto TargetBB : I->GetTargets())
+      for (auto &MBB : BBs)
+        if (TargetBB->GetName() == MBB.GetName()) {
+          ResultMI.AddLabel(MBB.GetName().c_str());
+          break;
+        }
+  }
   // Branch instruction: Br op label label
   else if (auto I = dynamic_cast<BranchInstruction *>(Instr); I != nullptr) {
     const char *LabelTrue = nullptr;
@@ -554,6 +695,13 @@ MachineInstruction IRtoLLIR::ConvertToMachineInstr(Instruction *Instr,
     if (I->HasFalseLabel())
       ResultMI.AddLabel(LabelTrue);
   }
+  // Select instruction: sel dest, cond, src1, src2
+  else if (auto I = dynamic_cast<SelectInstruction *>(Instr); I != nullptr) {
+    ResultMI.AddOperand(GetMachineOperandFromValue((Value *)I, BB, true));
+    ResultMI.AddOperand(GetMachineOperandFromValue(I->GetCondition(), BB));
+    ResultMI.AddOperand(GetMachineOperandFromValue(I->GetTrueValue(), BB));
+    ResultMI.AddOperand(GetMachineOperandFromValue(I->GetFalseValue(), BB));
+  }
   // Compare instruction: cmp dest, src1, src2
   else if (auto I = dynamic_cast<CompareInstruction *>(Instr); I != nullptr) {
     auto Result = GetMachineOperandFromValue((Value *)I, BB, true);
@@ -568,8 +716,10 @@ MachineInstruction IRtoLLIR::ConvertToMachineInstr(Instruction *Instr,
   }
   // Call instruction: call Result, function_name(Param1, ...)
   else if (auto I = dynamic_cast<CallInstruction *>(Instr); I != nullptr) {
-    // The function has a call instruction
-    ParentFunction->SetToCaller();
+    // The function has a call instruction. Tail calls return directly to the
+    // caller of the function, so the link register is not needed for them.
+    if (I != TailCall)
+      ParentFunction->SetToCaller();
 
     // insert COPY/MOV -s for each Param to move them the right registers
     // ignoring the case when there is too much parameter and has to pass
@@ -659,6 +809,12 @@ MachineInstruction IRtoLLIR::ConvertToMachineInstr(Instruction *Instr,
 
     ResultMI.AddFunctionName(I->GetName().c_str());
 
+    // The callee leaves the return value in the return registers
+    if (I == TailCall) {
+      ResultMI.SetOpcode(MachineInstruction::TAIL_CALL);
+      return ResultMI;
+    }
+
     // if no return value then we are done
     if (I->GetTypeRef().IsVoid())
       return ResultMI;
@@ -847,12 +1003,15 @@ MachineInstruction IRtoLLIR::ConvertToMachineInstr(Instruction *Instr,
   // Memcopy instruction: memcopy dest, source, num_of_bytes
   else if (auto I = dynamic_cast<MemoryCopyInstruction *>(Instr);
            I != nullptr) {
-    // lower this into load and store pairs if used with structs lower then
-    // a certain size (for now be it the size which can be passed by value)
-    // otherwise create a call maybe to an intrinsic memcopy function
-
-    // If the copy size is greater then 32 byte call memcpy
-    if (I->GetSize() >= 32 && TM->IsMemcpySupported()) {
+    // Copying a constant initializer of zeros is a fill with zeros, which does
+    // not need to read the source
+    auto ZeroBytes = GetZeroBytes(I->GetSource(), I->GetSize());
+    const bool IsFill =
+        !ZeroBytes.empty() &&
+        std::find(ZeroBytes.begin(), ZeroBytes.end(), false) == ZeroBytes.end();
+
+    // Large copies and fills call memcpy and memset if the target has them
+    if (I->GetSize() > TM->GetInlineMemOpLimit() && TM->IsMemcpySupported()) {
       ParentFunction->SetToCaller();
 
       ResultMI.SetOpcode(MachineInstruction::CALL);
@@ -868,14 +1027,19 @@ MachineInstruction IRtoLLIR::ConvertToMachineInstr(Instruction *Instr,
       Param1.AddOperand(Dest);
       BB->InsertInstr(Param1);
 
-      MachineOperand Src = MaterializeAddress(I->GetSource(), BB);
-
       auto Param2 = MachineInstruction(MachineInstruction::MOV, BB);
 
-      Param2.AddRegister(TargetArgRegs[1]->GetID(),
-                         TargetArgRegs[1]->GetBitWidth());
+      if (IsFill) {
+        Param2.AddRegister(TargetArgRegs[1]->GetSubRegs()[0],
+                           TargetArgRegs[1]->GetBitWidth());
+        Param2.AddImmediate(0);
+      } else {
+        MachineOperand Src = MaterializeAddress(I->GetSource(), BB);
 
-      Param2.AddOperand(Src);
+        Param2.AddRegister(TargetArgRegs[1]->GetID(),
+                           TargetArgRegs[1]->GetBitWidth());
+        Param2.AddOperand(Src);
+      }
       BB->InsertInstr(Param2);
 
       auto Param3 = MachineInstruction(MachineInstruction::MOV, BB);
@@ -888,7 +1052,7 @@ MachineInstruction IRtoLLIR::ConvertToMachineInstr(Instruction *Instr,
       Param3.AddImmediate(I->GetSize());
       BB->InsertInstr(Param3);
 
-      ResultMI.AddFunctionName("memcpy");
+      ResultMI.AddFunctionName(IsFill ? "memset" : "memcpy");
       return ResultMI;
     }
 
@@ -898,50 +1062,167 @@ MachineInstruction IRtoLLIR::ConvertToMachineInstr(Instruction *Instr,
 
     // If it was not mapped yet then it must mean it was not converted to MO yet
     // (TODO: at least I think so, well see...)
-    if (IRVregToLLIRVreg.count(I->GetSource()->GetID()) == 0)
+    if (!IsFill && IRVregToLLIRVreg.count(I->GetSource()->GetID()) == 0)
       Src = MaterializeAddress(I->GetSource(), BB);
 
     if (IRVregToLLIRVreg.count(I->GetDestination()->GetID()) == 0)
       Dest = MaterializeAddress(I->GetDestination(), BB);
 
-    auto SrcId = IRVregToLLIRVreg.count(I->GetSource()->GetID()) == 0
+    auto SrcId = IsFill ? ~0u
+                 : IRVregToLLIRVreg.count(I->GetSource()->GetID()) == 0
                      ? Src.GetReg()
                      : GetIDFromValue(I->GetSource());
     auto DestId = IRVregToLLIRVreg.count(I->GetDestination()->GetID()) == 0
                       ? Dest.GetReg()
                       : GetIDFromValue(I->GetDestination());
 
-    for (size_t i = 0; i < (I->GetSize() / /* TODO: use alignment here */ 4); i++) {
+    return ExpandMemoryCopy(DestId, SrcId, I->GetSize(), ZeroBytes, BB);
+  } else
+    assert(!"Unimplemented instruction!");
+
+  return ResultMI;
+}
+
+MachineInstruction
+IRtoLLIR::ExpandMemoryCopy(unsigned DestId, unsigned SrcId, size_t Size,
+                           const std::vector<bool> &ZeroBytes,
+                           MachineBasicBlock *BB) {
+  auto ParentFunction = BB->GetParent();
+  const unsigned PtrSize = TM->GetPointerSize();
+
+  // The widest chunks come first, then the halved ones cover the rest
+  std::vector<std::pair<size_t, unsigned>> Chunks;
+  size_t Covered = 0;
+  for (unsigned ChunkSize = TM->GetMemOpChunkSize(); ChunkSize > 0;
+       ChunkSize /= 2)
+    for (; Covered + ChunkSize <= Size; Covered += ChunkSize)
+      Chunks.push_back({Covered, ChunkSize});
+
+  auto IsZero = [&](size_t Offset, unsigned ChunkSize) {
+    if (SrcId == ~0u)
+      return true;
+    if (ZeroBytes.empty())
+      return false;
+    auto Begin = ZeroBytes.begin() + Offset;
+    return std::find(Begin, Begin + ChunkSize, false) == Begin + ChunkSize;
+  };
+
+  // Two chunks are loaded before they are stored, so the consecutive accesses
+  // can be paired by the target
+  std::vector<MachineInstruction> Instrs;
+  for (size_t i = 0; i < Chunks.size(); i += 2) {
+    const size_t End = std::min(i + 2, Chunks.size());
+    std::vector<unsigned> VRegs;
+
+    for (size_t j = i; j < End; j++) {
+      auto [Offset, ChunkSize] = Chunks[j];
+      VRegs.push_back(ParentFunction->GetNextAvailableVReg());
+      if (IsZero(Offset, ChunkSize))
+        continue;
+
       auto Load = MachineInstruction(MachineInstruction::LOAD, BB);
-      auto NewVReg = ParentFunction->GetNextAvailableVReg();
-      Load.AddVirtualRegister(NewVReg, /* TODO: use alignment here */ 32);
+      Load.AddVirtualRegister(VRegs.back(), ChunkSize * 8);
 
       if (ParentFunction->IsStackSlot(SrcId))
-        Load.AddStackAccess(SrcId, i * /* TODO: use alignment here */ 4);
+        Load.AddStackAccess(SrcId, Offset);
       else
-        Load.AddMemory(SrcId, i * /* TODO: use alignment here */ 4, TM->GetPointerSize());
+        Load.AddMemory(SrcId, Offset, PtrSize);
 
-      BB->InsertInstr(Load);
+      Instrs.push_back(Load);
+    }
+
+    for (size_t j = i; j < End; j++) {
+      auto [Offset, ChunkSize] = Chunks[j];
+      auto VReg = VRegs[j - i];
+
+      // Zeros are materialized right before the store, where the target can
+      // use its zero register instead
+      if (IsZero(Offset, ChunkSize)) {
+        auto LoadImm = MachineInstruction(MachineInstruction::LOAD_IMM, BB);
+        LoadImm.AddVirtualRegister(VReg, ChunkSize * 8);
+        LoadImm.AddImmediate(0, ChunkSize * 8);
+        Instrs.push_back(LoadImm);
+      }
 
       auto Store = MachineInstruction(MachineInstruction::STORE, BB);
 
       if (ParentFunction->IsStackSlot(DestId))
-        Store.AddStackAccess(DestId,i * /* TODO: use alignment here */ 4);
-      else {
-        Store.AddMemory(DestId, TM->GetPointerSize());
-        Store.GetOperands()[0].SetOffset(i * /* TODO: use alignment here */ 4);
-      }
-      Store.AddVirtualRegister(NewVReg, /* TODO: use alignment here */ 32);
-      // TODO: Change the function so it does not return the instruction but
-      // insert it in the function so don't have to do these annoying returns
-      if (i == ((I->GetSize() / /* TODO: use alignment here */ 4) - 1))
-        return Store;
-      BB->InsertInstr(Store);
+        Store.AddStackAccess(DestId, Offset);
+      else
+        Store.AddMemory(DestId, Offset, PtrSize);
+
+      Store.AddVirtualRegister(VReg, ChunkSize * 8);
+      Instrs.push_back(Store);
     }
-  } else
-    assert(!"Unimplemented instruction!");
+  }
 
-  return ResultMI;
+  for (size_t i = 0; i + 1 < Instrs.size(); i++)
+    BB->InsertInstr(Instrs[i]);
+
+  return Instrs.empty() ? MachineInstruction() : Instrs.back();
+}
+
+bool IRtoLLIR::HasAddressTakenLocals(Function &F) {
+  auto IsStackAlloc = [](Value *V) {
+    auto I = dynamic_cast<Instruction *>(V);
+    return I && I->IsStackAllocation();
+  };
+
+  for (auto &BB : F.GetBasicBlocks())
+    for (auto &Instr : BB->GetInstructions()) {
+      auto I = Instr.get();
+      if (I->GetInstructionKind() == Instruction::MEM_COPY)
+        continue;
+
+      // Loading and storing through the allocation does not leak the address
+      Value *Uses[] = {I->Get1stUse(), I->Get2ndUse()};
+      if (I->IsLoad())
+        Uses[0] = nullptr;
+      else if (I->IsStore())
+        Uses[1] = nullptr;
+
+      for (auto Use : Uses)
+        if (Use && IsStackAlloc(Use))
+          return true;
+
+      if (auto Call = dynamic_cast<CallInstruction *>(I))
+        for (auto Arg : Call->GetArgs())
+          if (IsStackAlloc(Arg))
+            return true;
+    }
+
+  return false;
+}
+
+bool IRtoLLIR::IsTailCall(CallInstruction *Call, Instruction *Next) {
+  auto Ret = dynamic_cast<ReturnInstruction *>(Next);
+  if (!TailCallsAllowed || !Ret || Call->GetImplicitStructArgIndex() >= 0 ||
+      Call->GetTypeRef().IsStruct())
+    return false;
+
+  // Only the unchanged result of the call can be returned
+  if (Call->GetTypeRef().IsVoid() ? Ret->GetRetVal() != nullptr
+                                  : Ret->GetRetVal() != Call)
+    return false;
+
+  // Arguments passed on the stack would be in the frame of the caller
+  size_t ArgRegsNeeded = 0;
+  for (auto Arg : Call->GetArgs()) {
+    if (Arg->GetTypeRef().IsStruct() && !Arg->GetTypeRef().IsPTR() &&
+        !Arg->IsGlobalVar())
+      ArgRegsNeeded += StructByIDToRegMap[Arg->GetID()].size();
+    else if (Arg->GetTypeRef().GetBitSize() > TM->GetPointerSize())
+      return false;
+    else
+      ArgRegsNeeded++;
+  }
+
+  // Targets without FP argument registers have only integer ones
+  auto ABI = TM->GetABI();
+  const size_t IntArgRegs = ABI->GetFirstFPArgRegIdx() > 0
+                                ? ABI->GetFirstFPArgRegIdx()
+                                : ABI->GetArgumentRegisters().size();
+  return ArgRegsNeeded <= IntArgRegs;
 }
 
 /// For each stack allocation instruction insert a new entry into the StackFrame
@@ -953,14 +1234,19 @@ void HandleStackAllocation(StackAllocationInstruction *Instr,
   const auto IsPTR = ReferredType.GetPointerLevel() > 0;
   const auto IsStruct = ReferredType.IsStruct();
 
-  const size_t Alignment = IsPTR ? TM->GetPointerSize() / 8
-                                 : IsStruct
-                                       ? ReferredType.GetStructMaxAlignment(TM)
-                                       : ReferredType.GetBaseTypeByteSize();
+  size_t Alignment = IsPTR ? TM->GetPointerSize() / 8
+                           : IsStruct ? ReferredType.GetStructMaxAlignment(TM)
+                                      : ReferredType.GetBaseTypeByteSize();
 
   const size_t Size =
       IsPTR ? TM->GetPointerSize() / 8 : ReferredType.GetByteSize();
 
+  // Aggregates are aligned for the widest chunks, which their initialization
+  // and copies are done with
+  const size_t ChunkSize = TM->GetMemOpChunkSize();
+  if (!IsPTR && (IsStruct || ReferredType.IsArray()) && Size >= ChunkSize)
+    Alignment = std::max(Alignment, ChunkSize);
+
   Func->InsertStackSlot(Instr->GetID(), Size, Alignment);
 }
 
@@ -1038,13 +1324,28 @@ void IRtoLLIR::GenerateLLIRFromIR() {
     // Create all basic block first with their name, so jumps can refer to them
     // already
     auto &MFuncMBBs = MFunction->GetBasicBlocks();
-    for (auto &BB : Fun.GetBasicBlocks())
+    for (auto &BB : Fun.GetBasicBlocks()) {
       MFuncMBBs.push_back(MachineBasicBlock{BB.get()->GetName(), MFunction});
+      MFuncMBBs.back().SetCount(BB->GetCount());
+      MFuncMBBs.back().SetAlignment(BB->GetAlignment());
+    }
+
+    // The frame is torn down before tail calls, so nothing may point into it
+    TailCallsAllowed = !HasAddressTakenLocals(Fun);
+    for (auto &Param : Fun.GetParameters())
+      if (Param->IsImplicitStructPtr())
+        TailCallsAllowed = false;
 
     unsigned BBCounter = 0;
     for (auto &BB : Fun.GetBasicBlocks()) {
-      for (auto &Instr : BB->GetInstructions()) {
-        auto InstrPtr = Instr.get();
+      auto &Instrs = BB->GetInstructions();
+      for (size_t i = 0; i < Instrs.size(); i++) {
+        auto InstrPtr = Instrs[i].get();
+
+        if (auto Call = dynamic_cast<CallInstruction *>(InstrPtr);
+            Call && i + 1 < Instrs.size() &&
+            IsTailCall(Call, Instrs[i + 1].get()))
+          TailCall = Call;
 
         if (InstrPtr->IsStackAllocation()) {
           HandleStackAllocation((StackAllocationInstruction *)InstrPtr,
@@ -1070,6 +1371,7 @@ void IRtoLLIR::GenerateLLIRFromIR() {
     auto Size = GlobalVar->GetTypeRef().GetByteSize();
 
     auto GD = GlobalData(Name, Size);
+    GD.SetSection(((GlobalVariable *)GlobalVar.get())->GetSection());
     auto &InitList = ((GlobalVariable*)GlobalVar.get())->GetInitList();
 
     if (GlobalVar->GetTypeRef().IsStruct() || GlobalVar->GetTypeRef().IsArray()) {
@@ -1099,9 +1401,14 @@ void IRtoLLIR::GenerateLLIRFromIR() {
         }
         // array case
         else {
-          const auto Size = GlobalVar->GetTypeRef().GetBaseType().GetByteSize();
+          const auto ElemSize =
+              GlobalVar->GetTypeRef().GetBaseType().GetByteSize();
           for (auto InitVal : InitList)
-            GD.InsertAllocation(Size, InitVal);
+            GD.InsertAllocation(ElemSize, InitVal);
+
+          // The elements missing from the list are zero
+          if (InitList.size() * ElemSize < Size)
+            GD.InsertAllocation(Size - InitList.size() * ElemSize, 0);
         }
       }
     }
@@ -26,6 +26,9 @@ public:
     ParamByIDToRegMap.clear();
     IRVregToLLIRVreg.clear();
     SpilledReturnValuesIDToStackID.clear();
+    JumpTableCounter = 0;
+    TailCallsAllowed = false;
+    TailCall = nullptr;
   }
 
 private:
@@ -47,6 +50,25 @@ private:
   /// GetMachineOperandFromValue is called.
   MachineOperand MaterializeAddress(Value *Val, MachineBasicBlock *MBB);
 
+  /// Expand the copy of @Size bytes from @SrcId to @DestId into loads and
+  /// stores of the widest chunks the target supports. The chunks which are
+  /// zero according to @ZeroBytes are stored without loading them, and if
+  /// @SrcId is ~0, then @DestId is filled with zeros. Return the last store,
+  /// every other instruction is inserted into @BB.
+  MachineInstruction ExpandMemoryCopy(unsigned DestId, unsigned SrcId,
+                                      size_t Size,
+                                      const std::vector<bool> &ZeroBytes,
+                                      MachineBasicBlock *BB);
+
+  /// Return true if the address of any stack allocation of @F might escape,
+  /// so the frame has to outlive the calls made by @F.
+  static bool HasAddressTakenLocals(Function &F);
+
+  /// Return true if @Call can be lowered to a tail call, which requires
+  /// @Next to return the result of the call and every argument to be passed
+  /// in registers.
+  bool IsTailCall(CallInstruction *Call, Instruction *Next);
+
   Module &IRM;
   MachineIRModule *TU;
   TargetMachine *TM;
@@ -68,6 +90,17 @@ private:
   /// To keep track which stack slots are used for spilling the return values
   /// of functions calls.
   std::map<unsigned, unsigned> SpilledReturnValuesIDToStackID;
+
+  /// Number of jump tables created for the current function, used to name
+  /// them uniquely.
+  unsigned JumpTableCounter = 0;
+
+  /// True if the frame of the current function is not referenced by others,
+  /// so it can be torn down before a call.
+  bool TailCallsAllowed = false;
+
+  /// The call currently lowered to a tail call.
+  CallInstruction *TailCall = nullptr;
 };
 
 #endif
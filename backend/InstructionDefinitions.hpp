@@ -1,7 +1,10 @@
 #ifndef INSTRUCTION_DEFINITIONS_HPP
 #define INSTRUCTION_DEFINITIONS_HPP
 
-#include <string>
+#include "PeepholeRule.hpp"
+#include "SelectionPattern.hpp"
+#include <string_view>
+#include <vector>
 
 class TargetInstruction;
 
@@ -10,8 +13,26 @@ public:
   InstructionDefinitions() {}
   virtual ~InstructionDefinitions() {}
 
-  virtual TargetInstruction *GetTargetInstr(unsigned Opcode) { return nullptr; }
-  virtual std::string GetInstrString(unsigned index) { return ""; }
+  virtual const TargetInstruction *GetTargetInstr(unsigned Opcode) {
+    return nullptr;
+  }
+  virtual std::string_view GetInstrString(unsigned Opcode) { return ""; }
+
+  /// The multi-instruction patterns which are tried before selecting
+  /// instructions one by one.
+  virtual const std::vector<SelectionPattern> &GetSelectionPatterns() {
+    static const std::vector<SelectionPattern> NoPatterns;
+    return NoPatterns;
+  }
+
+  /// The rewrite rules applied on the selected and allocated machine code.
+  virtual const std::vector<PeepholeRule> &GetPeepholeRules() {
+    static const std::vector<PeepholeRule> NoRules;
+    return NoRules;
+  }
+
+  /// The number of instructions the targeted cores issue per cycle.
+  virtual unsigned GetIssueWidth() { return 1; }
 };
 
 #endif
@@ -0,0 +1,240 @@
+#include "InstructionScheduler.hpp"
+#include "MachineBasicBlock.hpp"
+#include "MachineFunction.hpp"
+#include "TargetInstruction.hpp"
+#include "TargetRegister.hpp"
+#include <algorithm>
+#include <map>
+#include <set>
+
+unsigned InstructionScheduler::GetRegUnit(unsigned Reg) {
+  if (auto ParentReg = TM->GetRegInfo()->GetParentReg(Reg))
+    return ParentReg->GetID();
+  return Reg;
+}
+
+bool InstructionScheduler::MayAlias(const Node &A, const Node &B) {
+  if (!A.KnownAddress || !B.KnownAddress || A.BaseUnit != B.BaseUnit ||
+      A.BaseVersion != B.BaseVersion)
+    return true;
+
+  return A.Offset < B.Offset + B.Size && B.Offset < A.Offset + A.Size;
+}
+
+bool InstructionScheduler::IsBoundary(MachineInstruction &MI) {
+  auto TI = TM->GetInstrDefs()->GetTargetInstr(MI.GetOpcode());
+  return !TI || TI->IsBranch() || TI->IsCall() || TI->IsReturn();
+}
+
+void InstructionScheduler::BuildGraph(std::vector<Node> &Nodes) {
+  auto RegInfo = TM->GetRegInfo();
+  const unsigned StackUnit = GetRegUnit(RegInfo->GetStackRegister());
+  const std::set<unsigned> ZeroRegs = {RegInfo->GetZeroRegister(32),
+                                       RegInfo->GetZeroRegister(64)};
+
+  auto AddEdge = [&Nodes](unsigned From, unsigned To, unsigned Latency) {
+    Nodes[From].Succs.push_back({To, Latency});
+    Nodes[To].PredsLeft++;
+  };
+
+  std::map<unsigned, unsigned> LastDef;
+  std::map<unsigned, std::vector<unsigned>> UsesSinceDef;
+  std::map<unsigned, unsigned> DefCount;
+
+  for (unsigned i = 0; i < Nodes.size(); i++) {
+    auto &N = Nodes[i];
+    auto MI = N.MI;
+    auto TI = TM->GetInstrDefs()->GetTargetInstr(MI->GetOpcode());
+
+    // The pairs load or store two registers, the base follows them
+    const unsigned Properties = N.Class.Properties;
+    const unsigned DataRegs =
+        TI->IsLoadOrStore() && (Properties & SchedulingClass::PAIR) ? 2 : 1;
+    const bool Writeback = Properties & SchedulingClass::WRITEBACK;
+
+    std::set<unsigned> Defs, Uses;
+    for (unsigned j = 0; j < MI->GetOperandsNumber(); j++) {
+      auto MO = MI->GetOperand(j);
+      if (!MO->IsRegister() || ZeroRegs.count(MO->GetReg()))
+        continue;
+
+      const auto Unit = GetRegUnit(MO->GetReg());
+      const bool IsDef =
+          TI->HasDef() && j < (TI->IsLoad() ? DataRegs : 1);
+      if (IsDef || (Writeback && j == DataRegs))
+        Defs.insert(Unit);
+      if (!IsDef || TI->IsTiedDef())
+        Uses.insert(Unit);
+    }
+
+    if (Properties & SchedulingClass::SETS_FLAGS)
+      Defs.insert(FlagsUnit);
+    if (Properties & SchedulingClass::READS_FLAGS)
+      Uses.insert(FlagsUnit);
+
+    // The accesses below the stack pointer are not safe, so moving the stack
+    // orders the memory accesses as well
+    N.Memory = TI->IsLoadOrStore() || Defs.count(StackUnit);
+    N.WritesMemory = N.Memory && !TI->IsLoad();
+
+    if (TI->IsLoadOrStore() && !Writeback &&
+        MI->GetOperandsNumber() == DataRegs + 2) {
+      auto Base = MI->GetOperand(DataRegs);
+      auto Offset = MI->GetOperand(DataRegs + 1);
+      auto Data = MI->GetOperand(0);
+
+      if (Base->IsRegister() && Offset->IsImmediate() &&
+          !Offset->IsFPImmediate() && Data->IsRegister()) {
+        // The width of the register might be more than the accessed one, like
+        // for ldrb, which only makes the aliasing more conservative
+        const unsigned Bits =
+            std::max(RegInfo->GetRegisterByID(Data->GetReg())->GetBitWidth(),
+                     Data->GetSize());
+
+        N.KnownAddress = true;
+        N.BaseUnit = GetRegUnit(Base->GetReg());
+        N.BaseVersion = DefCount[N.BaseUnit];
+        N.Offset = Offset->GetImmediate();
+        N.Size = DataRegs * Bits / 8;
+      }
+    }
+
+    for (auto Unit : Uses)
+      if (LastDef.count(Unit))
+        AddEdge(LastDef[Unit], i, Nodes[LastDef[Unit]].Class.Latency);
+
+    // A later def must also write its result later
+    for (auto Unit : Defs) {
+      if (LastDef.count(Unit)) {
+        const unsigned Prev = Nodes[LastDef[Unit]].Class.Latency;
+        const unsigned Own = N.Class.Latency;
+        AddEdge(LastDef[Unit], i, Prev >= Own ? Prev - Own + 1 : 1);
+      }
+
+      for (auto User : UsesSinceDef[Unit])
+        AddEdge(User, i, 0);
+    }
+
+    // The memory accesses are only ordered
+    if (N.Memory)
+      for (unsigned j = 0; j < i; j++)
+        if (Nodes[j].Memory && (N.WritesMemory || Nodes[j].WritesMemory) &&
+            MayAlias(Nodes[j], N))
+          AddEdge(j, i, 0);
+
+    for (auto Unit : Uses)
+      if (!Defs.count(Unit))
+        UsesSinceDef[Unit].push_back(i);
+
+    for (auto Unit : Defs) {
+      LastDef[Unit] = i;
+      UsesSinceDef[Unit].clear();
+      DefCount[Unit]++;
+    }
+  }
+
+  for (unsigned i = Nodes.size(); i-- > 0;) {
+    auto &N = Nodes[i];
+    N.Height = N.Class.Latency;
+    for (auto [Succ, Latency] : N.Succs)
+      N.Height = std::max(N.Height, Latency + Nodes[Succ].Height);
+  }
+}
+
+std::vector<unsigned> InstructionScheduler::Schedule(std::vector<Node> &Nodes) {
+  const unsigned IssueWidth = TM->GetInstrDefs()->GetIssueWidth();
+
+  std::vector<unsigned> Order;
+  std::vector<bool> Scheduled(Nodes.size(), false);
+  std::vector<unsigned> BusyUntil(SchedulingClass::UNITS_END, 0);
+  std::vector<unsigned> IssuedToUnit(SchedulingClass::UNITS_END, 0);
+  unsigned Cycle = 0, Issued = 0;
+
+  while (Order.size() < Nodes.size()) {
+    // The ready node with the longest path to the end, the earlier one in the
+    // original order on ties
+    unsigned Best = Nodes.size();
+    for (unsigned i = 0; i < Nodes.size(); i++) {
+      auto &N = Nodes[i];
+      const unsigned Unit = N.Class.Unit;
+      const unsigned Capacity =
+          Unit == SchedulingClass::ALU ? IssueWidth : 1;
+
+      if (Scheduled[i] || N.PredsLeft > 0 || N.ReadyCycle > Cycle ||
+          BusyUntil[Unit] > Cycle || IssuedToUnit[Unit] >= Capacity)
+        continue;
+
+      if (Best == Nodes.size() || N.Height > Nodes[Best].Height)
+        Best = i;
+    }
+
+    if (Best == Nodes.size() || Issued == IssueWidth) {
+      Cycle++;
+      Issued = 0;
+      std::fill(IssuedToUnit.begin(), IssuedToUnit.end(), 0);
+      continue;
+    }
+
+    auto &N = Nodes[Best];
+    Scheduled[Best] = true;
+    Order.push_back(Best);
+    Issued++;
+    IssuedToUnit[N.Class.Unit]++;
+    if (N.Class.Occupancy > 1)
+      BusyUntil[N.Class.Unit] = Cycle + N.Class.Occupancy;
+
+    for (auto [Succ, Latency] : N.Succs) {
+      Nodes[Succ].PredsLeft--;
+      Nodes[Succ].ReadyCycle =
+          std::max(Nodes[Succ].ReadyCycle, Cycle + Latency);
+    }
+  }
+
+  return Order;
+}
+
+void InstructionScheduler::ScheduleRegion(
+    MachineBasicBlock &MBB, std::vector<MachineInstruction *> &Region) {
+  if (Region.size() < 2)
+    return;
+
+  std::vector<Node> Nodes(Region.size());
+  for (size_t i = 0; i < Region.size(); i++) {
+    Nodes[i].MI = Region[i];
+    Nodes[i].Class = TM->GetInstrDefs()
+                         ->GetTargetInstr(Region[i]->GetOpcode())
+                         ->GetSchedulingClass();
+  }
+
+  BuildGraph(Nodes);
+  const auto Order = Schedule(Nodes);
+
+  // The instructions are copied first, since they are replaced in place
+  std::vector<MachineInstruction> Instrs;
+  for (auto i : Order)
+    Instrs.push_back(*Region[i]);
+
+  for (size_t i = 0; i < Region.size(); i++)
+    MBB.ReplaceInstr(Instrs[i], Region[i]);
+}
+
+void InstructionScheduler::RunOnBasicBlock(MachineBasicBlock &MBB) {
+  std::vector<MachineInstruction *> Region;
+  for (auto &MI : MBB.GetInstructions()) {
+    if (!IsBoundary(MI)) {
+      Region.push_back(&MI);
+      continue;
+    }
+
+    ScheduleRegion(MBB, Region);
+    Region.clear();
+  }
+
+  ScheduleRegion(MBB, Region);
+}
+
+void InstructionScheduler::Run() {
+  for (auto &Func : MIRM->GetFunctions())
+    for (auto &MBB : Func.GetBasicBlocks())
+      RunOnBasicBlock(MBB);
+}
@@ -0,0 +1,87 @@
+#ifndef INSTRUCTION_SCHEDULER_HPP
+#define INSTRUCTION_SCHEDULER_HPP
+
+#include "MachineIRModule.hpp"
+#include "SchedulingClass.hpp"
+#include "TargetMachine.hpp"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/// Reorders the instructions of the basic blocks after the register
+/// allocation, so the in-order cores do not stall on results, which are not
+/// ready yet. The calls, branches and returns stay in place, the instructions
+/// between them form a region, where a dependence graph is built from the
+/// registers, the condition flags and the memory accesses. The accesses with
+/// the same base and disjoint offsets are independent. The regions are list
+/// scheduled cycle by cycle, issuing the ready instruction with the longest
+/// path to the end of the region first, as long as the target issues more
+/// in the cycle and the unit of the instruction is free. The latencies and
+/// the units come from TargetInstruction::GetSchedulingClass. For
+/// example the load of the second chain is moved before the use of the first
+/// one:
+///
+/// 	ldr	w1, [x0, #0]
+/// 	ldr	w2, [x0, #8]
+/// 	add	w1, w1, #1
+/// 	add	w2, w2, #2
+class InstructionScheduler {
+public:
+  InstructionScheduler(MachineIRModule *Module, TargetMachine *TM)
+      : MIRM(Module), TM(TM) {}
+
+  void Run();
+
+private:
+  struct Node {
+    MachineInstruction *MI = nullptr;
+    SchedulingClass Class;
+
+    /// The nodes depending on this one and the cycles they have to be issued
+    /// after it
+    std::vector<std::pair<unsigned, unsigned>> Succs;
+    unsigned PredsLeft = 0;
+    /// The longest path to the end of the region in cycles
+    unsigned Height = 0;
+    /// The earliest cycle, when the operands are ready
+    unsigned ReadyCycle = 0;
+
+    /// Accesses the memory or moves the stack
+    bool Memory = false;
+    bool WritesMemory = false;
+    /// The base, which is identified by its register unit and the number of
+    /// its redefinitions before the access, and the accessed bytes are known
+    bool KnownAddress = false;
+    unsigned BaseUnit = 0;
+    unsigned BaseVersion = 0;
+    int64_t Offset = 0;
+    unsigned Size = 0;
+  };
+
+  void RunOnBasicBlock(MachineBasicBlock &MBB);
+
+  /// Return true if no instruction can be moved across @MI.
+  bool IsBoundary(MachineInstruction &MI);
+
+  /// Reorder @Region, which are consecutive instructions of @MBB.
+  void ScheduleRegion(MachineBasicBlock &MBB,
+                      std::vector<MachineInstruction *> &Region);
+
+  void BuildGraph(std::vector<Node> &Nodes);
+
+  /// Return the nodes in the order they are issued.
+  std::vector<unsigned> Schedule(std::vector<Node> &Nodes);
+
+  unsigned GetRegUnit(unsigned Reg);
+
+  /// Return true if @A and @B might access the same bytes.
+  static bool MayAlias(const Node &A, const Node &B);
+
+  /// The condition flags are tracked as this register unit.
+  static constexpr unsigned FlagsUnit = ~0u;
+
+  MachineIRModule *MIRM;
+  TargetMachine *TM;
+};
+
+#endif
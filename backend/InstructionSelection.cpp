@@ -1,13 +1,382 @@
 #include "InsturctionSelection.hpp"
+#include "MachineBasicBlock.hpp"
+#include "MachineFunction.hpp"
+#include "Support.hpp"
+
+static bool IsVReg(MachineOperand *MO) {
+  return MO->IsVirtualReg() || (MO->IsMemory() && MO->IsVirtual());
+}
+
+/// The patterns and the addressing modes are only available for scalars.
+static bool HasVectorOperand(MachineInstruction *MI) {
+  for (auto &MO : MI->GetOperands())
+    if (MO.GetType().IsVector())
+      return true;
+
+  return false;
+}
+
+bool InsturctionSelection::MatchPattern(const SelectionPattern &P,
+                                        MachineInstruction *MI,
+                                        MachineInstruction *Inner,
+                                        unsigned InnerPos) {
+  // The folded value must not be used anywhere else, so the def in Inner and
+  // the use in MI must be its only occurrences.
+  auto FoldedReg = MI->GetOperand(P.FoldedOperand)->GetReg();
+  if (VRegOccurrences[FoldedReg] != 2)
+    return false;
+
+  const auto ResultSize = MI->GetOperand(0)->GetSize();
+  std::vector<MachineOperand> Operands;
+
+  for (size_t i = 0; i < P.ResultOperands.size(); i++) {
+    auto &PO = P.ResultOperands[i];
+    auto Src = PO.Kind == PatternOperand::ROOT ? MI : Inner;
+
+    if (PO.Index >= Src->GetOperandsNumber())
+      return false;
+
+    auto MO = Src->GetOperand(PO.Index);
+
+    if (PO.Kind == PatternOperand::ADDRESS) {
+      assert(P.Predicate == SelectionPattern::MEM_OFFSET);
+      auto Mem = MI->GetOperand(P.FoldedOperand);
+      auto Offset = Inner->GetOperand(PO.OffsetIndex);
+      if (MI->GetOperandsNumber() != 2 || !Mem->IsMemory() ||
+          !MO->IsVirtualReg() || !Offset->IsImmediate() ||
+          Offset->IsFPImmediate())
+        return false;
+
+      const int64_t NewOffset = Mem->GetOffset() + Offset->GetImmediate();
+      if (!TM->IsValidMemoryOffset(NewOffset))
+        return false;
+
+      auto Address = *Mem;
+      Address.SetReg(MO->GetReg());
+      Address.SetOffset(NewOffset);
+      Operands.push_back(Address);
+    } else if (P.Predicate == SelectionPattern::SHIFTED_REGISTER &&
+               i == P.ResultOperands.size() - 1) {
+      if (!MO->IsImmediate() || MO->IsFPImmediate() ||
+          MO->GetImmediate() >= ResultSize)
+        return false;
+
+      Operands.push_back(*MO);
+    } else if (P.Predicate != SelectionPattern::MEM_OFFSET) {
+      // Only 32 and 64 bit wide registers are allowed, since these patterns
+      // select target instructions directly and therefore skip the operand
+      // extension of the individual selectors.
+      if (!MO->IsVirtualReg() || MO->GetSize() != ResultSize ||
+          ResultSize < 32)
+        return false;
+
+      Operands.push_back(*MO);
+    } else
+      Operands.push_back(*MO);
+
+    // The operands taken from Inner are read later at MI, therefore they must
+    // not be redefined in between.
+    if (PO.Kind != PatternOperand::ROOT && IsVReg(MO) &&
+        LastDefPos.count(MO->GetReg()) && LastDefPos[MO->GetReg()] > InnerPos)
+      return false;
+  }
+
+  MI->GetOperands() = std::move(Operands);
+  MI->SetOpcode(P.ResultOpcode);
+  MI->GetParent()->Erase(Inner);
+  VRegOccurrences[FoldedReg] = 0;
+
+  return true;
+}
+
+void InsturctionSelection::CountVRegOccurrences(MachineFunction &MFunc) {
+  VRegOccurrences.clear();
+  for (auto &MBB : MFunc.GetBasicBlocks())
+    for (auto &MI : MBB.GetInstructions())
+      for (auto &MO : MI.GetOperands())
+        if (IsVReg(&MO))
+          VRegOccurrences[MO.GetReg()]++;
+}
+
+void InsturctionSelection::MatchPatterns(MachineFunction &MFunc) {
+  auto &Patterns = TM->GetInstrDefs()->GetSelectionPatterns();
+  if (Patterns.empty())
+    return;
+
+  CountVRegOccurrences(MFunc);
+
+  for (auto &MBB : MFunc.GetBasicBlocks()) {
+    Defs.clear();
+    LastDefPos.clear();
+    unsigned Pos = 0;
+
+    for (auto &MI : MBB.GetInstructions()) {
+      if (!MI.IsAlreadySelected() && !HasVectorOperand(&MI)) {
+        for (auto &P : Patterns) {
+          if (P.RootOpcode != MI.GetOpcode() ||
+              P.FoldedOperand >= MI.GetOperandsNumber())
+            continue;
+
+          auto Folded = MI.GetOperand(P.FoldedOperand);
+          if (!IsVReg(Folded) || !Defs.count(Folded->GetReg()))
+            continue;
+
+          auto [Inner, InnerPos] = Defs[Folded->GetReg()];
+          if (Inner->GetOpcode() != P.InnerOpcode ||
+              LastDefPos[Folded->GetReg()] != InnerPos)
+            continue;
+
+          if (MatchPattern(P, &MI, Inner, InnerPos)) {
+            Defs.erase(Folded->GetReg());
+            break;
+          }
+        }
+      }
+
+      // Conservatively treat the first operand as a def for every instruction
+      if (MI.GetOperandsNumber() > 0 && MI.GetOperand(0)->IsVirtualReg()) {
+        auto Reg = MI.GetOperand(0)->GetReg();
+        LastDefPos[Reg] = Pos;
+        if (!MI.IsAlreadySelected() && MI.GetDef())
+          Defs[Reg] = {&MI, Pos};
+      }
+      Pos++;
+    }
+  }
+}
+
+MachineInstruction *InsturctionSelection::GetFoldableDef(unsigned Reg,
+                                                         unsigned Opcode) {
+  if (!Defs.count(Reg) || VRegOccurrences[Reg] != 2)
+    return nullptr;
+
+  auto [Def, Pos] = Defs[Reg];
+  if (Def->GetOpcode() != Opcode || LastDefPos[Reg] != Pos)
+    return nullptr;
+
+  return Def;
+}
+
+bool InsturctionSelection::IsNotRedefinedAfter(MachineOperand *MO,
+                                               unsigned Pos) {
+  return !IsVReg(MO) || !LastDefPos.count(MO->GetReg()) ||
+         LastDefPos[MO->GetReg()] <= Pos;
+}
+
+/// Return the value of @MO if it is an immediate or a register set to an
+/// immediate by @MOVDef, otherwise 0.
+static int64_t GetConstantValue(MachineOperand *MO,
+                                MachineInstruction *MOVDef) {
+  if (MO->IsImmediate() && !MO->IsFPImmediate())
+    return MO->GetImmediate();
+
+  if (MOVDef && MOVDef->GetOpcode() == MachineInstruction::MOV &&
+      MOVDef->GetOperand(1)->IsImmediate() &&
+      !MOVDef->GetOperand(1)->IsFPImmediate())
+    return MOVDef->GetOperand(1)->GetImmediate();
+
+  return 0;
+}
+
+bool InsturctionSelection::FoldAddressingMode(MachineInstruction *MI) {
+  const bool IsLoad = MI->GetOpcode() == MachineInstruction::LOAD;
+  if (MI->GetOperandsNumber() != 2 || HasVectorOperand(MI))
+    return false;
+
+  auto Mem = MI->GetOperand(IsLoad ? 1 : 0);
+  if (!Mem->IsMemory() || !Mem->IsVirtual())
+    return false;
+
+  auto ADD = GetFoldableDef(Mem->GetReg(), MachineInstruction::ADD);
+  if (!ADD || !ADD->GetOperand(1)->IsVirtualReg() ||
+      !ADD->GetOperand(2)->IsVirtualReg())
+    return false;
+
+  const unsigned ADDPos = Defs[Mem->GetReg()].second;
+  for (unsigned BaseIdx : {1, 2}) {
+    MachineOperand Base = *ADD->GetOperand(BaseIdx);
+    MachineOperand *Index = ADD->GetOperand(3 - BaseIdx);
+    // The instructions computing the address from Base and Index
+    std::vector<MachineInstruction *> Folded = {ADD};
+    // The position of the instruction reading Index
+    unsigned IndexPos = ADDPos;
+    unsigned Shift = 0;
+    unsigned Extend = 0;
+
+    // The scaling of the index by a power of two
+    MachineInstruction *ScaleDef = nullptr;
+    if (auto MUL = GetFoldableDef(Index->GetReg(), MachineInstruction::MUL)) {
+      auto ScaleMO = MUL->GetOperand(2);
+      if (IsVReg(ScaleMO) && Defs.count(ScaleMO->GetReg()))
+        ScaleDef = Defs[ScaleMO->GetReg()].first;
+
+      const int64_t Scale = GetConstantValue(ScaleMO, ScaleDef);
+      if (MUL->GetOperand(1)->IsVirtualReg() && IsPowerOf2(Scale)) {
+        Shift = Log2(Scale);
+        IndexPos = Defs[Index->GetReg()].second;
+        Index = MUL->GetOperand(1);
+        Folded.push_back(MUL);
+      } else
+        ScaleDef = nullptr;
+    } else if (auto LSL =
+                   GetFoldableDef(Index->GetReg(), MachineInstruction::LSL)) {
+      if (LSL->GetOperand(1)->IsVirtualReg() &&
+          LSL->GetOperand(2)->IsImmediate() &&
+          !LSL->GetOperand(2)->IsFPImmediate()) {
+        Shift = LSL->GetOperand(2)->GetImmediate();
+        IndexPos = Defs[Index->GetReg()].second;
+        Index = LSL->GetOperand(1);
+        Folded.push_back(LSL);
+      }
+    }
+
+    // The extension of a 32 bit index to the pointer size
+    for (unsigned ExtOpcode :
+         {MachineInstruction::SEXT, MachineInstruction::ZEXT})
+      if (auto EXT = GetFoldableDef(Index->GetReg(), ExtOpcode);
+          EXT && EXT->GetOperand(1)->IsVirtualReg() &&
+          EXT->GetOperand(1)->GetSize() == 32) {
+        Extend = ExtOpcode;
+        IndexPos = Defs[Index->GetReg()].second;
+        Index = EXT->GetOperand(1);
+        Folded.push_back(EXT);
+        break;
+      }
+
+    if (!IsNotRedefinedAfter(&Base, ADDPos) ||
+        !IsNotRedefinedAfter(Index, IndexPos))
+      continue;
+
+    if (Mem->GetOffset() == 0 &&
+        TM->SelectIndexedLoadStore(MI, Base, *Index, Shift, Extend)) {
+      // The constant scale is dead as well if the multiplication was its only
+      // user
+      if (ScaleDef && --VRegOccurrences[ScaleDef->GetOperand(0)->GetReg()] == 1)
+        Folded.push_back(ScaleDef);
+
+      for (auto FoldedMI : Folded) {
+        const auto Reg = FoldedMI->GetOperand(0)->GetReg();
+        VRegOccurrences[Reg] = 0;
+        Defs.erase(Reg);
+        FoldedMI->GetParent()->Erase(FoldedMI);
+      }
+      return true;
+    }
+
+    // Without a suitable addressing mode, at least a constant addend of the
+    // index can be moved into the offset, like base + (i + 1) * 4 to
+    // (base + i * 4) + 4. Zero extension would not preserve the wrap around
+    // of the unsigned index.
+    auto Addend = GetFoldableDef(Index->GetReg(), MachineInstruction::ADD);
+    if (!Addend || Extend == MachineInstruction::ZEXT ||
+        !Addend->GetOperand(1)->IsVirtualReg() ||
+        !Addend->GetOperand(2)->IsImmediate() ||
+        Addend->GetOperand(2)->IsFPImmediate())
+      continue;
+
+    const unsigned AddendPos = Defs[Index->GetReg()].second;
+    const int64_t NewOffset = Mem->GetOffset() +
+                              (Addend->GetOperand(2)->GetImmediate() << Shift);
+    if (!TM->IsValidMemoryOffset(NewOffset) ||
+        !IsNotRedefinedAfter(Addend->GetOperand(1), AddendPos))
+      continue;
+
+    VRegOccurrences[Index->GetReg()] = 0;
+    Defs.erase(Index->GetReg());
+    Index->SetReg(Addend->GetOperand(1)->GetReg());
+    Mem->SetOffset(NewOffset);
+    Addend->GetParent()->Erase(Addend);
+    return true;
+  }
+
+  return false;
+}
+
+bool InsturctionSelection::FoldStackAddress(MachineInstruction *MI) {
+  const bool IsLoad = MI->GetOpcode() == MachineInstruction::LOAD;
+  if (MI->GetOperandsNumber() != 2 || HasVectorOperand(MI))
+    return false;
+
+  auto Mem = MI->GetOperand(IsLoad ? 1 : 0);
+  if (!Mem->IsMemory() || !Mem->IsVirtual() || !Defs.count(Mem->GetReg()))
+    return false;
+
+  const unsigned Reg = Mem->GetReg();
+  auto [Def, Pos] = Defs[Reg];
+  if (Def->GetOpcode() != MachineInstruction::STACK_ADDRESS ||
+      LastDefPos[Reg] != Pos)
+    return false;
+
+  // The offset from the stack pointer is only known after the register
+  // allocation, so every position in the frame must be encodable
+  auto MFunc = MI->GetParent()->GetParent();
+  auto Slot = *Def->GetOperand(1);
+  Slot.SetOffset(Slot.GetOffset() + Mem->GetOffset());
+  if (!TM->IsValidMemoryOffset(MFunc->GetStackFrameSize() + Slot.GetOffset()))
+    return false;
+
+  MI->ReplaceOperand(Slot, IsLoad ? 1 : 0);
+  if (--VRegOccurrences[Reg] == 1) {
+    VRegOccurrences[Reg] = 0;
+    Defs.erase(Reg);
+    Def->GetParent()->Erase(Def);
+  }
+  return true;
+}
+
+void InsturctionSelection::FoldAddressingModes(MachineFunction &MFunc) {
+  CountVRegOccurrences(MFunc);
+
+  for (auto &MBB : MFunc.GetBasicBlocks()) {
+    Defs.clear();
+    LastDefPos.clear();
+    unsigned Pos = 0;
+
+    for (auto &MI : MBB.GetInstructions()) {
+      if (MI.GetOpcode() == MachineInstruction::LOAD ||
+          MI.GetOpcode() == MachineInstruction::STORE)
+        FoldStackAddress(&MI) || FoldAddressingMode(&MI);
+
+      if (MI.GetOperandsNumber() > 0 && MI.GetOperand(0)->IsVirtualReg()) {
+        auto Reg = MI.GetOperand(0)->GetReg();
+        LastDefPos[Reg] = Pos;
+        if (!MI.IsAlreadySelected() && MI.GetDef())
+          Defs[Reg] = {&MI, Pos};
+      }
+      Pos++;
+    }
+  }
+}
+
+void InsturctionSelection::FuseCompareAndBranch(MachineFunction &MFunc) {
+  for (auto &MBB : MFunc.GetBasicBlocks())
+    for (auto &MI : MBB.GetInstructions()) {
+      if (MI.GetOpcode() != MachineInstruction::BRANCH ||
+          !MI.IsFallThroughBranch() || !MI.GetOperand(0)->IsVirtualReg())
+        continue;
+
+      auto CMP = MI.GetPrevNode();
+      if (CMP == nullptr || CMP->GetOpcode() != MachineInstruction::CMP ||
+          CMP->GetOperand(0)->GetReg() != MI.GetOperand(0)->GetReg())
+        continue;
+
+      if (TM->SelectCMPAndBRANCH(CMP, &MI) && !CMP->IsAlreadySelected())
+        MBB.Erase(CMP);
+    }
+}
 
 void InsturctionSelection::InstrSelect() {
   for (auto &MFunc : MIRM->GetFunctions()) {
+    FuseCompareAndBranch(MFunc);
+    FoldAddressingModes(MFunc);
+    MatchPatterns(MFunc);
+
     for (auto &MBB : MFunc.GetBasicBlocks())
-      for (size_t i = 0; i < MBB.GetInstructions().size(); i++)
+      for (auto &MI : MBB.GetInstructions())
         // Skip selection if already selected
-        if (!MBB.GetInstructions()[i].IsAlreadySelected()) {
-          TM->SelectInstruction(&MBB.GetInstructions()[i]);
-          assert(MBB.GetInstructions()[i].IsAlreadySelected());
+        if (!MI.IsAlreadySelected()) {
+          TM->SelectInstruction(&MI);
+          assert(MI.IsAlreadySelected());
         }
   }
 }
@@ -5,6 +5,7 @@
 #include "../middle_end/IR/Module.hpp"
 #include "MachineIRModule.hpp"
 #include "TargetMachine.hpp"
+#include <map>
 
 class InsturctionSelection {
 public:
@@ -14,8 +15,55 @@ public:
   void InstrSelect();
 
 private:
+  /// Let the target select each conditional branch of @MFunc together with
+  /// the compare right before it computing its condition.
+  void FuseCompareAndBranch(MachineFunction &MFunc);
+
+  /// Fold instruction pairs of @MFunc into single instructions using the
+  /// target's selection patterns.
+  void MatchPatterns(MachineFunction &MFunc);
+
+  /// Fold the address computations of the loads and stores of @MFunc into
+  /// their addressing mode, if the target supports it.
+  void FoldAddressingModes(MachineFunction &MFunc);
+
+  /// Try to select @MI, a load or store, with the address Base + (Index <<
+  /// Shift), where the index might be an extended 32 bit value. Otherwise if
+  /// the index has a constant addend, then move that into the offset of the
+  /// memory operand.
+  bool FoldAddressingMode(MachineInstruction *MI);
+
+  /// Replace the address of @MI by the stack slot access it is computed from,
+  /// so the stack pointer becomes the base. The computation is removed once
+  /// all of its uses are folded.
+  bool FoldStackAddress(MachineInstruction *MI);
+
+  /// Return the instruction of the current basic block defining @Reg, if it
+  /// is an unselected @Opcode and its result is only used once.
+  MachineInstruction *GetFoldableDef(unsigned Reg, unsigned Opcode);
+
+  /// Return true if @MO, read by the instruction at @Pos, is not redefined
+  /// later in the current basic block.
+  bool IsNotRedefinedAfter(MachineOperand *MO, unsigned Pos);
+
+  void CountVRegOccurrences(MachineFunction &MFunc);
+
+  /// Try to match @P with @MI as its root. @Inner is the instruction defining
+  /// the folded operand and @InnerPos is its position in the basic block.
+  bool MatchPattern(const SelectionPattern &P, MachineInstruction *MI,
+                    MachineInstruction *Inner, unsigned InnerPos);
+
   MachineIRModule *MIRM;
   TargetMachine *TM;
+
+  /// Number of occurrences of the virtual registers in the current function
+  std::map<unsigned, unsigned> VRegOccurrences;
+  /// Position of the last instruction in the current basic block which
+  /// defined the given virtual register
+  std::map<unsigned, unsigned> LastDefPos;
+  /// The not yet selected instructions of the current basic block defining
+  /// a virtual register, with their position
+  std::map<unsigned, std::pair<MachineInstruction *, unsigned>> Defs;
 };
 
 #endif
@@ -0,0 +1,281 @@
+#ifndef INTRUSIVE_LIST_HPP
+#define INTRUSIVE_LIST_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+template <typename T, size_t SlabSize> class IntrusiveList;
+
+/// Base class for the elements of an IntrusiveList. The links belong to the
+/// list, not to the value, so copying an element never copies its position
+/// and assigning to an element already in a list keeps it in place.
+template <typename T> class IntrusiveListNode {
+public:
+  IntrusiveListNode() = default;
+  IntrusiveListNode(const IntrusiveListNode &) {}
+  IntrusiveListNode &operator=(const IntrusiveListNode &) { return *this; }
+
+  T *GetPrevNode() const { return Prev; }
+  T *GetNextNode() const { return Next; }
+
+private:
+  template <typename, size_t> friend class IntrusiveList;
+
+  T *Prev = nullptr;
+  T *Next = nullptr;
+};
+
+/// Doubly linked list of T objects which are allocated from a slab pool owned
+/// by the list. Insertion and erasure are O(1) and never move other elements,
+/// so pointers and iterators to them stay valid until they are erased.
+/// Erased slots are recycled by later insertions.
+template <typename T, size_t SlabSize = 64> class IntrusiveList {
+  using Node = IntrusiveListNode<T>;
+  using Slot = std::aligned_storage_t<sizeof(T), alignof(T)>;
+
+  template <bool IsConst> class Iterator {
+    using ListPtr =
+        std::conditional_t<IsConst, const IntrusiveList *, IntrusiveList *>;
+
+  public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<IsConst, const T *, T *>;
+    using reference = std::conditional_t<IsConst, const T &, T &>;
+
+    Iterator() = default;
+    Iterator(T *N, ListPtr L) : Current(N), List(L) {}
+    /// Allow iterator -> const_iterator conversion
+    template <bool C = IsConst, typename = std::enable_if_t<C>>
+    Iterator(const Iterator<false> &It) : Current(It.Current), List(It.List) {}
+
+    reference operator*() const { return *Current; }
+    pointer operator->() const { return Current; }
+
+    Iterator &operator++() {
+      Current = static_cast<Node *>(Current)->Next;
+      return *this;
+    }
+    Iterator operator++(int) {
+      auto Tmp = *this;
+      ++*this;
+      return Tmp;
+    }
+    /// Decrementing end() yields the last element
+    Iterator &operator--() {
+      Current =
+          Current ? static_cast<Node *>(Current)->Prev : List->Tail;
+      return *this;
+    }
+    Iterator operator--(int) {
+      auto Tmp = *this;
+      --*this;
+      return Tmp;
+    }
+
+    bool operator==(const Iterator &Other) const {
+      return Current == Other.Current;
+    }
+    bool operator!=(const Iterator &Other) const {
+      return Current != Other.Current;
+    }
+
+  private:
+    friend class IntrusiveList;
+    friend class Iterator<!IsConst>;
+
+    T *Current = nullptr;
+    ListPtr List = nullptr;
+  };
+
+public:
+  using value_type = T;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  IntrusiveList() = default;
+  IntrusiveList(const IntrusiveList &Other) {
+    for (auto &E : Other)
+      push_back(E);
+  }
+  IntrusiveList(IntrusiveList &&Other) noexcept { Steal(Other); }
+  IntrusiveList &operator=(const IntrusiveList &Other) {
+    if (this != &Other) {
+      clear();
+      for (auto &E : Other)
+        push_back(E);
+    }
+    return *this;
+  }
+  IntrusiveList &operator=(IntrusiveList &&Other) noexcept {
+    if (this != &Other) {
+      clear();
+      Steal(Other);
+    }
+    return *this;
+  }
+  ~IntrusiveList() { clear(); }
+
+  iterator begin() { return iterator(Head, this); }
+  iterator end() { return iterator(nullptr, this); }
+  const_iterator begin() const { return const_iterator(Head, this); }
+  const_iterator end() const { return const_iterator(nullptr, this); }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+
+  size_t size() const { return Size; }
+  bool empty() const { return Size == 0; }
+
+  T &front() {
+    assert(Head && "List is empty");
+    return *Head;
+  }
+  T &back() {
+    assert(Tail && "List is empty");
+    return *Tail;
+  }
+  const T &front() const {
+    assert(Head && "List is empty");
+    return *Head;
+  }
+  const T &back() const {
+    assert(Tail && "List is empty");
+    return *Tail;
+  }
+
+  /// Return the iterator pointing to @E, which must be an element of this list.
+  iterator GetIterator(T *E) { return iterator(E, this); }
+
+  /// Insert a copy of @Value before @Pos and return an iterator to it.
+  iterator insert(iterator Pos, T Value) {
+    T *New = Allocate(std::move(Value));
+    Link(New, Pos.Current);
+    return iterator(New, this);
+  }
+
+  void push_back(T Value) { insert(end(), std::move(Value)); }
+  void push_front(T Value) { insert(begin(), std::move(Value)); }
+
+  /// Remove the element at @Pos and return an iterator to the following one.
+  iterator erase(iterator Pos) {
+    assert(Pos.Current && "Cannot erase end()");
+    T *E = Pos.Current;
+    T *Next = static_cast<Node *>(E)->Next;
+    Unlink(E);
+    Deallocate(E);
+    return iterator(Next, this);
+  }
+
+  iterator erase(iterator First, iterator Last) {
+    while (First != Last)
+      First = erase(First);
+    return Last;
+  }
+
+  void clear() {
+    for (T *E = Head; E;) {
+      T *Next = static_cast<Node *>(E)->Next;
+      E->~T();
+      E = Next;
+    }
+    Head = Tail = nullptr;
+    Size = 0;
+    Slabs.clear();
+    FreeSlots.clear();
+    NextFreeInSlab = SlabSize;
+  }
+
+private:
+  void Steal(IntrusiveList &Other) {
+    Head = Other.Head;
+    Tail = Other.Tail;
+    Size = Other.Size;
+    Slabs = std::move(Other.Slabs);
+    FreeSlots = std::move(Other.FreeSlots);
+    NextFreeInSlab = Other.NextFreeInSlab;
+    Other.Head = Other.Tail = nullptr;
+    Other.Size = 0;
+    Other.Slabs.clear();
+    Other.FreeSlots.clear();
+    Other.NextFreeInSlab = SlabSize;
+  }
+
+  T *Allocate(T &&Value) {
+    void *Mem;
+    if (!FreeSlots.empty()) {
+      Mem = FreeSlots.back();
+      FreeSlots.pop_back();
+    } else {
+      if (NextFreeInSlab == SlabSize) {
+        Slabs.push_back(std::make_unique<Slot[]>(SlabSize));
+        NextFreeInSlab = 0;
+      }
+      Mem = &Slabs.back()[NextFreeInSlab++];
+    }
+    return new (Mem) T(std::move(Value));
+  }
+
+  void Deallocate(T *E) {
+    E->~T();
+    FreeSlots.push_back(E);
+  }
+
+  /// Link @E before @Before, or to the end if @Before is null.
+  void Link(T *E, T *Before) {
+    Node *N = E;
+    N->Next = Before;
+    N->Prev = Before ? static_cast<Node *>(Before)->Prev : Tail;
+
+    if (N->Prev)
+      static_cast<Node *>(N->Prev)->Next = E;
+    else
+      Head = E;
+
+    if (Before)
+      static_cast<Node *>(Before)->Prev = E;
+    else
+      Tail = E;
+
+    Size++;
+  }
+
+  void Unlink(T *E) {
+    Node *N = E;
+    if (N->Prev)
+      static_cast<Node *>(N->Prev)->Next = N->Next;
+    else
+      Head = N->Next;
+
+    if (N->Next)
+      static_cast<Node *>(N->Next)->Prev = N->Prev;
+    else
+      Tail = N->Prev;
+
+    N->Prev = N->Next = nullptr;
+    Size--;
+  }
+
+  T *Head = nullptr;
+  T *Tail = nullptr;
+  size_t Size = 0;
+
+  std::vector<std::unique_ptr<Slot[]>> Slabs;
+  std::vector<void *> FreeSlots;
+  size_t NextFreeInSlab = SlabSize;
+};
+
+#endif // INTRUSIVE_LIST_HPP
@@ -59,9 +59,7 @@ static void CopyPropagation(MachineBasicBlock &MBB) {
   std::map<uint64_t, uint64_t> Renamables;
   std::map<uint64_t, uint64_t> KnownMemoryValues; // stack slot to vreg
 
-  for (int i = 0; i < (int)InstList.size(); i++) {
-    auto Instr = InstList[i];
-
+  for (auto &Instr : InstList) {
     // call -s will clobber registers, so anything defined before a call will
     // might be invalid.
     if (Instr.IsCall()) {
@@ -124,9 +122,7 @@ static void CSE(MachineBasicBlock &MBB) {
   std::map<uint64_t, uint64_t> Renamables;
   AliveDefinitions AliveDefs;
 
-  for (int i = 0; i < (int)InstList.size(); i++) {
-    auto Instr = InstList[i];
-
+  for (auto &Instr : InstList) {
     // Nothing to do with stack allocations or jumps. Also it is assumed, that
     // copy propagation was already done before this pass, therefore loads can
     // also be ignored.
@@ -148,7 +144,7 @@ static void CSE(MachineBasicBlock &MBB) {
       Renamables[Instr.GetDef()->GetReg()] = ACE->GetReg();
     } else {
       // Otherwise it is a newly defined expression/value, so register it
-      AliveDefs.InsertDef(&InstList[i]);
+      AliveDefs.InsertDef(&Instr);
     }
   }
 
@@ -160,13 +156,15 @@ static void DeadCodeElimination(MachineBasicBlock &MBB) {
   auto &Instructions = MBB.GetInstructions();
   std::set<uint64_t> UsedValues;
 
-  for (int i = Instructions.size() - 1; i >= 0; i--) {
-    if (auto Use1 = Instructions[i].GetNthUse(0);
+  for (auto It = Instructions.rbegin(); It != Instructions.rend();) {
+    auto &Instr = *It;
+
+    if (auto Use1 = Instr.GetNthUse(0);
         Use1 &&
         (Use1->IsVirtualReg() || (Use1->IsMemory() && Use1->IsVirtual())))
       UsedValues.insert(Use1->GetReg());
 
-    if (auto Use2 = Instructions[i].GetNthUse(1);
+    if (auto Use2 = Instr.GetNthUse(1);
         Use2 &&
         (Use2->IsVirtualReg() || (Use2->IsMemory() && Use2->IsVirtual())))
       UsedValues.insert(Use2->GetReg());
@@ -174,14 +172,17 @@ static void DeadCodeElimination(MachineBasicBlock &MBB) {
     // if an instruction does not define a value then it considered alive
     // also calls too and skip instructions which already has allocated def regs
     // these typically are instructions that preparing the parameters for a call
-    if (!Instructions[i].IsDef() || Instructions[i].IsCall() ||
-        Instructions[i].GetDef()->IsRegister())
+    if (!Instr.IsDef() || Instr.IsCall() || Instr.GetDef()->IsRegister()) {
+      It++;
       continue;
+    }
 
     // If the instruction result has no uses after it (note: iteration is bottom
     // up) then it's defined value is dead, mark it for termination.
-    if (UsedValues.count(Instructions[i].GetDef()->GetReg()) == 0)
-      Instructions.erase(Instructions.begin() + i);
+    if (UsedValues.count(Instr.GetDef()->GetReg()) == 0)
+      It = std::make_reverse_iterator(Instructions.erase(std::next(It).base()));
+    else
+      It++;
   }
 }
 
@@ -10,6 +10,7 @@ public:
     INVALID,
     POINTER,
     SCALAR,
+    VECTOR,
   };
 
   LowLevelType() : Type(INVALID) {}
@@ -30,9 +31,20 @@ public:
     return LLT;
   }
 
+  /// Create a vector of @Lanes elements, each @ElemBitWidth wide.
+  static LowLevelType CreateVector(unsigned Lanes, unsigned ElemBitWidth) {
+    LowLevelType LLT(VECTOR);
+    LLT.SetBitWidth(Lanes * ElemBitWidth);
+    LLT.Lanes = Lanes;
+    return LLT;
+  }
+
   bool IsValid() const { return Type != INVALID; }
   bool IsScalar() const { return Type == SCALAR; }
   bool IsPointer() const { return Type == POINTER; }
+  bool IsVector() const { return Type == VECTOR; }
+
+  unsigned GetLanes() const { return Lanes; }
 
   std::string ToString() const {
     std::string str;
@@ -41,6 +53,9 @@ public:
       str = "s";
     else if (Type == POINTER)
       str = "p";
+    else if (Type == VECTOR)
+      return "v" + std::to_string(Lanes) + "s" +
+             std::to_string(BitWidth / Lanes);
     else
       assert(!"Invalid type");
 
@@ -52,6 +67,7 @@ public:
 private:
   unsigned Type = INVALID;
   unsigned BitWidth;
+  unsigned Lanes = 1;
 };
 
 #endif
@@ -2,132 +2,86 @@
 #include "MachineInstruction.hpp"
 #include <cassert>
 #include <iostream>
+#include <iterator>
 #include <string>
 #include <vector>
 
 void MachineBasicBlock::InsertInstr(MachineInstruction MI) {
   if (MI.GetParent() == nullptr)
     MI.SetParent(this);
-  Instructions.push_back(MI);
-}
-
-MachineBasicBlock::InstructionList::iterator
-MachineBasicBlock::InsertInstr(MachineInstruction MI, size_t Pos) {
-  if (MI.GetParent() == nullptr)
-    MI.SetParent(this);
-  return Instructions.insert(Instructions.begin() + Pos, MI);
+  Instructions.push_back(std::move(MI));
 }
 
 MachineBasicBlock::InstructionList::iterator
 MachineBasicBlock::InsertInstrToFront(MachineInstruction MI) {
   if (MI.GetParent() == nullptr)
     MI.SetParent(this);
-  return Instructions.insert(Instructions.begin(), MI);
+  return Instructions.insert(Instructions.begin(), std::move(MI));
 }
 
 MachineBasicBlock::InstructionList::iterator
 MachineBasicBlock::InsertBefore(MachineInstruction MI,
                                 MachineInstruction *BeforeMI) {
-  size_t i = 0;
-  for (; i < Instructions.size(); i++)
-    if (&Instructions[i] == BeforeMI)
-      break;
-
-  assert(i < Instructions.size() && "Instruction not found in the list");
+  assert(BeforeMI && "Instruction not found in the list");
 
-  return InsertInstr(MI, i);
+  if (MI.GetParent() == nullptr)
+    MI.SetParent(this);
+  return Instructions.insert(Instructions.GetIterator(BeforeMI), std::move(MI));
 }
 
 MachineBasicBlock::InstructionList::iterator
 MachineBasicBlock::InsertBefore(std::vector<MachineInstruction> MIs,
                                 MachineInstruction *BeforeMI) {
-  size_t i = 0;
-  for (; i < Instructions.size(); i++)
-    if (&Instructions[i] == BeforeMI)
-      break;
-
-  assert(i < Instructions.size() && "Instruction not found in the list");
-
   for (auto &MI : MIs)
-    InsertInstr(MI, i++);
+    InsertBefore(std::move(MI), BeforeMI);
 
-  return Instructions.begin() + i;
+  return Instructions.GetIterator(BeforeMI);
 }
 
 MachineBasicBlock::InstructionList::iterator
 MachineBasicBlock::InsertAfter(MachineInstruction MI,
                                MachineInstruction *AfterMI) {
-  size_t i = 0;
-  for (; i < Instructions.size(); i++)
-    if (&Instructions[i] == AfterMI)
-      break;
-
-  assert(i < Instructions.size() && "Instruction not found in the list");
+  assert(AfterMI && "Instruction not found in the list");
 
-  return InsertInstr(MI, i + 1);
+  if (MI.GetParent() == nullptr)
+    MI.SetParent(this);
+  return Instructions.insert(std::next(Instructions.GetIterator(AfterMI)),
+                             std::move(MI));
 }
 
 MachineBasicBlock::InstructionList::iterator
 MachineBasicBlock::InsertAfter(std::vector<MachineInstruction> MIs,
-                               MachineInstruction *BeforeMI) {
-  size_t i = 0;
-  for (; i < Instructions.size(); i++)
-    if (&Instructions[i] == BeforeMI)
-      break;
-
-  assert(i < Instructions.size() && "Instruction not found in the list");
+                               MachineInstruction *AfterMI) {
+  auto InsertedLast = Instructions.GetIterator(AfterMI);
 
   for (auto &MI : MIs)
-    InsertInstr(MI, 1 + i++);
+    InsertedLast = InsertAfter(std::move(MI), &*InsertedLast);
 
-  return Instructions.begin() + i;
+  return InsertedLast;
 }
 
 MachineBasicBlock::InstructionList::iterator
 MachineBasicBlock::ReplaceInstr(MachineInstruction MI,
                                 MachineInstruction *Replacable) {
-  size_t i = 0;
-  for (; i < Instructions.size(); i++) {
-    auto Ptr = &Instructions[i];
-    if (Ptr == Replacable) {
-      Instructions[i] = std::move(MI);
-      return Instructions.begin() + i;
-      break;
-    }
-  }
-  assert(!"Replacable instruction was not found");
-  return Instructions.end();
+  assert(Replacable && "Replacable instruction was not found");
+
+  if (MI.GetParent() == nullptr)
+    MI.SetParent(this);
+  *Replacable = std::move(MI);
+  return Instructions.GetIterator(Replacable);
 }
 
 MachineInstruction *MachineBasicBlock::GetPrecedingInstr(MachineInstruction *MI) {
-  size_t Counter = 0;
-  for (; Counter < Instructions.size(); Counter++) {
-    auto Ptr = &Instructions[Counter];
-    if (Ptr == MI) {
-      if (Counter == 0) break;
-      return &Instructions[Counter - 1];
-    }
-  }
-  return nullptr;
+  return MI->GetPrevNode();
 }
 
 MachineInstruction *MachineBasicBlock::GetNextInstr(MachineInstruction *MI) {
-  size_t Counter = 0;
-  for (; Counter < Instructions.size() - 1; Counter++) {
-    auto Ptr = &Instructions[Counter];
-    if (Ptr == MI)
-      return &Instructions[Counter + 1];
-  }
-  return nullptr;
+  return MI->GetNextNode();
 }
 
-void MachineBasicBlock::Erase(MachineInstruction *MI) {
-  size_t i = 0;
-  for (; i < Instructions.size(); i++)
-    if (&Instructions[i] == MI) {
-      Instructions.erase(Instructions.begin() + i);
-      break;;
-    }
+MachineBasicBlock::InstructionList::iterator
+MachineBasicBlock::Erase(MachineInstruction *MI) {
+  return Instructions.erase(Instructions.GetIterator(MI));
 }
 
 void MachineBasicBlock::Print(TargetMachine *TM) const {
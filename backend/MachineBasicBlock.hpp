@@ -1,7 +1,9 @@
 #ifndef MACHINEBASICBLOCK_HPP
 #define MACHINEBASICBLOCK_HPP
 
+#include "IntrusiveList.hpp"
 #include "MachineInstruction.hpp"
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -10,7 +12,9 @@ class TargetMachine;
 
 class MachineBasicBlock {
 public:
-  using InstructionList = std::vector<MachineInstruction>;
+  /// Instructions are pool allocated and linked into an intrusive list, so
+  /// inserting or erasing does not invalidate pointers to other instructions.
+  using InstructionList = IntrusiveList<MachineInstruction>;
 
   MachineBasicBlock() = default;
   MachineBasicBlock(std::string &Name) : Name(Name) {}
@@ -21,41 +25,47 @@ public:
   InstructionList &GetInstructions() { return Instructions; }
   MachineFunction *GetParent() { return Parent; }
 
+  /// The execution count of the block in the profiled run, if it is known.
+  std::optional<uint64_t> GetCount() const { return Count; }
+  void SetCount(std::optional<uint64_t> C) { Count = C; }
+
+  /// The address of the block is aligned to 2^Alignment bytes.
+  unsigned GetAlignment() const { return Alignment; }
+  void SetAlignment(unsigned A) { Alignment = A; }
+
   /// Insert MI into back of the InstructionList
   void InsertInstr(MachineInstruction MI);
 
-  /// Insert MI into InstructionList at Pos position
-  InstructionList::iterator InsertInstr(MachineInstruction MI, size_t Pos);
-
   InstructionList::iterator InsertInstrToFront(MachineInstruction MI);
 
-  /// Find where BeforeMI is in the InstructionList and insert MI before it
+  /// Insert MI before BeforeMI and return an iterator to the new instruction
   InstructionList::iterator InsertBefore(MachineInstruction MI,
                                         MachineInstruction *BeforeMI);
 
-  /// Find where BeforeMI is in the InstructionList and insert MIs before it
+  /// Insert MIs before BeforeMI and return an iterator to BeforeMI
   InstructionList::iterator InsertBefore(std::vector<MachineInstruction> MIs,
                                          MachineInstruction *BeforeMI);
 
-  /// Find where AfterMI is in the InstructionList and insert MI after it
+  /// Insert MI after AfterMI and return an iterator to the new instruction
   InstructionList::iterator InsertAfter(MachineInstruction MI,
                                         MachineInstruction *AfterMI);
 
-  /// Find where AfterMI is in the InstructionList and insert MIs after it
+  /// Insert MIs after AfterMI and return an iterator to the last inserted one
   InstructionList::iterator InsertAfter(std::vector<MachineInstruction> MIs,
                                         MachineInstruction *AfterMI);
 
-  /// Find where Replacable is in the InstructionList and replace it with MI
+  /// Replace Replacable in place with MI. Pointers to it remain valid.
   InstructionList::iterator ReplaceInstr(MachineInstruction MI,
                                          MachineInstruction *Replacable);
 
-  /// Return the instruction before MI
+  /// Return the instruction before MI or nullptr if MI is the first one
   MachineInstruction *GetPrecedingInstr(MachineInstruction *MI);
 
-  /// Return the instruction after MI
+  /// Return the instruction after MI or nullptr if MI is the last one
   MachineInstruction *GetNextInstr(MachineInstruction *MI);
 
-  void Erase(MachineInstruction *MI);
+  /// Remove MI and return an iterator to the instruction after it
+  InstructionList::iterator Erase(MachineInstruction *MI);
 
   void Print(TargetMachine *TM) const;
 
@@ -63,6 +73,8 @@ private:
   std::string Name;
   InstructionList Instructions;
   MachineFunction *Parent = nullptr;
+  std::optional<uint64_t> Count;
+  unsigned Alignment = 0;
 };
 
 #endif
@@ -1,8 +1,10 @@
 #include "MachineFunction.hpp"
 #include "MachineBasicBlock.hpp"
+#include "TargetInstruction.hpp"
+#include "TargetMachine.hpp"
+#include <algorithm>
 #include <iostream>
-
-class TargetMachine;
+#include <map>
 
 unsigned MachineFunction::GetNextAvailableVReg() {
   // If this function was called the first time then here the highest virtual
@@ -22,6 +24,67 @@ unsigned MachineFunction::GetNextAvailableVReg() {
   return NextVReg++;
 }
 
+static bool IsBranch(MachineInstruction &MI, TargetMachine *TM) {
+  if (MI.IsAlreadySelected())
+    return TM->GetInstrDefs()->GetTargetInstr(MI.GetOpcode())->IsBranch();
+
+  const auto Opcode = MI.GetOpcode();
+  return Opcode == MachineInstruction::JUMP ||
+         Opcode == MachineInstruction::BRANCH ||
+         Opcode == MachineInstruction::INDIRECT_JUMP;
+}
+
+static bool IsReturn(MachineInstruction &MI, TargetMachine *TM) {
+  if (MI.IsAlreadySelected())
+    return TM->GetInstrDefs()->GetTargetInstr(MI.GetOpcode())->IsReturn();
+
+  return MI.IsReturn();
+}
+
+std::vector<std::vector<unsigned>>
+MachineFunction::GetSuccessors(TargetMachine *TM) {
+  std::map<std::string, unsigned> BBIndices;
+  for (size_t i = 0; i < BasicBlocks.size(); i++)
+    BBIndices[BasicBlocks[i].GetName()] = i;
+
+  std::vector<std::vector<unsigned>> Successors(BasicBlocks.size());
+  for (size_t i = 0; i < BasicBlocks.size(); i++) {
+    auto &Succs = Successors[i];
+    auto AddSuccessor = [&Succs](unsigned Idx) {
+      if (std::find(Succs.begin(), Succs.end(), Idx) == Succs.end())
+        Succs.push_back(Idx);
+    };
+
+    auto &Instrs = BasicBlocks[i].GetInstructions();
+    for (auto &MI : Instrs) {
+      if (!IsBranch(MI, TM))
+        continue;
+
+      bool HasLabel = false;
+      for (auto &MO : MI.GetOperands())
+        if (MO.IsLabel() && BBIndices.count(MO.GetLabel())) {
+          AddSuccessor(BBIndices[MO.GetLabel()]);
+          HasLabel = true;
+        }
+
+      // The targets of indirect jumps are not known, so any block might be
+      if (!HasLabel)
+        for (size_t j = 0; j < BasicBlocks.size(); j++)
+          AddSuccessor(j);
+    }
+
+    // Jumps keep the attribute of the LLIR jump after the selection, other
+    // branches might be conditional
+    const bool FallsThrough =
+        Instrs.empty() ||
+        (!Instrs.back().IsJump() && !IsReturn(Instrs.back(), TM));
+    if (i + 1 < BasicBlocks.size() && FallsThrough)
+      AddSuccessor(i + 1);
+  }
+
+  return Successors;
+}
+
 void MachineFunction::Print(TargetMachine *TM) const {
   std::cout << "function:" << Name << std::endl;
   std::cout << "\tStackFrame:" << std::endl;
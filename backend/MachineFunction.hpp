@@ -7,6 +7,7 @@
 #include <vector>
 
 class Function;
+class TargetMachine;
 
 class MachineFunction {
   using BasicBlockList = std::vector<MachineBasicBlock>;
@@ -49,12 +50,19 @@ public:
   unsigned GetStackFrameSize() { return SF.GetSize(); }
   unsigned GetStackObjectPosition(unsigned ID) { return SF.GetPosition(ID); }
   unsigned GetStackObjectSize(unsigned ID) { return SF.GetSize(ID); }
+  unsigned GetStackObjectAlign(unsigned ID) { return SF.GetAlign(ID); }
 
   bool IsStackSlot(unsigned ID) { return SF.IsStackSlot(ID); }
 
   /// Get the next available virtual register.
   unsigned GetNextAvailableVReg();
 
+  /// Return the indices of the successor blocks of each basic block. A block
+  /// falls through to the next one, unless it ends with a jump or a return.
+  /// Indirect jumps might branch to any block. Works both on LLIR and on
+  /// selected instructions.
+  std::vector<std::vector<unsigned>> GetSuccessors(TargetMachine *TM);
+
   void SetToCaller() { HasCall = true; }
   bool IsCaller() const { return HasCall; }
 
@@ -20,6 +20,10 @@ void MachineInstruction::UpdateAttributes() {
   case CALL:
     AddAttribute(IS_CALL);
     break;
+  case TAIL_CALL:
+    AddAttribute(IS_CALL);
+    AddAttribute(IS_RETURN);
+    break;
   default:
     break;
   }
@@ -133,9 +137,15 @@ void MachineInstruction::Print(TargetMachine *TM) const {
   case BRANCH:
     OpcodeStr = "BRANCH";
     break;
+  case INDIRECT_JUMP:
+    OpcodeStr = "INDIRECT_JUMP";
+    break;
   case CALL:
     OpcodeStr = "CALL";
     break;
+  case TAIL_CALL:
+    OpcodeStr = "TAIL_CALL";
+    break;
   case RET:
     OpcodeStr = "RET";
     break;
@@ -148,12 +158,45 @@ void MachineInstruction::Print(TargetMachine *TM) const {
   case MULHU:
     OpcodeStr = "MULHU";
     break;
+  case MULHS:
+    OpcodeStr = "MULHS";
+    break;
+  case ASR:
+    OpcodeStr = "ASR";
+    break;
   case MERGE:
     OpcodeStr = "MERGE";
     break;
   case SPLIT:
     OpcodeStr = "SPLIT";
     break;
+  case SPLAT:
+    OpcodeStr = "SPLAT";
+    break;
+  case REDUCE_ADD:
+    OpcodeStr = "REDUCE_ADD";
+    break;
+  case ROTR:
+    OpcodeStr = "ROTR";
+    break;
+  case CLZ:
+    OpcodeStr = "CLZ";
+    break;
+  case CTZ:
+    OpcodeStr = "CTZ";
+    break;
+  case POPCOUNT:
+    OpcodeStr = "POPCOUNT";
+    break;
+  case BSWAP:
+    OpcodeStr = "BSWAP";
+    break;
+  case CRC32:
+    OpcodeStr = "CRC32";
+    break;
+  case SELECT:
+    OpcodeStr = "SELECT";
+    break;
   case INVALID_OP:
     OpcodeStr = "INVALID_OP";
     break;
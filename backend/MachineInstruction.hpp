@@ -1,6 +1,7 @@
 #ifndef MACHINEINSTRUCTION_HPP
 #define MACHINEINSTRUCTION_HPP
 
+#include "IntrusiveList.hpp"
 #include "MachineOperand.hpp"
 #include <cassert>
 #include <iostream>
@@ -9,7 +10,7 @@
 class MachineBasicBlock;
 class TargetMachine;
 
-class MachineInstruction {
+class MachineInstruction : public IntrusiveListNode<MachineInstruction> {
   using OperandList = std::vector<MachineOperand>;
 
 public:
@@ -50,6 +51,7 @@ public:
     JUMP,
     BRANCH,
     RET,
+    INDIRECT_JUMP,
 
     // Moves and constant materializations
     LOAD_IMM,
@@ -71,8 +73,26 @@ public:
     ADDS, // Add with carry set
     ADDC, // Add with carry
     MULHU, // Mul unsigned return upper part 
+    MULHS, // Mul signed return upper part
+    ASR,   // Arithmetic shift right
     MERGE,
     SPLIT,
+    TAIL_CALL, // Call in tail position, which also returns
+
+    // Vector operations
+    SPLAT,      // Copy a scalar into every lane
+    REDUCE_ADD, // Sum of the lanes
+
+    // Bit manipulation
+    ROTR,     // Rotate right
+    CLZ,      // Count leading zeros
+    CTZ,      // Count trailing zeros
+    POPCOUNT, // Count set bits
+    BSWAP,    // Reverse the bytes
+    CRC32,    // CRC-32 of the 2nd source appended to the 1st one
+
+    // Conditional select
+    SELECT, // The 2nd source if the 1st one is not zero, else the 3rd one
 
     INVALID_OP,
   };
@@ -137,7 +157,8 @@ public:
 
   MachineOperand *GetDef() {
     // These do not define values just use them
-    if (Opcode == RET || Opcode == JUMP || Opcode == BRANCH || IsStore())
+    if (Opcode == RET || Opcode == JUMP || Opcode == BRANCH ||
+        Opcode == INDIRECT_JUMP || IsStore())
       return nullptr;
 
     assert(Operands.size() > 0);
@@ -149,7 +170,8 @@ public:
 
   MachineOperand *GetNthUse(size_t N) {
     // Ret only has operands, no defs
-    if (Opcode != RET && Opcode != JUMP && Opcode != BRANCH && !IsStore())
+    if (Opcode != RET && Opcode != JUMP && Opcode != BRANCH &&
+        Opcode != INDIRECT_JUMP && !IsStore())
       N++; // Others first operand is usually a def, so skip it
 
     // If trying to acces non existent use, then return nullptr as
@@ -162,7 +184,8 @@ public:
 
   void SetNthUse(size_t N, MachineOperand *Use) {
     // Ret only has operands, no defs
-    if (Opcode != RET && Opcode != JUMP && Opcode != BRANCH && !IsStore())
+    if (Opcode != RET && Opcode != JUMP && Opcode != BRANCH &&
+        Opcode != INDIRECT_JUMP && !IsStore())
       N++; // Others first operand is usually a def, so skip it
 
     // If trying to acces non existent use, then just return
@@ -11,13 +11,11 @@ void MachineInstructionLegalizer::Run() {
     return;
 
   for (auto &Func : MIRM->GetFunctions()) {
-    for (size_t BBIndex = 0; BBIndex < Func.GetBasicBlocks().size();
-         BBIndex++) {
-      for (size_t InstrIndex = 0;
-           InstrIndex < Func.GetBasicBlocks()[BBIndex].GetInstructions().size();
-           InstrIndex++) {
-        auto *MI =
-            &Func.GetBasicBlocks()[BBIndex].GetInstructions()[InstrIndex];
+    for (auto &MBB : Func.GetBasicBlocks()) {
+      auto &Instructions = MBB.GetInstructions();
+
+      for (auto It = Instructions.begin(); It != Instructions.end();) {
+        auto *MI = &*It;
 
         // If the instruction is not legal on the target and not selected yet
         // and has not yet been expanded
@@ -25,8 +23,13 @@ void MachineInstructionLegalizer::Run() {
             !MI->IsAlreadyExpanded()) {
           // but if it is expandable to hopefully legal ones, then do it
           if (Legalizer->IsExpandable(MI)) {
+            // The expansion can insert instructions before MI, so continue
+            // with the first instruction after the one preceding MI
+            auto *PrecedingMI = MBB.GetPrecedingInstr(MI);
+
             if (Legalizer->Expand(MI)) {
-              InstrIndex--;
+              It = PrecedingMI ? std::next(Instructions.GetIterator(PrecedingMI))
+                               : Instructions.begin();
             } else {
               Legalizer->Expand(MI);
               assert(!"Expandable instruction should be expandable");
@@ -36,17 +39,16 @@ void MachineInstructionLegalizer::Run() {
             assert(!"Machine Instruction is not legal neither expandable");
           }
         }
+
+        It++;
       }
 
       // After processing the BB propagate SPLIT and MERGE instruction
       // registers and remove these instructions
-      auto &Instructions = Func.GetBasicBlocks()[BBIndex].GetInstructions();
       std::map<uint64_t, std::pair<uint64_t, uint64_t>> MergedValuesMap;
       std::map<uint64_t, uint64_t> RegisterMap;
-      for (size_t InstrIndex = 0; InstrIndex < Instructions.size();
-           InstrIndex++) {
-
-        auto *MI = &Instructions[InstrIndex];
+      for (auto It = Instructions.begin(); It != Instructions.end();) {
+        auto *MI = &*It;
 
         // If it is a merge then register its operands and delete it
         if (MI->IsMerge()) {
@@ -54,8 +56,7 @@ void MachineInstructionLegalizer::Run() {
 
           MergedValuesMap[MI->GetOperand(0)->GetReg()] = {
               MI->GetOperand(1)->GetReg(), MI->GetOperand(2)->GetReg()};
-          Instructions.erase(Instructions.begin() + InstrIndex);
-          InstrIndex--;
+          It = Instructions.erase(It);
           continue;
         }
 
@@ -73,8 +74,7 @@ void MachineInstructionLegalizer::Run() {
           RegisterMap[SplitLo] = Lo;
           RegisterMap[SplitHi] = Hi;
 
-          Instructions.erase(Instructions.begin() + InstrIndex);
-          InstrIndex--;
+          It = Instructions.erase(It);
           continue;
         }
 
@@ -92,6 +92,8 @@ void MachineInstructionLegalizer::Run() {
           MI->GetOperand(OpIdx)->SetReg(
               RegisterMap[MI->GetOperand(OpIdx)->GetReg()]);
         }
+
+        It++;
       }
     }
   }
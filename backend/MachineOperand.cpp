@@ -8,7 +8,7 @@ void MachineOperand::Print(TargetMachine *TM) const {
     if (Virtual)
       std::cout << "%vreg" << IntVal;
     else if (!Virtual && TM) {
-      TargetRegister *Reg =
+      const TargetRegister *Reg =
           TM->GetRegInfo()->GetRegisterByID(GetReg());
       std::string RegStr;
       if (Reg->GetAlias() != "")
@@ -0,0 +1,408 @@
+#include "PeepholeOptimizer.hpp"
+#include "MachineBasicBlock.hpp"
+#include "MachineFunction.hpp"
+#include "TargetInstruction.hpp"
+#include "TargetRegister.hpp"
+
+unsigned PeepholeOptimizer::GetRegUnit(unsigned Reg) {
+  if (auto ParentReg = TM->GetRegInfo()->GetParentReg(Reg))
+    return ParentReg->GetID();
+  return Reg;
+}
+
+void PeepholeOptimizer::GetDefsAndUses(MachineInstruction *MI,
+                                       RegUnitSet &Defs, RegUnitSet &Uses) {
+  auto TI = TM->GetInstrDefs()->GetTargetInstr(MI->GetOpcode());
+  assert(TI && "Peephole optimization must run after instruction selection");
+
+  // The registers clobbered by calls are not tracked as defs, which only
+  // makes the liveness more conservative
+  if (TI->IsCall()) {
+    Uses.insert(CallUses.begin(), CallUses.end());
+    // Tail calls return to the caller through the callee
+    if (TI->IsTailCall())
+      Uses.insert(ReturnUses.begin(), ReturnUses.end());
+    return;
+  }
+
+  if (TI->IsReturn()) {
+    Uses.insert(ReturnUses.begin(), ReturnUses.end());
+    // Scalar return values are kept as operands of the return, otherwise the
+    // value might be in any of the return registers
+    if (MI->GetOperandsNumber() == 0)
+      Uses.insert(ReturnRegUses.begin(), ReturnRegUses.end());
+  }
+
+  for (size_t i = 0; i < MI->GetOperandsNumber(); i++) {
+    auto MO = MI->GetOperand(i);
+    if (!MO->IsRegister())
+      continue;
+
+    const auto Unit = GetRegUnit(MO->GetReg());
+    if (i == 0 && TI->HasDef()) {
+      Defs.insert(Unit);
+      if (TI->IsTiedDef())
+        Uses.insert(Unit);
+    } else
+      Uses.insert(Unit);
+  }
+}
+
+void PeepholeOptimizer::ComputeLiveOuts(MachineFunction &MFunc) {
+  auto &BBs = MFunc.GetBasicBlocks();
+  const auto Successors = MFunc.GetSuccessors(TM);
+
+  LiveOuts.clear();
+  std::map<MachineBasicBlock *, RegUnitSet> LiveIns;
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (size_t i = BBs.size(); i-- > 0;) {
+      auto &MBB = BBs[i];
+      RegUnitSet Live;
+      for (auto Succ : Successors[i])
+        Live.insert(LiveIns[&BBs[Succ]].begin(), LiveIns[&BBs[Succ]].end());
+      LiveOuts[&MBB] = Live;
+
+      auto &Instrs = MBB.GetInstructions();
+      for (auto MI = Instrs.rbegin(); MI != Instrs.rend(); MI++) {
+        RegUnitSet Defs, Uses;
+        GetDefsAndUses(&*MI, Defs, Uses);
+        for (auto Def : Defs)
+          Live.erase(Def);
+        Live.insert(Uses.begin(), Uses.end());
+      }
+
+      if (LiveIns[&MBB] != Live) {
+        LiveIns[&MBB] = std::move(Live);
+        Changed = true;
+      }
+    }
+  }
+}
+
+bool PeepholeOptimizer::IsDeadAfter(MachineInstruction *MI, unsigned Reg) {
+  const auto Unit = GetRegUnit(Reg);
+
+  for (auto Next = MI->GetNextNode(); Next; Next = Next->GetNextNode()) {
+    RegUnitSet Defs, Uses;
+    GetDefsAndUses(Next, Defs, Uses);
+    if (Uses.count(Unit))
+      return false;
+    if (Defs.count(Unit))
+      return true;
+  }
+
+  return !LiveOuts[CurrentMBB].count(Unit);
+}
+
+bool PeepholeOptimizer::ApplySelfMove(const PeepholeRule &R,
+                                      std::vector<MachineInstruction *> &Seq) {
+  auto MI = Seq[0];
+  if (MI->GetOperandsNumber() != 2 || !MI->GetOperand(0)->IsRegister() ||
+      !MI->GetOperand(1)->IsRegister() ||
+      MI->GetOperand(0)->GetReg() != MI->GetOperand(1)->GetReg())
+    return false;
+
+  CurrentMBB->Erase(MI);
+  return true;
+}
+
+bool PeepholeOptimizer::ApplyDeadDef(const PeepholeRule &R,
+                                     std::vector<MachineInstruction *> &Seq) {
+  auto MI = Seq[0];
+  if (MI->GetOperandsNumber() == 0 || !MI->GetOperand(0)->IsRegister() ||
+      !IsDeadAfter(MI, MI->GetOperand(0)->GetReg()))
+    return false;
+
+  CurrentMBB->Erase(MI);
+  return true;
+}
+
+bool PeepholeOptimizer::ApplyStoreToLoad(
+    const PeepholeRule &R, std::vector<MachineInstruction *> &Seq) {
+  auto Store = Seq[0];
+  auto Load = Seq[1];
+  if (Store->GetOperandsNumber() != 3 || Load->GetOperandsNumber() != 3)
+    return false;
+
+  auto Src = Store->GetOperand(0);
+  auto Dst = Load->GetOperand(0);
+  auto StoreBase = Store->GetOperand(1);
+  auto LoadBase = Load->GetOperand(1);
+  auto StoreOffset = Store->GetOperand(2);
+  auto LoadOffset = Load->GetOperand(2);
+
+  if (!Src->IsRegister() || !Dst->IsRegister() || !StoreBase->IsRegister() ||
+      !LoadBase->IsRegister() || StoreBase->GetReg() != LoadBase->GetReg() ||
+      !StoreOffset->IsImmediate() || !LoadOffset->IsImmediate() ||
+      StoreOffset->GetImmediate() != LoadOffset->GetImmediate())
+    return false;
+
+  auto SrcReg = TM->GetRegInfo()->GetRegisterByID(Src->GetReg());
+  auto DstReg = TM->GetRegInfo()->GetRegisterByID(Dst->GetReg());
+  if (SrcReg->GetBitWidth() != DstReg->GetBitWidth())
+    return false;
+
+  if (SrcReg == DstReg) {
+    CurrentMBB->Erase(Load);
+    return true;
+  }
+
+  // The result is a register move, which only works within the same register
+  // file
+  if (SrcReg->IsFP() || DstReg->IsFP())
+    return false;
+
+  Load->SetOpcode(R.ResultOpcode);
+  Load->RemoveOperand(2);
+  Load->ReplaceOperand(*Src, 1);
+  return true;
+}
+
+bool PeepholeOptimizer::ApplyStoreZero(const PeepholeRule &R,
+                                       std::vector<MachineInstruction *> &Seq) {
+  auto Mov = Seq[0];
+  auto Store = Seq[1];
+  if (Mov->GetOperandsNumber() != 2 || Store->GetOperandsNumber() < 2)
+    return false;
+
+  auto Dst = Mov->GetOperand(0);
+  auto Imm = Mov->GetOperand(1);
+  auto Src = Store->GetOperand(0);
+  auto Base = Store->GetOperand(1);
+  if (!Dst->IsRegister() || !Imm->IsImmediate() || Imm->IsFPImmediate() ||
+      Imm->GetImmediate() != 0 || !Src->IsRegister() ||
+      Src->GetReg() != Dst->GetReg() ||
+      (Base->IsRegister() &&
+       GetRegUnit(Base->GetReg()) == GetRegUnit(Dst->GetReg())) ||
+      !IsDeadAfter(Store, Dst->GetReg()))
+    return false;
+
+  const auto BitWidth =
+      TM->GetRegInfo()->GetRegisterByID(Src->GetReg())->GetBitWidth();
+  Src->SetReg(TM->GetRegInfo()->GetZeroRegister(BitWidth));
+  CurrentMBB->Erase(Mov);
+  return true;
+}
+
+bool PeepholeOptimizer::ApplySetCCBranch(
+    const PeepholeRule &R, std::vector<MachineInstruction *> &Seq) {
+  auto SetCC = Seq.front();
+  auto Branch = Seq.back();
+  auto InstrDefs = TM->GetInstrDefs();
+
+  if (SetCC->GetOperandsNumber() == 0 || !SetCC->GetOperand(0)->IsRegister())
+    return false;
+  for (size_t i = 1; i < SetCC->GetOperandsNumber(); i++)
+    if (!SetCC->GetOperand(i)->IsRegister())
+      return false;
+
+  // Every instruction after the first one must only test the result of the
+  // previous one
+  std::vector<unsigned> Defs = {(unsigned)SetCC->GetOperand(0)->GetReg()};
+  for (size_t i = 1; i < Seq.size(); i++) {
+    auto TI = InstrDefs->GetTargetInstr(Seq[i]->GetOpcode());
+    for (size_t j = 0; j < Seq[i]->GetOperandsNumber(); j++) {
+      auto MO = Seq[i]->GetOperand(j);
+      if (j == 0 && TI->HasDef())
+        continue;
+      if (MO->IsRegister()) {
+        if (MO->GetReg() != Defs.back())
+          return false;
+      } else if (MO->IsImmediate()) {
+        if (MO->IsFPImmediate() || MO->GetImmediate() != R.Imm)
+          return false;
+      } else if (!MO->IsLabel() || Seq[i] != Branch)
+        return false;
+    }
+
+    if (TI->HasDef()) {
+      if (!Seq[i]->GetOperand(0)->IsRegister())
+        return false;
+      Defs.push_back(Seq[i]->GetOperand(0)->GetReg());
+    }
+  }
+
+  if (Branch->GetOperandsNumber() == 0 ||
+      !Branch->GetOperand(Branch->GetOperandsNumber() - 1)->IsLabel())
+    return false;
+
+  for (auto Def : Defs)
+    if (!IsDeadAfter(Branch, Def))
+      return false;
+
+  auto Label = *Branch->GetOperand(Branch->GetOperandsNumber() - 1);
+  Branch->GetOperands().clear();
+  for (size_t i = 1; i < SetCC->GetOperandsNumber(); i++)
+    Branch->AddOperand(*SetCC->GetOperand(i));
+  Branch->AddOperand(Label);
+  Branch->SetOpcode(R.ResultOpcode);
+
+  for (size_t i = 0; i + 1 < Seq.size(); i++)
+    CurrentMBB->Erase(Seq[i]);
+
+  return true;
+}
+
+bool PeepholeOptimizer::ApplyPair(const PeepholeRule &R,
+                                  std::vector<MachineInstruction *> &Seq) {
+  auto First = Seq[0];
+  auto Second = Seq[1];
+  if (First->GetOperandsNumber() != 3 || Second->GetOperandsNumber() != 3)
+    return false;
+
+  for (auto MI : Seq)
+    if (!MI->GetOperand(0)->IsRegister() || !MI->GetOperand(1)->IsRegister() ||
+        !MI->GetOperand(2)->IsImmediate())
+      return false;
+
+  const auto Base = First->GetOperand(1)->GetReg();
+  if (Second->GetOperand(1)->GetReg() != Base)
+    return false;
+
+  auto RegInfo = TM->GetRegInfo();
+  auto Reg1 = RegInfo->GetRegisterByID(First->GetOperand(0)->GetReg());
+  auto Reg2 = RegInfo->GetRegisterByID(Second->GetOperand(0)->GetReg());
+  const unsigned BitWidth = Reg1->GetBitWidth();
+  if (Reg2->GetBitWidth() != BitWidth || Reg1->IsFP() != Reg2->IsFP() ||
+      (BitWidth != 32 && BitWidth != 64))
+    return false;
+
+  // The first load must not change the base or the register of the second
+  auto InstrDefs = TM->GetInstrDefs();
+  const auto Unit1 = GetRegUnit(Reg1->GetID());
+  if (InstrDefs->GetTargetInstr(First->GetOpcode())->IsLoad() &&
+      (Unit1 == GetRegUnit(Base) || Unit1 == GetRegUnit(Reg2->GetID())))
+    return false;
+
+  // Keep the second store if it might be forwarded to a following load
+  auto Next = Second->GetNextNode();
+  if (Next && InstrDefs->GetTargetInstr(Next->GetOpcode())->IsLoad() &&
+      Next->GetOperandsNumber() > 2 && Next->GetOperand(1)->IsRegister() &&
+      Next->GetOperand(1)->GetReg() == Base &&
+      Next->GetOperand(2)->IsImmediate() &&
+      Next->GetOperand(2)->GetImmediate() ==
+          Second->GetOperand(2)->GetImmediate())
+    return false;
+
+  const int64_t Size = BitWidth / 8;
+  int64_t Offset = First->GetOperand(2)->GetImmediate();
+  auto Low = *First->GetOperand(0);
+  auto High = *Second->GetOperand(0);
+
+  if (Second->GetOperand(2)->GetImmediate() == Offset - Size) {
+    Offset -= Size;
+    std::swap(Low, High);
+  } else if (Second->GetOperand(2)->GetImmediate() != Offset + Size)
+    return false;
+
+  if (Offset % Size != 0 || Offset < -64 * Size || Offset >= 64 * Size)
+    return false;
+
+  auto BaseMO = *First->GetOperand(1);
+  First->GetOperands().clear();
+  First->AddOperand(Low);
+  First->AddOperand(High);
+  First->AddOperand(BaseMO);
+  First->AddImmediate(Offset);
+  First->SetOpcode(R.ResultOpcode);
+
+  CurrentMBB->Erase(Second);
+  return true;
+}
+
+bool PeepholeOptimizer::Apply(const PeepholeRule &R, MachineInstruction *MI) {
+  std::vector<MachineInstruction *> Seq;
+  for (auto Opcode : R.Opcodes) {
+    if (!MI || MI->GetOpcode() != Opcode)
+      return false;
+    Seq.push_back(MI);
+    MI = MI->GetNextNode();
+  }
+
+  switch (R.Kind) {
+  case PeepholeRule::SELF_MOVE:
+    return ApplySelfMove(R, Seq);
+  case PeepholeRule::DEAD_DEF:
+    return ApplyDeadDef(R, Seq);
+  case PeepholeRule::STORE_TO_LOAD:
+    return ApplyStoreToLoad(R, Seq);
+  case PeepholeRule::STORE_ZERO:
+    return ApplyStoreZero(R, Seq);
+  case PeepholeRule::SETCC_BRANCH:
+    return ApplySetCCBranch(R, Seq);
+  case PeepholeRule::PAIR:
+    return ApplyPair(R, Seq);
+  default:
+    assert(!"Unknown peephole rule");
+  }
+
+  return false;
+}
+
+void PeepholeOptimizer::RunOnFunction(MachineFunction &MFunc) {
+  auto &Rules = TM->GetInstrDefs()->GetPeepholeRules();
+  ComputeLiveOuts(MFunc);
+
+  // The rules only remove instructions or replace them with ones reading the
+  // same registers, therefore the computed liveness stays conservative.
+  for (auto &MBB : MFunc.GetBasicBlocks()) {
+    CurrentMBB = &MBB;
+    auto &Instrs = MBB.GetInstructions();
+    auto MI = Instrs.empty() ? nullptr : &Instrs.front();
+
+    while (MI) {
+      auto Prev = MI->GetPrevNode();
+      bool Applied = false;
+
+      for (auto &R : Rules)
+        if (Apply(R, MI)) {
+          Applied = true;
+          break;
+        }
+
+      if (!Applied)
+        MI = MI->GetNextNode();
+      // Step back one instruction, since the rewrite may have enabled a rule
+      // starting at the previous one
+      else if (Prev)
+        MI = Prev;
+      else
+        MI = Instrs.empty() ? nullptr : &Instrs.front();
+    }
+  }
+}
+
+void PeepholeOptimizer::Run() {
+  if (TM->GetInstrDefs()->GetPeepholeRules().empty())
+    return;
+
+  auto RegInfo = TM->GetRegInfo();
+  CallUses.clear();
+  for (auto Reg : TM->GetABI()->GetArgumentRegisters())
+    CallUses.insert(GetRegUnit(Reg->GetID()));
+  if (RegInfo->GetStructPtrRegister() != ~0u)
+    CallUses.insert(GetRegUnit(RegInfo->GetStructPtrRegister()));
+  CallUses.insert(GetRegUnit(RegInfo->GetStackRegister()));
+  CallUses.insert(GetRegUnit(RegInfo->GetFrameRegister()));
+
+  // Values are returned in at most two registers of each register file, see
+  // IRtoLLIR
+  ReturnRegUses.clear();
+  auto &RetRegs = TM->GetABI()->GetReturnRegisters();
+  const size_t FirstFPRetReg = TM->GetABI()->GetFirstFPRetRegIdx();
+  for (size_t i = 0; i < RetRegs.size(); i++)
+    if (i < 2 || (i >= FirstFPRetReg && i < FirstFPRetReg + 2))
+      ReturnRegUses.insert(GetRegUnit(RetRegs[i]->GetID()));
+
+  ReturnUses.clear();
+  for (auto Reg : TM->GetABI()->GetCalleeSavedRegisters())
+    ReturnUses.insert(GetRegUnit(Reg->GetID()));
+  ReturnUses.insert(GetRegUnit(RegInfo->GetStackRegister()));
+  ReturnUses.insert(GetRegUnit(RegInfo->GetFrameRegister()));
+  ReturnUses.insert(GetRegUnit(RegInfo->GetLinkRegister()));
+
+  for (auto &MFunc : MIRM->GetFunctions())
+    RunOnFunction(MFunc);
+}
@@ -0,0 +1,67 @@
+#ifndef PEEPHOLE_OPTIMIZER_HPP
+#define PEEPHOLE_OPTIMIZER_HPP
+
+#include "MachineIRModule.hpp"
+#include "PeepholeRule.hpp"
+#include "TargetMachine.hpp"
+#include <map>
+#include <set>
+
+/// Rewrites short instruction sequences of the selected machine code using the
+/// target's peephole rules. Runs after the register allocation, so the rules
+/// work on physical registers and rely on a simple liveness analysis.
+class PeepholeOptimizer {
+  /// Registers are tracked by their widest super register, so w0 and x0 for
+  /// example are the same unit.
+  using RegUnitSet = std::set<unsigned>;
+
+public:
+  PeepholeOptimizer(MachineIRModule *Module, TargetMachine *TM)
+      : MIRM(Module), TM(TM) {}
+
+  void Run();
+
+private:
+  void RunOnFunction(MachineFunction &MFunc);
+
+  /// Try to apply @R on the instruction sequence starting with @MI.
+  bool Apply(const PeepholeRule &R, MachineInstruction *MI);
+
+  bool ApplySelfMove(const PeepholeRule &R,
+                     std::vector<MachineInstruction *> &Seq);
+  bool ApplyDeadDef(const PeepholeRule &R,
+                    std::vector<MachineInstruction *> &Seq);
+  bool ApplyStoreToLoad(const PeepholeRule &R,
+                        std::vector<MachineInstruction *> &Seq);
+  bool ApplyStoreZero(const PeepholeRule &R,
+                      std::vector<MachineInstruction *> &Seq);
+  bool ApplySetCCBranch(const PeepholeRule &R,
+                        std::vector<MachineInstruction *> &Seq);
+  bool ApplyPair(const PeepholeRule &R, std::vector<MachineInstruction *> &Seq);
+
+  unsigned GetRegUnit(unsigned Reg);
+
+  /// Collect the register units written and read by @MI into @Defs and @Uses.
+  void GetDefsAndUses(MachineInstruction *MI, RegUnitSet &Defs,
+                      RegUnitSet &Uses);
+
+  /// Compute the live out registers of every basic block of @MFunc.
+  void ComputeLiveOuts(MachineFunction &MFunc);
+
+  /// Return true if the value of @Reg is not read after @MI, which must be in
+  /// the current basic block.
+  bool IsDeadAfter(MachineInstruction *MI, unsigned Reg);
+
+  MachineIRModule *MIRM;
+  TargetMachine *TM;
+
+  /// Registers read by the call and return instructions
+  RegUnitSet CallUses;
+  RegUnitSet ReturnUses;
+  /// Return registers which might hold the returned value
+  RegUnitSet ReturnRegUses;
+  std::map<MachineBasicBlock *, RegUnitSet> LiveOuts;
+  MachineBasicBlock *CurrentMBB = nullptr;
+};
+
+#endif
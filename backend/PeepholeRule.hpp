@@ -0,0 +1,41 @@
+#ifndef PEEPHOLE_RULE_HPP
+#define PEEPHOLE_RULE_HPP
+
+#include <cstdint>
+#include <vector>
+
+/// Describes a rewrite of a sequence of consecutive target instructions within
+/// a basic block. The opcodes select the instructions, while the kind of the
+/// rule decides what is required from their operands and how they are
+/// rewritten.
+struct PeepholeRule {
+  enum Kinds : unsigned {
+    /// "mov r, r": the instruction is erased
+    SELF_MOVE,
+    /// A def which is not read before being redefined: the instruction is
+    /// erased
+    DEAD_DEF,
+    /// "str a, [b, #o]" followed by "ldr c, [b, #o]" of the same width: the
+    /// load is erased if c is a, otherwise replaced by "Result c, a"
+    STORE_TO_LOAD,
+    /// "mov r, #0" followed by a store of r: the store uses the zero register
+    /// instead and the mov is erased if r is dead afterwards
+    STORE_ZERO,
+    /// A flag materialization, then instructions testing it against Imm, then
+    /// a branch on the result: replaced by "Result <operands>, <label>", where
+    /// the operands are the ones read by the first instruction
+    SETCC_BRANCH,
+    /// Two loads or two stores of registers of the same width at adjacent
+    /// offsets from the same base: replaced by "Result a, c, [b, #o]", where
+    /// o is the lower offset, which must be a multiple of the access size
+    /// below 64 times of it
+    PAIR,
+  };
+
+  unsigned Kind;
+  std::vector<unsigned> Opcodes;
+  unsigned ResultOpcode = 0;
+  int64_t Imm = 0;
+};
+
+#endif
@@ -1,9 +1,11 @@
 #include "PrologueEpilogInsertion.hpp"
+#include "MachineBasicBlock.hpp"
 #include "MachineFunction.hpp"
 #include "MachineInstruction.hpp"
 #include "MachineOperand.hpp"
 #include "Support.hpp"
 #include "TargetInstruction.hpp"
+#include <algorithm>
 
 /// TODO: Solve the stack issue: inserting physregs can collide with existing
 /// stack slot with the same ID
@@ -29,184 +31,460 @@ PrologueEpilogInsertion::CreateADDInstruction(int64_t StackAdjustmentSize) {
   return Add;
 }
 
-void PrologueEpilogInsertion::InsertLinkRegisterSave(MachineFunction &Func) {
-  if (!Func.IsCaller())
-    return;
+int64_t PrologueEpilogInsertion::GetSavePosition(MachineFunction &Func,
+                                                 unsigned Register) {
+  return Func.GetStackObjectPosition(LocalPhysRegToStackSlotMap[Register]);
+}
 
+MachineInstruction PrologueEpilogInsertion::CreateSTORE(MachineFunction &Func,
+                                                        unsigned Register,
+                                                        int64_t Offset) {
   MachineInstruction STR(MachineInstruction::STORE, nullptr);
-  auto LROffset = Func.GetStackObjectPosition(
-      LocalPhysRegToStackSlotMap[TM->GetRegInfo()->GetLinkRegister()]);
-  LROffset = GetNextAlignedValue(LROffset, 16);
   auto SPReg = TM->GetRegInfo()->GetStackRegister();
-  auto Dest = TM->GetRegInfo()->GetLinkRegister();
 
-  STR.AddRegister(Dest);
+  STR.AddRegister(Register, TM->GetPointerSize());
   STR.AddRegister(SPReg);
-  STR.AddImmediate(LROffset);
+  STR.AddImmediate(Offset);
 
   if (!TM->SelectInstruction(&STR))
     assert(!"Unable to select instruction");
 
-  // Stack adjusting instruction already inserted at this point so this have
-  // to be inserted after it, hence the position 1
-  Func.GetBasicBlocks().front().InsertInstr(STR, 1);
+  return STR;
 }
 
-void PrologueEpilogInsertion::InsertLinkRegisterReload(MachineFunction &Func) {
-  if (!Func.IsCaller())
-    return;
-
+MachineInstruction PrologueEpilogInsertion::CreateLOAD(MachineFunction &Func,
+                                                       unsigned Register,
+                                                       int64_t Offset) {
   MachineInstruction LOAD(MachineInstruction::LOAD, nullptr);
-  auto LROffset = Func.GetStackObjectPosition(
-      LocalPhysRegToStackSlotMap[TM->GetRegInfo()->GetLinkRegister()]);
-  LROffset = GetNextAlignedValue(LROffset, 16);
   auto SPReg = TM->GetRegInfo()->GetStackRegister();
-  auto Dest = TM->GetRegInfo()->GetLinkRegister();
 
-  LOAD.AddRegister(Dest);
+  LOAD.AddRegister(Register, TM->GetPointerSize());
   LOAD.AddRegister(SPReg);
-  LOAD.AddImmediate(LROffset);
+  LOAD.AddImmediate(Offset);
 
   if (!TM->SelectInstruction(&LOAD))
     assert(!"Unable to select instruction");
 
-  auto &RetBB = Func.GetBasicBlocks()[MBBWithRetIdx];
-  RetBB.InsertInstr(LOAD,
-                     std::max(0, (int)RetBB.GetInstructions().size() - 1));
+  return LOAD;
 }
 
-void PrologueEpilogInsertion::InsertStackAdjustmentUpward(
-    MachineFunction &Func) {
-  unsigned StackAlignment = TM->GetABI()->GetStackAlignment();
+/// Return the instruction of @Instrs before which the epilogue is inserted,
+/// which is the return if there is one, otherwise the first branch.
+static MachineBasicBlock::InstructionList::iterator
+FindEpiloguePoint(TargetMachine *TM,
+                  MachineBasicBlock::InstructionList &Instrs) {
+  auto IsReturn = [TM](MachineInstruction &MI) {
+    return TM->GetInstrDefs()->GetTargetInstr(MI.GetOpcode())->IsReturn();
+  };
+  auto IsBranch = [TM](MachineInstruction &MI) {
+    return TM->GetInstrDefs()->GetTargetInstr(MI.GetOpcode())->IsBranch();
+  };
+
+  auto Ret = std::find_if(Instrs.begin(), Instrs.end(), IsReturn);
+  if (Ret != Instrs.end())
+    return Ret;
+  return std::find_if(Instrs.begin(), Instrs.end(), IsBranch);
+}
+
+bool PrologueEpilogInsertion::NeedsFrame(MachineFunction &Func,
+                                          MachineInstruction &MI) {
+  if (TM->GetInstrDefs()->GetTargetInstr(MI.GetOpcode())->IsCall())
+    return true;
 
-  int64_t StackAdjustmentSize =
-      GetNextAlignedValue(Func.GetStackFrameSize(), StackAlignment) * -1;
+  auto RegInfo = TM->GetRegInfo();
+  auto &CalleSavedRegs = Func.GetUsedCalleSavedRegs();
+  for (auto &MO : MI.GetOperands()) {
+    if (!MO.IsRegister() && !MO.IsMemory())
+      continue;
+
+    unsigned Reg = MO.GetReg();
+    if (auto ParentReg = RegInfo->GetParentReg(Reg))
+      Reg = ParentReg->GetID();
 
-  MachineInstruction ADDToSP = CreateADDInstruction(StackAdjustmentSize);
+    if (Reg == RegInfo->GetStackRegister() ||
+        Reg == RegInfo->GetFrameRegister() ||
+        std::find(CalleSavedRegs.begin(), CalleSavedRegs.end(), Reg) !=
+            CalleSavedRegs.end())
+      return true;
+  }
 
-  Func.GetBasicBlocks().front().InsertInstrToFront(ADDToSP);
+  return false;
 }
 
-void PrologueEpilogInsertion::InsertStackAdjustmentDownward(
-    MachineFunction &Func) {
-  unsigned StackAlignment = TM->GetABI()->GetStackAlignment();
+/// Immediate dominators of the nodes of a graph, where the root is its own
+/// immediate dominator and unreachable nodes have ~0.
+struct DominatorTree {
+  std::vector<unsigned> IDoms;
+  /// Postorder number of the nodes, ancestors have higher numbers
+  std::vector<unsigned> PostOrder;
+
+  bool IsReachable(unsigned N) const { return IDoms[N] != ~0u; }
+
+  unsigned FindNearestCommonDominator(unsigned A, unsigned B) const {
+    while (A != B) {
+      while (PostOrder[A] < PostOrder[B])
+        A = IDoms[A];
+      while (PostOrder[B] < PostOrder[A])
+        B = IDoms[B];
+    }
+    return A;
+  }
 
-  int64_t StackAdjustmentSize =
-      GetNextAlignedValue(Func.GetStackFrameSize(), StackAlignment);
+  bool Dominates(unsigned A, unsigned B) const {
+    return FindNearestCommonDominator(A, B) == A;
+  }
+};
+
+/// Compute the dominator tree of the graph given by @Succs from @Root, using
+/// the iterative algorithm of Cooper, Harvey and Kennedy.
+static DominatorTree
+ComputeDominatorTree(const std::vector<std::vector<unsigned>> &Succs,
+                     unsigned Root) {
+  const auto N = Succs.size();
+  DominatorTree DT;
+  DT.IDoms.assign(N, ~0u);
+  DT.PostOrder.assign(N, ~0u);
+
+  std::vector<unsigned> Order;
+  std::vector<bool> Visited(N, false);
+  std::vector<std::pair<unsigned, size_t>> Stack = {{Root, 0}};
+  Visited[Root] = true;
+  while (!Stack.empty()) {
+    const auto Node = Stack.back().first;
+    const auto Next = Stack.back().second++;
+    if (Next < Succs[Node].size()) {
+      const auto Succ = Succs[Node][Next];
+      if (!Visited[Succ]) {
+        Visited[Succ] = true;
+        Stack.push_back({Succ, 0});
+      }
+      continue;
+    }
 
-  MachineInstruction ADDToSP = CreateADDInstruction(StackAdjustmentSize);
+    DT.PostOrder[Node] = Order.size();
+    Order.push_back(Node);
+    Stack.pop_back();
+  }
 
-  auto &RetBB = Func.GetBasicBlocks()[MBBWithRetIdx];
-  assert(RetBB.GetInstructions().size() > 0);
-  RetBB.InsertInstr(ADDToSP, RetBB.GetInstructions().size() - 1);
-}
+  std::vector<std::vector<unsigned>> Preds(N);
+  for (auto Node : Order)
+    for (auto Succ : Succs[Node])
+      Preds[Succ].push_back(Node);
+
+  DT.IDoms[Root] = Root;
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    // Reverse postorder, skipping the root
+    for (size_t i = Order.size() - 1; i-- > 0;) {
+      const auto Node = Order[i];
+      unsigned NewIDom = ~0u;
+      for (auto Pred : Preds[Node]) {
+        if (!DT.IsReachable(Pred))
+          continue;
+        NewIDom = NewIDom == ~0u
+                      ? Pred
+                      : DT.FindNearestCommonDominator(Pred, NewIDom);
+      }
+
+      if (DT.IDoms[Node] != NewIDom) {
+        DT.IDoms[Node] = NewIDom;
+        Changed = true;
+      }
+    }
+  }
 
-MachineInstruction PrologueEpilogInsertion::CreateSTORE(MachineFunction &Func,
-                                                        unsigned Register) {
-  MachineInstruction STR(MachineInstruction::STORE, nullptr);
-  auto StackID = Register;
-  if (LocalPhysRegToStackSlotMap.count(Register) > 0)
-    StackID = LocalPhysRegToStackSlotMap[Register];
-  auto Offset = Func.GetStackObjectPosition(StackID);
-  Offset = GetNextAlignedValue(Offset, TM->GetPointerSize() / 8);
-  auto SPReg = TM->GetRegInfo()->GetStackRegister();
+  return DT;
+}
 
-  STR.AddRegister(Register, TM->GetPointerSize());
-  STR.AddRegister(SPReg);
-  STR.AddImmediate(Offset);
+/// Return true if @Node can be reached from its own successors.
+static bool IsInCycle(const std::vector<std::vector<unsigned>> &Succs,
+                      unsigned Node) {
+  std::vector<bool> Visited(Succs.size(), false);
+  std::vector<unsigned> WorkList = Succs[Node];
+  while (!WorkList.empty()) {
+    const auto Curr = WorkList.back();
+    WorkList.pop_back();
+    if (Curr == Node)
+      return true;
+    if (Visited[Curr])
+      continue;
 
-  if (!TM->SelectInstruction(&STR))
-    assert(!"Unable to select instruction");
+    Visited[Curr] = true;
+    WorkList.insert(WorkList.end(), Succs[Curr].begin(), Succs[Curr].end());
+  }
 
-  return STR;
+  return false;
 }
 
-MachineInstruction PrologueEpilogInsertion::CreateLOAD(MachineFunction &Func,
-                                                        unsigned Register) {
-  MachineInstruction LOAD(MachineInstruction::LOAD, nullptr);
-  auto StackID = Register;
-  if (LocalPhysRegToStackSlotMap.count(Register) > 0)
-    StackID = LocalPhysRegToStackSlotMap[Register];
-  auto Offset = Func.GetStackObjectPosition(StackID);
-  Offset = GetNextAlignedValue(Offset, TM->GetPointerSize() / 8);
-  auto SPReg = TM->GetRegInfo()->GetStackRegister();
+void PrologueEpilogInsertion::ComputeSaveAndRestorePoints(
+    MachineFunction &Func) {
+  auto &BBs = Func.GetBasicBlocks();
+
+  // By default the frame is set up at the entry and torn down before each
+  // return
+  std::vector<unsigned> ReturnBlocks;
+  std::vector<unsigned> FrameBlocks;
+  for (size_t i = 0; i < BBs.size(); i++) {
+    bool NeedsFrameHere = false;
+    for (auto &MI : BBs[i].GetInstructions()) {
+      if (TM->GetInstrDefs()->GetTargetInstr(MI.GetOpcode())->IsReturn()) {
+        ReturnBlocks.push_back(i);
+        break;
+      }
+      NeedsFrameHere = NeedsFrameHere || NeedsFrame(Func, MI);
+    }
 
-  LOAD.AddRegister(Register, TM->GetPointerSize());
-  LOAD.AddRegister(SPReg);
-  LOAD.AddImmediate(Offset);
+    if (NeedsFrameHere)
+      FrameBlocks.push_back(i);
+  }
 
-  if (!TM->SelectInstruction(&LOAD))
-    assert(!"Unable to select instruction");
+  SaveBlockIdx = 0;
+  RestoreBlockIdxs = ReturnBlocks;
+  if (FrameBlocks.empty() || ReturnBlocks.empty())
+    return;
 
-  return LOAD;
+  // Add a virtual exit node after the returning blocks to compute the post
+  // dominators on the reversed graph
+  auto Succs = Func.GetSuccessors(TM);
+  const unsigned ExitNode = BBs.size();
+  Succs.emplace_back();
+  for (auto Idx : ReturnBlocks)
+    Succs[Idx].push_back(ExitNode);
+
+  std::vector<std::vector<unsigned>> ReversedSuccs(Succs.size());
+  for (size_t i = 0; i < Succs.size(); i++)
+    for (auto Succ : Succs[i])
+      ReversedSuccs[Succ].push_back(i);
+
+  const auto DT = ComputeDominatorTree(Succs, 0);
+  const auto PDT = ComputeDominatorTree(ReversedSuccs, ExitNode);
+
+  for (auto Idx : FrameBlocks)
+    if (!DT.IsReachable(Idx) || !PDT.IsReachable(Idx))
+      return;
+
+  unsigned Save = FrameBlocks[0];
+  unsigned Restore = FrameBlocks[0];
+  for (auto Idx : FrameBlocks) {
+    Save = DT.FindNearestCommonDominator(Save, Idx);
+    Restore = PDT.FindNearestCommonDominator(Restore, Idx);
+  }
+
+  // The save point has to dominate the restore point and the restore point
+  // has to post-dominate the save point
+  while (!DT.IsReachable(Restore) || !DT.Dominates(Save, Restore) ||
+         !PDT.Dominates(Restore, Save)) {
+    if (DT.IsReachable(Restore))
+      Save = DT.FindNearestCommonDominator(Save, Restore);
+    Restore = PDT.FindNearestCommonDominator(Restore, Save);
+    if (Restore == ExitNode)
+      break;
+  }
+
+  // Inside a loop the frame would be set up in every iteration
+  if (Save == 0 || IsInCycle(Succs, Save))
+    return;
+
+  std::vector<unsigned> Restores;
+  if (Restore == ExitNode) {
+    // Tear down the frame in the returning blocks reached from the save point
+    for (auto Idx : ReturnBlocks) {
+      if (!IsInCycle(Succs, Idx) && DT.Dominates(Save, Idx)) {
+        Restores.push_back(Idx);
+        continue;
+      }
+
+      // Returning blocks bypassing the save point are fine, but if they are
+      // reached from both paths, then the default placement is used
+      std::vector<unsigned> Path = {Save};
+      std::vector<bool> Visited(Succs.size(), false);
+      while (!Path.empty()) {
+        const auto Curr = Path.back();
+        Path.pop_back();
+        if (Curr == Idx)
+          return;
+        if (Visited[Curr])
+          continue;
+        Visited[Curr] = true;
+        Path.insert(Path.end(), Succs[Curr].begin(), Succs[Curr].end());
+      }
+    }
+  } else {
+    if (IsInCycle(Succs, Restore))
+      return;
+
+    // Nothing after the epilogue can use the frame
+    auto &Instrs = BBs[Restore].GetInstructions();
+    for (auto It = FindEpiloguePoint(TM, Instrs); It != Instrs.end(); It++)
+      if (NeedsFrame(Func, *It))
+        return;
+
+    Restores.push_back(Restore);
+  }
+
+  SaveBlockIdx = Save;
+  RestoreBlockIdxs = Restores;
 }
 
-void PrologueEpilogInsertion::SpillClobberedCalleeSavedRegisters(
-    MachineFunction &Func) {
-  unsigned Counter = 0;
-  const unsigned StartOfInsertion = Func.IsCaller() ? 2 : 1;
+void PrologueEpilogInsertion::CollectSavedRegPairs(MachineFunction &Func) {
+  std::vector<unsigned> SavedRegs;
+  if (Func.IsCaller())
+    SavedRegs.push_back(TM->GetRegInfo()->GetLinkRegister());
+  for (auto Reg : Func.GetUsedCalleSavedRegs())
+    SavedRegs.push_back(Reg);
+
+  const auto SlotSize = TM->GetPointerSize() / 8;
+  // Only used to query whether the target can store the pair
+  MachineInstruction STP;
+
+  SavedRegPairs.clear();
+  for (size_t i = 0; i < SavedRegs.size(); i++) {
+    const bool HasNext =
+        i + 1 < SavedRegs.size() &&
+        GetSavePosition(Func, SavedRegs[i + 1]) ==
+            GetSavePosition(Func, SavedRegs[i]) + SlotSize &&
+        TM->CreateStorePair(STP, SavedRegs[i], SavedRegs[i + 1], 0, false);
+
+    SavedRegPairs.push_back({SavedRegs[i], HasNext ? SavedRegs[i + 1] : ~0u});
+    if (HasNext)
+      i++;
+  }
+}
 
-  for (auto Reg : Func.GetUsedCalleSavedRegs()) {
-    auto STR = CreateSTORE(Func, Reg);
-    Func.GetBasicBlocks().front().InsertInstr(STR, StartOfInsertion + Counter);
-    Counter++;
+void PrologueEpilogInsertion::InsertPrologue(MachineFunction &Func) {
+  std::vector<MachineInstruction> Prologue;
+
+  // If the target allows, then the save area is allocated by pushing the first
+  // saved registers and the rest of the frame is allocated afterwards, like
+  //    stp x30, x19, [sp, #-32]!
+  //    stp x20, x21, [sp, #16]
+  //    sub sp, sp, #48
+  // otherwise the whole frame is allocated first and then the registers are
+  // saved one by one.
+  MachineInstruction Push;
+  IsSaveAreaPushed =
+      !SavedRegPairs.empty() &&
+      TM->CreateStorePair(Push, SavedRegPairs[0].first,
+                          SavedRegPairs[0].second,
+                          SaveAreaStart - FrameSize, true);
+
+  if (IsSaveAreaPushed)
+    Prologue.push_back(Push);
+  else
+    Prologue.push_back(CreateADDInstruction(-FrameSize));
+
+  const int64_t SlotSize = TM->GetPointerSize() / 8;
+  const int64_t Base = IsSaveAreaPushed ? SaveAreaStart : 0;
+  for (size_t i = IsSaveAreaPushed ? 1 : 0; i < SavedRegPairs.size(); i++) {
+    auto [Reg1, Reg2] = SavedRegPairs[i];
+    const auto Offset = GetSavePosition(Func, Reg1) - Base;
+
+    MachineInstruction STP;
+    if (Reg2 != ~0u && TM->CreateStorePair(STP, Reg1, Reg2, Offset, false)) {
+      Prologue.push_back(STP);
+      continue;
+    }
+
+    Prologue.push_back(CreateSTORE(Func, Reg1, Offset));
+    if (Reg2 != ~0u)
+      Prologue.push_back(CreateSTORE(Func, Reg2, Offset + SlotSize));
   }
+
+  if (IsSaveAreaPushed && SaveAreaStart > 0)
+    Prologue.push_back(CreateADDInstruction(-SaveAreaStart));
+
+  auto &SaveBB = Func.GetBasicBlocks()[SaveBlockIdx];
+  if (SaveBB.GetInstructions().empty())
+    for (auto &MI : Prologue)
+      SaveBB.InsertInstr(MI);
+  else
+    SaveBB.InsertBefore(std::move(Prologue),
+                        &SaveBB.GetInstructions().front());
 }
 
-void PrologueEpilogInsertion::ReloadClobberedCalleeSavedRegisters(
-    MachineFunction &Func) {
-  unsigned Counter = 0;
-  auto &RetBB = Func.GetBasicBlocks()[MBBWithRetIdx];
+void PrologueEpilogInsertion::InsertEpilogue(MachineFunction &Func) {
+  std::vector<MachineInstruction> Epilogue;
+
+  if (IsSaveAreaPushed && SaveAreaStart > 0)
+    Epilogue.push_back(CreateADDInstruction(SaveAreaStart));
+
+  // Restore in the reverse order of the saves
+  const int64_t SlotSize = TM->GetPointerSize() / 8;
+  const int64_t Base = IsSaveAreaPushed ? SaveAreaStart : 0;
+  for (size_t i = SavedRegPairs.size(); i > (IsSaveAreaPushed ? 1 : 0); i--) {
+    auto [Reg1, Reg2] = SavedRegPairs[i - 1];
+    const auto Offset = GetSavePosition(Func, Reg1) - Base;
+
+    MachineInstruction LDP;
+    if (Reg2 != ~0u && TM->CreateLoadPair(LDP, Reg1, Reg2, Offset, false)) {
+      Epilogue.push_back(LDP);
+      continue;
+    }
 
-  for (auto Reg : Func.GetUsedCalleSavedRegs()) {
-    auto LOAD = CreateLOAD(Func, Reg);
-    RetBB.InsertInstr(LOAD, RetBB.GetInstructions().size() - 1 - Counter);
-    Counter++;
+    if (Reg2 != ~0u)
+      Epilogue.push_back(CreateLOAD(Func, Reg2, Offset + SlotSize));
+    Epilogue.push_back(CreateLOAD(Func, Reg1, Offset));
+  }
+
+  if (IsSaveAreaPushed) {
+    MachineInstruction Pop;
+    TM->CreateLoadPair(Pop, SavedRegPairs[0].first, SavedRegPairs[0].second,
+                       FrameSize - SaveAreaStart, true);
+    Epilogue.push_back(Pop);
+  } else
+    Epilogue.push_back(CreateADDInstruction(FrameSize));
+
+  for (auto Idx : RestoreBlockIdxs) {
+    auto &RestoreBB = Func.GetBasicBlocks()[Idx];
+    auto Exit = FindEpiloguePoint(TM, RestoreBB.GetInstructions());
+    if (Exit != RestoreBB.GetInstructions().end())
+      RestoreBB.InsertBefore(Epilogue, &*Exit);
+    else
+      for (auto &MI : Epilogue)
+        RestoreBB.InsertInstr(MI);
   }
 }
 
 void PrologueEpilogInsertion::Run() {
   for (auto &Func : MIRM->GetFunctions()) {
-    // if there is no stack frame then do not emit adjustments
-    if (Func.GetStackFrameSize() == 0 && Func.GetUsedCalleSavedRegs().empty())
+    // Leaf functions without stack objects and clobbered callee saved
+    // registers do not need a frame at all
+    if (Func.GetStackFrameSize() == 0 &&
+        Func.GetUsedCalleSavedRegs().empty() && !Func.IsCaller())
       continue;
 
     // reset state before processing a new function
     LocalPhysRegToStackSlotMap.clear();
-    MBBWithRetIdx = ~0;
     NextStackSlot = 10000;
 
-    for (auto CalleSavedReg : Func.GetUsedCalleSavedRegs()) {
-      Func.GetStackFrame().InsertStackSlot(NextStackSlot,
-                                           TM->GetPointerSize() / 8,
-                                           TM->GetPointerSize() / 8);
-      LocalPhysRegToStackSlotMap[CalleSavedReg] = NextStackSlot++;
-    }
-
-    if (Func.IsCaller()) {
-      Func.GetStackFrame().InsertStackSlot(NextStackSlot, TM->GetPointerSize() / 8, 16);
-      LocalPhysRegToStackSlotMap[TM->GetRegInfo()->GetLinkRegister()] = NextStackSlot++;
-    }
-
-    // find where the ret is
-    for (size_t i = 0; i < Func.GetBasicBlocks().size(); i++) {
-      for (auto &MI : Func.GetBasicBlocks()[i].GetInstructions())
-        if (TM->GetInstrDefs()->GetTargetInstr(MI.GetOpcode())->IsReturn()) {
-          MBBWithRetIdx = i;
-          break;
-        }
-      // break out from the outer loop aswell
-      if (MBBWithRetIdx != ~0u)
-        break;
-    }
-
-    assert(MBBWithRetIdx != ~0u && "Have not found a return instruction");
-
-    InsertStackAdjustmentUpward(Func);
-    InsertLinkRegisterSave(Func);
-    SpillClobberedCalleeSavedRegisters(Func);
-    ReloadClobberedCalleeSavedRegisters(Func);
-    InsertLinkRegisterReload(Func);
-    InsertStackAdjustmentDownward(Func);
+    // The saved registers are placed at the top of the frame in consecutive
+    // slots, starting with the link register. The area is aligned to 16, so
+    // it can be allocated separately from the rest of the frame.
+    const auto SlotSize = TM->GetPointerSize() / 8;
+    const auto FirstSaveSlot = NextStackSlot;
+    auto InsertSaveSlot = [&](unsigned Reg) {
+      const auto Align = NextStackSlot == FirstSaveSlot ? 16 : SlotSize;
+      Func.GetStackFrame().InsertStackSlot(NextStackSlot, SlotSize, Align);
+      LocalPhysRegToStackSlotMap[Reg] = NextStackSlot++;
+    };
+
+    if (Func.IsCaller())
+      InsertSaveSlot(TM->GetRegInfo()->GetLinkRegister());
+    for (auto CalleSavedReg : Func.GetUsedCalleSavedRegs())
+      InsertSaveSlot(CalleSavedReg);
+
+    FrameSize = GetNextAlignedValue(Func.GetStackFrameSize(),
+                                    TM->GetABI()->GetStackAlignment());
+    SaveAreaStart = FrameSize;
+    if (NextStackSlot != FirstSaveSlot)
+      SaveAreaStart = Func.GetStackObjectPosition(FirstSaveSlot);
+
+    ComputeSaveAndRestorePoints(Func);
+    assert(!RestoreBlockIdxs.empty() && "Have not found a return instruction");
+
+    CollectSavedRegPairs(Func);
+    InsertPrologue(Func);
+    InsertEpilogue(Func);
   }
-}
\ No newline at end of file
+}
@@ -13,23 +13,56 @@ public:
 
   MachineInstruction CreateADDInstruction(int64_t StackAdjustmentSize);
 
-  void InsertLinkRegisterSave(MachineFunction &Func);
-  void InsertLinkRegisterReload(MachineFunction &Func);
-  void InsertStackAdjustmentUpward(MachineFunction &Func);
-  void InsertStackAdjustmentDownward(MachineFunction &Func);
-  // TODO: naming inconsistency...
-  void SpillClobberedCalleeSavedRegisters(MachineFunction &Func);
-  void ReloadClobberedCalleeSavedRegisters(MachineFunction &Func);
+  /// Allocate the stack frame and save the link register and the clobbered
+  /// callee saved registers.
+  void InsertPrologue(MachineFunction &Func);
+  /// Restore the saved registers and deallocate the stack frame.
+  void InsertEpilogue(MachineFunction &Func);
 
 private:
-  MachineInstruction CreateSTORE(MachineFunction &Func, unsigned Register);
-  MachineInstruction CreateLOAD(MachineFunction &Func, unsigned Register);
+  MachineInstruction CreateSTORE(MachineFunction &Func, unsigned Register,
+                                 int64_t Offset);
+  MachineInstruction CreateLOAD(MachineFunction &Func, unsigned Register,
+                                int64_t Offset);
+
+  /// Return the position of the slot where @Register is saved.
+  int64_t GetSavePosition(MachineFunction &Func, unsigned Register);
+
+  /// Return true if @MI accesses the stack, calls or touches a callee saved
+  /// register, so it must be executed between the prologue and the epilogue.
+  bool NeedsFrame(MachineFunction &Func, MachineInstruction &MI);
+
+  /// Find the blocks where the prologue and the epilogues are inserted. By
+  /// default that is the entry and every returning block, but with
+  /// shrink-wrapping the prologue is moved to the nearest common dominator of
+  /// the blocks needing the frame and the epilogue to their nearest common
+  /// post-dominator, so paths not needing it do not pay for the frame.
+  void ComputeSaveAndRestorePoints(MachineFunction &Func);
+
+  /// Group the saved registers into pairs of consecutive slots, if the target
+  /// can save and restore them with one instruction.
+  void CollectSavedRegPairs(MachineFunction &Func);
 
   MachineIRModule *MIRM;
   TargetMachine *TM;
 
-  /// The index of the Machine Basic Block, which contains a return instruction.
-  unsigned MBBWithRetIdx = ~0;
+  /// The index of the block where the prologue is inserted at the beginning
+  unsigned SaveBlockIdx = 0;
+  /// The indices of the blocks where the epilogue is inserted before the first
+  /// branch or return instruction, or at the end if there is none
+  std::vector<unsigned> RestoreBlockIdxs;
+
+  /// The saved registers in the order of their slots, the link register first.
+  /// The second register of a pair is ~0 if the register is saved alone.
+  std::vector<std::pair<unsigned, unsigned>> SavedRegPairs;
+
+  /// Size of the whole frame, aligned to the stack alignment
+  int64_t FrameSize = 0;
+  /// Start of the save area, which is at the top of the frame
+  int64_t SaveAreaStart = 0;
+  /// True if the save area is allocated by pushing the first saved registers,
+  /// so the offsets of the saves are relative to the save area
+  bool IsSaveAreaPushed = false;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -27,7 +27,7 @@ void PreAllocateParameters(MachineFunction &Func, TargetMachine *TM,
     // set the parameter live
     LiveRanges[ParamID] = {0, ~0};
 
-    TargetRegister *CurrArgReg = nullptr;
+    const TargetRegister *CurrArgReg = nullptr;
     if (IsImplStructPtr)
         CurrArgReg = TM->GetRegInfo()->GetRegisterByID(
                               TM->GetRegInfo()->GetStructPtrRegister());
@@ -66,8 +66,9 @@ void PreAllocateReturnRegister(
       if (auto TargetInstr = TM->GetInstrDefs()->GetTargetInstr(Opcode);
           TargetInstr->IsReturn()) {
         // if the ret has no operands it means the function ret type is void and
-        // therefore does not need allocation for return registers
-        if (It->GetOperandsNumber() == 0)
+        // therefore does not need allocation for return registers. Tail calls
+        // leave the return value to the callee.
+        if (It->GetOperandsNumber() == 0 || TargetInstr->IsTailCall())
           continue;
 
         const auto RetValSize = It->GetOperands()[0].GetSize();
@@ -82,21 +83,25 @@ void PreAllocateReturnRegister(
     }
 }
 
-PhysicalReg GetNextAvailableReg(MachineOperand *MOperand,
-                                std::set<PhysicalReg> &Pool,
-                                std::set<PhysicalReg> &BackupPool,
-                                TargetMachine *TM, MachineFunction &MFunc) {
-  // TODO: implement spilling and remove this assertion then
-  assert(!(Pool.empty() && BackupPool.empty()) && "Ran out of registers");
-
-  if (Pool.empty()) {
-    const auto BackupReg = *BackupPool.begin();
-    Pool.insert(BackupReg);
-    MFunc.GetUsedCalleSavedRegs().push_back(BackupReg);
-    BackupPool.erase(BackupReg);
-  }
-
-  for (auto UnAllocatedReg : Pool) {
+/// Return a register from @Pool, which or which sub register matches the
+/// register class of @MOperand, or ~0 if there is none. The found register is
+/// removed from the pool. The registers never freed are tried first, then the
+/// ones freed the earliest according to @FreedAt.
+static PhysicalReg
+TakeRegFromPool(MachineOperand *MOperand, std::set<PhysicalReg> &Pool,
+                TargetMachine *TM,
+                const std::map<PhysicalReg, unsigned> &FreedAt) {
+  std::vector<PhysicalReg> Order(Pool.begin(), Pool.end());
+  auto GetFreedAt = [&FreedAt](PhysicalReg Reg) {
+    auto It = FreedAt.find(Reg);
+    return It == FreedAt.end() ? 0 : It->second;
+  };
+  std::stable_sort(Order.begin(), Order.end(),
+                   [&GetFreedAt](PhysicalReg A, PhysicalReg B) {
+                     return GetFreedAt(A) < GetFreedAt(B);
+                   });
+
+  for (auto UnAllocatedReg : Order) {
     // If the register class matches the requested operand's class, then return
     // this register and delete it from the pool
     if (TM->GetRegInfo()->GetRegClassFromReg(UnAllocatedReg) ==
@@ -116,10 +121,151 @@ PhysicalReg GetNextAvailableReg(MachineOperand *MOperand,
     }
   }
 
-  assert(!"Have not found the right registers");
+  return ~0u;
+}
+
+PhysicalReg
+GetNextAvailableReg(MachineOperand *MOperand, std::set<PhysicalReg> &Pool,
+                    std::set<PhysicalReg> &BackupPool, TargetMachine *TM,
+                    MachineFunction &MFunc,
+                    const std::map<PhysicalReg, unsigned> &FreedAt) {
+  if (auto Reg = TakeRegFromPool(MOperand, Pool, TM, FreedAt); Reg != ~0u)
+    return Reg;
+
+  // The callee saved registers are only used if there is no free register of
+  // the required class, since they have to be saved in the prologue
+  for (auto BackupReg : BackupPool) {
+    std::set<PhysicalReg> Candidate = {BackupReg};
+    if (auto Reg = TakeRegFromPool(MOperand, Candidate, TM, FreedAt);
+        Reg != ~0u) {
+      MFunc.GetUsedCalleSavedRegs().push_back(BackupReg);
+      BackupPool.erase(BackupReg);
+      return Reg;
+    }
+  }
+
+  // TODO: implement spilling and remove this assertion then
+  assert(!"Ran out of registers");
   return 0;
 }
 
+/// If more values are live at some point than the number of allocatable
+/// registers, then rematerialize the constants live there instead of keeping
+/// them in registers: their definition is cloned before each of their uses,
+/// so their live ranges shrink to these uses. With profile data the constants
+/// used in the coldest blocks are rematerialized first and only while the
+/// pressure is still too high, so the hot ones are kept in registers.
+static void RematerializeUnderPressure(MachineFunction &Func,
+                                       TargetMachine *TM, unsigned RegsNum) {
+  // Compute the live ranges on the linear order of the instructions, like
+  // RunRA does, and collect the defining instructions of the registers
+  std::vector<MachineInstruction *> Instrs;
+  LiveRangeMap LiveRanges;
+  std::map<VirtualReg, MachineInstruction *> Defs;
+  std::set<VirtualReg> Redefined;
+  for (auto &BB : Func.GetBasicBlocks())
+    for (auto &Instr : BB.GetInstructions()) {
+      const unsigned Idx = Instrs.size();
+      for (size_t i = 0; i < Instr.GetOperandsNumber(); i++) {
+        auto &Operand = Instr.GetOperands()[i];
+        if (!Operand.IsVirtualReg() && !Operand.IsParameter() &&
+            !Operand.IsMemory())
+          continue;
+
+        const auto Reg = Operand.GetReg();
+        if (LiveRanges.count(Reg) == 0) {
+          LiveRanges[Reg] = {Idx, Idx};
+          if (i == 0 && Operand.IsVirtualReg())
+            Defs[Reg] = &Instr;
+        } else {
+          LiveRanges[Reg].second = Idx;
+          if (i == 0 && TM->GetInstrDefs()
+                            ->GetTargetInstr(Instr.GetOpcode())
+                            ->IsTiedDef())
+            Redefined.insert(Reg);
+        }
+      }
+      Instrs.push_back(&Instr);
+    }
+
+  std::vector<unsigned> Pressure(Instrs.size() + 1, 0);
+  for (const auto &[Reg, LiveRange] : LiveRanges) {
+    Pressure[LiveRange.first]++;
+    Pressure[LiveRange.second + 1]--;
+  }
+  for (size_t i = 1; i < Pressure.size(); i++)
+    Pressure[i] += Pressure[i - 1];
+
+  auto &BBs = Func.GetBasicBlocks();
+  const bool HasProfile =
+      std::any_of(BBs.begin(), BBs.end(), [](MachineBasicBlock &BB) {
+        return BB.GetCount().has_value();
+      });
+
+  // The constants are weighted by the execution count of their uses
+  std::vector<std::pair<VirtualReg, uint64_t>> Candidates;
+  for (const auto &[Reg, DefMI] : Defs) {
+    uint64_t UseCount = 0;
+    for (unsigned Idx = LiveRanges[Reg].first + 1;
+         HasProfile && Idx <= LiveRanges[Reg].second; Idx++)
+      for (auto &Operand : Instrs[Idx]->GetOperands())
+        if (Operand.IsVirtualReg() && Operand.GetReg() == Reg)
+          UseCount += Instrs[Idx]->GetParent()->GetCount().value_or(0);
+    Candidates.push_back({Reg, UseCount});
+  }
+  std::stable_sort(Candidates.begin(), Candidates.end(),
+                   [](const std::pair<VirtualReg, uint64_t> &L,
+                      const std::pair<VirtualReg, uint64_t> &R) {
+                     return L.second < R.second;
+                   });
+
+  std::vector<MachineInstruction *> Rematerialized;
+  for (const auto &[Reg, UseCount] : Candidates) {
+    auto DefMI = Defs[Reg];
+    const auto [DefLine, KillLine] = LiveRanges[Reg];
+    if (Redefined.count(Reg) || !TM->IsRematerializable(DefMI))
+      continue;
+
+    if (std::none_of(Pressure.begin() + DefLine, Pressure.begin() + KillLine,
+                     [RegsNum](unsigned P) { return P > RegsNum; }))
+      continue;
+
+    for (unsigned Idx = DefLine + 1; Idx <= KillLine; Idx++) {
+      auto UseMI = Instrs[Idx];
+      auto IsUse = [Reg = Reg](MachineOperand &Operand) {
+        return (Operand.IsVirtualReg() || Operand.IsMemory()) &&
+               Operand.GetReg() == Reg;
+      };
+      auto &Operands = UseMI->GetOperands();
+      if (std::none_of(Operands.begin(), Operands.end(), IsUse))
+        continue;
+
+      const auto NewReg = Func.GetNextAvailableVReg();
+      for (auto &Operand : Operands)
+        if (IsUse(Operand))
+          Operand.SetReg(NewReg);
+
+      MachineInstruction Clone = *DefMI;
+      Clone.GetOperand(0)->SetReg(NewReg);
+      Clone.SetParent(UseMI->GetParent());
+      UseMI->GetParent()->InsertBefore(std::move(Clone), UseMI);
+
+      // The clones are only live at the uses
+      if (HasProfile)
+        Pressure[Idx]++;
+    }
+
+    if (HasProfile)
+      for (unsigned Idx = DefLine; Idx <= KillLine; Idx++)
+        Pressure[Idx]--;
+
+    Rematerialized.push_back(DefMI);
+  }
+
+  for (auto DefMI : Rematerialized)
+    DefMI->GetParent()->Erase(DefMI);
+}
+
 // TODO: Add handling for spilling registers
 void RegisterAllocator::RunRA() {
   for (auto &Func : MIRM->GetFunctions()) {
@@ -173,6 +319,13 @@ void RegisterAllocator::RunRA() {
     for (auto Reg : RegsToBeRemoved)
         RegisterPool.erase(Reg);
 
+    // Values are mostly integers, so only the integer registers are counted
+    unsigned GPRsNum = 0;
+    for (auto Pool : {&RegisterPool, &BackupRegisterPool})
+      for (auto Reg : *Pool)
+        GPRsNum += !TM->GetRegInfo()->GetRegisterByID(Reg)->IsFP();
+    RematerializeUnderPressure(Func, TM, GPRsNum);
+
     // Calculating the live ranges for the virtual registers
     unsigned InstrCounter = 0;
     for (auto &BB : Func.GetBasicBlocks())
@@ -242,6 +395,12 @@ void RegisterAllocator::RunRA() {
     std::cout << std::endl;
 #endif
 
+    // When the instructions are scheduled afterwards, the register freed the
+    // earliest is reused first, so the independent values do not share
+    // registers and the scheduler can interleave them
+    std::map<PhysicalReg, unsigned> FreedAt;
+    unsigned FreeCount = 0;
+
     // To keep track the already allocated, but not yet freed live ranges
     std::vector<std::tuple<unsigned, unsigned, unsigned>> FreeAbleWorkList;
     for (const auto &[VReg, DefLine, KillLine] : SortedLiveRanges) {
@@ -269,6 +428,8 @@ void RegisterAllocator::RunRA() {
           << std::endl;
 #endif
           RegisterPool.insert(RegisterPool.begin(), FreeAbleReg);
+          if (RotateRegisters)
+            FreedAt[FreeAbleReg] = ++FreeCount;
           FreeAbleWorkList.erase(FreeAbleWorkList.begin() + i);
           i--; // to correct the index i, because of the erase
         }
@@ -278,7 +439,7 @@ void RegisterAllocator::RunRA() {
       if (AllocatedRegisters.count(VReg) == 0) {
         AllocatedRegisters[VReg] =
             GetNextAvailableReg(VRegToMOMap[VReg], RegisterPool,
-                                BackupRegisterPool, TM, Func);
+                                BackupRegisterPool, TM, Func, FreedAt);
         FreeAbleWorkList.push_back({VReg, DefLine, KillLine});
       }
 #ifdef DEBUG
@@ -344,7 +505,8 @@ void RegisterAllocator::RunRA() {
             unsigned Reg =
                 Operand.IsVirtual() ? AllocatedRegisters[BaseReg] : BaseReg;
 
-            auto RegSize = TM->GetRegInfo()->GetRegister(Reg)->GetBitWidth();
+            auto RegSize =
+                TM->GetRegInfo()->GetRegisterByID(Reg)->GetBitWidth();
             Instr.RemoveMemOperand();
             Instr.AddRegister(Reg, RegSize);
             Instr.AddImmediate(Offset);
@@ -6,14 +6,18 @@
 
 class RegisterAllocator {
 public:
-  RegisterAllocator(MachineIRModule *Module, TargetMachine *TM)
-      : MIRM(Module), TM(TM) {}
+  /// If @RotateRegisters is set, the freed registers are reused in the order
+  /// they were freed instead of the lowest numbered one first.
+  RegisterAllocator(MachineIRModule *Module, TargetMachine *TM,
+                    bool RotateRegisters = false)
+      : MIRM(Module), TM(TM), RotateRegisters(RotateRegisters) {}
 
   void RunRA();
 
 private:
   MachineIRModule *MIRM;
   TargetMachine *TM;
+  bool RotateRegisters;
 };
 
 #endif
@@ -40,10 +40,9 @@ void RegisterClassSelection::Run() {
     ParameterCounter = 0;
 
     for (auto &MBB : MFunc.GetBasicBlocks())
-      for (size_t i = 0; i < MBB.GetInstructions().size(); i++)
-        for (size_t op_idx = 0;
-             op_idx < MBB.GetInstructions()[i].GetOperandsNumber(); op_idx++) {
-          MachineInstruction *MI = &MBB.GetInstructions()[i];
+      for (auto &Instr : MBB.GetInstructions())
+        for (size_t op_idx = 0; op_idx < Instr.GetOperandsNumber(); op_idx++) {
+          MachineInstruction *MI = &Instr;
           MachineOperand *Op = MI->GetOperand(op_idx);
 
           // if it is a store instruction accessing the stack, then map the
@@ -107,7 +106,18 @@ void RegisterClassSelection::Run() {
             continue;
           }
 
-          const bool IsFP = IsFPInstruction(&MBB.GetInstructions()[i], op_idx);
+          // The result of a select is in the class of its sources
+          bool IsFP = false;
+          if (MI->GetOpcode() == MachineInstruction::SELECT && op_idx == 0)
+            for (size_t i = 2; i < MI->GetOperandsNumber(); i++)
+              if (auto Src = MI->GetOperand(i);
+                  Src->IsVirtualReg() && VRegToRegClass.count(Src->GetReg()))
+                IsFP |= VRegToRegClass[Src->GetReg()] ==
+                        TM->GetRegInfo()->GetRegisterClass(Src->GetSize(),
+                                                           true);
+
+          // Vectors live in the floating point registers
+          IsFP |= IsFPInstruction(MI, op_idx) || Op->GetType().IsVector();
           unsigned RC = TM->GetRegInfo()->GetRegisterClass(Op->GetSize(), IsFP);
           assert(TM->GetRegInfo()->GetRegClassRegsSize(RC) >= Op->GetSize());
           Op->SetRegClass(RC);
@@ -3,6 +3,7 @@
 
 #include "TargetRegister.hpp"
 #include <cassert>
+#include <string>
 
 class RegisterInfo {
 public:
@@ -14,15 +15,15 @@ public:
   virtual unsigned GetStackRegister() { return 0; }
   virtual unsigned GetStructPtrRegister() { return ~0; }
   virtual unsigned GetZeroRegister(const unsigned BitWidth) { return ~0; }
-  virtual TargetRegister *GetParentReg(unsigned ID) {
+  virtual const TargetRegister *GetParentReg(unsigned ID) {
     assert(!"Unimplemented");
     return nullptr;
   }
-  virtual TargetRegister *GetRegister(unsigned i) {
+  virtual const TargetRegister *GetRegister(unsigned i) {
     assert(!"Unimplemented");
     return nullptr;
   }
-  virtual TargetRegister *GetRegisterByID(unsigned i) {
+  virtual const TargetRegister *GetRegisterByID(unsigned i) {
     assert(!"Unimplemented");
     return nullptr;
   }
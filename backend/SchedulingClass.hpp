@@ -0,0 +1,41 @@
+#ifndef SCHEDULING_CLASS_HPP
+#define SCHEDULING_CLASS_HPP
+
+/// Describes how a target instruction executes on an in-order core. The
+/// instruction scheduler orders the instructions, so their results are ready
+/// when they are read and their units are free when they are issued.
+struct SchedulingClass {
+  enum Units : unsigned {
+    /// Takes as many instructions per cycle as the target issues
+    ALU,
+    /// The others take one instruction per cycle
+    MUL_DIV,
+    LOAD_STORE,
+    FP,
+    UNITS_END,
+  };
+
+  enum Properties : unsigned {
+    NONE = 0,
+    /// Writes the condition flags
+    SETS_FLAGS = 1,
+    /// Reads the condition flags
+    READS_FLAGS = 1 << 1,
+    /// Loads or stores the first two operands, like ldp, so the base and the
+    /// offset are the third and the fourth ones
+    PAIR = 1 << 2,
+    /// Updates the base register of the memory access
+    WRITEBACK = 1 << 3,
+    PAIR_WRITEBACK = PAIR | WRITEBACK,
+  };
+
+  /// The cycles after the issue, when the result can be read
+  unsigned Latency = 1;
+  unsigned Unit = ALU;
+  /// The cycles the unit cannot take another instruction, more than one for
+  /// the ones not pipelined, like the dividers
+  unsigned Occupancy = 1;
+  unsigned Properties = NONE;
+};
+
+#endif
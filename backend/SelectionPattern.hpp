@@ -0,0 +1,55 @@
+#ifndef SELECTION_PATTERN_HPP
+#define SELECTION_PATTERN_HPP
+
+#include <vector>
+
+/// Refers to an operand of the matched instructions, from which the operands
+/// of the result instruction are built.
+struct PatternOperand {
+  enum Kinds : unsigned {
+    ROOT,    ///< Operand of the root instruction
+    INNER,   ///< Operand of the instruction folded into the root
+    ADDRESS, ///< Memory address: inner register operand plus inner immediate
+  };
+
+  unsigned Kind;
+  unsigned Index;
+  unsigned OffsetIndex = 0;
+};
+
+constexpr PatternOperand Root(unsigned Index) {
+  return {PatternOperand::ROOT, Index};
+}
+constexpr PatternOperand Inner(unsigned Index) {
+  return {PatternOperand::INNER, Index};
+}
+constexpr PatternOperand Address(unsigned Base, unsigned Offset) {
+  return {PatternOperand::ADDRESS, Base, Offset};
+}
+
+/// Describes a two level tree pattern: the LLIR instruction Root whose
+/// FoldedOperand is defined by the LLIR instruction Inner. If the pattern
+/// matches, then the two instructions are replaced by a single Result
+/// instruction. Result can be an LLIR opcode as well, in which case it will go
+/// through the normal instruction selection.
+struct SelectionPattern {
+  enum Predicates : unsigned {
+    /// Every Root and Inner operand is a register
+    REGISTERS,
+    /// Same as REGISTERS, except for the last Inner operand which must be an
+    /// immediate shift amount
+    SHIFTED_REGISTER,
+    /// The Inner instruction computes a register plus an immediate which fits
+    /// into the target's load/store offset
+    MEM_OFFSET,
+  };
+
+  unsigned RootOpcode;
+  unsigned FoldedOperand;
+  unsigned InnerOpcode;
+  unsigned Predicate;
+  unsigned ResultOpcode;
+  std::vector<PatternOperand> ResultOperands;
+};
+
+#endif
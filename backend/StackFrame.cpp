@@ -1,51 +1,105 @@
 #include "StackFrame.hpp"
 #include "Support.hpp"
+#include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <vector>
 
 void StackFrame::InsertStackSlot(unsigned ID, unsigned Size, unsigned Align) {
   assert(StackSlots.count(ID) == 0 && "Already existing object on the stack");
 
-  ObjectsSize = GetNextAlignedValue(ObjectsSize, Align);
-  ObjectsSize += Size;
-  
   StackSlots.insert({ID, {Size, Align}});
+
+  // The already placed objects must keep their positions
+  if (IsLayoutComputed) {
+    Positions[ID] = GetNextAlignedValue(ObjectsSize, Align);
+    ObjectsSize = Positions[ID] + Size;
+  }
 }
 
-unsigned StackFrame::GetPosition(unsigned ID) {
-  assert(IsStackSlot(ID) && "Must be a valid stack slot ID");
+void StackFrame::ShareStackSlot(unsigned ID, unsigned SharedID) {
+  assert(!IsLayoutComputed && "The layout is already computed");
+  assert(IsStackSlot(ID) && IsStackSlot(SharedID) && ID != SharedID);
+  assert(SharedSlots.count(SharedID) == 0 &&
+         "Must share the memory of an object which owns it");
 
-  unsigned Position = 0;
+  SharedSlots[ID] = SharedID;
+}
 
-  for (const auto &[ObjectID, ObjectSizeAndAlign] : StackSlots) {
-    const auto [ObjectSize, ObjectAlign] = ObjectSizeAndAlign;
+void StackFrame::ComputeLayout() {
+  // The memory of the objects sharing it must be suitable for each of them
+  std::map<unsigned, StackObject> Owners;
+  for (const auto &[ID, Object] : StackSlots)
+    if (SharedSlots.count(ID) == 0)
+      Owners[ID] = Object;
 
-    // If the stack object is what we are looking for
-    if (ObjectID == ID)
-      // then return its aligned position
-      return GetNextAlignedValue(Position, ObjectAlign);
+  for (const auto &[ID, SharedID] : SharedSlots) {
+    auto &Owner = Owners[SharedID];
+    Owner.Size = std::max(Owner.Size, StackSlots[ID].Size);
+    Owner.Align = std::max(Owner.Align, StackSlots[ID].Align);
+  }
 
-    Position = GetNextAlignedValue(Position, ObjectAlign);
-    Position += ObjectSize;
+  // Decreasing alignment leaves no padding between the objects, since the
+  // sizes are multiples of the alignments
+  std::vector<std::pair<unsigned, StackObject>> Order(Owners.begin(),
+                                                      Owners.end());
+  std::stable_sort(Order.begin(), Order.end(), [](auto &LHS, auto &RHS) {
+    return LHS.second.Align > RHS.second.Align;
+  });
+
+  ObjectsSize = 0;
+  for (const auto &[ID, Object] : Order) {
+    Positions[ID] = GetNextAlignedValue(ObjectsSize, Object.Align);
+    ObjectsSize = Positions[ID] + Object.Size;
   }
 
-  return ~0; // Error
+  for (const auto &[ID, SharedID] : SharedSlots)
+    Positions[ID] = Positions[SharedID];
+
+  IsLayoutComputed = true;
+}
+
+unsigned StackFrame::GetSize() {
+  if (!IsLayoutComputed)
+    ComputeLayout();
+
+  return ObjectsSize;
+}
+
+unsigned StackFrame::GetPosition(unsigned ID) {
+  assert(IsStackSlot(ID) && "Must be a valid stack slot ID");
+
+  if (!IsLayoutComputed)
+    ComputeLayout();
+
+  return Positions[ID];
 }
 
 unsigned StackFrame::GetSize(unsigned ID) {
   assert(IsStackSlot(ID) && "Must be a valid stack slot ID");
 
-  return StackSlots[ID].first;
+  return StackSlots[ID].Size;
+}
+
+unsigned StackFrame::GetAlign(unsigned ID) {
+  assert(IsStackSlot(ID) && "Must be a valid stack slot ID");
+
+  return StackSlots[ID].Align;
 }
 
 void StackFrame::Print() const {
-  unsigned Number = 0;
-  std::cout << "\t\tFrameSize: " << ObjectsSize << std::endl;
+  if (IsLayoutComputed)
+    std::cout << "\t\tFrameSize: " << ObjectsSize << std::endl;
 
-  for (const auto &FrameObj : StackSlots)
-    std::cout << "\t\tPosition: " << Number++ << ", ID: " << FrameObj.first
-              << ", Size: " << FrameObj.second.first
-              << ", Align: " << FrameObj.second.second << std::endl;
+  for (const auto &[ID, Object] : StackSlots) {
+    std::cout << "\t\tID: " << ID << ", Size: " << Object.Size
+              << ", Align: " << Object.Align;
+    if (IsLayoutComputed)
+      std::cout << ", Position: " << Positions.at(ID);
+    if (SharedSlots.count(ID))
+      std::cout << ", Shared with: " << SharedSlots.at(ID);
+    std::cout << std::endl;
+  }
 
   std::cout << std::endl;
 }
@@ -2,31 +2,51 @@
 #define STACKFRAME_HPP
 
 #include <map>
+#include <unordered_map>
 
+/// The objects of a function's frame. Their positions are computed once,
+/// when first requested: objects are ordered by decreasing alignment to
+/// minimize the padding, and objects with disjoint lifetimes may share their
+/// memory. Objects inserted afterwards are placed on the top of the frame.
 class StackFrame {
-  using StackSlotMap = std::map<unsigned, std::pair<unsigned, unsigned>>;
+  struct StackObject {
+    unsigned Size;
+    unsigned Align;
+  };
 
 public:
   StackFrame() {}
 
-  unsigned GetSize() const { return ObjectsSize; }
+  unsigned GetSize();
   unsigned GetEntriesCount() const { return StackSlots.size(); }
 
   void InsertStackSlot(unsigned ID, unsigned Size, unsigned Align);
 
   bool IsStackSlot(unsigned ID) const { return 0 != StackSlots.count(ID); }
 
+  /// Place the object @ID at the position of @SharedID. Must be called before
+  /// the layout is computed.
+  void ShareStackSlot(unsigned ID, unsigned SharedID);
+
   unsigned GetPosition(unsigned ID);
   unsigned GetSize(unsigned ID);
+  unsigned GetAlign(unsigned ID);
 
   void Print() const;
 
 private:
+  void ComputeLayout();
+
   unsigned ObjectsSize = 0;
+  bool IsLayoutComputed = false;
+
+  // Maps an object ID to its size and alignment.
+  std::map<unsigned, StackObject> StackSlots;
+
+  /// Maps objects to the object whose memory they share
+  std::map<unsigned, unsigned> SharedSlots;
 
-  // Maps an object ID to Its size and alignment. The order of the entries
-  // represents the order of the objects pushed to the stack.
-  StackSlotMap StackSlots;
+  std::unordered_map<unsigned, unsigned> Positions;
 };
 
 #endif
@@ -0,0 +1,130 @@
+#include "StackSlotColoring.hpp"
+#include <cassert>
+#include <vector>
+
+/// Collect the slots read and written by @MI. @Kills are the slots which are
+/// entirely overwritten, so their previous values are dead.
+static void GetSlotDefsAndUses(MachineFunction &Func, MachineInstruction &MI,
+                               std::vector<unsigned> &Defs,
+                               std::vector<unsigned> &Kills,
+                               std::vector<unsigned> &Uses,
+                               std::vector<unsigned> &Escapes) {
+  for (size_t i = 0; i < MI.GetOperandsNumber(); i++) {
+    auto MO = MI.GetOperand(i);
+    if (!MO->IsStackAccess())
+      continue;
+
+    const auto Slot = MO->GetSlot();
+    switch (MI.GetOpcode()) {
+    case MachineInstruction::LOAD:
+    case MachineInstruction::SEXT_LOAD:
+    case MachineInstruction::ZEXT_LOAD:
+      Uses.push_back(Slot);
+      break;
+    case MachineInstruction::STORE: {
+      auto Value = MI.GetOperand(MI.GetOperandsNumber() - 1);
+      Defs.push_back(Slot);
+      if (MO->GetOffset() == 0 &&
+          Value->GetSize() / 8 >= Func.GetStackObjectSize(Slot))
+        Kills.push_back(Slot);
+      break;
+    }
+    default:
+      Escapes.push_back(Slot);
+      break;
+    }
+  }
+}
+
+void StackSlotColoring::ComputeInterferences(MachineFunction &Func) {
+  auto &BBs = Func.GetBasicBlocks();
+  const auto Successors = Func.GetSuccessors(TM);
+
+  EscapedSlots.clear();
+  Interferences.clear();
+
+  // Standard backward liveness, a partially written slot stays live
+  std::vector<SlotSet> LiveIns(BBs.size());
+  std::vector<unsigned> Defs, Kills, Uses, Escapes;
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (size_t i = BBs.size(); i-- > 0;) {
+      SlotSet Live;
+      for (auto Succ : Successors[i])
+        Live.insert(LiveIns[Succ].begin(), LiveIns[Succ].end());
+
+      auto &Instrs = BBs[i].GetInstructions();
+      for (auto MI = Instrs.rbegin(); MI != Instrs.rend(); MI++) {
+        Defs.clear();
+        Kills.clear();
+        Uses.clear();
+        Escapes.clear();
+        GetSlotDefsAndUses(Func, *MI, Defs, Kills, Uses, Escapes);
+
+        EscapedSlots.insert(Escapes.begin(), Escapes.end());
+        for (auto Def : Defs)
+          for (auto LiveSlot : Live)
+            if (LiveSlot != Def) {
+              Interferences[Def].insert(LiveSlot);
+              Interferences[LiveSlot].insert(Def);
+            }
+
+        for (auto Kill : Kills)
+          Live.erase(Kill);
+        Live.insert(Uses.begin(), Uses.end());
+      }
+
+      if (LiveIns[i] != Live) {
+        LiveIns[i] = std::move(Live);
+        Changed = true;
+      }
+    }
+  }
+}
+
+void StackSlotColoring::RunOnFunction(MachineFunction &Func) {
+  auto &SF = Func.GetStackFrame();
+  if (SF.GetEntriesCount() < 2)
+    return;
+
+  ComputeInterferences(Func);
+
+  // Greedily give each slot the memory of the first slot it does not
+  // interfere with, together with the other slots already sharing it
+  std::map<unsigned, SlotSet> Owners;
+  for (unsigned ID = 0; ID < Func.GetNextVReg(); ID++) {
+    if (!SF.IsStackSlot(ID))
+      continue;
+
+    if (EscapedSlots.count(ID) > 0) {
+      Owners[ID] = {ID};
+      continue;
+    }
+
+    bool Shared = false;
+    for (auto &[Owner, Members] : Owners) {
+      if (EscapedSlots.count(Owner) > 0)
+        continue;
+
+      bool Interferes = false;
+      for (auto Member : Members)
+        Interferes = Interferes || Interferences[ID].count(Member) > 0;
+
+      if (!Interferes) {
+        SF.ShareStackSlot(ID, Owner);
+        Members.insert(ID);
+        Shared = true;
+        break;
+      }
+    }
+
+    if (!Shared)
+      Owners[ID] = {ID};
+  }
+}
+
+void StackSlotColoring::Run() {
+  for (auto &Func : MIRM->GetFunctions())
+    RunOnFunction(Func);
+}
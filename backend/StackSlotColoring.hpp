@@ -0,0 +1,36 @@
+#ifndef STACK_SLOT_COLORING_HPP
+#define STACK_SLOT_COLORING_HPP
+
+#include "MachineIRModule.hpp"
+#include "TargetMachine.hpp"
+#include <map>
+#include <set>
+
+/// Lets stack objects with disjoint lifetimes share their memory. Runs on the
+/// LLIR, where the stack is still accessed through stack slot operands. Slots
+/// whose address is taken are never shared.
+class StackSlotColoring {
+  using SlotSet = std::set<unsigned>;
+
+public:
+  StackSlotColoring(MachineIRModule *Module, TargetMachine *TM)
+      : MIRM(Module), TM(TM) {}
+
+  void Run();
+
+private:
+  void RunOnFunction(MachineFunction &Func);
+
+  /// Compute which slots are live at the same time as the others. A slot
+  /// interferes with the slots live where it is written.
+  void ComputeInterferences(MachineFunction &Func);
+
+  MachineIRModule *MIRM;
+  TargetMachine *TM;
+
+  /// Slots whose address is taken or which are accessed in unknown ways
+  SlotSet EscapedSlots;
+  std::map<unsigned, SlotSet> Interferences;
+};
+
+#endif
@@ -0,0 +1,261 @@
+#include "StoreMerging.hpp"
+#include "MachineBasicBlock.hpp"
+#include "MachineFunction.hpp"
+#include <algorithm>
+#include <cassert>
+
+static uint64_t GetMask(unsigned Width) {
+  return Width == 64 ? ~0ull : (1ull << Width) - 1;
+}
+
+/// Return true if @MI stores an integer constant, which is narrower than
+/// the registers.
+static bool IsConstantStore(MachineInstruction &MI) {
+  if (MI.GetOpcode() != MachineInstruction::STORE ||
+      MI.GetOperandsNumber() != 2)
+    return false;
+
+  auto Value = MI.GetOperand(1);
+  const unsigned Width = Value->GetSize();
+  return Value->IsImmediate() && !Value->IsFPImmediate() &&
+         (Width == 8 || Width == 16 || Width == 32);
+}
+
+bool StoreMerging::GetAddress(MachineOperand *MO, Address &Addr) {
+  if (MO->IsStackAccess()) {
+    Addr = {true, MO->GetSlot(), MO->GetOffset()};
+    return true;
+  }
+
+  if (!MO->IsMemory() || !MO->IsVirtual())
+    return false;
+
+  if (Addresses.count(MO->GetReg()))
+    Addr = Addresses[MO->GetReg()];
+  else
+    Addr = {false, (uint64_t)MO->GetReg(), 0};
+
+  Addr.Offset += MO->GetOffset();
+  return true;
+}
+
+bool StoreMerging::MayAlias(const Address &A, unsigned ASize,
+                            const Address &B, unsigned BSize) {
+  if (A.IsStackSlot == B.IsStackSlot && A.Base == B.Base)
+    return A.Offset < B.Offset + BSize && B.Offset < A.Offset + ASize;
+
+  // Distinct slots never overlap, but a register might point anywhere
+  if (A.IsStackSlot && B.IsStackSlot)
+    return false;
+
+  if (A.IsStackSlot)
+    return AddressTakenSlots.count(A.Base) != 0;
+  if (B.IsStackSlot)
+    return AddressTakenSlots.count(B.Base) != 0;
+
+  return true;
+}
+
+bool StoreMerging::IsAligned(const Address &Addr, unsigned Width) {
+  if (Addr.Offset % (Width / 8) != 0)
+    return false;
+
+  if (TM->AllowsMisalignedAccess())
+    return true;
+
+  // The alignment of the memory pointed by a register is unknown
+  return Addr.IsStackSlot &&
+         Func->GetStackObjectAlign(Addr.Base) * 8 >= Width;
+}
+
+void StoreMerging::Forget(const Address &Addr, unsigned Size) {
+  Pending.erase(std::remove_if(Pending.begin(), Pending.end(),
+                               [&](PendingStore &PS) {
+                                 const unsigned PSSize =
+                                     PS.MI->GetOperand(1)->GetSize() / 8;
+                                 return MayAlias(PS.Addr, PSSize, Addr, Size);
+                               }),
+                Pending.end());
+}
+
+void StoreMerging::Invalidate(uint64_t Reg) {
+  Addresses.erase(Reg);
+  for (auto It = Addresses.begin(); It != Addresses.end();)
+    if (!It->second.IsStackSlot && It->second.Base == Reg)
+      It = Addresses.erase(It);
+    else
+      It++;
+
+  // The address operand of the pending store is also needed to move it
+  Pending.erase(std::remove_if(Pending.begin(), Pending.end(),
+                               [&](PendingStore &PS) {
+                                 auto MO = PS.MI->GetOperand(0);
+                                 return (!PS.Addr.IsStackSlot &&
+                                         PS.Addr.Base == Reg) ||
+                                        (MO->IsMemory() &&
+                                         (uint64_t)MO->GetReg() == Reg);
+                               }),
+                Pending.end());
+}
+
+void StoreMerging::Merge(MachineInstruction *MI, Address Addr) {
+  const unsigned MaxWidth = TM->GetMemOpChunkSize() * 8;
+
+  for (bool Merged = true; Merged;) {
+    Merged = false;
+    const unsigned Width = MI->GetOperand(1)->GetSize();
+    if (Width * 2 > MaxWidth)
+      break;
+
+    for (auto It = Pending.begin(); It != Pending.end(); It++) {
+      auto Other = It->MI;
+      if (Other->GetOperand(1)->GetSize() != Width ||
+          It->Addr.IsStackSlot != Addr.IsStackSlot ||
+          It->Addr.Base != Addr.Base)
+        continue;
+
+      // The halves of the merged location
+      MachineInstruction *Lo, *Hi;
+      Address LoAddr;
+      if (It->Addr.Offset + Width / 8 == Addr.Offset) {
+        Lo = Other, Hi = MI, LoAddr = It->Addr;
+      } else if (Addr.Offset + Width / 8 == It->Addr.Offset) {
+        Lo = MI, Hi = Other, LoAddr = Addr;
+      } else
+        continue;
+
+      if (!IsAligned(LoAddr, Width * 2))
+        continue;
+
+      const uint64_t Mask = GetMask(Width);
+      const uint64_t Value = (Lo->GetOperand(1)->GetImmediate() & Mask) |
+                             ((Hi->GetOperand(1)->GetImmediate() & Mask)
+                              << Width);
+
+      // The address of the upper half might not be needed anymore
+      if (auto HiAddress = Hi->GetOperand(0); HiAddress->IsMemory())
+        ErasedAddresses.insert(HiAddress->GetReg());
+
+      MI->ReplaceOperand(*Lo->GetOperand(0), 0);
+      MI->ReplaceOperand(MachineOperand::CreateImmediate(Value, Width * 2), 1);
+      Addr = LoAddr;
+      Other->GetParent()->Erase(Other);
+
+      Pending.erase(It);
+      Merged = true;
+      break;
+    }
+  }
+
+  Pending.push_back({MI, Addr});
+}
+
+void StoreMerging::RunOnFunction(MachineFunction &Func) {
+  this->Func = &Func;
+  AddressTakenSlots.clear();
+  ErasedAddresses.clear();
+
+  for (auto &MBB : Func.GetBasicBlocks())
+    for (auto &MI : MBB.GetInstructions())
+      if (MI.GetOpcode() == MachineInstruction::STACK_ADDRESS)
+        AddressTakenSlots.insert(MI.GetOperand(1)->GetSlot());
+
+  for (auto &MBB : Func.GetBasicBlocks()) {
+    Addresses.clear();
+    Pending.clear();
+
+    auto &Instructions = MBB.GetInstructions();
+    for (auto It = Instructions.begin(); It != Instructions.end();) {
+      auto &MI = *It++;
+      Address Addr;
+      const unsigned Opcode = MI.GetOpcode();
+
+      if (MI.IsLoad()) {
+        if (GetAddress(MI.GetOperand(1), Addr))
+          Forget(Addr, MI.GetOperand(0)->GetSize() / 8);
+        else
+          Pending.clear();
+      } else if (MI.IsStore()) {
+        const bool Known = MI.GetOperandsNumber() == 2 &&
+                           GetAddress(MI.GetOperand(0), Addr);
+        if (!Known) {
+          Pending.clear();
+          continue;
+        }
+
+        Forget(Addr, MI.GetOperand(1)->GetSize() / 8);
+        if (IsConstantStore(MI))
+          Merge(&MI, Addr);
+        continue;
+      } else if (Opcode == MachineInstruction::STACK_ADDRESS) {
+        auto Slot = MI.GetOperand(1);
+        Invalidate(MI.GetOperand(0)->GetReg());
+        Addresses[MI.GetOperand(0)->GetReg()] = {true, Slot->GetSlot(),
+                                                 Slot->GetOffset()};
+        continue;
+      } else if (Opcode == MachineInstruction::ADD &&
+                 MI.GetOperand(0)->IsVirtualReg() &&
+                 MI.GetOperand(1)->IsVirtualReg() &&
+                 MI.GetOperand(2)->IsImmediate() &&
+                 !MI.GetOperand(2)->IsFPImmediate() &&
+                 MI.GetOperand(0)->GetReg() != MI.GetOperand(1)->GetReg()) {
+        const uint64_t Base = MI.GetOperand(1)->GetReg();
+        Addr = Addresses.count(Base) ? Addresses[Base]
+                                     : Address{false, Base, 0};
+        Addr.Offset += MI.GetOperand(2)->GetImmediate();
+        Invalidate(MI.GetOperand(0)->GetReg());
+        Addresses[MI.GetOperand(0)->GetReg()] = Addr;
+        continue;
+      } else if (MI.IsCall() || MI.IsJump() || MI.IsReturn() ||
+                 Opcode == MachineInstruction::BRANCH ||
+                 Opcode == MachineInstruction::INDIRECT_JUMP)
+        Pending.clear();
+
+      if (Opcode == MachineInstruction::SPLIT)
+        Invalidate(MI.GetOperand(1)->GetReg());
+      if (MI.IsDef() && MI.GetDef()->IsVirtualReg())
+        Invalidate(MI.GetDef()->GetReg());
+    }
+  }
+
+  // Remove the address computations of the erased stores if they are not
+  // used anymore, including the ones they were computed from
+  std::map<uint64_t, unsigned> Uses;
+  for (auto &MBB : Func.GetBasicBlocks())
+    for (auto &MI : MBB.GetInstructions())
+      for (size_t i = MI.IsDef() ? 1 : 0; i < MI.GetOperandsNumber(); i++)
+        if (auto MO = MI.GetOperand(i);
+            MO->IsVirtualReg() || (MO->IsMemory() && MO->IsVirtual()))
+          Uses[MO->GetReg()]++;
+
+  for (bool Changed = true; Changed;) {
+    Changed = false;
+    for (auto &MBB : Func.GetBasicBlocks()) {
+      auto &Instructions = MBB.GetInstructions();
+      for (auto It = Instructions.begin(); It != Instructions.end();) {
+        auto &MI = *It++;
+        const unsigned Opcode = MI.GetOpcode();
+        if ((Opcode != MachineInstruction::STACK_ADDRESS &&
+             Opcode != MachineInstruction::ADD) ||
+            !MI.GetOperand(0)->IsVirtualReg() ||
+            ErasedAddresses.count(MI.GetOperand(0)->GetReg()) == 0 ||
+            Uses[MI.GetOperand(0)->GetReg()] != 0)
+          continue;
+
+        if (Opcode == MachineInstruction::ADD &&
+            MI.GetOperand(1)->IsVirtualReg()) {
+          const uint64_t Base = MI.GetOperand(1)->GetReg();
+          Uses[Base]--;
+          ErasedAddresses.insert(Base);
+        }
+        MBB.Erase(&MI);
+        Changed = true;
+      }
+    }
+  }
+}
+
+void StoreMerging::Run() {
+  for (auto &Func : MIRM->GetFunctions())
+    RunOnFunction(Func);
+}
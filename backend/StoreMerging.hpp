@@ -0,0 +1,80 @@
+#ifndef STORE_MERGING_HPP
+#define STORE_MERGING_HPP
+
+#include "MachineIRModule.hpp"
+#include "TargetMachine.hpp"
+#include <map>
+#include <set>
+#include <vector>
+
+/// Merges the stores of constants to adjacent locations into a single store of
+/// their combined value, like the element by element initialization of a local
+/// array or the zeroing of the fields of a structure. Two stores of the same
+/// width are merged if they write the halves of a location twice as wide,
+/// which is aligned within the object and not wider than the memory operation
+/// chunks of the target. The merged store takes the place of the later one,
+/// so the earlier store must not be read, overwritten or skipped by the
+/// instructions in between. Runs on the LLIR, before the legalizer moves the
+/// stored immediates into registers.
+class StoreMerging {
+public:
+  StoreMerging(MachineIRModule *Module, TargetMachine *TM)
+      : MIRM(Module), TM(TM) {}
+
+  void Run();
+
+private:
+  /// A location at an offset from a stack slot or from the value of a virtual
+  /// register.
+  struct Address {
+    bool IsStackSlot;
+    uint64_t Base;
+    int64_t Offset;
+  };
+
+  /// A store of a constant, which might be merged with a later one.
+  struct PendingStore {
+    MachineInstruction *MI;
+    Address Addr;
+  };
+
+  void RunOnFunction(MachineFunction &Func);
+
+  /// Return true if the location accessed through @MO is known relative to a
+  /// base and set @Addr to it.
+  bool GetAddress(MachineOperand *MO, Address &Addr);
+
+  /// Return true if the @ASize bytes at @A and the @BSize bytes at @B might
+  /// overlap.
+  bool MayAlias(const Address &A, unsigned ASize, const Address &B,
+                unsigned BSize);
+
+  /// Return true if an access of @Width bits at @Addr is allowed.
+  bool IsAligned(const Address &Addr, unsigned Width);
+
+  /// Drop the pending stores, which might overlap the @Size bytes at @Addr.
+  void Forget(const Address &Addr, unsigned Size);
+
+  /// Forget the addresses and the pending stores depending on @Reg.
+  void Invalidate(uint64_t Reg);
+
+  /// Merge the constant store @MI to @Addr with the pending stores as long as
+  /// possible, then make the result pending.
+  void Merge(MachineInstruction *MI, Address Addr);
+
+  MachineIRModule *MIRM;
+  TargetMachine *TM;
+
+  MachineFunction *Func = nullptr;
+  /// The slots whose addresses are computed, so they might be accessed through
+  /// any register
+  std::set<uint64_t> AddressTakenSlots;
+  /// Virtual registers holding known addresses in the current block
+  std::map<uint64_t, Address> Addresses;
+  std::vector<PendingStore> Pending;
+  /// The address registers of the merged upper halves, which might became
+  /// unused
+  std::set<uint64_t> ErasedAddresses;
+};
+
+#endif
@@ -0,0 +1,339 @@
+#include "StrengthReduction.hpp"
+#include "MachineBasicBlock.hpp"
+#include "MachineFunction.hpp"
+#include "Support.hpp"
+#include <cassert>
+
+static uint64_t GetMask(unsigned Width) {
+  return Width == 64 ? ~0ull : (1ull << Width) - 1;
+}
+
+static int64_t SignExtend(uint64_t Value, unsigned Width) {
+  return Width == 64 ? (int64_t)Value : (int64_t)(int32_t)Value;
+}
+
+/// Compute the magic number and the shift of the signed division by
+/// @Divisor, where 2 <= |@Divisor| (Hacker's Delight, 10-1).
+static void GetSignedMagic(int64_t Divisor, unsigned Width, uint64_t &Magic,
+                           unsigned &Shift) {
+  const uint64_t Mask = GetMask(Width);
+  const uint64_t SignBit = 1ull << (Width - 1);
+  const uint64_t AbsDivisor = (Divisor < 0 ? -(uint64_t)Divisor : Divisor);
+  const uint64_t T = SignBit + (((uint64_t)Divisor & Mask) >> (Width - 1));
+  // The absolute value of the largest dividend, which is a multiple of the
+  // divisor minus 1
+  const uint64_t AbsNC = T - 1 - T % AbsDivisor;
+
+  unsigned P = Width - 1;
+  uint64_t Q1 = SignBit / AbsNC, R1 = SignBit - Q1 * AbsNC;
+  uint64_t Q2 = SignBit / AbsDivisor, R2 = SignBit - Q2 * AbsDivisor;
+  uint64_t Delta;
+  do {
+    P++;
+    Q1 = (2 * Q1) & Mask;
+    R1 = (2 * R1) & Mask;
+    if (R1 >= AbsNC) {
+      Q1 = (Q1 + 1) & Mask;
+      R1 = (R1 - AbsNC) & Mask;
+    }
+    Q2 = (2 * Q2) & Mask;
+    R2 = (2 * R2) & Mask;
+    if (R2 >= AbsDivisor) {
+      Q2 = (Q2 + 1) & Mask;
+      R2 = (R2 - AbsDivisor) & Mask;
+    }
+    Delta = AbsDivisor - R2;
+  } while (Q1 < Delta || (Q1 == Delta && R1 == 0));
+
+  Magic = (Q2 + 1) & Mask;
+  if (Divisor < 0)
+    Magic = -Magic & Mask;
+  Shift = P - Width;
+}
+
+/// Compute the magic number and the shift of the unsigned division by
+/// @Divisor, which is not a power of 2. If @NeedsAdd is set, then the magic
+/// number is one bit wider than the registers and its top bit must be
+/// compensated for by an add (Hacker's Delight, 10-2).
+static void GetUnsignedMagic(uint64_t Divisor, unsigned Width, uint64_t &Magic,
+                             unsigned &Shift, bool &NeedsAdd) {
+  const uint64_t Mask = GetMask(Width);
+  const uint64_t SignBit = 1ull << (Width - 1);
+  const uint64_t NC = (Mask - (-Divisor & Mask) % Divisor) & Mask;
+
+  NeedsAdd = false;
+  unsigned P = Width - 1;
+  uint64_t Q1 = SignBit / NC, R1 = SignBit - Q1 * NC;
+  uint64_t Q2 = (SignBit - 1) / Divisor, R2 = (SignBit - 1) - Q2 * Divisor;
+  uint64_t Delta;
+  do {
+    P++;
+    if (R1 >= ((NC - R1) & Mask)) {
+      Q1 = (2 * Q1 + 1) & Mask;
+      R1 = (2 * R1 - NC) & Mask;
+    } else {
+      Q1 = (2 * Q1) & Mask;
+      R1 = (2 * R1) & Mask;
+    }
+    if (((R2 + 1) & Mask) >= ((Divisor - R2) & Mask)) {
+      if (Q2 >= SignBit - 1)
+        NeedsAdd = true;
+      Q2 = (2 * Q2 + 1) & Mask;
+      R2 = (2 * R2 + 1 - Divisor) & Mask;
+    } else {
+      if (Q2 >= SignBit)
+        NeedsAdd = true;
+      Q2 = (2 * Q2) & Mask;
+      R2 = (2 * R2 + 1) & Mask;
+    }
+    Delta = (Divisor - 1 - R2) & Mask;
+  } while (P < 2 * Width && (Q1 < Delta || (Q1 == Delta && R1 == 0)));
+
+  Magic = (Q2 + 1) & Mask;
+  Shift = P - Width;
+}
+
+bool StrengthReduction::GetConstant(MachineOperand *MO, int64_t &Value) {
+  if (MO->IsImmediate() && !MO->IsFPImmediate()) {
+    Value = SignExtend(MO->GetImmediate(), Width);
+    return true;
+  }
+
+  if (MO->IsVirtualReg() && Constants.count(MO->GetReg())) {
+    Value = SignExtend(Constants[MO->GetReg()], Width);
+    return true;
+  }
+
+  return false;
+}
+
+MachineOperand StrengthReduction::Emit(unsigned Opcode, MachineOperand LHS,
+                                       MachineOperand RHS) {
+  auto Result =
+      MachineOperand::CreateVirtualRegister(Func->GetNextAvailableVReg());
+  Result.SetType(LowLevelType::CreateScalar(Width));
+
+  MachineInstruction MI(Opcode, nullptr);
+  MI.AddOperand(Result);
+  MI.AddOperand(LHS);
+  MI.AddOperand(RHS);
+  Replacement.push_back(MI);
+
+  return Result;
+}
+
+MachineOperand StrengthReduction::EmitConstant(uint64_t Value) {
+  auto Result =
+      MachineOperand::CreateVirtualRegister(Func->GetNextAvailableVReg());
+  Result.SetType(LowLevelType::CreateScalar(Width));
+
+  MachineInstruction MOV(MachineInstruction::MOV, nullptr);
+  MOV.AddOperand(Result);
+  MOV.AddImmediate(Value, Width);
+  Replacement.push_back(MOV);
+
+  return Result;
+}
+
+static MachineOperand Imm(uint64_t Value, unsigned BitWidth = 32) {
+  return MachineOperand::CreateImmediate(Value, BitWidth);
+}
+
+bool StrengthReduction::IsCheapMultiplier(int64_t C) {
+  return C >= 2 && (IsPowerOf2(C) || IsPowerOf2(C - 1) || IsPowerOf2(C + 1));
+}
+
+bool StrengthReduction::IsReducibleDivisor(int64_t C, bool IsUnsigned) {
+  const uint64_t SignBit = 1ull << (Width - 1);
+
+  // Unsigned divisors with the top bit set would need a compare instead
+  if (IsUnsigned)
+    return C != 0 && C != 1 && ((uint64_t)C & GetMask(Width)) < SignBit;
+
+  return C != 0 && C != 1 && C != -1 &&
+         ((uint64_t)C & GetMask(Width)) != SignBit;
+}
+
+MachineOperand StrengthReduction::EmitMUL(MachineOperand X, int64_t C) {
+  if (IsPowerOf2(C))
+    return Emit(MachineInstruction::LSL, X, Imm(Log2(C)));
+
+  // x * (2^k + 1) = x + (x << k)
+  if (IsPowerOf2(C - 1))
+    return Emit(MachineInstruction::ADD, X,
+                Emit(MachineInstruction::LSL, X, Imm(Log2(C - 1))));
+
+  // x * (2^k - 1) = (x << k) - x
+  if (IsPowerOf2(C + 1))
+    return Emit(MachineInstruction::SUB,
+                Emit(MachineInstruction::LSL, X, Imm(Log2(C + 1))), X);
+
+  return Emit(MachineInstruction::MUL, X, Imm(C, Width));
+}
+
+MachineOperand StrengthReduction::EmitDIV(MachineOperand X, int64_t C) {
+  // Signed division rounds towards zero, so 2^k - 1 is added to negative
+  // dividends before shifting them
+  if (C > 0 && IsPowerOf2(C)) {
+    const unsigned K = Log2(C);
+    auto Sign = K == 1 ? X : Emit(MachineInstruction::ASR, X, Imm(Width - 1));
+    auto Bias = Emit(MachineInstruction::LSR, Sign, Imm(Width - K));
+    auto Sum = Emit(MachineInstruction::ADD, X, Bias);
+    return Emit(MachineInstruction::ASR, Sum, Imm(K));
+  }
+
+  uint64_t Magic;
+  unsigned Shift;
+  GetSignedMagic(C, Width, Magic, Shift);
+
+  const bool IsMagicNegative = Magic >> (Width - 1);
+  auto Q = Emit(MachineInstruction::MULHS, X, EmitConstant(Magic));
+  if (C > 0 && IsMagicNegative)
+    Q = Emit(MachineInstruction::ADD, Q, X);
+  else if (C < 0 && !IsMagicNegative)
+    Q = Emit(MachineInstruction::SUB, Q, X);
+
+  if (Shift)
+    Q = Emit(MachineInstruction::ASR, Q, Imm(Shift));
+
+  // Add 1 to negative quotients to round them towards zero
+  return Emit(MachineInstruction::ADD, Q,
+              Emit(MachineInstruction::LSR, Q, Imm(Width - 1)));
+}
+
+MachineOperand StrengthReduction::EmitDIVU(MachineOperand X, uint64_t C) {
+  if (IsPowerOf2(C))
+    return Emit(MachineInstruction::LSR, X, Imm(Log2(C)));
+
+  uint64_t Magic;
+  unsigned Shift;
+  bool NeedsAdd;
+  GetUnsignedMagic(C, Width, Magic, Shift, NeedsAdd);
+
+  auto Q = Emit(MachineInstruction::MULHU, X, EmitConstant(Magic));
+  if (!NeedsAdd)
+    return Shift ? Emit(MachineInstruction::LSR, Q, Imm(Shift)) : Q;
+
+  // q = (((x - q) >> 1) + q) >> (s - 1), which avoids the overflow of x + q
+  auto T = Emit(MachineInstruction::SUB, X, Q);
+  T = Emit(MachineInstruction::LSR, T, Imm(1));
+  T = Emit(MachineInstruction::ADD, T, Q);
+  return Emit(MachineInstruction::LSR, T, Imm(Shift - 1));
+}
+
+void StrengthReduction::Reduce(MachineInstruction &MI) {
+  const auto Opcode = MI.GetOpcode();
+  if ((Opcode != MachineInstruction::MUL && Opcode != MachineInstruction::DIV &&
+       Opcode != MachineInstruction::DIVU &&
+       Opcode != MachineInstruction::MOD &&
+       Opcode != MachineInstruction::MODU) ||
+      MI.GetOperandsNumber() != 3 || !MI.GetOperand(0)->IsVirtualReg())
+    return;
+
+  Width = MI.GetOperand(0)->GetSize();
+  if ((Width != 32 && Width != 64) || Width > TM->GetPointerSize())
+    return;
+
+  auto X = MI.GetOperand(1);
+  auto CMO = MI.GetOperand(2);
+  int64_t C;
+  if (Opcode == MachineInstruction::MUL && !GetConstant(CMO, C))
+    std::swap(X, CMO);
+  if (!X->IsVirtualReg() || !GetConstant(CMO, C))
+    return;
+
+  const bool IsUnsigned = Opcode == MachineInstruction::DIVU ||
+                          Opcode == MachineInstruction::MODU;
+  const uint64_t UC = C & GetMask(Width);
+
+  Replacement.clear();
+  switch (Opcode) {
+  case MachineInstruction::MUL:
+    if (!IsCheapMultiplier(C))
+      return;
+    EmitMUL(*X, C);
+    break;
+  case MachineInstruction::DIV:
+    if (!IsReducibleDivisor(C, false))
+      return;
+    EmitDIV(*X, C);
+    break;
+  case MachineInstruction::DIVU:
+    if (!IsReducibleDivisor(C, true))
+      return;
+    EmitDIVU(*X, UC);
+    break;
+  case MachineInstruction::MOD:
+  case MachineInstruction::MODU: {
+    if (!IsReducibleDivisor(C, IsUnsigned))
+      return;
+
+    if (IsUnsigned && IsPowerOf2(UC)) {
+      Emit(MachineInstruction::AND, *X, Imm(UC - 1, Width));
+      break;
+    }
+
+    // x % c = x - (x / c) * c
+    auto Q = IsUnsigned ? EmitDIVU(*X, UC) : EmitDIV(*X, C);
+    Emit(MachineInstruction::SUB, *X, EmitMUL(Q, C));
+    break;
+  }
+  default:
+    assert(!"Unreachable");
+  }
+
+  // The last instruction computes the result, so let it define the original
+  // destination
+  *Replacement.back().GetOperand(0) = *MI.GetOperand(0);
+
+  auto MBB = MI.GetParent();
+  MBB->InsertBefore(std::move(Replacement), &MI);
+  MBB->Erase(&MI);
+}
+
+void StrengthReduction::RunOnFunction(MachineFunction &Func) {
+  this->Func = &Func;
+  ConstantMOVs.clear();
+
+  for (auto &MBB : Func.GetBasicBlocks()) {
+    Constants.clear();
+
+    auto &Instructions = MBB.GetInstructions();
+    for (auto It = Instructions.begin(); It != Instructions.end();) {
+      auto &MI = *It++;
+
+      if (MI.IsDef() && MI.GetDef()->IsVirtualReg())
+        Constants.erase(MI.GetDef()->GetReg());
+
+      if (MI.GetOpcode() == MachineInstruction::MOV &&
+          MI.GetOperand(0)->IsVirtualReg() &&
+          MI.GetOperand(1)->IsImmediate() &&
+          !MI.GetOperand(1)->IsFPImmediate()) {
+        Constants[MI.GetOperand(0)->GetReg()] =
+            MI.GetOperand(1)->GetImmediate();
+        ConstantMOVs.insert(&MI);
+        continue;
+      }
+
+      Reduce(MI);
+    }
+  }
+
+  // Remove the constants which are not used anymore
+  std::map<unsigned, unsigned> Uses;
+  for (auto &MBB : Func.GetBasicBlocks())
+    for (auto &MI : MBB.GetInstructions())
+      for (size_t i = MI.IsDef() ? 1 : 0; i < MI.GetOperandsNumber(); i++)
+        if (auto MO = MI.GetOperand(i);
+            MO->IsVirtualReg() || (MO->IsMemory() && MO->IsVirtual()))
+          Uses[MO->GetReg()]++;
+
+  for (auto MOV : ConstantMOVs)
+    if (Uses[MOV->GetOperand(0)->GetReg()] == 0)
+      MOV->GetParent()->Erase(MOV);
+}
+
+void StrengthReduction::Run() {
+  for (auto &Func : MIRM->GetFunctions())
+    RunOnFunction(Func);
+}
@@ -0,0 +1,61 @@
+#ifndef STRENGTH_REDUCTION_HPP
+#define STRENGTH_REDUCTION_HPP
+
+#include "MachineIRModule.hpp"
+#include "TargetMachine.hpp"
+#include <map>
+#include <set>
+#include <vector>
+
+/// Replaces multiplications, divisions and remainders by constants with
+/// cheaper instructions. Multiplications become shifts and adds, divisions by
+/// powers of 2 become shifts and other divisions become a multiplication by a
+/// magic number, keeping the upper half of the product. Runs on the LLIR,
+/// before the legalizer, on operations not wider than the registers.
+class StrengthReduction {
+public:
+  StrengthReduction(MachineIRModule *Module, TargetMachine *TM)
+      : MIRM(Module), TM(TM) {}
+
+  void Run();
+
+private:
+  void RunOnFunction(MachineFunction &Func);
+
+  /// Replace @MI with a cheaper sequence if possible.
+  void Reduce(MachineInstruction &MI);
+
+  /// Return true if @MO is a constant, an immediate or a virtual register set
+  /// to an immediate in the current block, and set @Value to it.
+  bool GetConstant(MachineOperand *MO, int64_t &Value);
+
+  /// Append "@Opcode %new, @LHS, @RHS" to the replacement and return %new.
+  MachineOperand Emit(unsigned Opcode, MachineOperand LHS, MachineOperand RHS);
+  /// Append a MOV of @Value into a new register and return it.
+  MachineOperand EmitConstant(uint64_t Value);
+
+  /// Return true if the multiplication by @C can be done by one shift and at
+  /// most one add or sub.
+  bool IsCheapMultiplier(int64_t C);
+  bool IsReducibleDivisor(int64_t C, bool IsUnsigned);
+
+  MachineOperand EmitMUL(MachineOperand X, int64_t C);
+  MachineOperand EmitDIV(MachineOperand X, int64_t C);
+  MachineOperand EmitDIVU(MachineOperand X, uint64_t C);
+
+  MachineIRModule *MIRM;
+  TargetMachine *TM;
+
+  MachineFunction *Func = nullptr;
+  /// The width of the operation being reduced
+  unsigned Width = 0;
+  /// The instructions replacing the operation
+  std::vector<MachineInstruction> Replacement;
+
+  /// Virtual registers set to an immediate in the current block
+  std::map<unsigned, int64_t> Constants;
+  /// The MOVs setting them, which might become dead after the reductions
+  std::set<MachineInstruction *> ConstantMOVs;
+};
+
+#endif
@@ -8,3 +8,14 @@ bool IsInt(uint64_t Number, unsigned BitWidth) {
   int64_t S = ((int64_t)Number) >> BitWidth;
   return S == 0 || S == -1;
 }
+
+bool IsPowerOf2(uint64_t Number) {
+  return Number != 0 && (Number & (Number - 1)) == 0;
+}
+
+unsigned Log2(uint64_t Number) {
+  unsigned Result = 0;
+  while (Number >>= 1)
+    Result++;
+  return Result;
+}
@@ -15,6 +15,11 @@ template <unsigned BitWidth> bool IsUInt(uint64_t Number) {
   return S == 0;
 }
 
+bool IsPowerOf2(uint64_t Number);
+
+/// Return the base 2 logarithm of @Number rounded down.
+unsigned Log2(uint64_t Number);
+
 // Only use with power of 2 alignments
 // FIXME: make it more general and safe
 uint64_t GetNextAlignedValue(unsigned Val, unsigned Alignment);
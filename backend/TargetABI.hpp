@@ -5,7 +5,7 @@
 #include <vector>
 
 class TargetABI {
-  using RegList = std::vector<TargetRegister *>;
+  using RegList = std::vector<const TargetRegister *>;
 
 public:
   TargetABI() {}
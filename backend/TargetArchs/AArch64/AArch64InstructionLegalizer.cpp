@@ -2,7 +2,9 @@
 #include "AArch64InstructionDefinitions.hpp"
 #include "../../MachineBasicBlock.hpp"
 #include "../../MachineFunction.hpp"
+#include "../../Support.hpp"
 #include "../../TargetMachine.hpp"
+#include <algorithm>
 #include <cassert>
 
 using namespace AArch64;
@@ -11,6 +13,8 @@ using namespace AArch64;
 bool AArch64InstructionLegalizer::Check(MachineInstruction *MI) {
   switch (MI->GetOpcode()) {
   case MachineInstruction::CMP:
+    // Vectors are compared lane by lane, the result is not in the flags
+    return MI->GetOperand(0)->GetType().IsVector();
   case MachineInstruction::MOD:
   case MachineInstruction::MODU:
     return false;
@@ -19,6 +23,13 @@ bool AArch64InstructionLegalizer::Check(MachineInstruction *MI) {
       return false;
     break;
   case MachineInstruction::SUB:
+    // Only 12 bit unsigned immediates can be subtracted directly
+    if (auto ImmMO = MI->GetOperand(2);
+        ImmMO->IsImmediate() && !IsUInt<12>((int64_t)ImmMO->GetImmediate()))
+      return false;
+    [[fallthrough]];
+  case MachineInstruction::LSL:
+  case MachineInstruction::LSR:
     if (MI->GetOperand(1)->IsImmediate())
       return false;
     break;
@@ -30,6 +41,16 @@ bool AArch64InstructionLegalizer::Check(MachineInstruction *MI) {
     break;
   case MachineInstruction::GLOBAL_ADDRESS:
     return false;
+  // There is no scalar population count in the base instruction set
+  case MachineInstruction::POPCOUNT:
+    return false;
+  case MachineInstruction::ROTR:
+    return !MI->GetOperand(1)->IsImmediate();
+  case MachineInstruction::CRC32:
+    return !MI->GetOperand(1)->IsImmediate() &&
+           !MI->GetOperand(2)->IsImmediate();
+  case MachineInstruction::SELECT:
+    return false;
   default:
     break;
   }
@@ -44,10 +65,16 @@ bool AArch64InstructionLegalizer::IsExpandable(const MachineInstruction *MI) {
   case MachineInstruction::MODU:
   case MachineInstruction::STORE:
   case MachineInstruction::SUB:
+  case MachineInstruction::LSL:
+  case MachineInstruction::LSR:
   case MachineInstruction::MUL:
   case MachineInstruction::DIV:
   case MachineInstruction::DIVU:
   case MachineInstruction::GLOBAL_ADDRESS:
+  case MachineInstruction::POPCOUNT:
+  case MachineInstruction::ROTR:
+  case MachineInstruction::CRC32:
+  case MachineInstruction::SELECT:
     return true;
 
   default:
@@ -61,14 +88,14 @@ bool AArch64InstructionLegalizer::ExpandCMP(MachineInstruction *MI) {
   assert(MI->GetOperandsNumber() == 3 && "CMP must have exactly 3 operands");
   auto ParentBB = MI->GetParent();
 
-  auto NextMI = ParentBB->GetNextInstr(MI);
-
   // since the function will return true either way, this can be set here
   // already
   MI->FlagAsExpanded();
 
-  // If the next MI is a branch, then nothing to do
-  if (NextMI != nullptr && NextMI->GetOpcode() == MachineInstruction::BRANCH)
+  // If the next MI is a branch on the result, then it is selected together
+  // with the compare into a conditional branch, so nothing to do. The same
+  // holds for a conditional select.
+  if (IsFeedingNextBranch(MI) || IsFeedingNextSelect(MI))
     return true;
 
   // otherwise a CSET must be emitted
@@ -159,7 +186,6 @@ bool ExpandArithmeticInstWithImm(MachineInstruction *MI, size_t Index) {
   MI->InsertOperand(Index,MachineOperand::CreateVirtualRegister(
       DestReg,MI->GetOperand(0)->GetSize()));
 
-  // insert after modifying SUB, otherwise MI would became invalid
   ParentBB->InsertBefore(std::move(MOV), MI);
 
   return true;
@@ -167,6 +193,20 @@ bool ExpandArithmeticInstWithImm(MachineInstruction *MI, size_t Index) {
 
 bool AArch64InstructionLegalizer::ExpandSUB(MachineInstruction *MI) {
   assert(MI->GetOperandsNumber() == 3 && "SUB must have exactly 3 operands");
+
+  if (auto Src2 = MI->GetOperand(2);
+      Src2->IsImmediate() && !IsUInt<12>((int64_t)Src2->GetImmediate()))
+    return ExpandArithmeticInstWithImm(MI, 2);
+
+  // A negation subtracts from the zero register
+  if (auto Src1 = MI->GetOperand(1); Src1->GetImmediate() == 0) {
+    const unsigned Size = std::max(32u, MI->GetOperand(0)->GetSize());
+    MI->ReplaceOperand(MachineOperand::CreateRegister(
+                           TM->GetRegInfo()->GetZeroRegister(Size), Size),
+                       1);
+    return true;
+  }
+
   return ExpandArithmeticInstWithImm(MI, 1);
 }
 
@@ -185,6 +225,85 @@ bool AArch64InstructionLegalizer::ExpandDIVU(MachineInstruction *MI) {
   return ExpandArithmeticInstWithImm(MI, 2);
 }
 
+bool AArch64InstructionLegalizer::ExpandCRC32(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 3 && "CRC32 must have exactly 3 operands");
+
+  for (size_t Index = 1; Index < 3; Index++) {
+    auto Operand = *MI->GetOperand(Index);
+    if (!Operand.IsImmediate())
+      continue;
+
+    if (Operand.GetImmediate() == 0) {
+      auto ZeroReg = TM->GetRegInfo()->GetZeroRegister(Operand.GetSize());
+      MI->ReplaceOperand(
+          MachineOperand::CreateRegister(ZeroReg, Operand.GetSize()), Index);
+    } else {
+      ExpandArithmeticInstWithImm(MI, Index);
+      MI->GetOperand(Index)->SetSize(Operand.GetSize());
+    }
+    return true;
+  }
+
+  return false;
+}
+
+bool AArch64InstructionLegalizer::ExpandSELECT(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 4 && "SELECT must have exactly 4 operands");
+  auto ParentBB = MI->GetParent();
+  auto ParentFunc = ParentBB->GetParent();
+  MI->FlagAsExpanded();
+
+  // The materialized immediates are inserted before the compare, so it stays
+  // right before the select
+  auto Compare = ParentBB->GetPrecedingInstr(MI);
+  if (!Compare || !IsFeedingNextSelect(Compare)) {
+    auto Cond = *MI->GetOperand(1);
+    auto Flags = MachineOperand::CreateVirtualRegister(
+        ParentFunc->GetNextAvailableVReg(), Cond.GetSize());
+
+    auto CMP = MachineInstruction(MachineInstruction::CMP, ParentBB);
+    CMP.SetAttributes(MachineInstruction::NE);
+    CMP.AddOperand(Flags);
+    CMP.AddOperand(Cond);
+    CMP.AddOperand(MachineOperand::CreateImmediate(0, Cond.GetSize()));
+    Compare = &*ParentBB->InsertBefore(std::move(CMP), MI);
+    MI->ReplaceOperand(Flags, 1);
+  }
+
+  auto Src1 = MI->GetOperand(2);
+  auto Src2 = MI->GetOperand(3);
+  if (Src1->IsImmediate() && Src2->IsImmediate() &&
+      ((Src1->GetImmediate() == 1 && Src2->GetImmediate() == 0) ||
+       (Src1->GetImmediate() == 0 && Src2->GetImmediate() == 1)))
+    return true;
+
+  for (size_t Index = 2; Index < 4; Index++) {
+    auto Operand = *MI->GetOperand(Index);
+    if (!Operand.IsImmediate())
+      continue;
+
+    const unsigned Size = MI->GetOperand(0)->GetSize();
+    if (Operand.GetImmediate() == 0) {
+      const unsigned RegSize = std::max(32u, Size);
+      MI->ReplaceOperand(
+          MachineOperand::CreateRegister(
+              TM->GetRegInfo()->GetZeroRegister(RegSize), RegSize),
+          Index);
+      continue;
+    }
+
+    auto LI = MachineInstruction(MachineInstruction::LOAD_IMM, ParentBB);
+    auto DestReg = ParentFunc->GetNextAvailableVReg();
+    LI.AddVirtualRegister(DestReg, Size);
+    LI.AddOperand(Operand);
+    MI->ReplaceOperand(MachineOperand::CreateVirtualRegister(DestReg, Size),
+                       Index);
+    ParentBB->InsertBefore(std::move(LI), Compare);
+  }
+
+  return true;
+}
+
 bool AArch64InstructionLegalizer::ExpandGLOBAL_ADDRESS(MachineInstruction *MI) {
   assert(MI->GetOperandsNumber() == 2 && "GLOBAL_ADDRESS must have exactly 2 operands");
   auto ParentBB = MI->GetParent();
@@ -40,7 +40,8 @@ public:
 
   /// Since AArch64 does not support for immediate operand as first source
   /// operand for SUB (and for other arithmetic instruction as well), therefore
-  /// it has to be materialized first into a register
+  /// it has to be materialized first into a register. So is the second one if
+  /// it does not fit into 12 bits.
   bool ExpandSUB(MachineInstruction *MI) override;
 
   /// Since AArch64 does not support for immediate operand as last source
@@ -50,6 +51,16 @@ public:
   bool ExpandDIV(MachineInstruction *MI) override;
   bool ExpandDIVU(MachineInstruction *MI) override;
 
+  /// The checksum and the data must be in registers, the data keeps its
+  /// width, which selects the instruction. A zero data is read from wzr.
+  bool ExpandCRC32(MachineInstruction *MI) override;
+
+  /// The condition is taken from the flags set by the compare right before
+  /// the select, otherwise a comparison with zero is inserted. The immediate
+  /// sources are materialized, except 0, which is read from the zero
+  /// register, and the pairs of 0 and 1, which are selected to a cset.
+  bool ExpandSELECT(MachineInstruction *MI) override;
+
   /// The global address materialization happens in two steps on arm. Example:
   ///   adrp x0, global_var
   ///   add  x0, x0, :lo12:global_var
@@ -8,19 +8,19 @@ namespace AArch64 {
 
 enum Registers : unsigned {
   INVALID,
-#define AARCH64_REGISTER(ID, WIDTH, NAME, ALIAS) ID,
+#define AARCH64_REGISTER(ID, WIDTH, NAME, ALIAS, SUBREG, FP) ID,
 #include "AArch64Registers.def"
   REGISTERS_END,
 };
 
 class AArch64RegisterInfo : public RegisterInfo {
 public:
-  AArch64RegisterInfo();
+  AArch64RegisterInfo() {}
   ~AArch64RegisterInfo() override {}
 
-  TargetRegister *GetRegister(unsigned i) override;
-  TargetRegister *GetRegisterByID(unsigned i) override;
-  TargetRegister *GetParentReg(unsigned ID) override;
+  const TargetRegister *GetRegister(unsigned i) override;
+  const TargetRegister *GetRegisterByID(unsigned i) override;
+  const TargetRegister *GetParentReg(unsigned ID) override;
   unsigned GetFrameRegister() override;
   unsigned GetLinkRegister() override;
   unsigned GetStackRegister() override;
@@ -30,10 +30,6 @@ public:
   virtual std::string GetRegClassString(const unsigned RegClass) override;
   unsigned GetRegClassFromReg(const unsigned Reg) override;
   unsigned GetRegClassRegsSize(const unsigned RegClass) override;
-
-private:
-  TargetRegister Registers[REGISTERS_END - 1];
-  std::vector<std::string> RegClassEnumStrings;
 };
 
 } // namespace AArch64
@@ -43,6 +43,9 @@ AArch64TargetABI::AArch64TargetABI(RegisterInfo *RI) {
   // d9-d15
   for (unsigned i = D9; i <= D15; i++)
     CallerSavedRegisters.push_back(RI->GetRegisterByID(i));
+  // v16-v31, only for vectors, since d16-d31 are not used
+  for (unsigned i = V16; i <= V31; i++)
+    CallerSavedRegisters.push_back(RI->GetRegisterByID(i));
 
 
   /// Return registers
@@ -3,7 +3,9 @@
 #include "../../MachineFunction.hpp"
 #include "../../Support.hpp"
 #include "AArch64InstructionDefinitions.hpp"
+#include <bitset>
 #include <cassert>
+#include <cstring>
 
 using namespace AArch64;
 
@@ -13,80 +15,203 @@ void ExtendRegSize(MachineOperand *MO, uint8_t BitWidth = 32) {
     MO->GetTypeRef().SetBitWidth(BitWidth);
 }
 
-/// Materialize the given constant before the MI instruction
-/// TODO: AArch64 have strange operands, MOV_rc can encode a 16 bit immediate,
-/// but actually it can do more, with added shifts etc. For example it can
-/// actually encode 1ull << 50, but not sure yet how this work exactly.
-/// Figure it out and implement these exceptional cases.
-/// NOTE: It seems like mov is an alias for movz as well! Seems far from being
-/// trivial.
+/// Return true if @Imm is encodable as the immediate of the logical
+/// instructions with @RegSize wide registers: a rotated run of ones, which
+/// is replicated over the register in elements of 2, 4, 8, 16, 32 or 64 bits.
+static bool IsLogicalImmediate(uint64_t Imm, unsigned RegSize) {
+  if (RegSize <= 32) {
+    if (!IsInt<32>(Imm) && !IsUInt<32>(Imm))
+      return false;
+    Imm = (Imm & 0xffffffffu) | (Imm << 32u);
+  }
+
+  if (Imm == 0 || Imm == ~0ull)
+    return false;
+
+  // Find the smallest replicated element
+  unsigned Size = 64;
+  while (Size > 2) {
+    const unsigned Half = Size / 2;
+    const uint64_t Mask = (1ull << Half) - 1;
+    if ((Imm & Mask) != ((Imm >> Half) & Mask))
+      break;
+    Size = Half;
+  }
+
+  // A rotated run of ones has exactly two bit changes going around
+  const uint64_t Mask = Size == 64 ? ~0ull : (1ull << Size) - 1;
+  const uint64_t Element = Imm & Mask;
+  const uint64_t Rotated = ((Element >> 1u) | (Element << (Size - 1))) & Mask;
+  return std::bitset<64>(Element ^ Rotated).count() == 2;
+}
+
+static uint64_t GetHalfWord(uint64_t Value, unsigned Idx) {
+  return (Value >> (16 * Idx)) & 0xffffu;
+}
+
+static MachineInstruction CreateMOVK(const MachineOperand &VReg,
+                                     uint64_t Constant, unsigned Idx) {
+  MachineInstruction MOVK(MOVK_ri, nullptr);
+  MOVK.AddOperand(VReg);
+  MOVK.AddImmediate(GetHalfWord(Constant, Idx));
+  MOVK.AddImmediate(16 * Idx);
+  return MOVK;
+}
+
+/// Create into @MIs the shortest sequence, which sets @VReg to @Constant. The
+/// candidates are a single mov, a logical immediate orr from the zero
+/// register, an orr of a logical immediate patched by a movk, and a movz or
+/// movn followed by a movk for every other halfword, which is not 0 or 0xffff
+/// respectively.
+static void CreateMaterialization(std::vector<MachineInstruction> &MIs,
+                                  uint64_t Constant, const MachineOperand &VReg,
+                                  unsigned RegSize) {
+  const unsigned HalfWords = RegSize / 16;
+  unsigned Zeros = 0;
+  unsigned Ones = 0;
+  for (unsigned i = 0; i < HalfWords; i++) {
+    Zeros += GetHalfWord(Constant, i) == 0;
+    Ones += GetHalfWord(Constant, i) == 0xffffu;
+  }
+
+  // A movz or movn of one halfword, which the assembler chooses for mov
+  if (Zeros + 1 >= HalfWords || Ones + 1 >= HalfWords) {
+    MachineInstruction MOV(MOV_rc, nullptr);
+    MOV.AddOperand(VReg);
+    MOV.AddImmediate(RegSize == 32 ? (int32_t)Constant : Constant);
+    MIs.push_back(MOV);
+    return;
+  }
+
+  const auto ZeroReg = RegSize == 32 ? WZR : XZR;
+  if (IsLogicalImmediate(Constant, RegSize)) {
+    MachineInstruction ORR(ORR_rri, nullptr);
+    ORR.AddOperand(VReg);
+    ORR.AddRegister(ZeroReg, RegSize);
+    ORR.AddImmediate(RegSize == 32 ? (int32_t)Constant : Constant);
+    MIs.push_back(ORR);
+    return;
+  }
+
+  // Patching one halfword of a logical immediate is better than 3 or 4
+  // movz/movk instructions. Try to make the constant a replication by
+  // replacing one of its halfwords with another one.
+  if (Zeros + 2 < HalfWords && Ones + 2 < HalfWords)
+    for (unsigned i = 0; i < HalfWords; i++)
+      for (unsigned j = 0; j < HalfWords; j++) {
+        const uint64_t Mask = 0xffffull << (16 * i);
+        const uint64_t Pattern =
+            (Constant & ~Mask) | (GetHalfWord(Constant, j) << (16 * i));
+        if (i == j || !IsLogicalImmediate(Pattern, RegSize))
+          continue;
+
+        MachineInstruction ORR(ORR_rri, nullptr);
+        ORR.AddOperand(VReg);
+        ORR.AddRegister(ZeroReg, RegSize);
+        ORR.AddImmediate(Pattern);
+        MIs.push_back(ORR);
+        MIs.push_back(CreateMOVK(VReg, Constant, i));
+        return;
+      }
+
+  // Start with movn if it sets more halfwords right, so less of them needs
+  // to be patched by a movk
+  const bool IsNegated = Ones > Zeros;
+  const uint64_t Skipped = IsNegated ? 0xffffu : 0;
+  for (unsigned i = 0; i < HalfWords; i++) {
+    const uint64_t HalfWord = GetHalfWord(Constant, i);
+    if (HalfWord == Skipped)
+      continue;
+
+    if (!MIs.empty()) {
+      MIs.push_back(CreateMOVK(VReg, Constant, i));
+      continue;
+    }
+
+    // The lowest halfword is set by a plain mov, like for small constants
+    if (i == 0) {
+      MachineInstruction MOV(MOV_rc, nullptr);
+      MOV.AddOperand(VReg);
+      MOV.AddImmediate(IsNegated ? ~0xffffull | HalfWord : HalfWord);
+      MIs.push_back(MOV);
+      continue;
+    }
+
+    MachineInstruction MOV(IsNegated ? MOVN_ri : MOVZ_ri, nullptr);
+    MOV.AddOperand(VReg);
+    MOV.AddImmediate(IsNegated ? ~HalfWord & 0xffffu : HalfWord);
+    MOV.AddImmediate(16 * i);
+    MIs.push_back(MOV);
+  }
+}
+
+/// Materialize the given constant before the MI instruction. The sequence is
+/// chosen by CreateMaterialization. If the same constant was materialized into
+/// a virtual register earlier in the basic block, then that register is
+/// reused instead.
 MachineInstruction *AArch64TargetMachine::MaterializeConstant(
     MachineInstruction *MI, const uint64_t Constant, MachineOperand &VReg,
     const bool UseVRegAndMI) {
   auto MBB = MI->GetParent();
 
+  // The width is defined by the register set, or otherwise by the source
+  // register of the MI for now and an integer constant is assumed.
+  auto SizeMO = MI->GetOperand(0);
+  if (!UseVRegAndMI && MI->GetOperandsNumber() > 1 &&
+      (MI->GetOperand(1)->IsRegister() || MI->GetOperand(1)->IsVirtualReg()))
+    SizeMO = MI->GetOperand(1);
+  const unsigned RegSize = SizeMO->GetSize() > 32 ? 64 : 32;
+  const uint64_t Value = RegSize == 32 ? Constant & 0xffffffffu : Constant;
+
   // If UseVRegAndMI is false, then a VReg is an out operand, so it must be
   // allocated and set. If it is true, then VReg is already set, so use it
   // without any change of it.
   if (!UseVRegAndMI) {
+    const auto Key = std::make_tuple(MBB, RegSize, Value);
+    if (auto It = MaterializedConstants.find(Key);
+        It != MaterializedConstants.end()) {
+      // Only reuse the register if it is defined before MI and no call
+      // clobbers it in between
+      auto &[LastDef, MaterializedVReg] = It->second;
+      for (auto Prev = MI->GetPrevNode(); Prev; Prev = Prev->GetPrevNode()) {
+        if (Prev == LastDef) {
+          VReg = MaterializedVReg;
+          return MI;
+        }
+        if (Prev->IsCall() || (Prev->IsAlreadySelected() &&
+                               InstrDefs->GetTargetInstr(Prev->GetOpcode())
+                                   ->IsCall()))
+          break;
+      }
+    }
+
     auto Reg = MBB->GetParent()->GetNextAvailableVReg();
-    VReg = MachineOperand::CreateVirtualRegister(Reg);
-    // define its size by the size of the destination register of the MI for now
-    // and assume an integer constant
-    VReg.SetRegClass(
-        RegInfo->GetRegisterClass(MI->GetOperand(0)->GetSize(), false));
+    VReg = MachineOperand::CreateVirtualRegister(Reg, RegSize);
+    VReg.SetRegClass(RegInfo->GetRegisterClass(RegSize, false));
   }
 
   std::vector<MachineInstruction> MIs;
+  CreateMaterialization(MIs, Value, VReg, RegSize);
 
   // If UseVRegAndMI is false, then MI will not be changed. If true then it
   // must be selected to the first instruction in the materialization sequence.
-  if (!UseVRegAndMI) {
-    MachineInstruction MOV;
-    MOV.SetOpcode(MOV_rc);
-    MOV.AddOperand(VReg);
-    if (!IsInt<16>(Constant))
-      MOV.AddImmediate(Constant & 0xffffu); // keep lower 16 bit
-    else
-      MOV.AddImmediate(Constant);
-    MIs.push_back(MOV);
-  } else {
-    MI->SetOpcode(MOV_rc);
-    MI->RemoveOperand(1);
-    if (!IsInt<16>(Constant))
-      MI->AddImmediate(Constant & 0xffffu); // keep lower 16 bit
-    else
-      MI->AddImmediate(Constant);
-  }
-
-  if (!IsInt<16>(Constant)) {
-    MachineInstruction MOVK;
-    MOVK.SetOpcode(MOVK_ri);
-    MOVK.AddOperand(VReg);
-    MOVK.AddImmediate((uint32_t)Constant >> 16u); // upper 16 bit
-    MOVK.AddImmediate(16);                        // left shift amount
-    MIs.push_back(MOVK);
-
-    if (!IsInt<32>(Constant)) {
-      MachineInstruction MOVK;
-      MOVK.SetOpcode(MOVK_ri);
-      MOVK.AddOperand(VReg);
-      MOVK.AddImmediate((Constant >> 32u) & 0xffffu);
-      MOVK.AddImmediate(32);
-      MIs.push_back(MOVK);
-
-      MachineInstruction MOVK2;
-      MOVK2.SetOpcode(MOVK_ri);
-      MOVK2.AddOperand(VReg);
-      MOVK2.AddImmediate(Constant >> 48u);
-      MOVK2.AddImmediate(48);
-      MIs.push_back(MOVK2);
-    }
+  if (UseVRegAndMI) {
+    MI->SetOpcode(MIs[0].GetOpcode());
+    while (MI->GetOperandsNumber() > 1)
+      MI->RemoveOperand(1);
+    for (unsigned i = 1; i < MIs[0].GetOperandsNumber(); i++)
+      MI->AddOperand(*MIs[0].GetOperand(i));
+
+    MIs.erase(MIs.begin());
+    if (MIs.empty())
+      return MI;
+    return &*MBB->InsertAfter(std::move(MIs), MI);
   }
 
-  if (UseVRegAndMI)
-    return &*MBB->InsertAfter(std::move(MIs), MI);
-  return &*MBB->InsertBefore(std::move(MIs), MI);
+  MBB->InsertBefore(std::move(MIs), MI);
+  MaterializedConstants[std::make_tuple(MBB, RegSize, Value)] = {
+      MI->GetPrevNode(), VReg};
+  return MI;
 }
 
 /// For the given MI the function select its rrr or rri variant based on
@@ -116,13 +241,45 @@ bool AArch64TargetMachine::SelectThreeAddressInstruction(
   return false;
 }
 
+/// Like SelectThreeAddressInstruction, but for the logical instructions, which
+/// immediate is a bitmask encoded by IsLogicalImmediate.
+bool AArch64TargetMachine::SelectLogicalInstruction(MachineInstruction *MI,
+                                                    const Opcodes rrr,
+                                                    const Opcodes rri) {
+  if (auto ImmMO = MI->GetOperand(2); ImmMO->IsImmediate()) {
+    if (IsLogicalImmediate(ImmMO->GetImmediate(),
+                           MI->GetOperand(0)->GetSize())) {
+      MI->SetOpcode(rri);
+      return true;
+    }
+
+    MachineOperand VReg;
+    MI = MaterializeConstant(MI, ImmMO->GetImmediate(), VReg);
+    MI->SetOpcode(rrr);
+    MI->RemoveOperand(2);
+    MI->AddOperand(VReg);
+
+    return true;
+  } else if (MI->GetOperand(2)->IsRegister() ||
+             MI->GetOperand(2)->IsVirtualReg()) {
+    MI->SetOpcode(rrr);
+    return true;
+  }
+  return false;
+}
+
 bool AArch64TargetMachine::SelectAND(MachineInstruction *MI) {
   assert(MI->GetOperandsNumber() == 3 && "AND must have 3 operands");
 
+  if (MI->GetOperand(0)->GetType().IsVector()) {
+    MI->SetOpcode(AND_vvv);
+    return true;
+  }
+
   ExtendRegSize(MI->GetOperand(0));
   ExtendRegSize(MI->GetOperand(1));
 
-  if (!SelectThreeAddressInstruction(MI, AND_rrr, AND_rri))
+  if (!SelectLogicalInstruction(MI, AND_rrr, AND_rri))
     assert(!"Cannot select AND");
 
   return true;
@@ -131,10 +288,15 @@ bool AArch64TargetMachine::SelectAND(MachineInstruction *MI) {
 bool AArch64TargetMachine::SelectOR(MachineInstruction *MI) {
   assert(MI->GetOperandsNumber() == 3 && "OR must have 3 operands");
 
+  if (MI->GetOperand(0)->GetType().IsVector()) {
+    MI->SetOpcode(ORR_vvv);
+    return true;
+  }
+
   ExtendRegSize(MI->GetOperand(0));
   ExtendRegSize(MI->GetOperand(1));
 
-  if (!SelectThreeAddressInstruction(MI, ORR_rrr, ORR_rri))
+  if (!SelectLogicalInstruction(MI, ORR_rrr, ORR_rri))
     assert(!"Cannot select OR");
 
   return true;
@@ -143,6 +305,11 @@ bool AArch64TargetMachine::SelectOR(MachineInstruction *MI) {
 bool AArch64TargetMachine::SelectXOR(MachineInstruction *MI) {
   assert(MI->GetOperandsNumber() == 3 && "XOR must have 3 operands");
 
+  if (MI->GetOperand(0)->GetType().IsVector()) {
+    MI->SetOpcode(EOR_vvv);
+    return true;
+  }
+
   ExtendRegSize(MI->GetOperand(0));
   ExtendRegSize(MI->GetOperand(1));
 
@@ -154,7 +321,7 @@ bool AArch64TargetMachine::SelectXOR(MachineInstruction *MI) {
     return true;
   }
 
-  if (!SelectThreeAddressInstruction(MI, EOR_rrr, EOR_rri))
+  if (!SelectLogicalInstruction(MI, EOR_rrr, EOR_rri))
     assert(!"Cannot select XOR");
 
   return true;
@@ -184,9 +351,26 @@ bool AArch64TargetMachine::SelectLSR(MachineInstruction *MI) {
   return true;
 }
 
+bool AArch64TargetMachine::SelectASR(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 3 && "ASR must have 3 operands");
+
+  ExtendRegSize(MI->GetOperand(0));
+  ExtendRegSize(MI->GetOperand(1));
+
+  if (!SelectThreeAddressInstruction(MI, ASR_rrr, ASR_rri))
+    assert(!"Cannot select ASR");
+
+  return true;
+}
+
 bool AArch64TargetMachine::SelectADD(MachineInstruction *MI) {
   assert(MI->GetOperandsNumber() == 3 && "ADD must have 3 operands");
 
+  if (MI->GetOperand(0)->GetType().IsVector()) {
+    MI->SetOpcode(ADD_vvv);
+    return true;
+  }
+
   ExtendRegSize(MI->GetOperand(0));
   ExtendRegSize(MI->GetOperand(1));
 
@@ -225,6 +409,11 @@ bool AArch64TargetMachine::SelectADD(MachineInstruction *MI) {
 bool AArch64TargetMachine::SelectSUB(MachineInstruction *MI) {
   assert(MI->GetOperandsNumber() == 3 && "SUB must have 3 operands");
 
+  if (MI->GetOperand(0)->GetType().IsVector()) {
+    MI->SetOpcode(SUB_vvv);
+    return true;
+  }
+
   ExtendRegSize(MI->GetOperand(0));
   ExtendRegSize(MI->GetOperand(1));
 
@@ -249,6 +438,11 @@ bool AArch64TargetMachine::SelectSUB(MachineInstruction *MI) {
 bool AArch64TargetMachine::SelectMUL(MachineInstruction *MI) {
   assert(MI->GetOperandsNumber() == 3 && "MUL must have 3 operands");
 
+  if (MI->GetOperand(0)->GetType().IsVector()) {
+    MI->SetOpcode(MUL_vvv);
+    return true;
+  }
+
   ExtendRegSize(MI->GetOperand(0));
   ExtendRegSize(MI->GetOperand(1));
 
@@ -270,6 +464,52 @@ bool AArch64TargetMachine::SelectMUL(MachineInstruction *MI) {
   return false;
 }
 
+/// Select the upper half of the product of the 32 or 64 bit operands. For 32
+/// bits there is no such instruction, so the 64 bit product is computed with
+/// @MULL and shifted down, then its W subregister is the result.
+static bool SelectMultiplyHigh(MachineInstruction *MI, RegisterInfo *RegInfo,
+                               unsigned MULH, unsigned MULL) {
+  assert(MI->GetOperandsNumber() == 3 && "MULH must have 3 operands");
+  assert(MI->GetOperand(2)->IsVirtualReg() && "Operand #2 must be a register");
+
+  if (MI->GetOperand(0)->GetSize() == 64) {
+    MI->SetOpcode(MULH);
+    return true;
+  }
+
+  auto MBB = MI->GetParent();
+  auto Product = MachineOperand::CreateVirtualRegister(
+      MBB->GetParent()->GetNextAvailableVReg(), 64);
+  Product.SetRegClass(RegInfo->GetRegisterClass(64, false));
+
+  MachineInstruction Mul(MULL, nullptr);
+  Mul.AddOperand(Product);
+  Mul.AddOperand(*MI->GetOperand(1));
+  Mul.AddOperand(*MI->GetOperand(2));
+
+  MachineInstruction Shift(LSR_rri, nullptr);
+  Shift.AddOperand(Product);
+  Shift.AddOperand(Product);
+  Shift.AddImmediate(32);
+
+  MBB->InsertBefore({Mul, Shift}, MI);
+
+  // Moved by its W subregister, see AArch64XRegToWRegFixPass
+  MI->SetOpcode(MOV_rr);
+  MI->RemoveOperand(2);
+  MI->RemoveOperand(1);
+  MI->AddOperand(Product);
+  return true;
+}
+
+bool AArch64TargetMachine::SelectMULHU(MachineInstruction *MI) {
+  return SelectMultiplyHigh(MI, RegInfo.get(), UMULH_rrr, UMULL_rrr);
+}
+
+bool AArch64TargetMachine::SelectMULHS(MachineInstruction *MI) {
+  return SelectMultiplyHigh(MI, RegInfo.get(), SMULH_rrr, SMULL_rrr);
+}
+
 bool AArch64TargetMachine::SelectDIV(MachineInstruction *MI) {
   assert(MI->GetOperandsNumber() == 3 && "DIV must have 3 operands");
 
@@ -321,9 +561,54 @@ bool AArch64TargetMachine::SelectMODU(MachineInstruction *MI) {
   return false;
 }
 
+/// Select the lane wise comparison @MI. The compare instructions set the lanes
+/// to all ones where the relation holds, so they are negated to get 1.
+static bool SelectVectorCMP(MachineInstruction *MI) {
+  auto MBB = MI->GetParent();
+  auto Mask = *MI->GetOperand(0);
+  Mask.SetReg(MBB->GetParent()->GetNextAvailableVReg());
+
+  auto LHS = *MI->GetOperand(1);
+  auto RHS = *MI->GetOperand(2);
+  unsigned Opcode = CMEQ_vvv;
+  switch (MI->GetRelation()) {
+  case MachineInstruction::EQ:
+    break;
+  case MachineInstruction::LT:
+    std::swap(LHS, RHS);
+    [[fallthrough]];
+  case MachineInstruction::GT:
+    Opcode = CMGT_vvv;
+    break;
+  case MachineInstruction::LE:
+    std::swap(LHS, RHS);
+    [[fallthrough]];
+  case MachineInstruction::GE:
+    Opcode = CMGE_vvv;
+    break;
+  default:
+    assert(!"Unsupported vector comparison");
+  }
+
+  MachineInstruction Compare(Opcode, nullptr);
+  Compare.AddOperand(Mask);
+  Compare.AddOperand(LHS);
+  Compare.AddOperand(RHS);
+  MBB->InsertBefore(Compare, MI);
+
+  MI->SetOpcode(NEG_vv);
+  MI->RemoveOperand(2);
+  MI->RemoveOperand(1);
+  MI->AddOperand(Mask);
+  return true;
+}
+
 bool AArch64TargetMachine::SelectCMP(MachineInstruction *MI) {
   assert(MI->GetOperandsNumber() == 3 && "CMP must have 3 operands");
 
+  if (MI->GetOperand(0)->GetType().IsVector())
+    return SelectVectorCMP(MI);
+
   ExtendRegSize(MI->GetOperand(0));
   ExtendRegSize(MI->GetOperand(1));
 
@@ -383,6 +668,11 @@ bool AArch64TargetMachine::SelectCMPF(MachineInstruction *MI) {
 bool AArch64TargetMachine::SelectADDF(MachineInstruction *MI) {
   assert(MI->GetOperandsNumber() == 3 && "ADDF must have 3 operands");
 
+  if (MI->GetOperand(0)->GetType().IsVector()) {
+    MI->SetOpcode(FADD_vvv);
+    return true;
+  }
+
   ExtendRegSize(MI->GetOperand(0));
   ExtendRegSize(MI->GetOperand(1));
 
@@ -395,6 +685,11 @@ bool AArch64TargetMachine::SelectADDF(MachineInstruction *MI) {
 bool AArch64TargetMachine::SelectSUBF(MachineInstruction *MI) {
   assert(MI->GetOperandsNumber() == 3 && "SUBF must have 3 operands");
 
+  if (MI->GetOperand(0)->GetType().IsVector()) {
+    MI->SetOpcode(FSUB_vvv);
+    return true;
+  }
+
   ExtendRegSize(MI->GetOperand(0));
   ExtendRegSize(MI->GetOperand(1));
 
@@ -407,6 +702,11 @@ bool AArch64TargetMachine::SelectSUBF(MachineInstruction *MI) {
 bool AArch64TargetMachine::SelectMULF(MachineInstruction *MI) {
   assert(MI->GetOperandsNumber() == 3 && "MULF must have 3 operands");
 
+  if (MI->GetOperand(0)->GetType().IsVector()) {
+    MI->SetOpcode(FMUL_vvv);
+    return true;
+  }
+
   ExtendRegSize(MI->GetOperand(0));
   ExtendRegSize(MI->GetOperand(1));
 
@@ -419,6 +719,11 @@ bool AArch64TargetMachine::SelectMULF(MachineInstruction *MI) {
 bool AArch64TargetMachine::SelectDIVF(MachineInstruction *MI) {
   assert(MI->GetOperandsNumber() == 3 && "DIVF must have 3 operands");
 
+  if (MI->GetOperand(0)->GetType().IsVector()) {
+    MI->SetOpcode(FDIV_vvv);
+    return true;
+  }
+
   ExtendRegSize(MI->GetOperand(0));
   ExtendRegSize(MI->GetOperand(1));
 
@@ -452,7 +757,8 @@ bool AArch64TargetMachine::SelectSEXT(MachineInstruction *MI) {
   ExtendRegSize(MI->GetOperand(0));
 
   if (MI->GetOperand(1)->IsImmediate()) {
-    MI->SetOpcode(MOV_rc);
+    MaterializeConstant(MI, MI->GetOperand(1)->GetImmediate(),
+                        *MI->GetOperand(0), true);
     return true;
   } else if (MI->GetOperand(1)->GetType().GetBitWidth() == 8) {
     MI->SetOpcode(SXTB);
@@ -460,7 +766,9 @@ bool AArch64TargetMachine::SelectSEXT(MachineInstruction *MI) {
   } else if (MI->GetOperand(1)->GetType().GetBitWidth() == 16) {
     MI->SetOpcode(SXTH);
     return true;
-  } else if (MI->GetOperand(1)->GetType().GetBitWidth() == 32) {
+  } else if (MI->GetOperand(1)->GetType().GetBitWidth() == 32 ||
+             // The results of the comparisons are 0 or 1 in a word register
+             MI->GetOperand(1)->GetType().GetBitWidth() == 1) {
     MI->SetOpcode(SXTW);
     return true;
   }
@@ -475,7 +783,8 @@ bool AArch64TargetMachine::SelectZEXT(MachineInstruction *MI) {
   ExtendRegSize(MI->GetOperand(0));
 
   if (MI->GetOperand(1)->IsImmediate()) {
-    MI->SetOpcode(MOV_rc);
+    MaterializeConstant(MI, MI->GetOperand(1)->GetImmediate(),
+                        *MI->GetOperand(0), true);
     return true;
   } else if (MI->GetOperand(1)->GetType().GetBitWidth() == 32) {
     MI->SetOpcode(UXTW);
@@ -581,11 +890,10 @@ bool AArch64TargetMachine::SelectLOAD_IMM(MachineInstruction *MI) {
 bool AArch64TargetMachine::SelectMOV(MachineInstruction *MI) {
   assert(MI->GetOperandsNumber() == 2 && "MOV must have exactly 2 operands");
 
-  if (MI->GetOperand(1)->IsImmediate()) {
-    assert(IsInt<16>(MI->GetOperand(1)->GetImmediate()) &&
-           "Invalid immediate value");
-    MI->SetOpcode(MOV_rc);
-  } else
+  if (MI->GetOperand(1)->IsImmediate())
+    MaterializeConstant(MI, MI->GetOperand(1)->GetImmediate(),
+                        *MI->GetOperand(0), true);
+  else
     MI->SetOpcode(MOV_rr);
 
   return true;
@@ -606,6 +914,12 @@ bool AArch64TargetMachine::SelectLOAD(MachineInstruction *MI) {
   assert((MI->GetOperandsNumber() == 2 || MI->GetOperandsNumber() == 3) &&
          "LOAD must have 2 or 3 operands");
 
+  if (MI->GetOperand(0)->GetType().IsVector()) {
+    assert(MI->GetOperand(1)->GetOffset() == 0 && "LD1 has no offset");
+    MI->SetOpcode(LD1);
+    return true;
+  }
+
   if (MI->GetOperand(0)->GetType().GetBitWidth() == 8 &&
       !MI->GetOperand(0)->GetType().IsPointer()) {
     MI->SetOpcode(LDRB);
@@ -614,6 +928,12 @@ bool AArch64TargetMachine::SelectLOAD(MachineInstruction *MI) {
     return true;
   }
 
+  if (MI->GetOperand(0)->GetType().GetBitWidth() == 16) {
+    MI->SetOpcode(LDRH);
+    MI->GetOperand(0)->GetTypeRef().SetBitWidth(32);
+    return true;
+  }
+
   if (MI->GetOperand(1)->IsStackAccess()) {
     auto StackSlotID = MI->GetOperand(1)->GetSlot();
     auto ParentFunc = MI->GetParent()->GetParent();
@@ -646,6 +966,12 @@ bool AArch64TargetMachine::SelectSTORE(MachineInstruction *MI) {
   assert((MI->GetOperandsNumber() == 2 || MI->GetOperandsNumber() == 3) &&
          "STORE must have 2 or 3 operands");
 
+  if (MI->GetOperand(1)->GetType().IsVector()) {
+    assert(MI->GetOperand(0)->GetOffset() == 0 && "ST1 has no offset");
+    MI->SetOpcode(ST1);
+    return true;
+  }
+
   MachineFunction *ParentMF = nullptr;
   if (MI->GetOperandsNumber() == 2)
     ParentMF = MI->GetParent()->GetParent();
@@ -667,6 +993,59 @@ bool AArch64TargetMachine::SelectSTORE(MachineInstruction *MI) {
   return true;
 }
 
+bool AArch64TargetMachine::SelectIndexedLoadStore(MachineInstruction *MI,
+                                                  MachineOperand Base,
+                                                  MachineOperand Index,
+                                                  unsigned Shift,
+                                                  unsigned Extend) {
+  const bool IsLoad = MI->GetOpcode() == MachineInstruction::LOAD;
+  MachineOperand Value = *MI->GetOperand(IsLoad ? 0 : 1);
+
+  if ((!Value.IsRegister() && !Value.IsVirtualReg()) ||
+      Base.GetSize() != 64 || Index.GetSize() != (Extend ? 32 : 64))
+    return false;
+
+  // The opcodes with the index shifted, sign or zero extended, for loads and
+  // stores of 32 or 64, 8 and 16 bits
+  static const unsigned Opcodes[2][3][3] = {
+      {{LDR_lsl, LDR_sxtw, LDR_uxtw},
+       {LDRB_lsl, LDRB_sxtw, LDRB_uxtw},
+       {LDRH_lsl, LDRH_sxtw, LDRH_uxtw}},
+      {{STR_lsl, STR_sxtw, STR_uxtw},
+       {STRB_lsl, STRB_sxtw, STRB_uxtw},
+       {STRH_lsl, STRH_sxtw, STRH_uxtw}}};
+
+  unsigned SizeIdx = 0;
+  unsigned AccessSize = Value.GetSize();
+  if (AccessSize == 8 && !Value.GetType().IsPointer())
+    SizeIdx = 1;
+  else if (AccessSize == 16)
+    SizeIdx = 2;
+  else if (AccessSize != 32 && AccessSize != 64)
+    return false;
+
+  // The index can only be scaled by the access size
+  if (Shift != 0 && Shift != Log2(AccessSize / 8))
+    return false;
+
+  unsigned ExtendIdx = 0;
+  if (Extend == MachineInstruction::SEXT)
+    ExtendIdx = 1;
+  else if (Extend == MachineInstruction::ZEXT)
+    ExtendIdx = 2;
+
+  ExtendRegSize(&Value);
+
+  MI->SetOpcode(Opcodes[IsLoad ? 0 : 1][SizeIdx][ExtendIdx]);
+  MI->RemoveOperand(1);
+  MI->RemoveOperand(0);
+  MI->AddOperand(Value);
+  MI->AddOperand(Base);
+  MI->AddOperand(Index);
+  MI->AddImmediate(Shift);
+  return true;
+}
+
 bool AArch64TargetMachine::SelectSTACK_ADDRESS(MachineInstruction *MI) {
   assert(MI->GetOperandsNumber() == 2 && "STACK_ADDRESS must have 2 operands");
 
@@ -680,15 +1059,7 @@ bool AArch64TargetMachine::SelectBRANCH(MachineInstruction *MI) {
   //    for this branch
   // FIXME: not sure if for a branch it is REQUIRED to have a compare before
   //        it or its just optional (likely its optional)
-  auto &BBInstructions = MI->GetParent()->GetInstructions();
-  MachineInstruction *PrecedingMI = nullptr;
-
-  for (size_t i = 0; i < BBInstructions.size(); i++)
-    // find the current instruction index
-    if (&BBInstructions[i] == MI && i > 0) {
-      PrecedingMI = &BBInstructions[i - 1];
-      break;
-    }
+  MachineInstruction *PrecedingMI = MI->GetParent()->GetPrecedingInstr(MI);
 
   if (MI->IsFallThroughBranch()) {
     assert(PrecedingMI && "For now assume a preceding cmp instruction");
@@ -732,12 +1103,307 @@ bool AArch64TargetMachine::SelectJUMP(MachineInstruction *MI) {
   return true;
 }
 
+bool AArch64TargetMachine::SelectINDIRECT_JUMP(MachineInstruction *MI) {
+  MI->SetOpcode(BR);
+  return true;
+}
+
 bool AArch64TargetMachine::SelectCALL(MachineInstruction *MI) {
   MI->SetOpcode(BL);
   return true;
 }
 
+bool AArch64TargetMachine::SelectTAIL_CALL(MachineInstruction *MI) {
+  MI->SetOpcode(B_TAIL);
+  return true;
+}
+
 bool AArch64TargetMachine::SelectRET(MachineInstruction *MI) {
   MI->SetOpcode(RET);
   return true;
 }
+
+bool AArch64TargetMachine::SelectSPLAT(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 2 && "SPLAT must have 2 operands");
+
+  auto MBB = MI->GetParent();
+  auto MF = MBB->GetParent();
+  auto Src = MI->GetOperand(1);
+
+  if (Src->IsImmediate()) {
+    uint32_t Bits = Src->GetImmediate();
+    if (Src->IsFPImmediate()) {
+      const float Value = Src->GetFPImmediate();
+      std::memcpy(&Bits, &Value, sizeof(Bits));
+    } else if (Bits <= 255) {
+      MI->SetOpcode(MOVI_vi);
+      MI->RemoveOperand(1);
+      MI->AddImmediate(Bits);
+      return true;
+    }
+
+    // Otherwise the bits of the lanes are set in a register first
+    auto VReg = MachineOperand::CreateVirtualRegister(
+        MF->GetNextAvailableVReg(), 32);
+    VReg.SetRegClass(RegInfo->GetRegisterClass(32, false));
+    MachineInstruction MOV(MachineInstruction::MOV, nullptr);
+    MOV.AddOperand(VReg);
+    MOV.AddImmediate(Bits);
+    SelectMOV(&*MBB->InsertBefore(MOV, MI));
+
+    MI->RemoveOperand(1);
+    MI->AddOperand(VReg);
+    MI->SetOpcode(DUP_vr);
+    return true;
+  }
+
+  bool IsFP = Src->GetRegClass() == FPR32;
+  if (Src->IsParameter())
+    for (auto [ID, LLT, IsStructPtr, IsFPParam] : MF->GetParameters())
+      if (ID == Src->GetReg())
+        IsFP = IsFPParam;
+
+  // The lanes can only be duplicated from a general purpose register
+  if (IsFP) {
+    auto VReg = MachineOperand::CreateVirtualRegister(
+        MF->GetNextAvailableVReg(), 32);
+    VReg.SetRegClass(RegInfo->GetRegisterClass(32, false));
+    MachineInstruction FMOV(FMOV_rr, nullptr);
+    FMOV.AddOperand(VReg);
+    FMOV.AddOperand(*Src);
+    MBB->InsertBefore(FMOV, MI);
+
+    MI->RemoveOperand(1);
+    MI->AddOperand(VReg);
+  }
+
+  ExtendRegSize(MI->GetOperand(1));
+  MI->SetOpcode(DUP_vr);
+  return true;
+}
+
+bool AArch64TargetMachine::SelectREDUCE_ADD(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 2 && "REDUCE_ADD must have 2 operands");
+
+  // The sum is computed into a scalar floating point register
+  auto MBB = MI->GetParent();
+  auto Sum = MachineOperand::CreateVirtualRegister(
+      MBB->GetParent()->GetNextAvailableVReg(), 32);
+  Sum.SetRegClass(RegInfo->GetRegisterClass(32, true));
+
+  MachineInstruction Reduce(ADDV, nullptr);
+  Reduce.AddOperand(Sum);
+  Reduce.AddOperand(*MI->GetOperand(1));
+  MBB->InsertBefore(Reduce, MI);
+
+  ExtendRegSize(MI->GetOperand(0));
+  MI->SetOpcode(FMOV_rr);
+  MI->RemoveOperand(1);
+  MI->AddOperand(Sum);
+  return true;
+}
+
+bool AArch64TargetMachine::SelectROTR(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 3 && "ROTR must have 3 operands");
+
+  ExtendRegSize(MI->GetOperand(0));
+  ExtendRegSize(MI->GetOperand(1));
+
+  if (!SelectThreeAddressInstruction(MI, ROR_rrr, ROR_rri))
+    assert(!"Cannot select ROTR");
+
+  return true;
+}
+
+bool AArch64TargetMachine::SelectCLZ(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 2 && "CLZ must have 2 operands");
+
+  MI->SetOpcode(CLZ);
+  return true;
+}
+
+/// Reverse the bits first, then count the leading zeros.
+bool AArch64TargetMachine::SelectCTZ(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 2 && "CTZ must have 2 operands");
+
+  auto MBB = MI->GetParent();
+  const unsigned Size = MI->GetOperand(0)->GetSize();
+  auto Reversed = MachineOperand::CreateVirtualRegister(
+      MBB->GetParent()->GetNextAvailableVReg(), Size);
+  Reversed.SetRegClass(RegInfo->GetRegisterClass(Size, false));
+
+  MachineInstruction RBit(RBIT, nullptr);
+  RBit.AddOperand(Reversed);
+  RBit.AddOperand(*MI->GetOperand(1));
+  MBB->InsertBefore(RBit, MI);
+
+  MI->SetOpcode(CLZ);
+  MI->ReplaceOperand(Reversed, 1);
+  return true;
+}
+
+/// The 16 bit values are reversed with the whole register, which moves them
+/// to the upper half, so they are shifted back.
+bool AArch64TargetMachine::SelectBSWAP(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 2 && "BSWAP must have 2 operands");
+
+  if (MI->GetOperand(0)->GetSize() != 16) {
+    MI->SetOpcode(REV);
+    return true;
+  }
+
+  ExtendRegSize(MI->GetOperand(0));
+  ExtendRegSize(MI->GetOperand(1));
+
+  auto MBB = MI->GetParent();
+  auto Reversed = MachineOperand::CreateVirtualRegister(
+      MBB->GetParent()->GetNextAvailableVReg(), 32);
+  Reversed.SetRegClass(RegInfo->GetRegisterClass(32, false));
+
+  MachineInstruction Rev(REV, nullptr);
+  Rev.AddOperand(Reversed);
+  Rev.AddOperand(*MI->GetOperand(1));
+  MBB->InsertBefore(Rev, MI);
+
+  MI->SetOpcode(LSR_rri);
+  MI->ReplaceOperand(Reversed, 1);
+  MI->AddImmediate(16);
+  return true;
+}
+
+/// The width of the data selects the instruction.
+bool AArch64TargetMachine::SelectCRC32(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 3 && "CRC32 must have 3 operands");
+
+  switch (MI->GetOperand(2)->GetSize()) {
+  case 8:
+    MI->SetOpcode(CRC32B);
+    break;
+  case 16:
+    MI->SetOpcode(CRC32H);
+    break;
+  case 32:
+    MI->SetOpcode(CRC32W);
+    break;
+  case 64:
+    MI->SetOpcode(CRC32X);
+    break;
+  default:
+    assert(!"Unsupported CRC-32 data width");
+  }
+
+  ExtendRegSize(MI->GetOperand(2));
+  return true;
+}
+
+/// The condition is in the flags set by the preceding compare. Selecting 1 or
+/// 0 is a cset, which is an alias of csinc.
+bool AArch64TargetMachine::SelectSELECT(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 4 && "SELECT must have 4 operands");
+  auto PrecedingMI = MI->GetParent()->GetPrecedingInstr(MI);
+  assert(PrecedingMI && "The select must follow its compare");
+
+  // Indexed by the relations from EQ
+  static const unsigned CSELs[] = {CSEL_eq, CSEL_ne, CSEL_lt,
+                                   CSEL_gt, CSEL_le, CSEL_ge};
+  static const unsigned FCSELs[] = {FCSEL_eq, FCSEL_ne, FCSEL_lt,
+                                    FCSEL_gt, FCSEL_le, FCSEL_ge};
+  static const unsigned CSETs[] = {CSET_eq, CSET_ne, CSET_lt,
+                                   CSET_gt, CSET_le, CSET_ge};
+  static const unsigned Inverses[] = {
+      MachineInstruction::NE, MachineInstruction::EQ, MachineInstruction::GE,
+      MachineInstruction::LE, MachineInstruction::GT, MachineInstruction::LT};
+
+  unsigned Relation = PrecedingMI->GetRelation();
+  assert(Relation >= MachineInstruction::EQ &&
+         Relation <= MachineInstruction::GE && "Unknown condition");
+
+  ExtendRegSize(MI->GetOperand(0));
+
+  if (auto Src1 = MI->GetOperand(2); Src1->IsImmediate()) {
+    if (Src1->GetImmediate() == 0)
+      Relation = Inverses[Relation - MachineInstruction::EQ];
+
+    MI->SetOpcode(CSETs[Relation - MachineInstruction::EQ]);
+    MI->RemoveOperand(3);
+    MI->RemoveOperand(2);
+    MI->RemoveOperand(1);
+    return true;
+  }
+
+  const unsigned RegClass = MI->GetOperand(0)->GetRegClass();
+  if (RegClass == FPR32 || RegClass == FPR64)
+    MI->SetOpcode(FCSELs[Relation - MachineInstruction::EQ]);
+  else {
+    MI->SetOpcode(CSELs[Relation - MachineInstruction::EQ]);
+    ExtendRegSize(MI->GetOperand(2));
+    ExtendRegSize(MI->GetOperand(3));
+  }
+
+  MI->RemoveOperand(1);
+  return true;
+}
+
+bool AArch64TargetMachine::IsRematerializable(MachineInstruction *MI) {
+  switch (MI->GetOpcode()) {
+  case MOV_rc:
+  case MOVZ_ri:
+  case MOVN_ri:
+    return true;
+  case ORR_rri:
+    return MI->GetOperand(1)->IsRegister() &&
+           (MI->GetOperand(1)->GetReg() == WZR ||
+            MI->GetOperand(1)->GetReg() == XZR);
+  default:
+    return false;
+  }
+}
+
+bool AArch64TargetMachine::SelectCMPAndBRANCH(MachineInstruction *CMP,
+                                              MachineInstruction *BRANCH) {
+  // The compare only sets the flags, which are tested by the b.cond selected
+  // from the relation of the compare
+  return SelectCMP(CMP) && SelectBRANCH(BRANCH);
+}
+
+/// Return true if @Offset is encodable in a 64 bit stp or ldp, which is a 7 bit
+/// signed immediate scaled by 8. Single registers use the unscaled 9 bit one.
+static bool IsValidPairOffset(int64_t Offset, bool IsPair) {
+  if (!IsPair)
+    return Offset >= -256 && Offset <= 255;
+  return Offset % 8 == 0 && Offset >= -512 && Offset <= 504;
+}
+
+bool AArch64TargetMachine::CreateStorePair(MachineInstruction &MI,
+                                           unsigned Reg1, unsigned Reg2,
+                                           int64_t Offset, bool UpdateSP) {
+  const bool IsPair = Reg2 != ~0u;
+  if ((!IsPair && !UpdateSP) || !IsValidPairOffset(Offset, IsPair))
+    return false;
+
+  MI = MachineInstruction(IsPair ? (UpdateSP ? STP_pre : STP) : STR_pre,
+                          nullptr);
+  MI.AddRegister(Reg1, 64);
+  if (IsPair)
+    MI.AddRegister(Reg2, 64);
+  MI.AddRegister(GetRegInfo()->GetStackRegister());
+  MI.AddImmediate(Offset);
+  return true;
+}
+
+bool AArch64TargetMachine::CreateLoadPair(MachineInstruction &MI,
+                                          unsigned Reg1, unsigned Reg2,
+                                          int64_t Offset, bool UpdateSP) {
+  const bool IsPair = Reg2 != ~0u;
+  if ((!IsPair && !UpdateSP) || !IsValidPairOffset(Offset, IsPair))
+    return false;
+
+  MI = MachineInstruction(IsPair ? (UpdateSP ? LDP_post : LDP) : LDR_post,
+                          nullptr);
+  MI.AddRegister(Reg1, 64);
+  if (IsPair)
+    MI.AddRegister(Reg2, 64);
+  MI.AddRegister(GetRegInfo()->GetStackRegister());
+  MI.AddImmediate(Offset);
+  return true;
+}
@@ -5,6 +5,8 @@
 #include "AArch64RegisterInfo.hpp"
 #include "AArch64TargetABI.hpp"
 #include <cassert>
+#include <map>
+#include <tuple>
 
 namespace AArch64 {
 
@@ -23,14 +25,27 @@ public:
   uint8_t GetIntSize() override { return 32; }
   uint8_t GetLongSize() override { return 64; }
 
+  /// Unscaled offsets in this range are valid for all access sizes
+  bool IsValidMemoryOffset(int64_t Offset) override {
+    return Offset >= -256 && Offset <= 255;
+  }
+
+  /// Copies use x registers, which the peepholes pair into ldp and stp
+  unsigned GetMemOpChunkSize() override { return 8; }
+  unsigned GetInlineMemOpLimit() override { return 128; }
+  bool AllowsMisalignedAccess() override { return true; }
+
   bool SelectAND(MachineInstruction *MI) override;
   bool SelectOR(MachineInstruction *MI) override;
   bool SelectXOR(MachineInstruction *MI) override;
   bool SelectLSL(MachineInstruction *MI) override;
   bool SelectLSR(MachineInstruction *MI) override;
+  bool SelectASR(MachineInstruction *MI) override;
   bool SelectADD(MachineInstruction *MI) override;
   bool SelectSUB(MachineInstruction *MI) override;
   bool SelectMUL(MachineInstruction *MI) override;
+  bool SelectMULHU(MachineInstruction *MI) override;
+  bool SelectMULHS(MachineInstruction *MI) override;
   bool SelectDIV(MachineInstruction *MI) override;
   bool SelectDIVU(MachineInstruction *MI) override;
   bool SelectMOD(MachineInstruction *MI) override;
@@ -55,8 +70,32 @@ public:
   bool SelectSTACK_ADDRESS(MachineInstruction *MI) override;
   bool SelectBRANCH(MachineInstruction *MI) override;
   bool SelectJUMP(MachineInstruction *MI) override;
+  bool SelectINDIRECT_JUMP(MachineInstruction *MI) override;
   bool SelectCALL(MachineInstruction *MI) override;
+  bool SelectTAIL_CALL(MachineInstruction *MI) override;
   bool SelectRET(MachineInstruction *MI) override;
+  bool SelectSPLAT(MachineInstruction *MI) override;
+  bool SelectREDUCE_ADD(MachineInstruction *MI) override;
+  bool SelectROTR(MachineInstruction *MI) override;
+  bool SelectCLZ(MachineInstruction *MI) override;
+  bool SelectCTZ(MachineInstruction *MI) override;
+  bool SelectBSWAP(MachineInstruction *MI) override;
+  bool SelectCRC32(MachineInstruction *MI) override;
+  bool SelectSELECT(MachineInstruction *MI) override;
+
+  bool SelectCMPAndBRANCH(MachineInstruction *CMP,
+                          MachineInstruction *BRANCH) override;
+
+  bool CreateStorePair(MachineInstruction &MI, unsigned Reg1, unsigned Reg2,
+                       int64_t Offset, bool UpdateSP) override;
+  bool CreateLoadPair(MachineInstruction &MI, unsigned Reg1, unsigned Reg2,
+                      int64_t Offset, bool UpdateSP) override;
+
+  bool SelectIndexedLoadStore(MachineInstruction *MI, MachineOperand Base,
+                              MachineOperand Index, unsigned Shift,
+                              unsigned Extend) override;
+
+  bool IsRematerializable(MachineInstruction *MI) override;
 
   MachineInstruction *MaterializeConstant(MachineInstruction *MI,
                                           const uint64_t Constant,
@@ -64,6 +103,15 @@ public:
                                           const bool UseVRegAndMI = false);
   bool SelectThreeAddressInstruction(MachineInstruction *MI, const Opcodes rrr,
                                      const Opcodes rri, unsigned ImmSize = 12);
+  bool SelectLogicalInstruction(MachineInstruction *MI, const Opcodes rrr,
+                                const Opcodes rri);
+
+private:
+  /// The constants materialized into virtual registers per basic block and
+  /// register size, with the last instruction of their materialization
+  std::map<std::tuple<MachineBasicBlock *, unsigned, uint64_t>,
+           std::pair<MachineInstruction *, MachineOperand>>
+      MaterializedConstants;
 };
 
 } // namespace AArch64
\ No newline at end of file
@@ -3,64 +3,17 @@
 
 #include "../../InstructionDefinitions.hpp"
 #include "../../MachineInstruction.hpp"
+#include "../../SelectionPattern.hpp"
 #include "../../TargetInstruction.hpp"
-#include <map>
 
 namespace RISCV {
 
 enum Opcodes : unsigned {
-  LB,
-  LH,
-  LW,
-  LBU,
-  LHU,
-  SB,
-  SH,
-  SW,
-  SLL,
-  SLLI,
-  SRL,
-  SRLI,
-  SRA,
-  SRAI,
-  ADD,
-  ADDI,
-  SUB,
-  LUI,
-  AUIPC,
-  XOR,
-  XORI,
-  OR,
-  ORI,
-  AND,
-  ANDI,
-  SLT,
-  SLTI,
-  SLTU,
-  SLTIU,
-  BEQ,
-  BNE,
-  BLT,
-  BGE,
-  BLTU,
-  BGEU,
-  MUL,
-  MULH,
-  MULHSU,
-  MULHU,
-  DIV,
-  DIVU,
-  REM,
-  REMU,
-  NOT,
-  MV,
-  SEQZ,
-  SNEZ,
-  BNEZ,
-  J,
-  CALL,
-  RET,
-  LI,
+#define RISCV_INSTRUCTION(ID, SIZE, ASM, OPERANDS, ATTRIBUTES, SCHED,          \
+                          INVERSE)                                             \
+  ID,
+#include "RISCVInstructions.def"
+  INSTRUCTIONS_END,
 };
 
 enum OperandTypes : unsigned {
@@ -75,20 +28,21 @@ enum OperandTypes : unsigned {
 };
 
 class RISCVInstructionDefinitions : public InstructionDefinitions {
-  using IRToTargetInstrMap = std::map<unsigned, TargetInstruction>;
-
 public:
-  RISCVInstructionDefinitions();
   ~RISCVInstructionDefinitions() override {}
-  TargetInstruction *GetTargetInstr(unsigned Opcode) override;
-  std::string GetInstrString(unsigned index) override {
-    assert(index < InstrEnumStrings.size() && "Out of bound access");
-    return InstrEnumStrings[index];
+  const TargetInstruction *GetTargetInstr(unsigned Opcode) override;
+  std::string_view GetInstrString(unsigned Opcode) override;
+  const std::vector<SelectionPattern> &GetSelectionPatterns() override {
+    return Patterns;
+  }
+  const std::vector<PeepholeRule> &GetPeepholeRules() override {
+    return PeepholeRules;
   }
+  unsigned GetIssueWidth() override;
 
 private:
-  static IRToTargetInstrMap Instructions;
-  std::vector<std::string> InstrEnumStrings;
+  static std::vector<SelectionPattern> Patterns;
+  static std::vector<PeepholeRule> PeepholeRules;
 };
 
 } // namespace RISCV
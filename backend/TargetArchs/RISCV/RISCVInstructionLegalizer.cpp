@@ -22,8 +22,15 @@ bool RISCVInstructionLegalizer::Check(MachineInstruction *MI) {
     break;
   case MachineInstruction::CMP:
     if (MI->GetOperand(1)->GetSize() > TM->GetPointerSize() ||
-        MI->GetOperand(2)->GetSize() > TM->GetPointerSize() ||
-        MI->GetRelation() != MachineInstruction::LT)
+        MI->GetOperand(2)->GetSize() > TM->GetPointerSize())
+      return false;
+    // Selected together with the branch into a compare and branch instruction,
+    // which supports every relation, but only with register operands
+    if (IsFeedingNextBranch(MI))
+      return !MI->GetOperand(1)->IsImmediate() &&
+             (!MI->GetOperand(2)->IsImmediate() ||
+              MI->GetOperand(2)->GetImmediate() == 0);
+    if (MI->GetRelation() != MachineInstruction::LT)
       return false;
     break;
   case MachineInstruction::LOAD:
@@ -54,6 +61,11 @@ bool RISCVInstructionLegalizer::Check(MachineInstruction *MI) {
         MI->GetOperand(1)->IsImmediate())
       return false;
     break;
+  case MachineInstruction::LSL:
+  case MachineInstruction::LSR:
+    if (MI->GetOperand(1)->IsImmediate())
+      return false;
+    break;
   case MachineInstruction::ZEXT:
     if (MI->GetDef()->GetSize() > TM->GetPointerSize())
       return false;
@@ -62,6 +74,16 @@ bool RISCVInstructionLegalizer::Check(MachineInstruction *MI) {
     if (MI->GetOperand(1)->GetSize() > TM->GetPointerSize())
       return false;
     break;
+  // The base instruction set has no bit manipulation instructions
+  case MachineInstruction::ROTR:
+  case MachineInstruction::CLZ:
+  case MachineInstruction::CTZ:
+  case MachineInstruction::POPCOUNT:
+  case MachineInstruction::BSWAP:
+  case MachineInstruction::CRC32:
+  // and no conditional move
+  case MachineInstruction::SELECT:
+    return false;
   default:
     break;
   }
@@ -80,6 +102,8 @@ bool RISCVInstructionLegalizer::IsExpandable(const MachineInstruction *MI) {
   case MachineInstruction::LOAD_IMM:
   case MachineInstruction::STORE:
   case MachineInstruction::SUB:
+  case MachineInstruction::LSL:
+  case MachineInstruction::LSR:
   case MachineInstruction::MUL:
   case MachineInstruction::DIV:
   case MachineInstruction::DIVU:
@@ -87,6 +111,13 @@ bool RISCVInstructionLegalizer::IsExpandable(const MachineInstruction *MI) {
   case MachineInstruction::MODU:
   case MachineInstruction::ZEXT:
   case MachineInstruction::TRUNC:
+  case MachineInstruction::ROTR:
+  case MachineInstruction::CLZ:
+  case MachineInstruction::CTZ:
+  case MachineInstruction::POPCOUNT:
+  case MachineInstruction::BSWAP:
+  case MachineInstruction::CRC32:
+  case MachineInstruction::SELECT:
     return true;
 
   default:
@@ -111,12 +142,24 @@ static bool ExpandArithmeticInstWithImm(MachineInstruction *MI, size_t Index) {
   MI->InsertOperand(Index, MachineOperand::CreateVirtualRegister(
                                DestReg, MI->GetOperand(0)->GetSize()));
 
-  // insert after modifying MI, otherwise MI would became invalid
   ParentBB->InsertBefore(std::move(MOV), MI);
 
   return true;
 }
 
+bool RISCVInstructionLegalizer::ExpandCMP(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 3 && "CMP must have exactly 3 operands");
+
+  if (!IsFeedingNextBranch(MI) ||
+      MI->GetOperand(1)->GetSize() > TM->GetPointerSize() ||
+      MI->GetOperand(2)->GetSize() > TM->GetPointerSize())
+    return TargetInstructionLegalizer::ExpandCMP(MI);
+
+  // The zero immediate can be replaced by the zero register at selection
+  const size_t Index = MI->GetOperand(1)->IsImmediate() ? 1 : 2;
+  return ExpandArithmeticInstWithImm(MI, Index);
+}
+
 bool RISCVInstructionLegalizer::ExpandDIV(MachineInstruction *MI) {
   assert(MI->GetOperandsNumber() == 3 && "DIV must have exactly 3 operands");
   return ExpandArithmeticInstWithImm(MI, 2);
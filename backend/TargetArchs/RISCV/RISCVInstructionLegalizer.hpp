@@ -24,6 +24,7 @@ public:
   /// operand for some arithmetic instruction, therefore it has to be
   /// materialized first into a register
   bool ExpandDIV(MachineInstruction *MI) override;
+  bool ExpandCMP(MachineInstruction *MI) override;
   bool ExpandDIVU(MachineInstruction *MI) override;
   bool ExpandMOD(MachineInstruction *MI, bool IsUnsigned) override;
 };
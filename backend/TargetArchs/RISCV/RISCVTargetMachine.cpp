@@ -44,8 +44,7 @@ bool RISCVTargetMachine::SelectThreeAddressInstruction(MachineInstruction *MI,
     LoadImm.AddVirtualRegister(DestReg);
     LoadImm.GetOperand(0)->SetRegClass(GPR32);
     LoadImm.AddOperand(*ImmMO);
-    MI = &*ParentBB->InsertBefore(std::move(LoadImm), MI);
-    MI++;
+    ParentBB->InsertBefore(std::move(LoadImm), MI);
 
     MI->SetOpcode(rrr);
     MI->RemoveOperand(2);
@@ -112,6 +111,12 @@ bool RISCVTargetMachine::SelectLSR(MachineInstruction *MI) {
   return true;
 }
 
+bool RISCVTargetMachine::SelectASR(MachineInstruction *MI) {
+  if (!SelectThreeAddressInstruction(MI, SRA, SRAI))
+    assert(!"Cannot select ASR");
+  return true;
+}
+
 bool RISCVTargetMachine::SelectADD(MachineInstruction *MI) {
   if (!SelectThreeAddressInstruction(MI, ADD, ADDI))
     assert(!"Cannot select ADD");
@@ -142,10 +147,14 @@ bool RISCVTargetMachine::SelectSUB(MachineInstruction *MI) {
     MachineInstruction LoadImm;
     LoadImm.SetOpcode(LI);
     LoadImm.AddVirtualRegister(DestReg);
+    LoadImm.GetOperand(0)->SetRegClass(GPR32);
     LoadImm.AddOperand(*ImmMO);
-    MI = &*ParentBB->InsertBefore(std::move(LoadImm), MI);
+    ParentBB->InsertBefore(std::move(LoadImm), MI);
 
-    MI->SetOpcode(ADDI);
+    MI->RemoveOperand(2);
+    MI->AddVirtualRegister(DestReg);
+    MI->GetOperand(2)->SetRegClass(GPR32);
+    ExtendRegSize(MI->GetOperand(2));
     return true;
   } else {
     MI->SetOpcode(SUB);
@@ -162,6 +171,10 @@ bool RISCVTargetMachine::SelectMULHU(MachineInstruction *MI) {
   return SelectThreeAddressInstruction(MI, MULHU);
 }
 
+bool RISCVTargetMachine::SelectMULHS(MachineInstruction *MI) {
+  return SelectThreeAddressInstruction(MI, MULH);
+}
+
 bool RISCVTargetMachine::SelectDIV(MachineInstruction *MI) {
   return SelectThreeAddressInstruction(MI, DIV);
 }
@@ -237,7 +250,7 @@ bool RISCVTargetMachine::SelectSEXT(MachineInstruction *MI) {
   ArithShiftRight.AddOperand(Dest);
   ArithShiftRight.AddOperand(Temp);
   ArithShiftRight.AddImmediate(ShiftAmt);
-  MI = &*ParentBB->InsertAfter(std::move(ArithShiftRight), MI);
+  ParentBB->InsertAfter(std::move(ArithShiftRight), MI);
 
   return true;
 }
@@ -276,7 +289,7 @@ bool RISCVTargetMachine::SelectZEXT(MachineInstruction *MI) {
     Li.SetOpcode(LI);
     Li.AddOperand(Temp);
     Li.AddImmediate((1u << Src->GetSize()) - 1);
-    MI = &*ParentBB->InsertBefore(std::move(Li), MI);
+    ParentBB->InsertBefore(std::move(Li), MI);
 
     return true;
   }
@@ -335,7 +348,7 @@ bool RISCVTargetMachine::SelectTRUNC(MachineInstruction *MI) {
     ShR.AddOperand(Dest);
     ShR.AddOperand(Temp);
     ShR.AddImmediate(ShiftAmt);
-    MI = &*ParentBB->InsertAfter(std::move(ShR), MI);
+    ParentBB->InsertAfter(std::move(ShR), MI);
 
     return true;
   } else if (MI->GetOperand(0)->GetSize() == 32) {
@@ -459,14 +472,79 @@ bool RISCVTargetMachine::SelectJUMP(MachineInstruction *MI) {
   return true;
 }
 
+bool RISCVTargetMachine::SelectINDIRECT_JUMP(MachineInstruction *MI) {
+  MI->SetOpcode(JR);
+  return true;
+}
+
 bool RISCVTargetMachine::SelectCALL(MachineInstruction *MI) {
   MI->SetOpcode(CALL);
   return true;
 }
 
+bool RISCVTargetMachine::SelectTAIL_CALL(MachineInstruction *MI) {
+  MI->SetOpcode(TAIL);
+  return true;
+}
+
 bool RISCVTargetMachine::SelectRET(MachineInstruction *MI) {
   MI->SetOpcode(RET);
   if (MI->GetOperandsNumber() == 1)
     ExtendRegSize(MI->GetOperand(0));
   return true;
 }
+
+bool RISCVTargetMachine::SelectCMPAndBRANCH(MachineInstruction *CMP,
+                                            MachineInstruction *BRANCH) {
+  assert(CMP->GetOperandsNumber() == 3 && "CMP must have 3 operands");
+  auto LHS = *CMP->GetOperand(1);
+  auto RHS = *CMP->GetOperand(2);
+
+  // The legalizer already materialized every immediate except zero
+  if (RHS.IsImmediate()) {
+    assert(RHS.GetImmediate() == 0 && "Immediate must be zero");
+    RHS = MachineOperand::CreateRegister(GetRegInfo()->GetZeroRegister(32));
+  }
+  assert(!LHS.IsImmediate() && "LHS must be a register");
+  ExtendRegSize(&LHS);
+  ExtendRegSize(&RHS);
+
+  // GT and LE are selected as LT and GE with swapped operands
+  unsigned Opcode;
+  bool Swap = false;
+  switch (CMP->GetRelation()) {
+  case MachineInstruction::EQ:
+    Opcode = BEQ;
+    break;
+  case MachineInstruction::NE:
+    Opcode = BNE;
+    break;
+  case MachineInstruction::LT:
+    Opcode = BLT;
+    break;
+  case MachineInstruction::GE:
+    Opcode = BGE;
+    break;
+  case MachineInstruction::GT:
+    Opcode = BLT;
+    Swap = true;
+    break;
+  case MachineInstruction::LE:
+    Opcode = BGE;
+    Swap = true;
+    break;
+  default:
+    return false;
+  }
+
+  if (Swap)
+    std::swap(LHS, RHS);
+
+  // beq lhs, rhs, label
+  BRANCH->RemoveOperand(0);
+  BRANCH->InsertOperand(0, LHS);
+  BRANCH->InsertOperand(1, RHS);
+  BRANCH->SetOpcode(Opcode);
+
+  return true;
+}
@@ -23,6 +23,14 @@ public:
   uint8_t GetIntSize() override { return 32; }
   uint8_t GetLongSize() override { return 32; }
 
+  bool IsValidMemoryOffset(int64_t Offset) override {
+    return Offset >= -2048 && Offset <= 2047;
+  }
+
+  bool IsRematerializable(MachineInstruction *MI) override {
+    return MI->GetOpcode() == LI;
+  }
+
   bool SelectThreeAddressInstruction(MachineInstruction *MI, const Opcodes rrr,
                                      const Opcodes rri, unsigned ImmSize = 12);
 
@@ -33,10 +41,12 @@ public:
   bool SelectXOR(MachineInstruction *MI) override;
   bool SelectLSL(MachineInstruction *MI) override;
   bool SelectLSR(MachineInstruction *MI) override;
+  bool SelectASR(MachineInstruction *MI) override;
   bool SelectADD(MachineInstruction *MI) override;
   bool SelectSUB(MachineInstruction *MI) override;
   bool SelectMUL(MachineInstruction *MI) override;
   bool SelectMULHU(MachineInstruction *MI) override;
+  bool SelectMULHS(MachineInstruction *MI) override;
   bool SelectDIV(MachineInstruction *MI) override;
   bool SelectDIVU(MachineInstruction *MI) override;
   bool SelectMOD(MachineInstruction *MI) override;
@@ -55,8 +65,13 @@ public:
   bool SelectGLOBAL_ADDRESS(MachineInstruction *MI) override;
   bool SelectBRANCH(MachineInstruction *MI) override;
   bool SelectJUMP(MachineInstruction *MI) override;
+  bool SelectINDIRECT_JUMP(MachineInstruction *MI) override;
   bool SelectCALL(MachineInstruction *MI) override;
+  bool SelectTAIL_CALL(MachineInstruction *MI) override;
   bool SelectRET(MachineInstruction *MI) override;
+
+  bool SelectCMPAndBRANCH(MachineInstruction *CMP,
+                          MachineInstruction *BRANCH) override;
 };
 
 } // namespace RISCV
\ No newline at end of file
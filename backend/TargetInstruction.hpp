@@ -1,46 +1,99 @@
 #ifndef TARGET_INSTRUCTION_HPP
 #define TARGET_INSTRUCTION_HPP
 
-#include <string>
-#include <vector>
+#include "SchedulingClass.hpp"
+#include <cassert>
+#include <initializer_list>
+#include <string_view>
 
+/// Compile time description of a target instruction. Instances are meant to
+/// live in constexpr tables indexed by the opcode.
 class TargetInstruction {
 public:
   enum Attributes : unsigned {
+    NONE = 0,
     LOAD = 1,
     STORE = 1 << 1,
     RETURN = 1 << 2,
+    BRANCH = 1 << 3,
+    CALL = 1 << 4,
+    /// Only sets the condition flags, the first operand is not a def
+    COMPARE = 1 << 5,
+    /// The first operand is a def which is also read, like in movk
+    TIED_DEF = 1 << 6,
+    /// A jump to a function which returns to the caller of the current one
+    TAIL_CALL = CALL | RETURN,
   };
 
-  TargetInstruction() {}
-  TargetInstruction(unsigned OperationID, unsigned Size, const char *AsmString,
-                    std::vector<unsigned> OperandTypes)
-      : OperationID(OperationID), Size(Size), AsmString(AsmString),
-        OperandTypes(OperandTypes) {}
+  static constexpr unsigned MaxOperands = 4;
+
+  /// The opcode of the inverse branch of the instructions, which have none
+  static constexpr unsigned NO_INVERSE = ~0u;
 
-  TargetInstruction(unsigned OperationID, unsigned Size, const char *AsmString,
-                    std::vector<unsigned> OperandTypes, unsigned Attributes)
+  constexpr TargetInstruction() {}
+  constexpr TargetInstruction(unsigned OperationID, unsigned Size,
+                              std::string_view AsmString,
+                              std::initializer_list<unsigned> OperandTypes,
+                              unsigned Attributes = NONE,
+                              SchedulingClass SchedClass = {},
+                              unsigned InverseBranch = NO_INVERSE)
       : OperationID(OperationID), Size(Size), AsmString(AsmString),
-        OperandTypes(OperandTypes), Attributes(Attributes) {}
+        Attributes(Attributes), SchedClass(SchedClass),
+        InverseBranch(InverseBranch) {
+    assert(OperandTypes.size() <= MaxOperands && "Too many operands");
+    for (auto OpType : OperandTypes)
+      this->OperandTypes[OperandNumber++] = OpType;
+  }
+
+  constexpr std::string_view GetAsmString() const { return AsmString; }
+
+  constexpr unsigned GetOperationID() const { return OperationID; }
+  constexpr unsigned GetOperandNumber() const { return OperandNumber; }
+  constexpr unsigned GetOperandType(unsigned i) const {
+    assert(i < OperandNumber && "Out of bound access");
+    return OperandTypes[i];
+  }
+
+  constexpr unsigned GetSize() const { return Size; }
 
-  std::string &GetAsmString() { return AsmString; }
+  constexpr bool IsLoad() const { return (Attributes & LOAD) != 0; }
+  constexpr bool IsStore() const { return (Attributes & STORE) != 0; }
+  constexpr bool IsReturn() const { return (Attributes & RETURN) != 0; }
+  constexpr bool IsBranch() const { return (Attributes & BRANCH) != 0; }
+  constexpr bool IsCall() const { return (Attributes & CALL) != 0; }
+  constexpr bool IsCompare() const { return (Attributes & COMPARE) != 0; }
+  constexpr bool IsTiedDef() const { return (Attributes & TIED_DEF) != 0; }
+  constexpr bool IsTailCall() const { return IsCall() && IsReturn(); }
+  constexpr bool IsLoadOrStore() const { return IsLoad() || IsStore(); }
 
-  unsigned GetOperationID() const { return OperationID; }
-  unsigned GetOperandNumber() const { return OperandTypes.size(); }
+  /// Return how the instruction executes on the in-order cores targeted by
+  /// the instruction scheduler
+  constexpr const SchedulingClass &GetSchedulingClass() const {
+    return SchedClass;
+  }
 
-  unsigned GetSize() const { return Size; }
+  /// Return the opcode of the conditional branch, which is taken exactly when
+  /// this one is not, or NO_INVERSE
+  constexpr unsigned GetInverseBranch() const { return InverseBranch; }
+  constexpr bool HasInverseBranch() const {
+    return InverseBranch != NO_INVERSE;
+  }
 
-  bool IsLoad() const { return (Attributes & LOAD) != 0; }
-  bool IsStore() const { return (Attributes & STORE) != 0; }
-  bool IsReturn() const { return (Attributes & RETURN) != 0; }
-  bool IsLoadOrStore() const { return IsLoad() || IsStore(); }
+  /// Return true if the first operand is defined by the instruction
+  constexpr bool HasDef() const {
+    return OperandNumber > 0 && !IsStore() && !IsBranch() && !IsCall() &&
+           !IsReturn() && !IsCompare();
+  }
 
 private:
-  unsigned OperationID;
-  unsigned Size;
-  std::string AsmString;
-  std::vector<unsigned> OperandTypes;
-  unsigned Attributes = 0;
+  unsigned OperationID = 0;
+  unsigned Size = 0;
+  std::string_view AsmString;
+  unsigned OperandTypes[MaxOperands] = {};
+  unsigned OperandNumber = 0;
+  unsigned Attributes = NONE;
+  SchedulingClass SchedClass;
+  unsigned InverseBranch = NO_INVERSE;
 };
 
 #endif
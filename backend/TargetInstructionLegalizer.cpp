@@ -4,6 +4,7 @@
 #include "MachineInstruction.hpp"
 #include "TargetMachine.hpp"
 #include <cassert>
+#include <utility>
 
 /// Materialize @MI instruction @Index-th operand - which must be an immediate -
 /// into a virtual register by issuing a LOAD_IMM
@@ -22,12 +23,44 @@ static bool MaterializeImmOperand(MachineInstruction *MI, const size_t Index) {
   MI->InsertOperand(Index, MachineOperand::CreateVirtualRegister(
                                DestReg, MI->GetOperand(0)->GetSize()));
 
-  // insert after modifying MI, otherwise MI would became invalid
   ParentBB->InsertBefore(std::move(LI), MI);
 
   return true;
 }
 
+bool TargetInstructionLegalizer::IsFeedingNextBranch(MachineInstruction *MI) {
+  auto NextMI = MI->GetParent()->GetNextInstr(MI);
+
+  return MI->GetOpcode() == MachineInstruction::CMP && NextMI != nullptr &&
+         NextMI->GetOpcode() == MachineInstruction::BRANCH &&
+         NextMI->IsFallThroughBranch() &&
+         NextMI->GetOperand(0)->IsVirtualReg() &&
+         NextMI->GetOperand(0)->GetReg() == MI->GetOperand(0)->GetReg();
+}
+
+bool TargetInstructionLegalizer::IsFeedingNextSelect(MachineInstruction *MI) {
+  auto NextMI = MI->GetParent()->GetNextInstr(MI);
+
+  if ((MI->GetOpcode() != MachineInstruction::CMP &&
+       MI->GetOpcode() != MachineInstruction::CMPF) ||
+      NextMI == nullptr || NextMI->GetOpcode() != MachineInstruction::SELECT ||
+      !NextMI->GetOperand(1)->IsVirtualReg() ||
+      NextMI->GetOperand(1)->GetReg() != MI->GetOperand(0)->GetReg())
+    return false;
+
+  // The values are not used outside of their block
+  for (auto &Other : MI->GetParent()->GetInstructions()) {
+    if (&Other == MI || &Other == NextMI)
+      continue;
+
+    for (auto &MO : Other.GetOperands())
+      if (MO.IsVirtualReg() && MO.GetReg() == MI->GetOperand(0)->GetReg())
+        return false;
+  }
+
+  return true;
+}
+
 bool TargetInstructionLegalizer::IsRelSupported(
     MachineInstruction::CMPRelation Rel) const {
   return UnSupportedRelations.count(Rel) == 0;
@@ -648,8 +681,7 @@ bool TargetInstructionLegalizer::ExpandCMP(MachineInstruction *MI) {
     Xor.AddOperand(XorDstMO);
     Xor.AddOperand(*MI->GetOperand(1));
     Xor.AddOperand(*MI->GetOperand(2));
-    MI = &*ParentBB->InsertBefore(std::move(Xor), MI);
-    MI++;
+    ParentBB->InsertBefore(std::move(Xor), MI);
 
     // Replace the immediate operand with the result register
     MI->RemoveOperand(2);
@@ -697,9 +729,8 @@ bool TargetInstructionLegalizer::ExpandCMP(MachineInstruction *MI) {
         LI.SetOpcode(MachineInstruction::LOAD_IMM);
         LI.AddOperand(dst);
         LI.AddOperand(src2);
-        MI = &*ParentBB->InsertBefore(std::move(LI), MI);
+        ParentBB->InsertBefore(std::move(LI), MI);
         src2 = dst;
-        MI++;
       }
     }
 
@@ -769,9 +800,8 @@ bool TargetInstructionLegalizer::ExpandCMP(MachineInstruction *MI) {
         LI.SetOpcode(MachineInstruction::LOAD_IMM);
         LI.AddOperand(dst);
         LI.AddOperand(src2);
-        MI = &*ParentBB->InsertBefore(std::move(LI), MI);
+        ParentBB->InsertBefore(std::move(LI), MI);
         src2 = dst;
-        MI++;
       }
     }
 
@@ -991,6 +1021,29 @@ bool TargetInstructionLegalizer::ExpandSTORE(MachineInstruction *MI) {
   return true;
 }
 
+/// The shifted value can only be a register, so if it is an immediate like in
+///     LSL %dst, 1, %amount
+/// then it is materialized first
+///     LOAD_IMM %one, 1
+///     LSL      %dst, %one, %amount
+bool TargetInstructionLegalizer::ExpandLSL(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 3 && "LSL must have exactly 3 operands");
+
+  if (MI->GetOperand(1)->IsImmediate())
+    return MaterializeImmOperand(MI, 1);
+
+  return false;
+}
+
+bool TargetInstructionLegalizer::ExpandLSR(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 3 && "LSR must have exactly 3 operands");
+
+  if (MI->GetOperand(1)->IsImmediate())
+    return MaterializeImmOperand(MI, 1);
+
+  return false;
+}
+
 /// Expand 64 bit SUB to equivalent calculation using 32 bit substractions
 /// The following
 ///     SUB     %dst(s64), %src1(s64), %src1(s64)
@@ -1168,6 +1221,363 @@ bool TargetInstructionLegalizer::ExpandTRUNC(MachineInstruction *MI) {
   return true;
 }
 
+/// Insert @Opcode %dst, @Src1, @Src2 before @MI, where %dst is a new virtual
+/// register as wide as the result of @MI. Return %dst.
+static MachineOperand InsertBefore(MachineInstruction *MI, unsigned Opcode,
+                                   const MachineOperand &Src1,
+                                   const MachineOperand &Src2) {
+  auto ParentBB = MI->GetParent();
+  auto Dest = MachineOperand::CreateVirtualRegister(
+      ParentBB->GetParent()->GetNextAvailableVReg(),
+      MI->GetOperand(0)->GetSize());
+
+  auto NewMI = MachineInstruction(Opcode, ParentBB);
+  NewMI.AddOperand(Dest);
+  NewMI.AddOperand(Src1);
+  NewMI.AddOperand(Src2);
+  ParentBB->InsertBefore(std::move(NewMI), MI);
+
+  return Dest;
+}
+
+/// Replace @MI with @Opcode computing its result from @Src1 and @Src2.
+static bool ReplaceWith(MachineInstruction *MI, unsigned Opcode,
+                        const MachineOperand &Src1,
+                        const MachineOperand &Src2) {
+  auto NewMI = MachineInstruction(Opcode, MI->GetParent());
+  NewMI.AddOperand(*MI->GetOperand(0));
+  NewMI.AddOperand(Src1);
+  NewMI.AddOperand(Src2);
+  MI->GetParent()->ReplaceInstr(std::move(NewMI), MI);
+
+  return true;
+}
+
+/// Return @Value as an immediate as wide as the result of @MI.
+static MachineOperand GetImmediate(MachineInstruction *MI, uint64_t Value) {
+  const unsigned Size = MI->GetOperand(0)->GetSize();
+  const uint64_t Mask = Size == 64 ? ~0ull : (1ull << Size) - 1;
+
+  return MachineOperand::CreateImmediate(Value & Mask, Size);
+}
+
+/// The rotation is done by two shifts
+///     ROTR    %dst, %src, %amount
+///
+/// is replaced with
+///     LSR     %lo, %src, %amount
+///     SUB     %neg, 0, %amount
+///     LSL     %hi, %src, %neg
+///     OR      %dst, %lo, %hi
+///
+/// relying on that only the low bits of the shift amount are used. With an
+/// immediate amount the width minus the amount is used instead.
+bool TargetInstructionLegalizer::ExpandROTR(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 3 && "ROTR must have exactly 3 operands");
+  const unsigned Size = MI->GetOperand(0)->GetSize();
+  assert(Size <= TM->GetPointerSize() && "Unsupported rotation");
+
+  if (MI->GetOperand(1)->IsImmediate())
+    return MaterializeImmOperand(MI, 1);
+
+  auto Src = *MI->GetOperand(1);
+  auto Amount = *MI->GetOperand(2);
+
+  MachineOperand NegAmount;
+  if (Amount.IsImmediate()) {
+    const uint64_t Imm = Amount.GetImmediate() % Size;
+    if (Imm == 0)
+      return ReplaceWith(MI, MachineInstruction::OR, Src, GetImmediate(MI, 0));
+
+    NegAmount = MachineOperand::CreateImmediate(Size - Imm, Amount.GetSize());
+  } else {
+    auto Zero = MachineOperand::CreateImmediate(0, Amount.GetSize());
+    if (auto ZeroReg = TM->GetRegInfo()->GetZeroRegister(Amount.GetSize());
+        ZeroReg != ~0u)
+      Zero = MachineOperand::CreateRegister(ZeroReg, Amount.GetSize());
+    NegAmount = InsertBefore(MI, MachineInstruction::SUB, Zero, Amount);
+  }
+
+  auto Lo = InsertBefore(MI, MachineInstruction::LSR, Src, Amount);
+  auto Hi = InsertBefore(MI, MachineInstruction::LSL, Src, NegAmount);
+  return ReplaceWith(MI, MachineInstruction::OR, Lo, Hi);
+}
+
+/// Every bit below the highest set one is set first, then the remaining zeros
+/// are counted
+///     CLZ     %dst, %src
+///
+/// is replaced with
+///     LSR     %shr1, %src, 1
+///     OR      %or1, %src, %shr1
+///     ...
+///     LSR     %shr16, %or8, 16
+///     OR      %or16, %or8, %shr16
+///     XOR     %not, %or16, -1
+///     POPCOUNT %dst, %not
+bool TargetInstructionLegalizer::ExpandCLZ(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 2 && "CLZ must have exactly 2 operands");
+  const unsigned Size = MI->GetOperand(0)->GetSize();
+
+  auto Value = *MI->GetOperand(1);
+  for (unsigned Shift = 1; Shift < Size; Shift *= 2) {
+    auto Shifted = InsertBefore(MI, MachineInstruction::LSR, Value,
+                                MachineOperand::CreateImmediate(Shift));
+    Value = InsertBefore(MI, MachineInstruction::OR, Value, Shifted);
+  }
+
+  auto Not = InsertBefore(MI, MachineInstruction::XOR, Value,
+                          GetImmediate(MI, ~0ull));
+  MI->SetOpcode(MachineInstruction::POPCOUNT);
+  MI->ReplaceOperand(Not, 1);
+
+  return true;
+}
+
+/// The trailing zeros are turned into ones and everything else to zeros
+///     CTZ     %dst, %src
+///
+/// is replaced with
+///     SUB     %dec, %src, 1
+///     XOR     %not, %src, -1
+///     AND     %and, %not, %dec
+///     POPCOUNT %dst, %and
+bool TargetInstructionLegalizer::ExpandCTZ(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 2 && "CTZ must have exactly 2 operands");
+
+  auto Src = *MI->GetOperand(1);
+  auto Dec = InsertBefore(MI, MachineInstruction::SUB, Src, GetImmediate(MI, 1));
+  auto Not =
+      InsertBefore(MI, MachineInstruction::XOR, Src, GetImmediate(MI, ~0ull));
+  auto And = InsertBefore(MI, MachineInstruction::AND, Not, Dec);
+  MI->SetOpcode(MachineInstruction::POPCOUNT);
+  MI->ReplaceOperand(And, 1);
+
+  return true;
+}
+
+/// The bits are summed in parallel in increasingly wider fields
+///     POPCOUNT %dst, %src
+///
+/// is replaced with
+///     LSR     %shr1, %src, 1
+///     AND     %and1, %shr1, 0x5555...
+///     SUB     %sum2, %src, %and1
+///     AND     %and2, %sum2, 0x3333...
+///     LSR     %shr2, %sum2, 2
+///     AND     %and3, %shr2, 0x3333...
+///     ADD     %sum4, %and2, %and3
+///     LSR     %shr4, %sum4, 4
+///     ADD     %add4, %sum4, %shr4
+///     AND     %sum8, %add4, 0x0f0f...
+///     MUL     %mul, %sum8, 0x0101...
+///     LSR     %dst, %mul, width - 8
+///
+/// where the multiplication sums the bytes into the highest one.
+bool TargetInstructionLegalizer::ExpandPOPCOUNT(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 2 &&
+         "POPCOUNT must have exactly 2 operands");
+  const unsigned Size = MI->GetOperand(0)->GetSize();
+  assert((Size == 32 || Size == 64) && Size <= TM->GetPointerSize() &&
+         "Unsupported population count");
+
+  auto Src = *MI->GetOperand(1);
+  auto Shr1 = InsertBefore(MI, MachineInstruction::LSR, Src,
+                           MachineOperand::CreateImmediate(1));
+  auto And1 = InsertBefore(MI, MachineInstruction::AND, Shr1,
+                           GetImmediate(MI, 0x5555555555555555));
+  auto Sum2 = InsertBefore(MI, MachineInstruction::SUB, Src, And1);
+  auto And2 = InsertBefore(MI, MachineInstruction::AND, Sum2,
+                           GetImmediate(MI, 0x3333333333333333));
+  auto Shr2 = InsertBefore(MI, MachineInstruction::LSR, Sum2,
+                           MachineOperand::CreateImmediate(2));
+  auto And3 = InsertBefore(MI, MachineInstruction::AND, Shr2,
+                           GetImmediate(MI, 0x3333333333333333));
+  auto Sum4 = InsertBefore(MI, MachineInstruction::ADD, And2, And3);
+  auto Shr4 = InsertBefore(MI, MachineInstruction::LSR, Sum4,
+                           MachineOperand::CreateImmediate(4));
+  auto Add4 = InsertBefore(MI, MachineInstruction::ADD, Sum4, Shr4);
+  auto Sum8 = InsertBefore(MI, MachineInstruction::AND, Add4,
+                           GetImmediate(MI, 0x0f0f0f0f0f0f0f0f));
+  auto Mul = InsertBefore(MI, MachineInstruction::MUL, Sum8,
+                          GetImmediate(MI, 0x0101010101010101));
+  return ReplaceWith(MI, MachineInstruction::LSR, Mul,
+                     MachineOperand::CreateImmediate(Size - 8));
+}
+
+/// The bytes are moved to their place by shifts and masks, for 32 bit
+///     BSWAP   %dst, %src
+///
+/// is replaced with
+///     LSL     %b3, %src, 24
+///     AND     %and2, %src, 0xff00
+///     LSL     %b2, %and2, 8
+///     OR      %or2, %b3, %b2
+///     LSR     %shr1, %src, 8
+///     AND     %b1, %shr1, 0xff00
+///     OR      %or1, %or2, %b1
+///     LSR     %b0, %src, 24
+///     OR      %dst, %or1, %b0
+bool TargetInstructionLegalizer::ExpandBSWAP(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 2 && "BSWAP must have exactly 2 operands");
+  const unsigned Size = MI->GetOperand(0)->GetSize();
+  assert((Size == 16 || Size == 32) && "Unsupported byte swap");
+
+  auto Src = *MI->GetOperand(1);
+  auto Byte = [](unsigned Shift) {
+    return MachineOperand::CreateImmediate(Shift);
+  };
+
+  if (Size == 16) {
+    auto Lo = InsertBefore(MI, MachineInstruction::AND, Src,
+                           GetImmediate(MI, 0xff));
+    auto Hi = InsertBefore(MI, MachineInstruction::LSL, Lo, Byte(8));
+    auto Shr = InsertBefore(MI, MachineInstruction::LSR, Src, Byte(8));
+    auto And = InsertBefore(MI, MachineInstruction::AND, Shr,
+                            GetImmediate(MI, 0xff));
+    return ReplaceWith(MI, MachineInstruction::OR, Hi, And);
+  }
+
+  auto B3 = InsertBefore(MI, MachineInstruction::LSL, Src, Byte(24));
+  auto And2 = InsertBefore(MI, MachineInstruction::AND, Src,
+                           GetImmediate(MI, 0xff00));
+  auto B2 = InsertBefore(MI, MachineInstruction::LSL, And2, Byte(8));
+  auto Or2 = InsertBefore(MI, MachineInstruction::OR, B3, B2);
+  auto Shr1 = InsertBefore(MI, MachineInstruction::LSR, Src, Byte(8));
+  auto B1 = InsertBefore(MI, MachineInstruction::AND, Shr1,
+                         GetImmediate(MI, 0xff00));
+  auto Or1 = InsertBefore(MI, MachineInstruction::OR, Or2, B1);
+  auto B0 = InsertBefore(MI, MachineInstruction::LSR, Src, Byte(24));
+  return ReplaceWith(MI, MachineInstruction::OR, Or1, B0);
+}
+
+/// The checksum is updated bit by bit with the reversed polynomial 0xEDB88320
+///     CRC32   %dst, %crc, %data
+///
+/// is replaced with
+///     AND     %masked, %data, width mask
+///     XOR     %crc0, %crc, %masked
+///     LOAD_IMM %poly, 0xEDB88320
+///     AND     %bit, %crc0, 1
+///     MUL     %xor, %bit, %poly
+///     LSR     %shr, %crc0, 1
+///     XOR     %crc1, %shr, %xor
+///     ...
+///
+/// repeating the last 4 instructions for each bit of the data.
+bool TargetInstructionLegalizer::ExpandCRC32(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 3 && "CRC32 must have exactly 3 operands");
+  auto ParentBB = MI->GetParent();
+  auto CRC = *MI->GetOperand(1);
+  auto Data = *MI->GetOperand(2);
+  const unsigned DataSize = Data.GetSize();
+  assert(DataSize <= TM->GetPointerSize() && "Unsupported CRC-32");
+
+  // The data register might have garbage above its width
+  if (Data.IsImmediate())
+    Data = GetImmediate(MI, Data.GetImmediate());
+  else if (DataSize < 32) {
+    Data.SetSize(MI->GetOperand(0)->GetSize());
+    Data = InsertBefore(MI, MachineInstruction::AND, Data,
+                        GetImmediate(MI, (1ull << DataSize) - 1));
+  }
+
+  if (CRC.IsImmediate())
+    std::swap(CRC, Data);
+  CRC = InsertBefore(MI, MachineInstruction::XOR, CRC, Data);
+
+  auto Poly = MachineOperand::CreateVirtualRegister(
+      ParentBB->GetParent()->GetNextAvailableVReg(), 32);
+  auto LI = MachineInstruction(MachineInstruction::LOAD_IMM, ParentBB);
+  LI.AddOperand(Poly);
+  LI.AddOperand(GetImmediate(MI, 0xEDB88320));
+  ParentBB->InsertBefore(std::move(LI), MI);
+
+  for (unsigned i = 0; i < DataSize; i++) {
+    auto Bit = InsertBefore(MI, MachineInstruction::AND, CRC,
+                            GetImmediate(MI, 1));
+    auto Xor = InsertBefore(MI, MachineInstruction::MUL, Bit, Poly);
+    auto Shr = InsertBefore(MI, MachineInstruction::LSR, CRC,
+                            MachineOperand::CreateImmediate(1));
+    if (i + 1 == DataSize)
+      return ReplaceWith(MI, MachineInstruction::XOR, Shr, Xor);
+    CRC = InsertBefore(MI, MachineInstruction::XOR, Shr, Xor);
+  }
+
+  return false;
+}
+
+/// The source is chosen without a branch by masking their difference
+///     SELECT  %dst, %cond, %src1, %src2
+///
+/// is replaced with
+///     SUB     %mask, 0, %cond
+///     XOR     %diff, %src1, %src2
+///     AND     %masked, %diff, %mask
+///     XOR     %dst, %src2, %masked
+///
+/// where the condition is 0 or 1. The values wider than the registers are
+/// selected by halves.
+bool TargetInstructionLegalizer::ExpandSELECT(MachineInstruction *MI) {
+  assert(MI->GetOperandsNumber() == 4 && "SELECT must have exactly 4 operands");
+  auto ParentBB = MI->GetParent();
+  auto ParentFunc = ParentBB->GetParent();
+  auto Dest = *MI->GetOperand(0);
+  auto Cond = *MI->GetOperand(1);
+
+  for (size_t Index = 2; Index < 4; Index++)
+    if (MI->GetOperand(Index)->IsImmediate()) {
+      MaterializeImmOperand(MI, Index);
+      return true;
+    }
+
+  auto Src1 = *MI->GetOperand(2);
+  auto Src2 = *MI->GetOperand(3);
+
+  if (Dest.GetSize() > TM->GetPointerSize()) {
+    MachineOperand Halves[2][2];
+    for (unsigned i = 0; i < 2; i++) {
+      auto Split = MachineInstruction(MachineInstruction::SPLIT, ParentBB);
+      for (auto &Half : Halves[i]) {
+        Half = MachineOperand::CreateVirtualRegister(
+            ParentFunc->GetNextAvailableVReg(), TM->GetPointerSize());
+        Split.AddOperand(Half);
+      }
+      Split.AddOperand(i == 0 ? Src1 : Src2);
+      ParentBB->InsertBefore(std::move(Split), MI);
+    }
+
+    auto Merge = MachineInstruction(MachineInstruction::MERGE, ParentBB);
+    Merge.AddOperand(Dest);
+    for (unsigned i = 0; i < 2; i++) {
+      auto Half = MachineOperand::CreateVirtualRegister(
+          ParentFunc->GetNextAvailableVReg(), TM->GetPointerSize());
+      auto Select = MachineInstruction(MachineInstruction::SELECT, ParentBB);
+      Select.AddOperand(Half);
+      Select.AddOperand(Cond);
+      Select.AddOperand(Halves[0][i]);
+      Select.AddOperand(Halves[1][i]);
+      ParentBB->InsertBefore(std::move(Select), MI);
+      Merge.AddOperand(Half);
+    }
+
+    ParentBB->ReplaceInstr(std::move(Merge), MI);
+    return true;
+  }
+
+  // The negation subtracts from the zero register, if the target has one
+  auto Zero = GetImmediate(MI, 0);
+  if (auto ZeroReg = TM->GetRegInfo()->GetZeroRegister(Dest.GetSize());
+      ZeroReg != ~0u)
+    Zero = MachineOperand::CreateRegister(ZeroReg, Dest.GetSize());
+
+  Cond.SetSize(Dest.GetSize());
+  auto Mask = InsertBefore(MI, MachineInstruction::SUB, Zero, Cond);
+  auto Diff = InsertBefore(MI, MachineInstruction::XOR, Src1, Src2);
+  auto Masked = InsertBefore(MI, MachineInstruction::AND, Diff, Mask);
+  return ReplaceWith(MI, MachineInstruction::XOR, Src2, Masked);
+}
+
 bool TargetInstructionLegalizer::Expand(MachineInstruction *MI) {
   switch (MI->GetOpcode()) {
   case MachineInstruction::ADD:
@@ -1178,6 +1588,10 @@ bool TargetInstructionLegalizer::Expand(MachineInstruction *MI) {
     return ExpandADDC(MI);
   case MachineInstruction::XOR:
     return ExpandXOR(MI);
+  case MachineInstruction::LSL:
+    return ExpandLSL(MI);
+  case MachineInstruction::LSR:
+    return ExpandLSR(MI);
   case MachineInstruction::CMP:
     return ExpandCMP(MI);
   case MachineInstruction::MOD:
@@ -1203,6 +1617,20 @@ bool TargetInstructionLegalizer::Expand(MachineInstruction *MI) {
     return ExpandTRUNC(MI);
   case MachineInstruction::GLOBAL_ADDRESS:
     return ExpandGLOBAL_ADDRESS(MI);
+  case MachineInstruction::ROTR:
+    return ExpandROTR(MI);
+  case MachineInstruction::CLZ:
+    return ExpandCLZ(MI);
+  case MachineInstruction::CTZ:
+    return ExpandCTZ(MI);
+  case MachineInstruction::POPCOUNT:
+    return ExpandPOPCOUNT(MI);
+  case MachineInstruction::BSWAP:
+    return ExpandBSWAP(MI);
+  case MachineInstruction::CRC32:
+    return ExpandCRC32(MI);
+  case MachineInstruction::SELECT:
+    return ExpandSELECT(MI);
   default:
     break;
   }
@@ -27,6 +27,8 @@ public:
   virtual bool ExpandADDS(MachineInstruction *MI);
   virtual bool ExpandADDC(MachineInstruction *MI);
   virtual bool ExpandXOR(MachineInstruction *MI);
+  virtual bool ExpandLSL(MachineInstruction *MI);
+  virtual bool ExpandLSR(MachineInstruction *MI);
   virtual bool ExpandCMP(MachineInstruction *MI);
   virtual bool ExpandMOD(MachineInstruction *MI, bool IsUnsigned);
   virtual bool ExpandLOAD(MachineInstruction *MI);
@@ -39,11 +41,28 @@ public:
   virtual bool ExpandZEXT(MachineInstruction *MI);
   virtual bool ExpandTRUNC(MachineInstruction *MI);
   virtual bool ExpandGLOBAL_ADDRESS(MachineInstruction *MI) { return false; }
+  virtual bool ExpandROTR(MachineInstruction *MI);
+  virtual bool ExpandCLZ(MachineInstruction *MI);
+  virtual bool ExpandCTZ(MachineInstruction *MI);
+  virtual bool ExpandPOPCOUNT(MachineInstruction *MI);
+  virtual bool ExpandBSWAP(MachineInstruction *MI);
+  virtual bool ExpandCRC32(MachineInstruction *MI);
+  virtual bool ExpandSELECT(MachineInstruction *MI);
 
   /// Expanding the instruction into other ones which are compute the same
   /// value, but usually takes more instructions.
   bool Expand(MachineInstruction *MI);
 protected:
+  /// Return true if the result of the compare @MI is the condition of the
+  /// branch right after it. Instruction selection fuses such pairs, so the
+  /// boolean result does not need to be materialized.
+  static bool IsFeedingNextBranch(MachineInstruction *MI);
+
+  /// Return true if the result of the compare @MI is only used as the
+  /// condition of the select right after it.
+  static bool IsFeedingNextSelect(MachineInstruction *MI);
+
+
   TargetMachine *TM = nullptr;
   std::set<MachineInstruction::CMPRelation> UnSupportedRelations;
 };
@@ -28,6 +28,10 @@ bool TargetMachine::SelectInstruction(MachineInstruction *MI) {
     return SelectMUL(MI);
   case MachineInstruction::MULHU:
     return SelectMULHU(MI);
+  case MachineInstruction::MULHS:
+    return SelectMULHS(MI);
+  case MachineInstruction::ASR:
+    return SelectASR(MI);
   case MachineInstruction::DIV:
     return SelectDIV(MI);
   case MachineInstruction::DIVU:
@@ -78,10 +82,30 @@ bool TargetMachine::SelectInstruction(MachineInstruction *MI) {
     return SelectBRANCH(MI);
   case MachineInstruction::JUMP:
     return SelectJUMP(MI);
+  case MachineInstruction::INDIRECT_JUMP:
+    return SelectINDIRECT_JUMP(MI);
   case MachineInstruction::CALL:
     return SelectCALL(MI);
+  case MachineInstruction::TAIL_CALL:
+    return SelectTAIL_CALL(MI);
   case MachineInstruction::RET:
     return SelectRET(MI);
+  case MachineInstruction::SPLAT:
+    return SelectSPLAT(MI);
+  case MachineInstruction::REDUCE_ADD:
+    return SelectREDUCE_ADD(MI);
+  case MachineInstruction::ROTR:
+    return SelectROTR(MI);
+  case MachineInstruction::CLZ:
+    return SelectCLZ(MI);
+  case MachineInstruction::CTZ:
+    return SelectCTZ(MI);
+  case MachineInstruction::BSWAP:
+    return SelectBSWAP(MI);
+  case MachineInstruction::CRC32:
+    return SelectCRC32(MI);
+  case MachineInstruction::SELECT:
+    return SelectSELECT(MI);
   default:
     assert(!"Unimplemented");
   }
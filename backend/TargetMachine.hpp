@@ -25,6 +25,22 @@ public:
 
   bool IsMemcpySupported() const { return ABI->HasCLib(); }
 
+  /// Return the size in bytes of the widest chunks, which the inline expanded
+  /// memory copies and fills access at once.
+  virtual unsigned GetMemOpChunkSize() { return 4; }
+
+  /// Return the largest memory copy or fill in bytes, which is expanded inline
+  /// even if the C library could be called for it.
+  virtual unsigned GetInlineMemOpLimit() { return 32; }
+
+  /// Return true if loads and stores may access memory at addresses, which
+  /// are not multiples of the access size.
+  virtual bool AllowsMisalignedAccess() { return false; }
+
+  /// Return true if @Offset can be encoded as the immediate offset of every
+  /// load and store instruction of the target.
+  virtual bool IsValidMemoryOffset(int64_t Offset) { return false; }
+
   bool SelectInstruction(MachineInstruction *MI);
 
   virtual bool SelectAND(MachineInstruction *MI) { assert(!"Unimplemented"); }
@@ -32,12 +48,14 @@ public:
   virtual bool SelectXOR(MachineInstruction *MI) { assert(!"Unimplemented"); }
   virtual bool SelectLSL(MachineInstruction *MI) { assert(!"Unimplemented"); }
   virtual bool SelectLSR(MachineInstruction *MI) { assert(!"Unimplemented"); }
+  virtual bool SelectASR(MachineInstruction *MI) { assert(!"Unimplemented"); }
   virtual bool SelectADD(MachineInstruction *MI) { assert(!"Unimplemented"); }
   virtual bool SelectADDS(MachineInstruction *MI) { assert(!"Unimplemented"); }
   virtual bool SelectADDC(MachineInstruction *MI) { assert(!"Unimplemented"); }
   virtual bool SelectSUB(MachineInstruction *MI) { assert(!"Unimplemented"); }
   virtual bool SelectMUL(MachineInstruction *MI) { assert(!"Unimplemented"); }
   virtual bool SelectMULHU(MachineInstruction *MI) { assert(!"Unimplemented"); }
+  virtual bool SelectMULHS(MachineInstruction *MI) { assert(!"Unimplemented"); }
   virtual bool SelectDIV(MachineInstruction *MI) { assert(!"Unimplemented"); }
   virtual bool SelectDIVU(MachineInstruction *MI) { assert(!"Unimplemented"); }
   virtual bool SelectMOD(MachineInstruction *MI) { assert(!"Unimplemented"); }
@@ -65,8 +83,62 @@ public:
   virtual bool SelectGLOBAL_ADDRESS(MachineInstruction *MI) { assert(!"Unimplemented"); }
   virtual bool SelectBRANCH(MachineInstruction *MI) { assert(!"Unimplemented"); }
   virtual bool SelectJUMP(MachineInstruction *MI) { assert(!"Unimplemented"); }
+  virtual bool SelectINDIRECT_JUMP(MachineInstruction *MI) { assert(!"Unimplemented"); }
   virtual bool SelectCALL(MachineInstruction *MI) { assert(!"Unimplemented"); }
+  virtual bool SelectTAIL_CALL(MachineInstruction *MI) {
+    assert(!"Unimplemented");
+  }
   virtual bool SelectRET(MachineInstruction *MI) { assert(!"Unimplemented"); }
+  virtual bool SelectSPLAT(MachineInstruction *MI) { assert(!"Unimplemented"); }
+  virtual bool SelectREDUCE_ADD(MachineInstruction *MI) {
+    assert(!"Unimplemented");
+  }
+  virtual bool SelectROTR(MachineInstruction *MI) { assert(!"Unimplemented"); }
+  virtual bool SelectCLZ(MachineInstruction *MI) { assert(!"Unimplemented"); }
+  virtual bool SelectCTZ(MachineInstruction *MI) { assert(!"Unimplemented"); }
+  virtual bool SelectBSWAP(MachineInstruction *MI) { assert(!"Unimplemented"); }
+  virtual bool SelectCRC32(MachineInstruction *MI) { assert(!"Unimplemented"); }
+  virtual bool SelectSELECT(MachineInstruction *MI) { assert(!"Unimplemented"); }
+
+  /// Select the compare @CMP and the conditional branch @BRANCH testing its
+  /// result together, so the result is never materialized. On success
+  /// @BRANCH is selected, while @CMP is either selected as well or left
+  /// unselected, which means it is not needed anymore.
+  virtual bool SelectCMPAndBRANCH(MachineInstruction *CMP,
+                                  MachineInstruction *BRANCH) {
+    return false;
+  }
+
+  /// Select the LOAD or STORE @MI into an access of @Base + (@Index << @Shift),
+  /// where @Extend is 0 or the SEXT or ZEXT opcode extending the smaller
+  /// @Index to the pointer size. Return false if the target has no such
+  /// addressing mode, in which case @MI is left unchanged.
+  virtual bool SelectIndexedLoadStore(MachineInstruction *MI,
+                                      MachineOperand Base, MachineOperand Index,
+                                      unsigned Shift, unsigned Extend) {
+    return false;
+  }
+
+  /// Return true if @MI only sets its destination to a constant, so instead of
+  /// keeping its result in a register, it can be executed again at the uses.
+  virtual bool IsRematerializable(MachineInstruction *MI) { return false; }
+
+  /// Create into @MI a store of @Reg1 and @Reg2 to the consecutive stack
+  /// slots at SP + @Offset. With @UpdateSP the store is pre-indexed: SP is
+  /// adjusted by @Offset first and the registers are stored at the new SP, in
+  /// which case @Reg2 might be ~0 to only store @Reg1. Return false if the
+  /// target has no such instruction.
+  virtual bool CreateStorePair(MachineInstruction &MI, unsigned Reg1,
+                               unsigned Reg2, int64_t Offset, bool UpdateSP) {
+    return false;
+  }
+
+  /// Like CreateStorePair, but loads the registers. With @UpdateSP the load is
+  /// post-indexed: SP is adjusted by @Offset after loading from SP.
+  virtual bool CreateLoadPair(MachineInstruction &MI, unsigned Reg1,
+                              unsigned Reg2, int64_t Offset, bool UpdateSP) {
+    return false;
+  }
 
 protected:
   std::unique_ptr<TargetABI> ABI = nullptr;
@@ -1,54 +1,61 @@
 #ifndef TARGET_REGISTER_HPP
 #define TARGET_REGISTER_HPP
 
-#include <set>
-#include <string>
-#include <vector>
+#include <cassert>
+#include <string_view>
 
+/// Compile time description of a physical register. Instances are meant to
+/// live in constexpr tables indexed by the register ID.
 class TargetRegister {
 public:
-  TargetRegister() {}
-
-  void SetID(unsigned ID) { this->ID = ID; }
-  unsigned GetID() { return ID; }
-
-  void SetBitWidth(unsigned BitWidth) { this->BitWidth = BitWidth; }
-  unsigned GetBitWidth() const { return BitWidth; }
-
-  void SetName(std::string &N) { Name = N; }
-  void SetName(const char *N) { Name = N; }
-  std::string &GetName() { return Name; }
-
-  void SetAlias(const char *N) { AliasName = N; }
-  std::string &GetAlias() { return AliasName; }
-
-  void SetSubRegs(std::vector<unsigned> &N) { SubRegisters = N; }
-  std::vector<unsigned> &GetSubRegs() { return SubRegisters; }
-
-  void SetFP(bool p) { FPCapable = p; }
-  bool IsFP() const { return FPCapable; }
-
-  static TargetRegister Create(unsigned ID, unsigned BitWidth, const char *Name,
-                               const char *Alias,
-                               std::vector<unsigned> SubRegs = {},
-                               bool FP = false) {
-    TargetRegister NewReg;
-    NewReg.SetID(ID);
-    NewReg.SetBitWidth(BitWidth);
-    NewReg.SetName(Name);
-    NewReg.SetAlias(Alias);
-    NewReg.SetFP(FP);
-    NewReg.SetSubRegs(SubRegs);
-    return NewReg;
+  /// For now a register has at most one sub register, like the W register of
+  /// an X register on AArch64
+  static constexpr unsigned MaxSubRegs = 1;
+
+  /// Read-only view of the sub registers
+  class SubRegList {
+  public:
+    constexpr SubRegList(const unsigned *Begin, unsigned Size)
+        : Begin(Begin), Size(Size) {}
+
+    constexpr const unsigned *begin() const { return Begin; }
+    constexpr const unsigned *end() const { return Begin + Size; }
+    constexpr bool empty() const { return Size == 0; }
+    constexpr unsigned size() const { return Size; }
+    constexpr unsigned operator[](unsigned i) const {
+      assert(i < Size && "Out of bound access");
+      return Begin[i];
+    }
+
+  private:
+    const unsigned *Begin;
+    unsigned Size;
+  };
+
+  constexpr TargetRegister() {}
+  constexpr TargetRegister(unsigned ID, unsigned BitWidth,
+                           std::string_view Name, std::string_view Alias,
+                           unsigned SubReg = 0, bool FP = false)
+      : ID(ID), BitWidth(BitWidth), Name(Name), AliasName(Alias),
+        SubRegisters{SubReg}, SubRegsNumber(SubReg ? 1 : 0), FPCapable(FP) {}
+
+  constexpr unsigned GetID() const { return ID; }
+  constexpr unsigned GetBitWidth() const { return BitWidth; }
+  constexpr std::string_view GetName() const { return Name; }
+  constexpr std::string_view GetAlias() const { return AliasName; }
+  constexpr SubRegList GetSubRegs() const {
+    return SubRegList(SubRegisters, SubRegsNumber);
   }
+  constexpr bool IsFP() const { return FPCapable; }
 
 private:
   unsigned ID = 0;
   unsigned BitWidth = 0;
-  std::string Name;
-  std::string AliasName;
-  std::vector<unsigned> SubRegisters;
-  bool FPCapable;
+  std::string_view Name;
+  std::string_view AliasName;
+  unsigned SubRegisters[MaxSubRegs] = {};
+  unsigned SubRegsNumber = 0;
+  bool FPCapable = false;
 };
 
 #endif
@@ -1,5 +1,7 @@
 #include "AST.hpp"
 #include "Type.hpp"
+#include <algorithm>
+#include <cstdint>
 #include <memory>
 
 //=--------------------------------------------------------------------------=//
@@ -149,15 +151,214 @@ Value *IfStatement::IRCodegen(IRFactory *IRF) {
   return nullptr;
 }
 
+/// A case value of a switch statement and the block it jumps to
+using SwitchCase = std::pair<int64_t, BasicBlock *>;
+using SwitchCaseIt = std::vector<SwitchCase>::const_iterator;
+
+/// State of the dispatch code generation of a switch statement
+struct SwitchLowering {
+  IRFactory *IRF;
+  BasicBlock *Default;
+  /// The condition as available in the current dispatch block
+  Value *Cond;
+  /// Stack slot of the condition, created when the dispatch needs more blocks
+  Value *CondSlot = nullptr;
+  /// The blocks of the compare chains and the index of their first compare
+  std::vector<std::pair<BasicBlock *, size_t>> Chains;
+};
+
+/// Emit a compare of the condition against each case and a jump to the
+/// default case at the end.
+static void LowerSwitchCaseChain(SwitchLowering &SL, SwitchCaseIt Begin,
+                                 SwitchCaseIt End) {
+  auto IRF = SL.IRF;
+  const auto BW = SL.Cond->GetBitWidth();
+
+  auto BB = IRF->GetCurrentFunction()->GetCurrentBB();
+  SL.Chains.push_back({BB, BB->GetInstructions().size()});
+  for (auto It = Begin; It != End; It++) {
+    auto CMP = IRF->CreateCMP(CompareInstruction::EQ, SL.Cond,
+                              IRF->GetConstant((uint64_t)It->first, BW));
+    IRF->CreateBR(CMP, It->second);
+  }
+  IRF->CreateJUMP(SL.Default);
+}
+
+/// Branch to the default case if the condition is outside of [First, Last].
+/// The checks already implied by the known bounds [Lo, Hi] are omitted.
+static void LowerSwitchRangeCheck(SwitchLowering &SL, int64_t First,
+                                  int64_t Last, int64_t Lo, int64_t Hi) {
+  auto IRF = SL.IRF;
+  const auto BW = SL.Cond->GetBitWidth();
+
+  if (First > Lo) {
+    auto CMP = IRF->CreateCMP(CompareInstruction::LT, SL.Cond,
+                              IRF->GetConstant((uint64_t)First, BW));
+    IRF->CreateBR(CMP, SL.Default);
+  }
+  if (Last < Hi) {
+    auto CMP = IRF->CreateCMP(CompareInstruction::GT, SL.Cond,
+                              IRF->GetConstant((uint64_t)Last, BW));
+    IRF->CreateBR(CMP, SL.Default);
+  }
+}
+
+/// Return the value of the condition relative to @First.
+static Value *GetSwitchIndex(SwitchLowering &SL, int64_t First) {
+  if (First == 0)
+    return SL.Cond;
+
+  const auto BW = SL.Cond->GetBitWidth();
+  return SL.IRF->CreateSUB(SL.Cond, SL.IRF->GetConstant((uint64_t)First, BW));
+}
+
+/// Test the condition against bit masks, one for each distinct target:
+///   lsr $bits, <mask>, $index
+///   and $bit, $bits, 1
+///   cmp.ne $hit, $bit, 0
+///   br $hit, <target>
+static void LowerSwitchBitTests(SwitchLowering &SL,
+                                std::vector<BasicBlock *> &Targets,
+                                SwitchCaseIt Begin, SwitchCaseIt End,
+                                int64_t Lo, int64_t Hi) {
+  auto IRF = SL.IRF;
+  const auto BW = SL.Cond->GetBitWidth();
+  const auto First = Begin->first;
+
+  LowerSwitchRangeCheck(SL, First, (End - 1)->first, Lo, Hi);
+  auto Index = GetSwitchIndex(SL, First);
+
+  for (auto Target : Targets) {
+    uint64_t Mask = 0;
+    for (auto It = Begin; It != End; It++)
+      if (It->second == Target)
+        Mask |= 1ull << (It->first - First);
+
+    auto Bits = IRF->CreateLSR(IRF->GetConstant(Mask, BW), Index);
+    auto Bit = IRF->CreateAND(Bits, IRF->GetConstant((uint64_t)1, BW));
+    auto Hit = IRF->CreateCMP(CompareInstruction::NE, Bit,
+                              IRF->GetConstant((uint64_t)0, BW));
+    IRF->CreateBR(Hit, Target);
+  }
+  IRF->CreateJUMP(SL.Default);
+}
+
+/// Jump through a table holding a target for each value of the case range,
+/// the holes are jumping to the default case.
+static void LowerSwitchJumpTable(SwitchLowering &SL, SwitchCaseIt Begin,
+                                 SwitchCaseIt End, int64_t Lo, int64_t Hi) {
+  const auto First = Begin->first;
+  const auto Last = (End - 1)->first;
+
+  LowerSwitchRangeCheck(SL, First, Last, Lo, Hi);
+
+  std::vector<BasicBlock *> Targets(Last - First + 1, SL.Default);
+  for (auto It = Begin; It != End; It++)
+    Targets[It->first - First] = It->second;
+
+  SL.IRF->CreateJT(GetSwitchIndex(SL, First), std::move(Targets));
+}
+
+/// Reorder the compares of the chains in @SL by the execution count of the
+/// cases in the profile, so the frequent cases need less compares. The cases
+/// are distinct, therefore the order of their compares does not matter.
+static void OrderSwitchCaseChains(SwitchLowering &SL) {
+  auto Prof = SL.IRF->GetProfile();
+  if (!Prof)
+    return;
+
+  const auto &FuncName = SL.IRF->GetCurrentFunction()->GetName();
+  for (auto [BB, Begin] : SL.Chains) {
+    auto &Instrs = BB->GetInstructions();
+
+    std::vector<std::pair<uint64_t, size_t>> Cases;
+    size_t End = Begin;
+    for (; End + 1 < Instrs.size(); End += 2) {
+      auto Br = dynamic_cast<BranchInstruction *>(Instrs[End + 1].get());
+      if (!Br || Instrs[End]->GetInstructionKind() != Instruction::CMP)
+        break;
+
+      auto Count = Prof->GetCount(FuncName, Br->GetTrueTarget()->GetName());
+      Cases.push_back({Count.value_or(0), End});
+    }
+
+    std::stable_sort(Cases.begin(), Cases.end(),
+                     [](const std::pair<uint64_t, size_t> &L,
+                        const std::pair<uint64_t, size_t> &R) {
+                       return L.first > R.first;
+                     });
+
+    BasicBlock::InstructionList Ordered;
+    for (auto [Count, Index] : Cases) {
+      Ordered.push_back(std::move(Instrs[Index]));
+      Ordered.push_back(std::move(Instrs[Index + 1]));
+    }
+    std::move(Ordered.begin(), Ordered.end(), Instrs.begin() + Begin);
+  }
+}
+
+/// Lower the dispatch of the cases [Begin, End), where the condition is known
+/// to be in [Lo, Hi]. Sparse case sets are split into a balanced binary search
+/// tree, whose leaves are bit tests, jump tables or short compare chains.
+static void LowerSwitchCases(SwitchLowering &SL, SwitchCaseIt Begin,
+                             SwitchCaseIt End, int64_t Lo, int64_t Hi) {
+  auto IRF = SL.IRF;
+  const size_t CaseNum = End - Begin;
+  const auto Range = (uint64_t)((End - 1)->first - Begin->first) + 1;
+
+  // Bit tests pay off if they replace enough compares
+  std::vector<BasicBlock *> Targets;
+  for (auto It = Begin; It != End && Targets.size() <= 3; It++)
+    if (std::find(Targets.begin(), Targets.end(), It->second) == Targets.end())
+      Targets.push_back(It->second);
+
+  if (Range <= SL.Cond->GetBitWidth() && Targets.size() <= 3 &&
+      CaseNum >= 2 + 2 * Targets.size()) {
+    LowerSwitchBitTests(SL, Targets, Begin, End, Lo, Hi);
+    return;
+  }
+
+  // Jump tables for at least 40% dense case ranges, the indirect jump costs
+  // about as much as a few compares
+  if (CaseNum >= 6 && Range <= 4096 && Range * 4 <= CaseNum * 10) {
+    LowerSwitchJumpTable(SL, Begin, End, Lo, Hi);
+    return;
+  }
+
+  if (CaseNum <= 4) {
+    LowerSwitchCaseChain(SL, Begin, End);
+    return;
+  }
+
+  // From now on the condition is needed in more blocks. Since values are not
+  // living across basic blocks, it is reloaded from a stack slot in each.
+  if (!SL.CondSlot) {
+    SL.CondSlot = IRF->CreateSA("switch_cond", SL.Cond->GetType());
+    IRF->CreateSTR(SL.Cond, SL.CondSlot);
+  }
+
+  const auto Mid = Begin + CaseNum / 2;
+  const auto Pivot = Mid->first;
+  auto LeftBB =
+      std::make_unique<BasicBlock>("switch_node", IRF->GetCurrentFunction());
+  auto CMP = IRF->CreateCMP(CompareInstruction::LT, SL.Cond,
+                            IRF->GetConstant((uint64_t)Pivot,
+                                             SL.Cond->GetBitWidth()));
+  IRF->CreateBR(CMP, LeftBB.get());
+
+  LowerSwitchCases(SL, Mid, End, Pivot, Hi);
+
+  IRF->InsertBB(std::move(LeftBB));
+  SL.Cond = IRF->CreateLD(SL.CondSlot->GetType(), SL.CondSlot);
+  LowerSwitchCases(SL, Begin, Mid, Lo, Pivot - 1);
+}
+
 Value *SwitchStatement::IRCodegen(IRFactory *IRF) {
   //   # generate code for Condition
+  //   # dispatch to the case bodies, see LowerSwitchCases, like:
   //   cmp.eq $cmp_res1, %Condition, case1_const
   //   br $cmp_res1, <case1_body>
-  //   cmp.eq $cmp_res2, %Condition, case2_const
-  //   br $cmp_res2, <case2_body>
   //   ...
-  //   cmp.eq $cmp_resN, %Condition, caseN_const
-  //   br $cmp_resN, <caseN_body>
   //   j <default_case>
   //
   // <case1_body>
@@ -186,22 +387,61 @@ Value *SwitchStatement::IRCodegen(IRFactory *IRF) {
 
   IRF->GetBreaksEndBBsTable().push_back(SwitchEnd.get());
 
+  // The condition is promoted to int like in C, the known bounds of its value
+  // help to omit range checks
+  const auto CondBW = Cond->GetBitWidth();
+  int64_t Lo = INT32_MIN;
+  int64_t Hi = INT32_MAX;
+  if (CondBW < 32) {
+    const bool Signed = Cond->GetTypeRef().IsSInt();
+    Lo = Signed ? -(1ll << (CondBW - 1)) : 0;
+    Hi = Signed ? (1ll << (CondBW - 1)) - 1 : (1ll << CondBW) - 1;
+    Cond = Signed ? IRF->CreateSEXT(Cond, 32) : IRF->CreateZEXT(Cond, 32);
+  } else if (CondBW > 32) {
+    Lo = INT64_MIN;
+    Hi = INT64_MAX;
+  }
+
   // because of the fallthrough mechanism multiple cases could use the same
-  // code block, CaseIdx keep track the current target basic block so falling
-  // through cases could refer to it
+  // code block, empty cases are jumping to the next non empty one
+  std::vector<SwitchCase> SortedCases;
   size_t CaseIdx = 0;
   for (auto &[CaseExpr, Statements] : Cases) {
     auto CaseConst = dynamic_cast<IntegerLiteralExpression *>(CaseExpr.get())
                          ->GetSIntValue();
-    auto CMP_res = IRF->CreateCMP(CompareInstruction::EQ, Cond,
-                                  IRF->GetConstant((uint64_t)CaseConst));
-    IRF->CreateBR(CMP_res, CaseBodies[CaseIdx].get());
+    if (CondBW <= 32)
+      CaseConst = (int32_t)CaseConst;
+
+    BasicBlock *Target = DefaultCase.get();
+    if (CaseIdx < CaseBodies.size())
+      Target = CaseBodies[CaseIdx].get();
+
+    if (CaseConst >= Lo && CaseConst <= Hi)
+      SortedCases.push_back({CaseConst, Target});
 
     if (!Statements.empty())
       CaseIdx++;
   }
 
-  IRF->CreateJUMP(DefaultCase.get());
+  std::stable_sort(SortedCases.begin(), SortedCases.end(),
+                   [](const SwitchCase &L, const SwitchCase &R) {
+                     return L.first < R.first;
+                   });
+
+  SwitchLowering SL{IRF, DefaultCase.get(), Cond};
+  if (Cond->IsConstant()) {
+    int64_t CondConst = dynamic_cast<Constant *>(Cond)->GetIntValue();
+    if (CondBW <= 32)
+      CondConst = (int32_t)CondConst;
+    auto Target = std::find_if(
+        SortedCases.begin(), SortedCases.end(),
+        [CondConst](const SwitchCase &C) { return C.first == CondConst; });
+    IRF->CreateJUMP(Target != SortedCases.end() ? Target->second
+                                                : DefaultCase.get());
+  } else if (SortedCases.empty() || CondBW > 32)
+    LowerSwitchCaseChain(SL, SortedCases.begin(), SortedCases.end());
+  else
+    LowerSwitchCases(SL, SortedCases.begin(), SortedCases.end(), Lo, Hi);
 
   // Generating the bodies for the cases
   for (auto &[Const, Statements] : Cases) {
@@ -222,6 +462,9 @@ Value *SwitchStatement::IRCodegen(IRFactory *IRF) {
   IRF->GetBreaksEndBBsTable().pop_back();
   IRF->InsertBB(std::move(SwitchEnd));
 
+  // The cases have their final names by now, so their counts can be found
+  OrderSwitchCaseChains(SL);
+
   return nullptr;
 }
 
@@ -334,11 +577,15 @@ Value *DoWhileStatement::IRCodegen(IRFactory *IRF) {
   }
 
   if (!IsEndlessLoop) {
-    // check that the condition is not 0 == true
-    auto Cmp = IRF->CreateCMP(CompareInstruction::NE, Cond,
-                              IRF->GetConstant((uint64_t)0));
-
-    IRF->CreateBR(Cmp, LoopBodyPtr);
+    // if Condition was a compare instruction then branch on it directly,
+    // otherwise check that the condition is not 0 == true
+    if (dynamic_cast<CompareInstruction *>(Cond) != nullptr)
+      IRF->CreateBR(Cond, LoopBodyPtr);
+    else {
+      auto Cmp = IRF->CreateCMP(CompareInstruction::NE, Cond,
+                                IRF->GetConstant((uint64_t)0));
+      IRF->CreateBR(Cmp, LoopBodyPtr);
+    }
   } else
     IRF->CreateJUMP(LoopBodyPtr);
 
@@ -454,7 +701,10 @@ Value *ReturnStatement::IRCodegen(IRFactory *IRF) {
   if (RetVal && IRF->GetCurrentFunction()->IsRetTypeStruct())
     RetVal = IRF->CreateLD(IRF->GetCurrentFunction()->GetReturnType(), RetVal);
 
-  if (IRF->GetCurrentFunction()->HasMultipleReturn()) {
+  // The result of a call is returned directly instead of through the return
+  // value, so the call stays in tail position
+  const bool IsCallResult = dynamic_cast<CallInstruction *>(RetVal) != nullptr;
+  if (IRF->GetCurrentFunction()->HasMultipleReturn() && !IsCallResult) {
     if (HasRetVal)
       IRF->CreateSTR(RetVal, IRF->GetCurrentFunction()->GetReturnValue());
     return IRF->CreateJUMP(nullptr);
@@ -840,6 +1090,45 @@ Value *StructDeclaration::IRCodegen(IRFactory *IRF) { return nullptr; }
 
 Value *EnumDeclaration::IRCodegen(IRFactory *IRF) { return nullptr; }
 
+Value *CallExpression::BuiltinIRCodegen(IRFactory *IRF,
+                                        std::vector<Value *> &Args) {
+  const auto Kind = BuiltinFunc->Kind;
+
+  // The expected value must be a constant, otherwise the hint is ignored
+  if (Kind == Instruction::BRANCH) {
+    if (auto C = dynamic_cast<Constant *>(Args[1]);
+        C && !C->IsFPType() && !Args[0]->IsConstant())
+      IRF->SetExpectedValue(Args[0], C->GetIntValue());
+    return Args[0];
+  }
+
+  if (Kind == Instruction::ROTR) {
+    auto Amount = Args[1];
+    if (BuiltinFunc->RotateLeft) {
+      auto Zero = IRF->GetConstant((uint64_t)0, Amount->GetBitWidth());
+      Amount = IRF->CreateSUB(Zero, Amount);
+    }
+    return IRF->CreateROTR(Args[0], Amount);
+  }
+
+  if (Kind == Instruction::CRC32)
+    return IRF->CreateCRC32(Args[0], Args[1]);
+
+  auto Result = IRF->CreateBitOperation(Kind, Args[0]);
+
+  // The counts are returned as int
+  const auto RetType = GetIRTypeFromVK(BuiltinFunc->ReturnType,
+                                       IRF->GetTargetMachine());
+  if (Result->GetBitWidth() <= RetType.GetBitSize())
+    return Result;
+
+  if (auto C = dynamic_cast<Constant *>(Result))
+    return IRF->GetConstant(C->GetIntValue(), RetType.GetBitSize());
+  return IRF->CreateTRUNC(Result, RetType.GetBitSize());
+
+  return Result;
+}
+
 Value *CallExpression::IRCodegen(IRFactory *IRF) {
   std::vector<Value *> Args;
 
@@ -868,6 +1157,9 @@ Value *CallExpression::IRCodegen(IRFactory *IRF) {
     Args.push_back(ArgIR);
   }
 
+  if (BuiltinFunc)
+    return BuiltinIRCodegen(IRF, Args);
+
   auto RetType = GetResultType().GetReturnType();
   auto FuncName = Name.GetString();
 
@@ -1712,7 +2004,19 @@ Value *TernaryExpression::IRCodegen(IRFactory *IRF) {
 
   // FALSE
   IRF->InsertBB(std::move(FalseBB));
-  IRF->CreateSTR(ExprIfFalse->IRCodegen(IRF), Result);
+  auto FalseExpr = ExprIfFalse->IRCodegen(IRF);
+
+  // The non negative integer literals are stored as wide as the result,
+  // otherwise only a part of it would be written
+  if (auto FalseConst = dynamic_cast<Constant *>(FalseExpr);
+      FalseConst && TrueExpr->IsIntType() && FalseConst->IsIntType() &&
+      !TrueExpr->GetTypeRef().IsPTR() &&
+      FalseConst->GetBitWidth() < TrueExpr->GetBitWidth() &&
+      FalseConst->GetIntValue() >> (FalseConst->GetBitWidth() - 1) == 0)
+    FalseExpr = IRF->GetConstant(FalseConst->GetIntValue(),
+                                 TrueExpr->GetBitWidth());
+
+  IRF->CreateSTR(FalseExpr, Result);
   IRF->CreateJUMP(FinalBB.get());
 
   IRF->InsertBB(std::move(FinalBB));
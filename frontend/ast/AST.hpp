@@ -5,6 +5,7 @@
 #include "../../middle_end/IR/Value.hpp"
 #include "../lexer/Token.hpp"
 #include "ASTVisitor.hpp"
+#include "Builtins.hpp"
 #include "Type.hpp"
 #include <cassert>
 #include <iostream>
@@ -835,8 +836,11 @@ public:
 
   ExprVec const &GetArguments() const { return Arguments; }
 
-  CallExpression(const Token &Name, ExprVec &Args, Type T)
-      : Name(Name), Arguments(std::move(Args)), FuncType(std::move(T)) {
+  /// A call of the builtin @B is lowered to its instruction.
+  CallExpression(const Token &Name, ExprVec &Args, Type T,
+                 const Builtin *B = nullptr)
+      : Name(Name), Arguments(std::move(Args)), FuncType(std::move(T)),
+        BuiltinFunc(B) {
     Type ResultType = FuncType;
     ResultType.GetParameterList().clear();
     GetResultType() = ResultType;
@@ -849,9 +853,12 @@ public:
   Value *IRCodegen(IRFactory *IRF) override;
 
 private:
+  Value *BuiltinIRCodegen(IRFactory *IRF, std::vector<Value *> &Args);
+
   Token Name;
   Type FuncType;
   ExprVec Arguments;
+  const Builtin *BuiltinFunc = nullptr;
 };
 
 class ReferenceExpression : public Expression {
@@ -0,0 +1,68 @@
+#include "Builtins.hpp"
+
+static const std::vector<Builtin> Builtins = {
+    {"__builtin_clz", Instruction::CLZ, Type::Int, {Type::UnsignedInt}},
+    {"__builtin_clzl", Instruction::CLZ, Type::Int, {Type::UnsignedLong}},
+    {"__builtin_clzll", Instruction::CLZ, Type::Int, {Type::UnsignedLongLong}},
+    {"__builtin_ctz", Instruction::CTZ, Type::Int, {Type::UnsignedInt}},
+    {"__builtin_ctzl", Instruction::CTZ, Type::Int, {Type::UnsignedLong}},
+    {"__builtin_ctzll", Instruction::CTZ, Type::Int, {Type::UnsignedLongLong}},
+    {"__builtin_popcount", Instruction::POPCOUNT, Type::Int,
+     {Type::UnsignedInt}},
+    {"__builtin_popcountl", Instruction::POPCOUNT, Type::Int,
+     {Type::UnsignedLong}},
+    {"__builtin_popcountll", Instruction::POPCOUNT, Type::Int,
+     {Type::UnsignedLongLong}},
+    {"__builtin_bswap16", Instruction::BSWAP, Type::UnsignedShort,
+     {Type::UnsignedShort}},
+    {"__builtin_bswap32", Instruction::BSWAP, Type::UnsignedInt,
+     {Type::UnsignedInt}},
+    {"__builtin_bswap64", Instruction::BSWAP, Type::UnsignedLongLong,
+     {Type::UnsignedLongLong}},
+    {"__builtin_rotateleft32", Instruction::ROTR, Type::UnsignedInt,
+     {Type::UnsignedInt, Type::UnsignedInt}, true},
+    {"__builtin_rotateleft64", Instruction::ROTR, Type::UnsignedLongLong,
+     {Type::UnsignedLongLong, Type::UnsignedLongLong}, true},
+    {"__builtin_rotateright32", Instruction::ROTR, Type::UnsignedInt,
+     {Type::UnsignedInt, Type::UnsignedInt}},
+    {"__builtin_rotateright64", Instruction::ROTR, Type::UnsignedLongLong,
+     {Type::UnsignedLongLong, Type::UnsignedLongLong}},
+    {"__builtin_arm_crc32b", Instruction::CRC32, Type::UnsignedInt,
+     {Type::UnsignedInt, Type::UnsignedChar}},
+    {"__builtin_arm_crc32h", Instruction::CRC32, Type::UnsignedInt,
+     {Type::UnsignedInt, Type::UnsignedShort}},
+    {"__builtin_arm_crc32w", Instruction::CRC32, Type::UnsignedInt,
+     {Type::UnsignedInt, Type::UnsignedInt}},
+    {"__builtin_arm_crc32d", Instruction::CRC32, Type::UnsignedInt,
+     {Type::UnsignedInt, Type::UnsignedLongLong}},
+    // Returns its first argument and hints the branches depending on it
+    {"__builtin_expect", Instruction::BRANCH, Type::Long,
+     {Type::Long, Type::Long}},
+};
+
+Type Builtin::GetType() const {
+  std::vector<Type> Params;
+  for (auto ArgType : ArgTypes)
+    Params.push_back(Type(ArgType));
+
+  return Type(Type(ReturnType), std::move(Params));
+}
+
+bool Builtin::HasLongLongType() const {
+  if (ReturnType == Type::UnsignedLongLong)
+    return true;
+
+  for (auto ArgType : ArgTypes)
+    if (ArgType == Type::UnsignedLongLong)
+      return true;
+
+  return false;
+}
+
+const Builtin *GetBuiltin(const std::string &Name) {
+  for (auto &B : Builtins)
+    if (Name == B.Name)
+      return &B;
+
+  return nullptr;
+}
@@ -0,0 +1,30 @@
+#ifndef BUILTINS_HPP
+#define BUILTINS_HPP
+
+#include "../../middle_end/IR/Instructions.hpp"
+#include "Type.hpp"
+#include <string>
+#include <vector>
+
+/// A builtin function, which is not called but lowered to a bit manipulation
+/// instruction of the IR, or to a branch hint.
+struct Builtin {
+  const char *Name;
+  Instruction::IKind Kind;
+  Type::VariantKind ReturnType;
+  std::vector<Type::VariantKind> ArgTypes;
+  /// Rotations to the left are done by rotating to the right by the negated
+  /// amount.
+  bool RotateLeft = false;
+
+  /// The function type of the builtin.
+  Type GetType() const;
+
+  /// Return true if the result or an argument is a long long.
+  bool HasLongLongType() const;
+};
+
+/// Return the builtin called @Name or nullptr if there is no such one.
+const Builtin *GetBuiltin(const std::string &Name);
+
+#endif
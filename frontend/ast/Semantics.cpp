@@ -1,5 +1,6 @@
 #include "Semantics.hpp"
 #include "AST.hpp"
+#include "Builtins.hpp"
 #include <tuple>
 
 //=--------------------------------------------------------------------------=//
@@ -321,8 +322,22 @@ void Semantics::VisitUnaryExpression(const UnaryExpression *node) {
 
 void Semantics::VisitCallExpression(const CallExpression *node) {
   auto CalledFunc = SymbolTables.Contains(node->GetName());
+  auto CalledBuiltin = GetBuiltin(node->GetName());
 
-  if (!CalledFunc) {
+  if (!CalledFunc && CalledBuiltin) {
+    if (CalledBuiltin->ArgTypes.size() != node->GetArguments().size()) {
+      std::string Msg = "wrong number of arguments to builtin function '" +
+                        node->GetName() + "'";
+      ErrorLog.AddError(Msg, node->GetNameToken());
+    }
+    // The builtins are lowered in one register, which is too narrow for the
+    // long long operands on the 32 bit targets
+    if (CalledBuiltin->HasLongLongType() && TM->GetPointerSize() < 64) {
+      std::string Msg = "builtin function '" + node->GetName() +
+                        "' is not supported on this target";
+      ErrorLog.AddError(Msg, node->GetNameToken());
+    }
+  } else if (!CalledFunc) {
     std::string Msg =
         "implicit declaration of function '" + node->GetName() + "'";
     ErrorLog.AddWarning(Msg, node->GetNameToken());
@@ -6,9 +6,11 @@
 #include "ASTVisitor.hpp"
 #include <map>
 
+class TargetMachine;
+
 class Semantics : public ASTVisitor {
 public:
-  explicit Semantics(ErrorLogger &EL) : ErrorLog(EL) {}
+  Semantics(ErrorLogger &EL, TargetMachine *TM) : ErrorLog(EL), TM(TM) {}
 
   // Insert into the symbol table. At the same time checking for redefinitions
   // and if it happens, then register the error.
@@ -56,6 +58,8 @@ public:
 private:
   SymbolTableStack SymbolTables;
   ErrorLogger &ErrorLog;
+  /// Decides which builtins can be lowered.
+  TargetMachine *TM;
   std::vector<const FunctionDeclaration *> FuncDeclList;
   std::map<std::string, std::tuple<Type, std::vector<Token>>> UserDefinedTypes;
 };
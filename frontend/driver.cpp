@@ -1,16 +1,23 @@
 #include "../backend/AssemblyEmitter.hpp"
+#include "../backend/BranchFolding.hpp"
+#include "../backend/InstructionScheduler.hpp"
 #include "../backend/LLIROptimizer.hpp"
 #include "../backend/IRtoLLIR.hpp"
 #include "../backend/InsturctionSelection.hpp"
 #include "../backend/MachineInstructionLegalizer.hpp"
+#include "../backend/PeepholeOptimizer.hpp"
 #include "../backend/PrologueEpilogInsertion.hpp"
 #include "../backend/RegisterAllocator.hpp"
 #include "../backend/RegisterClassSelection.hpp"
+#include "../backend/StackSlotColoring.hpp"
+#include "../backend/StoreMerging.hpp"
+#include "../backend/StrengthReduction.hpp"
 #include "../backend/TargetArchs/AArch64/AArch64TargetMachine.hpp"
 #include "../backend/TargetArchs/AArch64/AArch64XRegToWRegFixPass.hpp"
 #include "../backend/TargetArchs/RISCV/RISCVTargetMachine.hpp"
 #include "../middle_end/IR/IRFactory.hpp"
 #include "../middle_end/Transforms/PassManager.hpp"
+#include "../middle_end/Transforms/ProfileInstrumentationPass.hpp"
 #include "ErrorLogger.hpp"
 #include "ast/ASTPrint.hpp"
 #include "ast/Semantics.hpp"
@@ -57,8 +64,17 @@ int main(int argc, char *argv[]) {
   bool PrintBeforePasses = false;
   bool Wall = false;
   std::set<Optimization> RequestedOptimizations;
+  unsigned UnrollFactor = 4;
   bool RunLLIROpt = false;
+  bool ReduceStrength = false;
+  bool MergeStores = false;
+  bool ColorStackSlots = false;
+  bool Peephole = false;
+  bool FoldBranches = false;
+  bool Schedule = false;
   std::string TargetArch = "aarch64";
+  bool ProfileGenerate = false;
+  std::string ProfileUsePath;
 
   for (int i = 0; i < argc; i++)
     if (argv[i][0] != '-')
@@ -67,6 +83,24 @@ int main(int argc, char *argv[]) {
       if (!std::string(&argv[i][1]).compare("llir-opt")) {
         RunLLIROpt = true;
         continue;
+      } else if (!std::string(&argv[i][1]).compare("strength-reduction")) {
+        ReduceStrength = true;
+        continue;
+      } else if (!std::string(&argv[i][1]).compare("store-merging")) {
+        MergeStores = true;
+        continue;
+      } else if (!std::string(&argv[i][1]).compare("stack-slot-coloring")) {
+        ColorStackSlots = true;
+        continue;
+      } else if (!std::string(&argv[i][1]).compare("peephole")) {
+        Peephole = true;
+        continue;
+      } else if (!std::string(&argv[i][1]).compare("branch-folding")) {
+        FoldBranches = true;
+        continue;
+      } else if (!std::string(&argv[i][1]).compare("schedule")) {
+        Schedule = true;
+        continue;
       } else if (!std::string(&argv[i][1]).compare("copy-propagation")) {
         RequestedOptimizations.insert(Optimization::CopyPropagation);
         continue;
@@ -74,9 +108,58 @@ int main(int argc, char *argv[]) {
         RequestedOptimizations.insert(Optimization::CopyPropagation);
         RequestedOptimizations.insert(Optimization::CSE);
         continue;
+      } else if (!std::string(&argv[i][1]).compare("loop-strength-reduction")) {
+        RequestedOptimizations.insert(Optimization::LoopStrengthReduction);
+        continue;
+      } else if (!std::string(&argv[i][1]).compare("loop-unroll")) {
+        RequestedOptimizations.insert(Optimization::LoopUnroll);
+        continue;
+      } else if (!std::string(&argv[i][1]).compare("loop-vectorize")) {
+        RequestedOptimizations.insert(Optimization::LoopVectorize);
+        continue;
+      } else if (!std::string(&argv[i][1]).compare("loop-idiom")) {
+        RequestedOptimizations.insert(Optimization::LoopIdiom);
+        continue;
+      } else if (!std::string(&argv[i][1]).compare("bit-idiom")) {
+        RequestedOptimizations.insert(Optimization::BitIdiom);
+        continue;
+      } else if (!std::string(&argv[i][1]).compare("if-convert")) {
+        RequestedOptimizations.insert(Optimization::IfConversion);
+        continue;
+      } else if (!std::string(&argv[i][1]).compare("block-placement")) {
+        RequestedOptimizations.insert(Optimization::BlockPlacement);
+        continue;
+      } else if (!std::string(&argv[i][1]).compare("simplify-cfg")) {
+        RequestedOptimizations.insert(Optimization::SimplifyCFG);
+        continue;
+      } else if (!std::string(&argv[i][1]).compare(0, 15, "funroll-factor=")) {
+        UnrollFactor = std::stoi(std::string(&argv[i][16]));
+        RequestedOptimizations.insert(Optimization::LoopUnroll);
+        continue;
       } else if (!std::string(&argv[i][1]).compare("O")) {
         RequestedOptimizations.insert(Optimization::CopyPropagation);
         RequestedOptimizations.insert(Optimization::CSE);
+        RequestedOptimizations.insert(Optimization::LoopStrengthReduction);
+        RequestedOptimizations.insert(Optimization::LoopUnroll);
+        RequestedOptimizations.insert(Optimization::LoopVectorize);
+        RequestedOptimizations.insert(Optimization::LoopIdiom);
+        RequestedOptimizations.insert(Optimization::BitIdiom);
+        RequestedOptimizations.insert(Optimization::IfConversion);
+        RequestedOptimizations.insert(Optimization::BlockPlacement);
+        RequestedOptimizations.insert(Optimization::SimplifyCFG);
+        ReduceStrength = true;
+        MergeStores = true;
+        ColorStackSlots = true;
+        Peephole = true;
+        FoldBranches = true;
+        Schedule = true;
+        continue;
+      } else if (!std::string(&argv[i][1]).compare("fprofile-generate")) {
+        ProfileGenerate = true;
+        continue;
+      } else if (!std::string(&argv[i][1]).compare(0, 13, "fprofile-use=")) {
+        ProfileUsePath = std::string(&argv[i][14]);
+        RequestedOptimizations.insert(Optimization::BlockPlacement);
         continue;
       } else if (!std::string(&argv[i][1]).compare("E")) {
         DumpPreProcessedFile = true;
@@ -132,13 +215,28 @@ int main(int argc, char *argv[]) {
 
   std::unique_ptr<TargetMachine> TM;
 
-  if (TargetArch == "riscv32")
+  // The RISC-V target has no vector, bit manipulation and conditional move
+  // instructions and no C library
+  if (TargetArch == "riscv32") {
     TM = std::make_unique<RISCV::RISCVTargetMachine>();
-  else
+    RequestedOptimizations.erase(Optimization::LoopVectorize);
+    RequestedOptimizations.erase(Optimization::LoopIdiom);
+    RequestedOptimizations.erase(Optimization::BitIdiom);
+    RequestedOptimizations.erase(Optimization::IfConversion);
+  } else
     TM = std::make_unique<AArch64::AArch64TargetMachine>();
 
+  Profile ProfileData;
+  if (!ProfileUsePath.empty() && !ProfileData.Read(ProfileUsePath)) {
+    std::cerr << "Error: Cannot read the profile '" << ProfileUsePath << "'"
+              << std::endl;
+    return -1;
+  }
+
   Module IRModule;
   IRFactory IRF(IRModule, TM.get());
+  if (!ProfileUsePath.empty())
+    IRF.SetProfile(&ProfileData);
   ErrorLogger ErrorLog(FilePath, src);
   Parser parser(src, &IRF, ErrorLog);
   auto AST = parser.Parse();
@@ -154,7 +252,7 @@ int main(int argc, char *argv[]) {
   }
 
   // Do semantic analysis on the AST
-  auto Sema = std::make_unique<Semantics>(ErrorLog);
+  auto Sema = std::make_unique<Semantics>(ErrorLog, TM.get());
   AST->Accept(Sema.get());
 
   if (ErrorLog.HasErrors(Wall)) {
@@ -164,9 +262,20 @@ int main(int argc, char *argv[]) {
 
   AST->IRCodegen(&IRF);
 
+  // The profile is collected and attached right after the code generation,
+  // where the blocks are named the same way in both runs
+  if (ProfileGenerate) {
+    ProfileInstrumentationPass Instrument(&IRModule);
+    for (auto &F : IRModule.GetFunctions())
+      Instrument.RunOnFunction(F);
+  }
+
+  if (!ProfileUsePath.empty())
+    ProfileData.Annotate(IRModule);
+
   const bool Optimize = !RequestedOptimizations.empty();
   if (Optimize) {
-    PassManager PM(&IRModule, RequestedOptimizations);
+    PassManager PM(&IRModule, RequestedOptimizations, UnrollFactor);
     PM.RunAll();
   }
 
@@ -198,6 +307,13 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  if (ReduceStrength)
+    StrengthReduction(&LLIRModule, TM.get()).Run();
+  if (MergeStores)
+    StoreMerging(&LLIRModule, TM.get()).Run();
+  if (ColorStackSlots)
+    StackSlotColoring(&LLIRModule, TM.get()).Run();
+
   MachineInstructionLegalizer Legalizer(&LLIRModule, TM.get());
   Legalizer.Run();
 
@@ -228,7 +344,7 @@ int main(int argc, char *argv[]) {
     std::cout << std::endl;
   }
 
-  RegisterAllocator RA(&LLIRModule, TM.get());
+  RegisterAllocator RA(&LLIRModule, TM.get(), Schedule);
   RA.RunRA();
 
   if (PrintBeforePasses) {
@@ -243,6 +359,39 @@ int main(int argc, char *argv[]) {
   if (TargetArch == "aarch64")
     AArch64XRegToWRegFixPass(&LLIRModule, TM.get()).Run();
 
+  if (Peephole) {
+    if (PrintBeforePasses) {
+      std::cout << "<<<<< Before Peephole Optimizer >>>>>" << std::endl
+                << std::endl;
+      LLIRModule.Print(TM.get());
+      std::cout << std::endl;
+    }
+
+    PeepholeOptimizer(&LLIRModule, TM.get()).Run();
+  }
+
+  if (FoldBranches) {
+    if (PrintBeforePasses) {
+      std::cout << "<<<<< Before Branch Folding >>>>>" << std::endl
+                << std::endl;
+      LLIRModule.Print(TM.get());
+      std::cout << std::endl;
+    }
+
+    BranchFolding(&LLIRModule, TM.get()).Run();
+  }
+
+  if (Schedule) {
+    if (PrintBeforePasses) {
+      std::cout << "<<<<< Before Instruction Scheduling >>>>>" << std::endl
+                << std::endl;
+      LLIRModule.Print(TM.get());
+      std::cout << std::endl;
+    }
+
+    InstructionScheduler(&LLIRModule, TM.get()).Run();
+  }
+
   if (PrintBeforePasses) {
     std::cout << "<<<<< Before Emitting Assembly >>>>>" << std::endl
               << std::endl;
@@ -1,5 +1,6 @@
 #include "Parser.hpp"
 #include "../Support.hpp"
+#include "../ast/Builtins.hpp"
 #include <cassert>
 #include <iostream>
 #include <memory>
@@ -1692,9 +1693,12 @@ std::unique_ptr<Expression> Parser::ParseCallExpression(Token Id) {
   Lex(); // eat the '('
 
   Type FuncType = Type(Type::Int); // default return type is int
+  const Builtin *B = nullptr;
 
   if (auto SymEntry = SymTabStack.Contains(Id.GetString()))
     FuncType = std::get<1>(SymEntry.value());
+  else if ((B = GetBuiltin(Id.GetString())))
+    FuncType = B->GetType();
 
   std::vector<std::unique_ptr<Expression>> CallArgs;
 
@@ -1727,7 +1731,7 @@ std::unique_ptr<Expression> Parser::ParseCallExpression(Token Id) {
 
   Expect(Token::RightParen);
 
-  return std::make_unique<CallExpression>(Id, CallArgs, FuncType);
+  return std::make_unique<CallExpression>(Id, CallArgs, FuncType, B);
 }
 
 std::unique_ptr<Expression>
@@ -6,6 +6,19 @@ Instruction *BasicBlock::Insert(std::unique_ptr<Instruction> Instruction) {
   return Instructions.back().get();
 }
 
+Instruction *BasicBlock::InsertBefore(std::unique_ptr<Instruction> I,
+                                      Instruction *Position) {
+  for (size_t i = 0; i < Instructions.size(); i++)
+    if (Instructions[i].get() == Position) {
+      auto InstPtr = I.get();
+      Instructions.insert(Instructions.begin() + i, std::move(I));
+      return InstPtr;
+    }
+
+  assert(!"Position is not in the basic block");
+  return nullptr;
+}
+
 Instruction *BasicBlock::InsertSA(std::unique_ptr<Instruction> Instruction) {
   // Edge case: The BB is empty -> Just use Insert
   if (Instructions.empty())
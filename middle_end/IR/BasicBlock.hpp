@@ -5,6 +5,7 @@
 #include "Value.hpp"
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -33,17 +34,32 @@ public:
   /// instructions.
   Instruction *InsertSA(std::unique_ptr<Instruction> Instruction);
 
+  /// Insert @I before @Position, which must be in this block.
+  Instruction *InsertBefore(std::unique_ptr<Instruction> I,
+                            Instruction *Position);
+
   std::string &GetName() { return Name; }
   void SetName(const std::string &N) { Name = N; }
 
   InstructionList &GetInstructions() { return Instructions; }
 
+  /// The number of times the block was executed in the profiled run, if it
+  /// was profiled.
+  std::optional<uint64_t> GetCount() const { return Count; }
+  void SetCount(uint64_t C) { Count = C; }
+
+  /// The address of the block is aligned to 2^Alignment bytes.
+  unsigned GetAlignment() const { return Alignment; }
+  void SetAlignment(unsigned A) { Alignment = A; }
+
   void Print() const;
 
 private:
   std::string Name;
   InstructionList Instructions;
   Function *Parent;
+  std::optional<uint64_t> Count;
+  unsigned Alignment = 0;
 };
 
 #endif
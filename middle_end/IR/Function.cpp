@@ -33,6 +33,14 @@ size_t Function::GetNumberOfInstructions() const {
   return Num;
 }
 
+Constant *Function::GetConstant(uint64_t C, uint8_t BW) {
+  auto &Const = Constants[{C, BW}];
+  if (!Const)
+    Const = std::make_unique<Constant>(C, BW);
+
+  return Const.get();
+}
+
 void Function::CreateBasicBlock() {
   auto BB = std::make_unique<BasicBlock>(BasicBlock(this));
   BasicBlocks.push_back(std::move(BB));
@@ -2,11 +2,13 @@
 #define FUNCTION_HPP
 
 #include "IRType.hpp"
+#include "Value.hpp"
+#include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
-class Value;
 class BasicBlock;
 class FunctionParameter;
 
@@ -54,6 +56,10 @@ public:
 
   size_t GetNumberOfInstructions() const;
 
+  /// Return the integer constant @C with @BW bit width for the passes, which
+  /// cannot reach the constants created during the code generation.
+  Constant *GetConstant(uint64_t C, uint8_t BW = 32);
+
   void CreateBasicBlock();
 
   void Insert(std::unique_ptr<BasicBlock> BB);
@@ -71,6 +77,7 @@ private:
   bool DeclarationOnly = false;
   unsigned ReturnsNumber = ~0;
   Value *ReturnValue = nullptr;
+  std::map<std::pair<uint64_t, uint8_t>, std::unique_ptr<Constant>> Constants;
 };
 
 #endif
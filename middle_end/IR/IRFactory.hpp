@@ -6,6 +6,7 @@
 #include "Function.hpp"
 #include "Instructions.hpp"
 #include "Module.hpp"
+#include "Profile.hpp"
 #include "Value.hpp"
 #include <map>
 #include <memory>
@@ -33,6 +34,47 @@ static Value *EvaluateComparison(const T L, const T R,
   }
 }
 
+/// Compute the bit manipulation @Operation on the @Width bit value @X. The
+/// rotation amount or the data of the CRC is @Y, which is @YWidth bits wide.
+static uint64_t EvaluateBitOperation(const Instruction::IKind Operation,
+                                     uint64_t X, uint64_t Y, unsigned Width,
+                                     unsigned YWidth = 0) {
+  const uint64_t Mask = Width == 64 ? ~0ull : (1ull << Width) - 1;
+  X &= Mask;
+
+  unsigned Count = 0;
+  switch (Operation) {
+  case Instruction::ROTR:
+    Y %= Width;
+    return Y == 0 ? X : ((X >> Y) | (X << (Width - Y))) & Mask;
+  case Instruction::CLZ:
+    for (unsigned i = Width; i > 0 && !(X >> (i - 1) & 1); i--)
+      Count++;
+    return Count;
+  case Instruction::CTZ:
+    for (unsigned i = 0; i < Width && !(X >> i & 1); i++)
+      Count++;
+    return Count;
+  case Instruction::POPCOUNT:
+    for (; X != 0; X &= X - 1)
+      Count++;
+    return Count;
+  case Instruction::BSWAP: {
+    uint64_t Result = 0;
+    for (unsigned i = 0; i < Width; i += 8)
+      Result |= (X >> i & 0xff) << (Width - 8 - i);
+    return Result;
+  }
+  case Instruction::CRC32:
+    X ^= Y & (YWidth == 64 ? ~0ull : (1ull << YWidth) - 1);
+    for (unsigned i = 0; i < YWidth; i++)
+      X = (X >> 1) ^ (0xEDB88320 & -(X & 1));
+    return X;
+  default:
+    assert(!"Unreachable");
+  }
+}
+
 class IRFactory {
 private:
   Value *
@@ -143,6 +185,26 @@ private:
     return InstPtr;
   }
 
+  /// Like CreateBinaryInstruction, but the operands might have different
+  /// widths and the result has the width of @L.
+  Value *CreateBitBinaryInstruction(Instruction::IKind K, Value *L, Value *R) {
+    auto ConstLHS = dynamic_cast<Constant *>(L);
+    auto ConstRHS = dynamic_cast<Constant *>(R);
+    if (ConstLHS && ConstRHS)
+      return GetConstant(EvaluateBitOperation(K, ConstLHS->GetIntValue(),
+                                              ConstRHS->GetIntValue(),
+                                              L->GetBitWidth(),
+                                              R->GetBitWidth()),
+                         L->GetBitWidth());
+
+    auto Inst = std::make_unique<BinaryInstruction>(K, L, R, GetCurrentBB());
+    Inst->SetID(ID++);
+    auto InstPtr = Inst.get();
+    Insert(std::move(Inst));
+
+    return InstPtr;
+  }
+
   BasicBlock *GetCurrentBB() { return CurrentModule.CurrentBB(); }
 
   Instruction *Insert(std::unique_ptr<Instruction> I) {
@@ -217,6 +279,35 @@ public:
     return CreateBinaryInstruction(Instruction::DIVF, LHS, RHS);
   }
 
+  /// Create one of the unary bit manipulations, CLZ, CTZ, POPCOUNT or BSWAP.
+  Value *CreateBitOperation(Instruction::IKind K, Value *Operand) {
+    if (auto C = dynamic_cast<Constant *>(Operand))
+      return GetConstant(EvaluateBitOperation(K, C->GetIntValue(), 0,
+                                              C->GetBitWidth()),
+                         C->GetBitWidth());
+
+    auto Inst = std::make_unique<UnaryInstruction>(K, Operand, GetCurrentBB());
+    Inst->SetID(ID++);
+    auto InstPtr = Inst.get();
+    Insert(std::move(Inst));
+
+    return InstPtr;
+  }
+
+  Value *CreateROTR(Value *LHS, Value *RHS) {
+    // Keep constant amounts in the [0, width) range
+    if (auto C = dynamic_cast<Constant *>(RHS))
+      RHS = GetConstant(C->GetIntValue() % LHS->GetBitWidth(),
+                        RHS->GetBitWidth());
+    return CreateBitBinaryInstruction(Instruction::ROTR, LHS, RHS);
+  }
+
+  /// Accumulate the CRC-32 of @Data to the checksum @CRC, the width of @Data
+  /// is the number of bits processed.
+  Value *CreateCRC32(Value *CRC, Value *Data) {
+    return CreateBitBinaryInstruction(Instruction::CRC32, CRC, Data);
+  }
+
   UnaryInstruction *CreateSEXT(Value *Operand, uint8_t BitWidth = 32) {
     auto Inst = std::make_unique<UnaryInstruction>(Instruction::SEXT,
                                                    IRType::CreateInt(BitWidth),
@@ -401,16 +492,36 @@ public:
     return InstPtr;
   }
 
+  JumpTableInstruction *CreateJT(Value *Index,
+                                 std::vector<BasicBlock *> Targets) {
+    auto Inst = std::make_unique<JumpTableInstruction>(
+        JumpTableInstruction(Index, std::move(Targets), GetCurrentBB()));
+    auto InstPtr = Inst.get();
+    Insert(std::move(Inst));
+
+    return InstPtr;
+  }
+
   BranchInstruction *CreateBR(Value *Condition, BasicBlock *True,
                               BasicBlock *False = nullptr) {
     auto Inst = std::make_unique<BranchInstruction>(
         BranchInstruction(Condition, True, False, GetCurrentBB()));
     auto InstPtr = Inst.get();
+    InstPtr->SetLikelyTaken(IsLikelyTrue(Condition));
     Insert(std::move(Inst));
 
     return InstPtr;
   }
 
+  /// Record that @V is expected to be @Expected, as told by __builtin_expect.
+  void SetExpectedValue(Value *V, uint64_t Expected) {
+    unsigned Relation = CompareInstruction::INVALID;
+    if (auto CMP = dynamic_cast<CompareInstruction *>(V))
+      Relation = CMP->GetRelation();
+
+    ExpectedValues[V] = {Expected, Relation};
+  }
+
   GlobalVariable *CreateGlobalVar(std::string &Identifier, const IRType &Type) {
     auto GlobalVar = new GlobalVariable(Identifier, Type);
     GlobalVar->SetID(ID++);
@@ -537,9 +648,42 @@ public:
 
   TargetMachine *GetTargetMachine() { return TM; }
 
+  /// The profile of an earlier run, if the code is generated using one.
+  Profile *GetProfile() { return ProfileData; }
+  void SetProfile(Profile *P) { ProfileData = P; }
+
 private:
+  /// Return whether @Condition is expected to be non zero, if it is known
+  /// from the expected values. Either the expected value itself or its
+  /// comparison to a constant is recognized.
+  std::optional<bool> IsLikelyTrue(Value *Condition) {
+    auto CMP = dynamic_cast<CompareInstruction *>(Condition);
+
+    if (ExpectedValues.count(Condition) != 0) {
+      auto [Expected, Relation] = ExpectedValues[Condition];
+      // The conditions of the statements are inverted in place
+      if (CMP && CMP->GetRelation() != Relation)
+        return Expected == 0;
+      return Expected != 0;
+    }
+
+    if (!CMP || (CMP->GetRelation() != CompareInstruction::EQ &&
+                 CMP->GetRelation() != CompareInstruction::NE))
+      return std::nullopt;
+
+    auto Expected = CMP->GetLHS();
+    auto C = dynamic_cast<Constant *>(CMP->GetRHS());
+    if (!C || C->IsFPType() || ExpectedValues.count(Expected) == 0)
+      return std::nullopt;
+
+    const bool Equal = ExpectedValues[Expected].first == C->GetIntValue();
+    return CMP->GetRelation() == CompareInstruction::EQ ? Equal : !Equal;
+  }
+
   TargetMachine *TM{};
 
+  Profile *ProfileData = nullptr;
+
   Module &CurrentModule;
 
   /// A counter essentially, which used to give Values a unique ID.
@@ -571,6 +715,10 @@ private:
   /// For context information for "break" statements. Containing the pointer
   /// to the basic block which will be the target of the generated jump.
   std::vector<BasicBlock *> BreaksTargetBBsTable;
+
+  /// The values given to __builtin_expect with the expected value and with
+  /// the relation they had, if they are comparisons.
+  std::map<Value *, std::pair<uint64_t, unsigned>> ExpectedValues;
 };
 
 #endif
@@ -74,7 +74,7 @@ size_t IRType::GetByteSize(TargetMachine *TM) const {
   }
 
   if (PointerLevel == 0)
-    return (BitWidth * NumberOfElements + 7) / 8;
+    return (BitWidth * Lanes * NumberOfElements + 7) / 8;
 
   // in case if it is a pointer type, then ask the target for the pointer size
   // or if it was not given then the default size is 64
@@ -118,6 +118,9 @@ std::string IRType::AsString() const {
   if (Kind != STRUCT)
     Str += std::to_string(BitWidth);
 
+  if (IsVector())
+    Str = "<" + std::to_string(Lanes) + " x " + Str + ">";
+
   if (!Dimensions.empty()) {
     for (int i = Dimensions.size() - 1; i >= 0; i--)
       Str = "[" + std::to_string(Dimensions[i]) + " x " + Str + "]";
@@ -39,8 +39,15 @@ public:
 
   static IRType CreateInt(uint8_t BitWidth = 32) { return {SINT, BitWidth}; }
 
+  /// Create a vector of @Lanes elements of the scalar type @Elem.
+  static IRType CreateVector(const IRType &Elem, uint8_t Lanes) {
+    IRType Vector = Elem.GetBaseType();
+    Vector.Lanes = Lanes;
+    return Vector;
+  }
+
   bool operator==(const IRType &RHS) {
-    return BitWidth == RHS.BitWidth && Kind == RHS.Kind;
+    return BitWidth == RHS.BitWidth && Kind == RHS.Kind && Lanes == RHS.Lanes;
   }
 
   bool IsInvalid() const { return Kind == INVALID; }
@@ -53,6 +60,9 @@ public:
   bool IsStruct() const { return Kind == STRUCT; }
   bool IsArray() const { return !Dimensions.empty(); }
   bool IsVoid() const { return Kind == NONE && PointerLevel == 0; }
+  bool IsVector() const { return Lanes > 1; }
+
+  uint8_t GetLanes() const { return Lanes; }
 
   void SetDimensions(const std::vector<unsigned> &N) { Dimensions = N; }
   std::vector<unsigned> &GetDimensions() { return Dimensions; }
@@ -69,7 +79,7 @@ public:
   unsigned GetElemByteOffset(unsigned StructElemIndex,
                              TargetMachine *TM = nullptr) const;
 
-  size_t GetBitSize() const { return BitWidth; }
+  size_t GetBitSize() const { return BitWidth * Lanes; }
 
   size_t GetByteSize(TargetMachine *TM = nullptr) const;
 
@@ -77,6 +87,8 @@ public:
   /// and dimensionality.
   size_t GetBaseTypeByteSize(TargetMachine *TM = nullptr) const;
 
+  /// The type of the elements, ignoring the pointerness, dimensionality and
+  /// the lanes of vectors.
   IRType GetBaseType() const { return {Kind, BitWidth}; }
 
   void SetStructName(std::string &str) { StructName = str; }
@@ -89,6 +101,8 @@ public:
 private:
   uint8_t BitWidth;
   uint8_t PointerLevel = 0;
+  /// The number of elements of a vector, 1 for scalars
+  uint8_t Lanes = 1;
   std::string StructName;
   std::vector<IRType> MembersTypeList;
   std::vector<unsigned> Dimensions;
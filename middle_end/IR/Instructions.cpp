@@ -55,6 +55,8 @@ std::string Instruction::AsString(IKind IK) {
     return "br";
   case RET:
     return "ret";
+  case JUMP_TABLE:
+    return "jt";
   case LOAD:
     return "ld";
   case STORE:
@@ -69,6 +71,24 @@ std::string Instruction::AsString(IKind IK) {
     return "cmp";
   case CMPF:
     return "cmpf";
+  case SPLAT:
+    return "splat";
+  case REDUCE_ADD:
+    return "reduce.add";
+  case ROTR:
+    return "rotr";
+  case CLZ:
+    return "clz";
+  case CTZ:
+    return "ctz";
+  case POPCOUNT:
+    return "popcount";
+  case BSWAP:
+    return "bswap";
+  case CRC32:
+    return "crc32";
+  case SELECT:
+    return "sel";
   default:
     assert(!"Unknown instruction kind.");
     break;
@@ -145,6 +165,14 @@ void CompareInstruction::Print() const {
   std::cout << RHS->ValueString() << std::endl;
 }
 
+void SelectInstruction::Print() const {
+  std::cout << "\t" << AsString(InstKind) << "\t";
+  std::cout << ValueString() << ", ";
+  std::cout << Condition->ValueString() << ", ";
+  std::cout << TrueValue->ValueString() << ", ";
+  std::cout << FalseValue->ValueString() << std::endl;
+}
+
 void CallInstruction::Print() const {
   std::cout << "\t" << AsString(InstKind) << "\t";
   if (!ValueType.IsVoid())
@@ -187,6 +215,17 @@ void BranchInstruction::Print() const {
   std::cout << std::endl;
 }
 
+void JumpTableInstruction::Print() const {
+  std::cout << "\t" << AsString(InstKind) << "\t";
+  std::cout << Index->ValueString() << ", [";
+  for (size_t i = 0; i < Targets.size(); i++) {
+    if (i > 0)
+      std::cout << ", ";
+    std::cout << "<" << Targets[i]->GetName() << ">";
+  }
+  std::cout << "]" << std::endl;
+}
+
 void ReturnInstruction::Print() const {
   std::cout << "\t" << AsString(InstKind) << "\t";
   if (RetVal)
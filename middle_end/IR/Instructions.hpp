@@ -4,6 +4,8 @@
 #include "Value.hpp"
 #include <cassert>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <sstream>
 #include <utility>
 #include <vector>
@@ -48,13 +50,29 @@ public:
     JUMP,
     BRANCH,
     RET,
+    JUMP_TABLE,
 
     // Memory operations
-    LOAD = RET + 4,
+    LOAD = JUMP_TABLE + 4,
     STORE,
     MEM_COPY,
     STACK_ALLOC,
     GET_ELEM_PTR,
+
+    // Vector operations
+    SPLAT,      // Copy a scalar into every lane
+    REDUCE_ADD, // Sum of the lanes
+
+    // Bit manipulation
+    ROTR,     // Rotate right
+    CLZ,      // Count leading zeros
+    CTZ,      // Count trailing zeros
+    POPCOUNT, // Count set bits
+    BSWAP,    // Reverse the bytes
+    CRC32,    // CRC-32 of the RHS appended to the LHS checksum
+
+    // Conditional select
+    SELECT, // Choose the 2nd or 3rd operand by the 1st one
   };
 
   IKind GetInstructionKind() { return InstKind; }
@@ -63,7 +81,8 @@ public:
 
   Instruction(IKind K, BasicBlock *P, IRType V)
       : InstKind(K), Parent(P), Value(std::move(V)) {
-    BasicBlockTerminator = (InstKind == RET || InstKind == JUMP);
+    BasicBlockTerminator =
+        (InstKind == RET || InstKind == JUMP || InstKind == JUMP_TABLE);
   }
 
   bool IsStackAllocation() const { return InstKind == STACK_ALLOC; }
@@ -81,12 +100,22 @@ public:
 
   virtual Value *Get1stUse() { return nullptr; }
   virtual Value *Get2ndUse() { return nullptr; }
+  virtual Value *Get3rdUse() { return nullptr; }
 
   virtual void Set1stUse(Value *v) {}
   virtual void Set2ndUse(Value *v) {}
+  virtual void Set3rdUse(Value *v) {}
 
   virtual void Print() const { assert(!"Cannot print base class"); }
 
+  /// Create a copy of the instruction with the same ID and operands.
+  virtual std::unique_ptr<Instruction> Clone() const {
+    assert(!"Cannot clone base class");
+    return nullptr;
+  }
+
+  void SetParent(BasicBlock *BB) { Parent = BB; }
+
 protected:
   IKind InstKind;
   BasicBlock *Parent = nullptr;
@@ -109,6 +138,10 @@ public:
 
   void Print() const override;
 
+  std::unique_ptr<Instruction> Clone() const override {
+    return std::make_unique<BinaryInstruction>(*this);
+  }
+
 private:
   Value *LHS;
   Value *RHS;
@@ -130,6 +163,10 @@ public:
 
   void Print() const override;
 
+  std::unique_ptr<Instruction> Clone() const override {
+    return std::make_unique<UnaryInstruction>(*this);
+  }
+
 private:
   Value *Op;
 };
@@ -144,6 +181,13 @@ public:
                     P, IRType(IRType::SINT, 1)),
         LHS(L), RHS(R), Relation(REL) {}
 
+  /// Compare vectors lane by lane, the lanes of the result are 1 where the
+  /// relation holds and 0 elsewhere.
+  CompareInstruction(Value *L, Value *R, CompRel REL, IRType ResultType,
+                     BasicBlock *P)
+      : Instruction(Instruction::CMP, P, std::move(ResultType)), LHS(L),
+        RHS(R), Relation(REL) {}
+
   const char *GetRelString() const;
 
   Value *GetLHS() { return LHS; }
@@ -160,12 +204,48 @@ public:
 
   void Print() const override;
 
+  std::unique_ptr<Instruction> Clone() const override {
+    return std::make_unique<CompareInstruction>(*this);
+  }
+
 private:
   CompRel Relation = INVALID;
   Value *LHS;
   Value *RHS;
 };
 
+/// Choose the true value if the condition is not zero, otherwise the false
+/// value. Both of them are evaluated.
+class SelectInstruction : public Instruction {
+public:
+  SelectInstruction(Value *C, Value *T, Value *F, BasicBlock *P)
+      : Instruction(Instruction::SELECT, P, T->GetType()), Condition(C),
+        TrueValue(T), FalseValue(F) {}
+
+  Value *GetCondition() { return Condition; }
+  Value *GetTrueValue() { return TrueValue; }
+  Value *GetFalseValue() { return FalseValue; }
+
+  Value *Get1stUse() override { return Condition; }
+  Value *Get2ndUse() override { return TrueValue; }
+  Value *Get3rdUse() override { return FalseValue; }
+
+  void Set1stUse(Value *v) override { Condition = v; }
+  void Set2ndUse(Value *v) override { TrueValue = v; }
+  void Set3rdUse(Value *v) override { FalseValue = v; }
+
+  void Print() const override;
+
+  std::unique_ptr<Instruction> Clone() const override {
+    return std::make_unique<SelectInstruction>(*this);
+  }
+
+private:
+  Value *Condition;
+  Value *TrueValue;
+  Value *FalseValue;
+};
+
 class CallInstruction : public Instruction {
 public:
   CallInstruction(std::string N, std::vector<Value *> &A, IRType T,
@@ -184,6 +264,10 @@ public:
 
   void Print() const override;
 
+  std::unique_ptr<Instruction> Clone() const override {
+    return std::make_unique<CallInstruction>(*this);
+  }
+
 private:
   std::string Name;
   std::vector<Value *> Arguments;
@@ -204,6 +288,10 @@ public:
 
   void Print() const override;
 
+  std::unique_ptr<Instruction> Clone() const override {
+    return std::make_unique<JumpInstruction>(*this);
+  }
+
 private:
   BasicBlock *Target;
 };
@@ -216,22 +304,65 @@ public:
         TrueTarget(True), FalseTarget(False) {}
 
   Value *GetCondition() { return Condition; }
+  BasicBlock *GetTrueTarget() { return TrueTarget; }
+  BasicBlock *GetFalseTarget() { return FalseTarget; }
+  void SetTrueTarget(BasicBlock *BB) { TrueTarget = BB; }
+  void SetFalseTarget(BasicBlock *BB) { FalseTarget = BB; }
   std::string &GetTrueLabelName();
   std::string &GetFalseLabelName();
 
   bool HasFalseLabel() { return FalseTarget != nullptr; }
   bool IsDef() const override { return false; }
 
+  /// Whether the branch is expected to be taken, if it is known from a
+  /// __builtin_expect.
+  std::optional<bool> IsLikelyTaken() const { return LikelyTaken; }
+  void SetLikelyTaken(std::optional<bool> L) { LikelyTaken = L; }
+
   Value *Get1stUse() override { return Condition; }
 
   void Set1stUse(Value *v) override { Condition = v; }
 
   void Print() const override;
 
+  std::unique_ptr<Instruction> Clone() const override {
+    return std::make_unique<BranchInstruction>(*this);
+  }
+
 private:
   Value *Condition;
   BasicBlock *TrueTarget;
   BasicBlock *FalseTarget;
+  std::optional<bool> LikelyTaken;
+};
+
+/// Jump to the Index-th target. Index must be in range, the bound checks
+/// precede the instruction.
+class JumpTableInstruction : public Instruction {
+public:
+  JumpTableInstruction(Value *Index, std::vector<BasicBlock *> Targets,
+                       BasicBlock *P)
+      : Instruction(Instruction::JUMP_TABLE, P, IRType(IRType::NONE)),
+        Index(Index), Targets(std::move(Targets)) {}
+
+  Value *GetIndex() { return Index; }
+  std::vector<BasicBlock *> &GetTargets() { return Targets; }
+
+  bool IsDef() const override { return false; }
+
+  Value *Get1stUse() override { return Index; }
+
+  void Set1stUse(Value *v) override { Index = v; }
+
+  void Print() const override;
+
+  std::unique_ptr<Instruction> Clone() const override {
+    return std::make_unique<JumpTableInstruction>(*this);
+  }
+
+private:
+  Value *Index;
+  std::vector<BasicBlock *> Targets;
 };
 
 class ReturnInstruction : public Instruction {
@@ -252,6 +383,10 @@ public:
 
   void Print() const override;
 
+  std::unique_ptr<Instruction> Clone() const override {
+    return std::make_unique<ReturnInstruction>(*this);
+  }
+
 private:
   Value *RetVal;
 };
@@ -267,6 +402,10 @@ public:
 
   void Print() const override;
 
+  std::unique_ptr<Instruction> Clone() const override {
+    return std::make_unique<StackAllocationInstruction>(*this);
+  }
+
 private:
   std::string VariableName;
 };
@@ -289,6 +428,10 @@ public:
 
   void Print() const override;
 
+  std::unique_ptr<Instruction> Clone() const override {
+    return std::make_unique<GetElementPointerInstruction>(*this);
+  }
+
 private:
   Value *Source;
   Value *Index;
@@ -304,6 +447,10 @@ public:
 
   void Print() const override;
 
+  std::unique_ptr<Instruction> Clone() const override {
+    return std::make_unique<StoreInstruction>(*this);
+  }
+
   Value *GetMemoryLocation() { return Destination; }
   Value *GetSavedValue() { return Source; }
 
@@ -342,6 +489,10 @@ public:
 
   void Print() const override;
 
+  std::unique_ptr<Instruction> Clone() const override {
+    return std::make_unique<LoadInstruction>(*this);
+  }
+
   Value *GetMemoryLocation() { return Source; }
 
   Value *Get1stUse() override { return Source; }
@@ -375,6 +526,10 @@ public:
 
   void Print() const override;
 
+  std::unique_ptr<Instruction> Clone() const override {
+    return std::make_unique<MemoryCopyInstruction>(*this);
+  }
+
 private:
   Value *Dest;
   Value *Src;
@@ -0,0 +1,49 @@
+#include "Profile.hpp"
+#include "BasicBlock.hpp"
+#include "Function.hpp"
+#include "Module.hpp"
+#include <fstream>
+
+bool Profile::Read(const std::string &Path) {
+  std::ifstream File(Path);
+  if (!File.is_open())
+    return false;
+
+  std::string Func;
+  size_t BlocksNum;
+  while (File >> Func >> BlocksNum) {
+    auto &FuncCounts = Counts[Func];
+
+    std::string BB;
+    uint64_t Count;
+    for (size_t i = 0; i < BlocksNum; i++) {
+      if (!(File >> BB >> Count))
+        return false;
+      FuncCounts[BB] += Count;
+    }
+  }
+
+  return File.eof();
+}
+
+std::optional<uint64_t> Profile::GetCount(const std::string &Func,
+                                          const std::string &BB) const {
+  auto FuncIt = Counts.find(Func);
+  if (FuncIt == Counts.end())
+    return std::nullopt;
+
+  // The blocks missing from a profiled function were not created in the
+  // profiled run, so nothing is known about them
+  auto BBIt = FuncIt->second.find(BB);
+  if (BBIt == FuncIt->second.end())
+    return std::nullopt;
+
+  return BBIt->second;
+}
+
+void Profile::Annotate(Module &M) const {
+  for (auto &F : M.GetFunctions())
+    for (auto &BB : F.GetBasicBlocks())
+      if (auto Count = GetCount(F.GetName(), BB->GetName()))
+        BB->SetCount(*Count);
+}
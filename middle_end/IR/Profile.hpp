@@ -0,0 +1,39 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+
+class Module;
+
+/// The execution counts of the basic blocks from a profiled run. The profile
+/// runtime writes them as a header line for each function followed by a line
+/// for each of its blocks:
+///
+///   <function> <number of blocks>
+///   <block> <count>
+///   ...
+///
+/// The blocks are identified by their names right after the code generation,
+/// so the profile is only usable for the same source.
+class Profile {
+public:
+  /// Read the profile from @Path. The counts of the functions appearing
+  /// several times are summed up. Return false if it cannot be read.
+  bool Read(const std::string &Path);
+
+  /// Return the count of the block named @BB of the function @Func, if the
+  /// function was profiled.
+  std::optional<uint64_t> GetCount(const std::string &Func,
+                                   const std::string &BB) const;
+
+  /// Attach the counts to the basic blocks of @M.
+  void Annotate(Module &M) const;
+
+private:
+  std::map<std::string, std::map<std::string, uint64_t>> Counts;
+};
+
+#endif // PROFILE_HPP
@@ -44,6 +44,9 @@ void GlobalVariable::Print() const {
   std::cout << "global var (" << GetType().AsString() << "):" << std::endl
             << "\t" << Name;
 
+  if (!Section.empty())
+    std::cout << " in " << Section;
+
   if (!InitList.empty()) {
     std::cout << " = {";
     for (size_t i = 0; i < InitList.size(); i++) {
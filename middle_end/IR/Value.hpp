@@ -100,6 +100,11 @@ public:
   std::string &GetInitString() { return InitString; }
   Value *GetInitValue() { return InitValue; }
 
+  /// The name of the section the variable is placed into, if it is not the
+  /// default data section.
+  std::string &GetSection() { return Section; }
+  void SetSection(const std::string &S) { Section = S; }
+
   std::string ValueString() const override {
     return "@" + Name + "<" + ValueType.AsString() + ">";
   }
@@ -111,6 +116,7 @@ private:
   std::vector<uint64_t> InitList;
   std::string InitString;
   Value *InitValue = nullptr;
+  std::string Section;
 };
 
 #endif
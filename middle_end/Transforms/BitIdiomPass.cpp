@@ -0,0 +1,560 @@
+#include "BitIdiomPass.hpp"
+#include "../IR/Function.hpp"
+#include "Util.hpp"
+#include <algorithm>
+#include <utility>
+
+/// The reflected CRC-32 polynomial, as used by the crc32 instructions.
+static constexpr uint64_t CRC32Polynomial = 0xEDB88320;
+
+static uint64_t GetMask(unsigned Width) {
+  return Width >= 64 ? ~0ull : (1ull << Width) - 1;
+}
+
+static bool IsConstant(Value *V, uint64_t C) {
+  auto Const = dynamic_cast<Constant *>(V);
+  return Const && !Const->IsFPConst() &&
+         (Const->GetIntValue() & GetMask(V->GetBitWidth())) == C;
+}
+
+/// Return @V if it is a binary instruction of @Kind, otherwise nullptr.
+static BinaryInstruction *GetBinary(Value *V, Instruction::IKind Kind) {
+  auto I = dynamic_cast<BinaryInstruction *>(V);
+  return I && I->GetInstructionKind() == Kind ? I : nullptr;
+}
+
+/// If one of the operands of @I is the constant @C, then return the other
+/// one, otherwise nullptr.
+static Value *GetOtherOperand(BinaryInstruction *I, uint64_t C) {
+  if (!I)
+    return nullptr;
+  if (IsConstant(I->GetRHS(), C))
+    return I->GetLHS();
+  if (IsConstant(I->GetLHS(), C))
+    return I->GetRHS();
+  return nullptr;
+}
+
+/// Return the operand of @V if it is a zero extension, otherwise @V.
+static Value *StripExtension(Value *V) {
+  auto Ext = dynamic_cast<UnaryInstruction *>(V);
+  if (Ext && Ext->GetInstructionKind() == Instruction::ZEXT)
+    return Ext->GetOperand();
+  return V;
+}
+
+/// Return true if @V is a local variable, which is only accessed directly.
+static bool IsLocalVariable(LoopAnalysis &LA, Value *V) {
+  return dynamic_cast<StackAllocationInstruction *>(V) &&
+         !LA.IsAddressTaken(V);
+}
+
+static bool IsLoadOf(Value *V, Value *Address) {
+  auto Load = dynamic_cast<LoadInstruction *>(V);
+  return Load && !Load->Get2ndUse() && Load->GetMemoryLocation() == Address;
+}
+
+template <typename T, typename... Args>
+T *BitIdiomPass::Insert(BasicBlock *BB, Args &&...Arguments) {
+  auto I = std::make_unique<T>(std::forward<Args>(Arguments)..., BB);
+  auto InstPtr = I.get();
+
+  if (I->IsDef())
+    I->SetID(NextID++);
+
+  BB->Insert(std::move(I));
+  return InstPtr;
+}
+
+Value *BitIdiomPass::GetLeader(Value *V) {
+  auto It = Leaders.find(V);
+  return It != Leaders.end() ? It->second : V;
+}
+
+bool BitIdiomPass::GetBitOrigins(Value *V, unsigned Depth,
+                                 BitOrigins &Result) {
+  V = GetLeader(V);
+  const unsigned Width = V->GetBitWidth();
+  auto &Type = V->GetTypeRef();
+  if (!Type.IsINT() || Type.IsPTR() || Type.IsVector() || Width == 0 ||
+      Width > 64)
+    return false;
+
+  if (auto It = Origins.find(V); It != Origins.end()) {
+    Result = It->second;
+    return true;
+  }
+
+  Result.Source = nullptr;
+  Result.Bits.assign(Width, -1);
+
+  if (auto C = dynamic_cast<Constant *>(V))
+    return (C->GetIntValue() & GetMask(Width)) == 0;
+
+  auto I = dynamic_cast<Instruction *>(V);
+  bool Leaf = Depth >= MaxDepth || !I;
+  BitOrigins Op;
+
+  if (!Leaf)
+    switch (I->GetInstructionKind()) {
+    case Instruction::LSL:
+    case Instruction::LSR: {
+      auto Shift = (BinaryInstruction *)I;
+      auto Amount = dynamic_cast<Constant *>(Shift->GetRHS());
+      if (!Amount || Amount->GetIntValue() >= Width) {
+        Leaf = true;
+        break;
+      }
+
+      if (!GetBitOrigins(Shift->GetLHS(), Depth + 1, Op) ||
+          Op.Bits.size() != Width)
+        return false;
+
+      const unsigned N = Amount->GetIntValue();
+      for (unsigned i = 0; i < Width; i++)
+        if (I->GetInstructionKind() == Instruction::LSL)
+          Result.Bits[i] = i >= N ? Op.Bits[i - N] : -1;
+        else
+          Result.Bits[i] = i + N < Width ? Op.Bits[i + N] : -1;
+      Result.Source = Op.Source;
+      break;
+    }
+    case Instruction::AND: {
+      auto And = (BinaryInstruction *)I;
+      auto Mask = dynamic_cast<Constant *>(And->GetRHS());
+      auto Operand = And->GetLHS();
+      if (!Mask) {
+        Mask = dynamic_cast<Constant *>(And->GetLHS());
+        Operand = And->GetRHS();
+      }
+
+      if (!Mask || Mask->IsFPConst()) {
+        Leaf = true;
+        break;
+      }
+
+      if (!GetBitOrigins(Operand, Depth + 1, Op) || Op.Bits.size() != Width)
+        return false;
+
+      for (unsigned i = 0; i < Width; i++)
+        Result.Bits[i] = (Mask->GetIntValue() >> i) & 1 ? Op.Bits[i] : -1;
+      Result.Source = Op.Source;
+      break;
+    }
+    case Instruction::OR: {
+      auto Or = (BinaryInstruction *)I;
+      BitOrigins Other;
+      if (!GetBitOrigins(Or->GetLHS(), Depth + 1, Op) ||
+          !GetBitOrigins(Or->GetRHS(), Depth + 1, Other) ||
+          Op.Bits.size() != Width || Other.Bits.size() != Width ||
+          (Op.Source && Other.Source && Op.Source != Other.Source))
+        return false;
+
+      for (unsigned i = 0; i < Width; i++) {
+        if (Op.Bits[i] != -1 && Other.Bits[i] != -1 &&
+            Op.Bits[i] != Other.Bits[i])
+          return false;
+        Result.Bits[i] = std::max(Op.Bits[i], Other.Bits[i]);
+      }
+      Result.Source = Op.Source ? Op.Source : Other.Source;
+      break;
+    }
+    case Instruction::ZEXT:
+    case Instruction::TRUNC: {
+      if (!GetBitOrigins(((UnaryInstruction *)I)->GetOperand(), Depth + 1,
+                         Op))
+        return false;
+
+      for (unsigned i = 0; i < Width && i < Op.Bits.size(); i++)
+        Result.Bits[i] = Op.Bits[i];
+      Result.Source = Op.Source;
+      break;
+    }
+    default:
+      Leaf = true;
+      break;
+    }
+
+  if (Leaf) {
+    Result.Source = V;
+    for (unsigned i = 0; i < Width; i++)
+      Result.Bits[i] = i;
+  }
+
+  // A value without any copied bits does not depend on anything
+  if (std::all_of(Result.Bits.begin(), Result.Bits.end(),
+                  [](int Bit) { return Bit == -1; }))
+    Result.Source = nullptr;
+
+  Origins[V] = Result;
+  return true;
+}
+
+std::unique_ptr<Instruction> BitIdiomPass::MatchPermutation(Function &F,
+                                                            Instruction *I) {
+  BitOrigins Origin;
+  const unsigned Width = I->GetBitWidth();
+  if (!GetBitOrigins(I, 0, Origin) || !Origin.Source ||
+      Origin.Source->GetBitWidth() != Width)
+    return nullptr;
+
+  auto &Bits = Origin.Bits;
+  const int Amount = Bits[0];
+  bool IsRotate = (Width == 32 || Width == 64) && Amount > 0;
+  bool IsSwap = Width == 16 || Width == 32 || Width == 64;
+  for (unsigned i = 0; i < Width; i++) {
+    IsRotate = IsRotate && Bits[i] == (int)((i + Amount) % Width);
+    IsSwap = IsSwap && Bits[i] == (int)((Width / 8 - 1 - i / 8) * 8 + i % 8);
+  }
+
+  std::unique_ptr<Instruction> New;
+  if (IsRotate)
+    New = std::make_unique<BinaryInstruction>(
+        Instruction::ROTR, Origin.Source, F.GetConstant(Amount), CurrentBB);
+  else if (IsSwap)
+    New = std::make_unique<UnaryInstruction>(Instruction::BSWAP,
+                                             Origin.Source, CurrentBB);
+  else
+    return nullptr;
+
+  New->SetID(NextID++);
+  New->GetTypeRef() = I->GetType();
+  return New;
+}
+
+std::unique_ptr<Instruction> BitIdiomPass::MatchVariableRotate(Instruction *I) {
+  auto Or = GetBinary(I, Instruction::OR);
+  const unsigned Width = I->GetBitWidth();
+  if (!Or || !I->IsIntType() || (Width != 32 && Width != 64))
+    return nullptr;
+
+  // Return true if @A is width - @B or -@B & (width - 1)
+  auto IsComplement = [&](Value *A, Value *B) {
+    A = StripExtension(A);
+    B = GetLeader(StripExtension(B));
+    if (auto Masked = GetOtherOperand(GetBinary(A, Instruction::AND),
+                                      Width - 1)) {
+      auto Neg = GetBinary(Masked, Instruction::SUB);
+      return Neg && IsConstant(Neg->GetLHS(), 0) &&
+             GetLeader(StripExtension(Neg->GetRHS())) == B;
+    }
+
+    auto Sub = GetBinary(A, Instruction::SUB);
+    return Sub && IsConstant(Sub->GetLHS(), Width) &&
+           GetLeader(StripExtension(Sub->GetRHS())) == B;
+  };
+
+  for (auto [A, B] : {std::pair(Or->GetLHS(), Or->GetRHS()),
+                      std::pair(Or->GetRHS(), Or->GetLHS())}) {
+    auto Left = GetBinary(A, Instruction::LSL);
+    auto Right = GetBinary(B, Instruction::LSR);
+    if (!Left || !Right ||
+        GetLeader(Left->GetLHS()) != GetLeader(Right->GetLHS()) ||
+        (!IsComplement(Left->GetRHS(), Right->GetRHS()) &&
+         !IsComplement(Right->GetRHS(), Left->GetRHS())))
+      continue;
+
+    // Either way it is a rotate right by the amount of the right shift
+    auto New = std::make_unique<BinaryInstruction>(
+        Instruction::ROTR, GetLeader(Left->GetLHS()), Right->GetRHS(),
+        CurrentBB);
+    New->SetID(NextID++);
+    New->GetTypeRef() = I->GetType();
+    return New;
+  }
+
+  return nullptr;
+}
+
+Value *BitIdiomPass::MatchCRCStep(Instruction *I) {
+  auto Xor = GetBinary(I, Instruction::XOR);
+  if (!Xor || !Xor->IsIntType() || Xor->GetBitWidth() != 32)
+    return nullptr;
+
+  // crc = (crc >> 1) ^ (Polynomial & -(crc & 1))
+  for (auto [A, B] : {std::pair(Xor->GetLHS(), Xor->GetRHS()),
+                      std::pair(Xor->GetRHS(), Xor->GetLHS())}) {
+    auto Shift = GetBinary(A, Instruction::LSR);
+    auto Neg = GetBinary(GetOtherOperand(GetBinary(B, Instruction::AND),
+                                         CRC32Polynomial),
+                         Instruction::SUB);
+    if (!Shift || !IsConstant(Shift->GetRHS(), 1) || !Neg ||
+        !IsConstant(Neg->GetLHS(), 0))
+      continue;
+
+    auto CRC = GetLeader(Shift->GetLHS());
+    auto Bit = GetOtherOperand(GetBinary(Neg->GetRHS(), Instruction::AND), 1);
+    if (Bit && GetLeader(Bit) == CRC)
+      return CRC;
+  }
+
+  return nullptr;
+}
+
+void BitIdiomPass::RemoveDeadStores(BasicBlock *BB, LoopAnalysis &LA,
+                                    std::set<Value *> &Steps) {
+  auto &Instructions = BB->GetInstructions();
+
+  for (size_t i = 0; i < Instructions.size(); i++) {
+    auto Store = dynamic_cast<StoreInstruction *>(Instructions[i].get());
+    if (!Store || Steps.count(Store->GetSavedValue()) == 0)
+      continue;
+
+    auto Address = Store->GetMemoryLocation();
+    if (!IsLocalVariable(LA, Address))
+      continue;
+
+    for (size_t j = i + 1; j < Instructions.size(); j++) {
+      auto I = Instructions[j].get();
+      if (I->IsLoad() && I->Get1stUse() == Address)
+        break;
+
+      if (I->IsStore() && I->Get2ndUse() == Address) {
+        Instructions.erase(Instructions.begin() + i--);
+        break;
+      }
+    }
+  }
+}
+
+bool BitIdiomPass::RunOnBlock(Function &F, BasicBlock *BB, LoopAnalysis &LA) {
+  auto &Instructions = BB->GetInstructions();
+  CurrentBB = BB;
+  Leaders.clear();
+  Origins.clear();
+
+  // The loads of a location give the same value until it might be modified.
+  // Only the local variables are known to keep their values over the stores
+  // through pointers and the calls.
+  std::map<Value *, Value *> Loaded;
+  for (auto &Ptr : Instructions) {
+    auto I = Ptr.get();
+
+    if (auto Load = dynamic_cast<LoadInstruction *>(I)) {
+      if (Load->Get2ndUse())
+        continue;
+
+      auto It = Loaded.find(Load->GetMemoryLocation());
+      if (It != Loaded.end() &&
+          It->second->GetBitWidth() == Load->GetBitWidth())
+        Leaders[Load] = It->second;
+      else
+        Loaded[Load->GetMemoryLocation()] = Load;
+    } else if (I->IsStore() || I->IsCall() ||
+               I->GetInstructionKind() == Instruction::MEM_COPY) {
+      auto Address = I->IsStore() ? I->Get2ndUse() : nullptr;
+      for (auto It = Loaded.begin(); It != Loaded.end();)
+        if (It->first == Address || !IsLocalVariable(LA, It->first))
+          It = Loaded.erase(It);
+        else
+          It++;
+    }
+  }
+
+  std::vector<Instruction *> Worklist;
+  for (auto &Ptr : Instructions)
+    Worklist.push_back(Ptr.get());
+
+  std::map<Value *, Value *> Renames;
+  for (auto I : Worklist) {
+    const auto Kind = I->GetInstructionKind();
+    std::unique_ptr<Instruction> New;
+    if (Kind == Instruction::OR)
+      New = MatchVariableRotate(I);
+    if (!New && (Kind == Instruction::OR || Kind == Instruction::TRUNC))
+      New = MatchPermutation(F, I);
+
+    if (New)
+      Renames[I] = BB->InsertBefore(std::move(New), I);
+  }
+
+  // Each CRC-32 step is linked to the previous one, if it is not shared
+  std::map<Value *, Value *> Previous;
+  std::map<Value *, Value *> Next;
+  std::set<Value *> Shared;
+  for (auto I : Worklist)
+    if (auto CRC = MatchCRCStep(I)) {
+      Previous[I] = CRC;
+      if (Next.count(CRC) != 0)
+        Shared.insert(CRC);
+      Next[CRC] = I;
+    }
+
+  // Every 32, 16 or 8 steps of a chain are replaced by a single instruction,
+  // which processes that many zero bits
+  std::set<Value *> Steps;
+  for (auto I : Worklist) {
+    if (Previous.count(I) == 0 || Previous.count(Previous[I]) != 0)
+      continue;
+
+    std::vector<Value *> Chain = {I};
+    while (Shared.count(Chain.back()) == 0 && Next.count(Chain.back()) != 0)
+      Chain.push_back(Next[Chain.back()]);
+
+    Value *CRC = Previous[I];
+    size_t Pos = 0;
+    while (Chain.size() - Pos >= 8) {
+      const size_t Left = Chain.size() - Pos;
+      const unsigned Bits = Left >= 32 ? 32 : Left >= 16 ? 16 : 8;
+      Pos += Bits;
+
+      auto Last = (Instruction *)Chain[Pos - 1];
+      auto New = std::make_unique<BinaryInstruction>(
+          Instruction::CRC32, CRC, F.GetConstant(0, Bits), BB);
+      New->SetID(NextID++);
+      New->GetTypeRef() = Last->GetType();
+      CRC = BB->InsertBefore(std::move(New), Last);
+      Renames[Last] = CRC;
+      Steps.insert(CRC);
+    }
+
+    Steps.insert(Chain.begin(), Chain.begin() + Pos);
+  }
+
+  if (Renames.empty())
+    return false;
+
+  RenameRegisters(Renames, Instructions);
+  for (auto &Ptr : Instructions)
+    if (auto Call = dynamic_cast<CallInstruction *>(Ptr.get()))
+      for (auto &Arg : Call->GetArgs())
+        if (Renames.count(Arg) != 0)
+          Arg = Renames[Arg];
+
+  // The replaced steps are still stored to the variable of the checksum
+  RemoveDeadStores(BB, LA, Steps);
+  return true;
+}
+
+bool BitIdiomPass::RunOnLoop(Function &F, LoopAnalysis &LA, Loop *L) {
+  auto &Blocks = F.GetBasicBlocks();
+  auto Header = L->GetHeader();
+  auto Cmp = L->GetExitCondition();
+  size_t Begin = 0;
+  size_t End = 0;
+  if (!Cmp || !L->ExitsOnTrue() ||
+      Cmp->GetRelation() != CompareInstruction::EQ ||
+      !IsConstant(Cmp->GetRHS(), 0) || !GetLoopRange(F, L, Begin, End))
+    return false;
+
+  // The header only tests whether the variable became zero
+  auto Load = dynamic_cast<LoadInstruction *>(Cmp->GetLHS());
+  auto Slot = Load ? Load->GetMemoryLocation() : nullptr;
+  const unsigned Width = Cmp->GetLHS()->GetBitWidth();
+  if (!Load || Load->Get2ndUse() || !Load->IsIntType() ||
+      !IsLocalVariable(LA, Slot) || (Width != 32 && Width != 64) ||
+      Header->GetInstructions().size() != 3)
+    return false;
+
+  // Each iteration executes every block of the loop
+  std::vector<Instruction *> Body;
+  for (size_t i = Begin + 1; i < End; i++) {
+    auto &Instructions = Blocks[i]->GetInstructions();
+    auto Jump = Instructions.empty() ? nullptr
+                                     : dynamic_cast<JumpInstruction *>(
+                                           Instructions.back().get());
+    auto Next = i + 1 < End ? Blocks[i + 1].get() : Header;
+    if (!Jump || Jump->GetTargetBB() != Next)
+      return false;
+
+    for (size_t j = 0; j + 1 < Instructions.size(); j++)
+      Body.push_back(Instructions[j].get());
+  }
+
+  StoreInstruction *Clear = nullptr;
+  StoreInstruction *Increment = nullptr;
+  for (auto I : Body)
+    if (auto Store = dynamic_cast<StoreInstruction *>(I)) {
+      auto &S = Store->GetMemoryLocation() == Slot ? Clear : Increment;
+      if (S)
+        return false;
+      S = Store;
+    }
+
+  if (!Clear || !Increment)
+    return false;
+
+  // x & (x - 1) clears the lowest set bit, while the counter is incremented
+  auto Counter = Increment->GetMemoryLocation();
+  auto And = GetBinary(Clear->GetSavedValue(), Instruction::AND);
+  auto Sub = And ? GetBinary(And->GetRHS(), Instruction::SUB) : nullptr;
+  auto Other = And ? And->GetLHS() : nullptr;
+  if (And && !Sub) {
+    Sub = GetBinary(And->GetLHS(), Instruction::SUB);
+    Other = And->GetRHS();
+  }
+
+  auto Add = GetBinary(Increment->GetSavedValue(), Instruction::ADD);
+  if (!Sub || !IsConstant(Sub->GetRHS(), 1) || !IsLoadOf(Sub->GetLHS(), Slot) ||
+      !IsLoadOf(Other, Slot) || !Add || !Add->IsIntType() ||
+      !IsConstant(Add->GetRHS(), 1) || !IsLoadOf(Add->GetLHS(), Counter) ||
+      !IsLocalVariable(LA, Counter))
+    return false;
+
+  // Nothing else is done in the loop
+  const std::set<Value *> Matched = {Clear, Increment, And, Sub, Other,
+                                     Sub->GetLHS(), Add, Add->GetLHS()};
+  for (auto I : Body)
+    if (Matched.count(I) == 0)
+      return false;
+
+  // The body is replaced by a single block, which adds the number of set bits
+  // to the counter, clears the variable and leaves the loop
+  auto Exit = ((BranchInstruction *)Header->GetInstructions().back().get())
+                  ->GetTrueTarget();
+  auto NewLoad = Load->Clone();
+  auto NewCounterLoad = ((LoadInstruction *)Add->GetLHS())->Clone();
+  const unsigned CounterWidth = Add->GetBitWidth();
+
+  auto BB = Blocks[Begin + 1].get();
+  auto &Instructions = BB->GetInstructions();
+  Instructions.clear();
+
+  NewLoad->SetID(NextID++);
+  NewCounterLoad->SetID(NextID++);
+  auto Variable = BB->Insert(std::move(NewLoad));
+  auto OldCount = BB->Insert(std::move(NewCounterLoad));
+
+  Value *Count = Insert<UnaryInstruction>(BB, Instruction::POPCOUNT, Variable);
+  if (CounterWidth > Width)
+    Count = Insert<UnaryInstruction>(BB, Instruction::ZEXT,
+                                     IRType::CreateInt(CounterWidth), Count);
+  else if (CounterWidth < Width)
+    Count = Insert<UnaryInstruction>(BB, Instruction::TRUNC,
+                                     IRType::CreateInt(CounterWidth), Count);
+
+  auto Sum = Insert<BinaryInstruction>(BB, Instruction::ADD, OldCount, Count);
+  Insert<StoreInstruction>(BB, Sum, Counter);
+  Insert<StoreInstruction>(BB, F.GetConstant(0, Width), Slot);
+  Insert<JumpInstruction>(BB, Exit);
+
+  Blocks.erase(Blocks.begin() + Begin + 2, Blocks.begin() + End);
+  return true;
+}
+
+bool BitIdiomPass::RunOnFunction(Function &F) {
+  if (F.GetBasicBlocks().empty())
+    return false;
+
+  NextID = GetNextID(F);
+
+  // The analysis is recomputed after each replaced loop, since its blocks are
+  // removed
+  bool Changed = false;
+  for (bool LoopChanged = true; LoopChanged;) {
+    LoopChanged = false;
+    LoopAnalysis LA(F);
+
+    for (auto L : LA.GetLoops())
+      if (RunOnLoop(F, LA, L)) {
+        LoopChanged = Changed = true;
+        break;
+      }
+  }
+
+  LoopAnalysis LA(F);
+  for (auto &BB : F.GetBasicBlocks())
+    Changed |= RunOnBlock(F, BB.get(), LA);
+
+  return Changed;
+}
@@ -0,0 +1,83 @@
+#ifndef BIT_IDIOM_PASS_HPP
+#define BIT_IDIOM_PASS_HPP
+
+#include "FunctionPass.hpp"
+#include "LoopAnalysis.hpp"
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+/// Replace the open coded bit manipulations with the bit manipulation
+/// instructions of the IR. Within a block the following are recognized:
+///
+///  - rotates, which are the or of two opposite shifts of the same value, by
+///    constant or variable amounts,
+///  - byte swaps, which are the or of the shifted and masked bytes of a value,
+///  - chains of bitwise CRC-32 steps, like the fully unrolled loop
+///
+/// .loop_header0_unroll0:
+/// 	lsr	$26<u32>, $25<u32>, 1<u32>
+/// 	and	$28<u32>, $25<u32>, 1<u32>
+/// 	sub	$29<u32>, 0<u32>, $28<u32>
+/// 	and	$30<u32>, $29<u32>, -306674912<u32>
+/// 	xor	$31<u32>, $26<u32>, $30<u32>
+/// 	...
+///
+/// where every 8, 16 or 32 steps are done by a single crc32 of a zero byte,
+/// half word or word. The loops clearing the lowest set bit of a local
+/// variable until it becomes zero, while incrementing another one, are
+/// replaced with a popcount. The matched instructions are left to the dead
+/// code elimination.
+class BitIdiomPass : public FunctionPass {
+public:
+  bool RunOnFunction(Function &F) override;
+
+private:
+  /// The origin of each bit of a value: the bit of the source it is copied
+  /// from or -1 if it is zero.
+  struct BitOrigins {
+    Value *Source = nullptr;
+    std::vector<int> Bits;
+  };
+
+  /// Replace @L with a popcount if it only counts the set bits of a variable.
+  bool RunOnLoop(Function &F, LoopAnalysis &LA, Loop *L);
+
+  bool RunOnBlock(Function &F, BasicBlock *BB, LoopAnalysis &LA);
+
+  /// Return the rotate or byte swap computing the same value as @I, or
+  /// nullptr.
+  std::unique_ptr<Instruction> MatchPermutation(Function &F, Instruction *I);
+  std::unique_ptr<Instruction> MatchVariableRotate(Instruction *I);
+
+  /// Return the checksum, which the CRC-32 step @I is applied to, or nullptr.
+  Value *MatchCRCStep(Instruction *I);
+
+  /// Compute where the bits of @V come from through constant shifts, masks,
+  /// ors and extensions. Return false if they come from several values.
+  bool GetBitOrigins(Value *V, unsigned Depth, BitOrigins &Result);
+
+  /// Return the first load of the same location in the block if @V is a load,
+  /// which gives the same value, otherwise @V.
+  Value *GetLeader(Value *V);
+
+  /// Remove the stores of the replaced CRC-32 steps in @Steps to local
+  /// variables, which are overwritten before being read.
+  void RemoveDeadStores(BasicBlock *BB, LoopAnalysis &LA,
+                        std::set<Value *> &Steps);
+
+  /// Create an instruction with a new ID and insert it to the end of @BB.
+  template <typename T, typename... Args>
+  T *Insert(BasicBlock *BB, Args &&...Arguments);
+
+  /// The origins are not followed through deeper operand trees than this.
+  static constexpr unsigned MaxDepth = 16;
+
+  unsigned NextID = 0;
+  BasicBlock *CurrentBB = nullptr;
+  std::map<Value *, Value *> Leaders;
+  std::map<Value *, BitOrigins> Origins;
+};
+
+#endif // BIT_IDIOM_PASS_HPP
@@ -0,0 +1,443 @@
+#include "BlockPlacementPass.hpp"
+#include "../IR/BasicBlock.hpp"
+#include "../IR/Function.hpp"
+#include "Util.hpp"
+#include <algorithm>
+#include <set>
+
+/// Return the position of the first jump, return or jump table of @BB, or the
+/// number of its instructions if it has none. The branches before it leave
+/// the block when taken, otherwise the execution continues after them.
+static size_t GetTerminatorIndex(BasicBlock *BB) {
+  auto &Instructions = BB->GetInstructions();
+  size_t i = 0;
+  while (i < Instructions.size() && !Instructions[i]->IsTerminator())
+    i++;
+
+  return i;
+}
+
+/// Return the jump ending @BB, or nullptr.
+static JumpInstruction *GetJump(BasicBlock *BB) {
+  auto &Instructions = BB->GetInstructions();
+  const size_t i = GetTerminatorIndex(BB);
+
+  return i < Instructions.size()
+             ? dynamic_cast<JumpInstruction *>(Instructions[i].get())
+             : nullptr;
+}
+
+/// Return the branch right before the jump ending @BB, or nullptr.
+static BranchInstruction *GetLastBranch(BasicBlock *BB) {
+  auto &Instructions = BB->GetInstructions();
+  const size_t i = GetTerminatorIndex(BB);
+
+  return GetJump(BB) && i > 0
+             ? dynamic_cast<BranchInstruction *>(Instructions[i - 1].get())
+             : nullptr;
+}
+
+/// Return the distinct successors of @BB, once its fall through is explicit.
+static std::vector<BasicBlock *> GetSuccessors(BasicBlock *BB) {
+  auto &Instructions = BB->GetInstructions();
+  const size_t End = GetTerminatorIndex(BB);
+  std::vector<BasicBlock *> Successors;
+
+  for (size_t i = 0; i < Instructions.size() && i <= End; i++)
+    for (auto Target : GetTargets(Instructions[i].get()))
+      if (Target && std::find(Successors.begin(), Successors.end(), Target) ==
+                        Successors.end())
+        Successors.push_back(Target);
+
+  return Successors;
+}
+
+/// Return true if the condition of @Br ending @BB can be inverted in place:
+/// it is an integer comparison, which is not used by anything else.
+static bool IsInvertible(BasicBlock *BB, BranchInstruction *Br) {
+  auto CMP = dynamic_cast<CompareInstruction *>(Br->GetCondition());
+  if (!CMP || CMP->GetInstructionKind() != Instruction::CMP ||
+      CMP->GetTypeRef().IsVector())
+    return false;
+
+  for (auto &I : BB->GetInstructions()) {
+    if (I.get() == Br)
+      continue;
+
+    std::vector<Value *> Uses = {I->Get1stUse(), I->Get2ndUse(),
+                                 I->Get3rdUse()};
+    if (I->IsCall())
+      Uses = ((CallInstruction *)I.get())->GetArgs();
+
+    if (std::find(Uses.begin(), Uses.end(), CMP) != Uses.end())
+      return false;
+  }
+
+  return true;
+}
+
+bool BlockPlacementPass::MakeFallThroughsExplicit(Function &F) {
+  auto &Blocks = F.GetBasicBlocks();
+  std::vector<size_t> FallThroughs;
+
+  for (size_t i = 0; i < Blocks.size(); i++) {
+    auto &Instructions = Blocks[i]->GetInstructions();
+    const size_t End = GetTerminatorIndex(Blocks[i].get());
+
+    for (size_t j = 0; j < End; j++)
+      if (auto Br = dynamic_cast<BranchInstruction *>(Instructions[j].get());
+          Br && Br->HasFalseLabel())
+        return false;
+
+    if (End == Instructions.size()) {
+      if (i + 1 == Blocks.size())
+        return false;
+      FallThroughs.push_back(i);
+    }
+  }
+
+  for (auto i : FallThroughs) {
+    auto BB = Blocks[i].get();
+    BB->Insert(std::make_unique<JumpInstruction>(Blocks[i + 1].get(), BB));
+  }
+
+  return true;
+}
+
+std::vector<std::pair<BasicBlock *, double>>
+BlockPlacementPass::GetSuccessorProbabilities(BasicBlock *BB,
+                                              LoopAnalysis &LA) {
+  auto &Instructions = BB->GetInstructions();
+  const size_t End = GetTerminatorIndex(BB);
+  std::vector<std::pair<BasicBlock *, double>> Result;
+  if (End == Instructions.size())
+    return Result;
+
+  auto Jump = GetJump(BB);
+  auto L = LA.GetLoopFor(BB);
+  unsigned Branches = 0;
+  for (size_t i = 0; i < End; i++)
+    if (Instructions[i]->GetInstructionKind() == Instruction::BRANCH)
+      Branches++;
+
+  // Without hints each way out of the block is equally likely, but the loops
+  // are assumed to be iterated rather than left
+  double Remaining = 1;
+  for (size_t i = 0; i < End; i++) {
+    auto Br = dynamic_cast<BranchInstruction *>(Instructions[i].get());
+    if (!Br)
+      continue;
+
+    auto Taken = Br->GetTrueTarget();
+    const bool IsLast = i + 1 == End && Jump;
+    double Probability = 1.0 / (Branches-- + 1);
+
+    if (auto Likely = Br->IsLikelyTaken())
+      Probability = *Likely ? 1 - UnlikelyProbability : UnlikelyProbability;
+    else if (L && !L->Contains(Taken))
+      Probability = 1 / LoopScale;
+    else if (L && IsLast && !L->Contains(Jump->GetTargetBB()))
+      Probability = 1 - 1 / LoopScale;
+
+    Result.push_back({Taken, Remaining * Probability});
+    Remaining *= 1 - Probability;
+  }
+
+  auto Targets = GetTargets(Instructions[End].get());
+  for (auto Target : Targets)
+    Result.push_back({Target, Remaining / Targets.size()});
+
+  return Result;
+}
+
+void BlockPlacementPass::ComputeWeights(Function &F, LoopAnalysis &LA) {
+  // The blocks are visited in reverse post order, so the frequency of each
+  // block is known before it is propagated to its successors, apart from the
+  // back edges, which are accounted for by scaling the loop headers
+  std::vector<BasicBlock *> PostOrder;
+  std::set<BasicBlock *> Visited = {Entry};
+  std::vector<std::pair<BasicBlock *, size_t>> Stack = {{Entry, 0}};
+
+  while (!Stack.empty()) {
+    auto &[BB, Next] = Stack.back();
+    auto Successors = GetSuccessors(BB);
+
+    if (Next == Successors.size()) {
+      PostOrder.push_back(BB);
+      Stack.pop_back();
+      continue;
+    }
+
+    auto Successor = Successors[Next++];
+    if (Visited.insert(Successor).second)
+      Stack.push_back({Successor, 0});
+  }
+
+  Frequencies[Entry] = 1;
+  for (auto It = PostOrder.rbegin(); It != PostOrder.rend(); It++) {
+    auto BB = *It;
+    if (auto L = LA.GetLoopFor(BB); L && L->GetHeader() == BB)
+      Frequencies[BB] *= LoopScale;
+
+    for (auto [Successor, Probability] : GetSuccessorProbabilities(BB, LA)) {
+      const double Weight = Frequencies[BB] * Probability;
+      Weights[{BB, Successor}] += Weight;
+
+      if (!LA.Dominates(Successor, BB))
+        Frequencies[Successor] += Weight;
+    }
+  }
+}
+
+void BlockPlacementPass::ComputeProfileWeights(Function &F,
+                                               LoopAnalysis &LA) {
+  // The blocks created after the profile was read, like the copies of an
+  // unrolled loop body, are as hot as the block before them
+  double LastCount = 0;
+  for (auto &BB : F.GetBasicBlocks())
+    Frequencies[BB.get()] = LastCount =
+        BB->GetCount() ? (double)*BB->GetCount() : LastCount;
+
+  // Only the blocks are counted, so an edge is known exactly if it is the
+  // single way to reach its target, the rest of the count of the source is
+  // divided among the other targets
+  for (auto &BB : F.GetBasicBlocks()) {
+    const double Count = Frequencies[BB.get()];
+    auto Successors = GetSuccessors(BB.get());
+    double Remaining = Count;
+    std::vector<BasicBlock *> Unknown;
+
+    for (auto Successor : Successors) {
+      auto &Preds = LA.GetPredecessors(Successor);
+      if (Successors.size() > 1 &&
+          std::any_of(Preds.begin(), Preds.end(),
+                      [&BB](BasicBlock *P) { return P != BB.get(); })) {
+        Unknown.push_back(Successor);
+        continue;
+      }
+
+      const double Weight = std::min(Count, Frequencies[Successor]);
+      Weights[{BB.get(), Successor}] = Weight;
+      Remaining -= Weight;
+    }
+
+    for (auto Successor : Unknown)
+      Weights[{BB.get(), Successor}] =
+          std::min(std::max(Remaining, 0.0), Frequencies[Successor]);
+  }
+}
+
+bool BlockPlacementPass::IsCold(BasicBlock *BB) {
+  const double EntryFrequency = Frequencies[Entry];
+
+  if (UseProfile)
+    return EntryFrequency > 0 && Frequencies[BB] == 0;
+  return Frequencies[BB] <= EntryFrequency * UnlikelyProbability;
+}
+
+std::vector<std::vector<BasicBlock *>>
+BlockPlacementPass::BuildChains(Function &F, LoopAnalysis &LA) {
+  struct Edge {
+    BasicBlock *From;
+    BasicBlock *To;
+    double Weight;
+    bool IsBackEdge;
+    /// The edges from the loop headers testing the exit condition into the
+    /// loop are merged last, so the latch can be placed before the header.
+    bool IsRotated;
+  };
+
+  auto &Blocks = F.GetBasicBlocks();
+  std::vector<Edge> Edges;
+
+  // Only the target of the jump or of the branch before it, if that can be
+  // inverted, is worth placing after a block
+  for (auto &BB : Blocks) {
+    auto Br = GetLastBranch(BB.get());
+    auto Jump = GetJump(BB.get());
+
+    // The jump is usually the original fall through, which is kept on ties
+    std::vector<BasicBlock *> Targets;
+    if (Jump)
+      Targets.push_back(Jump->GetTargetBB());
+    if (Br && IsInvertible(BB.get(), Br))
+      Targets.push_back(Br->GetTrueTarget());
+
+    auto L = LA.GetLoopFor(BB.get());
+    auto Successors = GetSuccessors(BB.get());
+    const bool IsExitingHeader =
+        L && L->GetHeader() == BB.get() &&
+        std::any_of(Successors.begin(), Successors.end(),
+                    [L](BasicBlock *S) { return !L->Contains(S); });
+
+    for (auto Target : Targets)
+      if (Target != Entry && Target != BB.get())
+        Edges.push_back({BB.get(), Target, Weights[{BB.get(), Target}],
+                         LA.Dominates(Target, BB.get()),
+                         IsExitingHeader && L->Contains(Target)});
+  }
+
+  std::stable_sort(Edges.begin(), Edges.end(),
+                   [](const Edge &L, const Edge &R) {
+                     if (L.IsRotated != R.IsRotated)
+                       return R.IsRotated;
+                     if (L.Weight != R.Weight)
+                       return L.Weight > R.Weight;
+                     return L.IsBackEdge && !R.IsBackEdge;
+                   });
+
+  std::vector<std::vector<BasicBlock *>> Chains;
+  std::map<BasicBlock *, size_t> ChainOf;
+  for (auto &BB : Blocks) {
+    ChainOf[BB.get()] = Chains.size();
+    Chains.push_back({BB.get()});
+  }
+
+  // The cold blocks are not appended to hot ones, so they can be moved away
+  for (auto &E : Edges) {
+    const size_t From = ChainOf[E.From];
+    const size_t To = ChainOf[E.To];
+
+    if (From == To || Chains[From].back() != E.From ||
+        Chains[To].front() != E.To || (IsCold(E.To) && !IsCold(E.From)))
+      continue;
+
+    for (auto BB : Chains[To]) {
+      ChainOf[BB] = From;
+      Chains[From].push_back(BB);
+    }
+    Chains[To].clear();
+  }
+
+  Chains.erase(std::remove_if(Chains.begin(), Chains.end(),
+                              [](std::vector<BasicBlock *> &Chain) {
+                                return Chain.empty();
+                              }),
+               Chains.end());
+  return Chains;
+}
+
+std::vector<std::vector<BasicBlock *>>
+BlockPlacementPass::OrderChains(std::vector<std::vector<BasicBlock *>> &Chains) {
+  std::map<BasicBlock *, size_t> ChainOf;
+  for (size_t i = 0; i < Chains.size(); i++)
+    for (auto BB : Chains[i])
+      ChainOf[BB] = i;
+
+  std::vector<std::vector<BasicBlock *>> Order;
+  std::vector<bool> Placed(Chains.size(), false);
+  std::vector<double> Connections(Chains.size(), 0);
+
+  auto Place = [&](size_t i) {
+    Placed[i] = true;
+    Order.push_back(Chains[i]);
+
+    for (auto BB : Chains[i])
+      for (auto Successor : GetSuccessors(BB))
+        if (!Placed[ChainOf[Successor]])
+          Connections[ChainOf[Successor]] += Weights[{BB, Successor}];
+  };
+
+  // Among the equally connected chains the original order is kept
+  Place(0);
+  for (;;) {
+    size_t Best = Chains.size();
+    for (size_t i = 0; i < Chains.size(); i++)
+      if (!Placed[i] &&
+          !std::all_of(Chains[i].begin(), Chains[i].end(),
+                       [this](BasicBlock *BB) { return IsCold(BB); }) &&
+          (Best == Chains.size() || Connections[i] > Connections[Best]))
+        Best = i;
+
+    if (Best == Chains.size())
+      break;
+    Place(Best);
+  }
+
+  for (size_t i = 0; i < Chains.size(); i++)
+    if (!Placed[i])
+      Place(i);
+
+  return Order;
+}
+
+bool BlockPlacementPass::FixTerminators(Function &F) {
+  auto &Blocks = F.GetBasicBlocks();
+  bool Changed = false;
+
+  for (size_t i = 0; i < Blocks.size(); i++) {
+    auto BB = Blocks[i].get();
+    auto Next = i + 1 < Blocks.size() ? Blocks[i + 1].get() : nullptr;
+    auto &Instructions = BB->GetInstructions();
+    auto Jump = GetJump(BB);
+    if (!Jump)
+      continue;
+
+    auto Br = GetLastBranch(BB);
+    if (Br && Br->GetTrueTarget() == Next && Jump->GetTargetBB() != Next &&
+        IsInvertible(BB, Br)) {
+      ((CompareInstruction *)Br->GetCondition())->InvertRelation();
+      Br->SetTrueTarget(Jump->GetTargetBB());
+      if (auto Likely = Br->IsLikelyTaken())
+        Br->SetLikelyTaken(!*Likely);
+      Jump->SetTargetBB(Next);
+    }
+
+    // The unreachable instructions after the jump are removed with it
+    if (Jump->GetTargetBB() == Next) {
+      auto It = std::find_if(Instructions.begin(), Instructions.end(),
+                             [Jump](std::unique_ptr<Instruction> &I) {
+                               return I.get() == Jump;
+                             });
+      Instructions.erase(It, Instructions.end());
+      Changed = true;
+    }
+  }
+
+  return Changed;
+}
+
+bool BlockPlacementPass::RunOnFunction(Function &F) {
+  auto &Blocks = F.GetBasicBlocks();
+  if (Blocks.size() < 3 || !MakeFallThroughsExplicit(F))
+    return false;
+
+  Frequencies.clear();
+  Weights.clear();
+  Entry = Blocks[0].get();
+
+  LoopAnalysis LA(F);
+  UseProfile = std::any_of(Blocks.begin(), Blocks.end(),
+                           [](std::unique_ptr<BasicBlock> &BB) {
+                             return BB->GetCount().has_value();
+                           });
+  if (UseProfile)
+    ComputeProfileWeights(F, LA);
+  else
+    ComputeWeights(F, LA);
+
+  auto Chains = BuildChains(F, LA);
+
+  std::map<BasicBlock *, std::unique_ptr<BasicBlock>> Owners;
+  for (auto &BB : Blocks)
+    Owners[BB.get()] = std::move(BB);
+
+  Blocks.clear();
+  for (auto &Chain : OrderChains(Chains))
+    for (auto BB : Chain)
+      Blocks.push_back(std::move(Owners[BB]));
+
+  for (auto L : LA.GetLoops()) {
+    if (!L->GetSubLoops().empty() || IsCold(L->GetHeader()))
+      continue;
+
+    for (auto &BB : Blocks)
+      if (L->Contains(BB.get())) {
+        BB->SetAlignment(LoopAlignment);
+        break;
+      }
+  }
+
+  FixTerminators(F);
+  return true;
+}
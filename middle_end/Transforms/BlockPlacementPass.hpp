@@ -0,0 +1,80 @@
+#ifndef BLOCK_PLACEMENT_PASS_HPP
+#define BLOCK_PLACEMENT_PASS_HPP
+
+#include "FunctionPass.hpp"
+#include "LoopAnalysis.hpp"
+#include <map>
+#include <utility>
+#include <vector>
+
+/// Reorder the blocks of a function, so the likely successor of each block
+/// follows it and the branches are mostly not taken. The edges of the control
+/// flow graph are weighted by the profile counts of the blocks if the
+/// function was profiled, otherwise by the block frequencies estimated from
+/// the loop nesting and the __builtin_expect hints. The blocks are merged
+/// into chains along the heaviest edges first (Pettis–Hansen), the back edges
+/// being preferred on ties. The edges from the headers testing the exit
+/// condition into their loops are merged last, which rotates the loops:
+///
+/// .loop_body0:
+/// 	...
+/// .loop_header0:
+/// 	cmp.lt	$9<i1>, $8<i32>, $1<i32>
+/// 	br	$9<i1>, <loop_body0>
+/// .loop_end0:
+///
+/// The chains are then placed after the entry one, the ones most strongly
+/// connected to the already placed blocks first, and the cold chains last.
+/// Finally the integer comparisons of the branches are inverted where the
+/// taken target got placed next, the jumps to the next block are removed and
+/// the top of each innermost loop is aligned.
+class BlockPlacementPass : public FunctionPass {
+public:
+  bool RunOnFunction(Function &F) override;
+
+private:
+  /// Append a jump to the next block to the blocks falling through into it.
+  /// Return false without changing anything if @F has a block ending in a
+  /// way, which the pass does not handle.
+  bool MakeFallThroughsExplicit(Function &F);
+
+  /// Compute the frequency of each block and the weight of each edge.
+  void ComputeWeights(Function &F, LoopAnalysis &LA);
+  void ComputeProfileWeights(Function &F, LoopAnalysis &LA);
+
+  /// Return the successors of @BB with the probability of going to them,
+  /// estimated from the hints and the loops.
+  std::vector<std::pair<BasicBlock *, double>>
+  GetSuccessorProbabilities(BasicBlock *BB, LoopAnalysis &LA);
+
+  /// Return the blocks of @F merged into chains, the entry one first.
+  std::vector<std::vector<BasicBlock *>> BuildChains(Function &F,
+                                                     LoopAnalysis &LA);
+
+  /// Return the chains in the order they are placed.
+  std::vector<std::vector<BasicBlock *>>
+  OrderChains(std::vector<std::vector<BasicBlock *>> &Chains);
+
+  /// Invert the branches and remove the jumps made redundant by the new
+  /// order of the blocks. Return true if anything changed.
+  bool FixTerminators(Function &F);
+
+  bool IsCold(BasicBlock *BB);
+
+  /// A loop is assumed to iterate this many times, so it is left with the
+  /// reciprocal of it as probability.
+  static constexpr double LoopScale = 8;
+  /// The probability of the branches hinted to be unlikely. The blocks, which
+  /// are this unlikely to be reached from the entry, are cold.
+  static constexpr double UnlikelyProbability = 1.0 / 64;
+  /// The top of the innermost loops are aligned to 2^LoopAlignment bytes,
+  /// so the fetch of the first instructions is not split.
+  static constexpr unsigned LoopAlignment = 4;
+
+  BasicBlock *Entry = nullptr;
+  bool UseProfile = false;
+  std::map<BasicBlock *, double> Frequencies;
+  std::map<std::pair<BasicBlock *, BasicBlock *>, double> Weights;
+};
+
+#endif // BLOCK_PLACEMENT_PASS_HPP
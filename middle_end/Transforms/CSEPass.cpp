@@ -4,6 +4,18 @@
 #include "Util.hpp"
 #include <map>
 
+/// Return true if @A and @B compute different values from the same operands,
+/// like comparisons with different relations or truncations to other types.
+static bool IsDifferentOperation(Instruction *A, Instruction *B) {
+  if (!(A->GetTypeRef() == B->GetTypeRef()) ||
+      A->GetTypeRef().GetPointerLevel() != B->GetTypeRef().GetPointerLevel())
+    return true;
+
+  auto CmpA = dynamic_cast<CompareInstruction *>(A);
+  auto CmpB = dynamic_cast<CompareInstruction *>(B);
+  return CmpA && CmpB && CmpA->GetRelation() != CmpB->GetRelation();
+}
+
 struct AliveDefinitions {
   std::vector<Instruction *> Instructions;
 
@@ -19,7 +31,9 @@ struct AliveDefinitions {
       // same operands
       if (I->GetInstructionKind() == Instr->GetInstructionKind() &&
           I->Get1stUse() == Instr->Get1stUse() &&
-          I->Get2ndUse() == Instr->Get2ndUse()) {
+          I->Get2ndUse() == Instr->Get2ndUse() &&
+          I->Get3rdUse() == Instr->Get3rdUse() &&
+          !IsDifferentOperation(I, Instr)) {
         // then the value computed by I is already computed, return it's
         // defining instruction
         return Instr;
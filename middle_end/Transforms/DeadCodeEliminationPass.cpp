@@ -16,6 +16,9 @@ void FindDeadInstructions(const std::unique_ptr<BasicBlock> &BB,
     if (auto Use2 = Instructions[i]->Get2ndUse(); Use2 && Use2->IsRegister())
       UsedValues.insert(Use2);
 
+    if (auto Use3 = Instructions[i]->Get3rdUse(); Use3 && Use3->IsRegister())
+      UsedValues.insert(Use3);
+
     // If it is a call then added all of it's parameters to the use set
     if (Instructions[i]->IsCall())
       for (auto Param :
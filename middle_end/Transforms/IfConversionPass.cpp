@@ -0,0 +1,249 @@
+#include "IfConversionPass.hpp"
+#include "../IR/BasicBlock.hpp"
+#include "../IR/Function.hpp"
+#include "Util.hpp"
+#include <algorithm>
+
+/// Return true if @I can be executed even where its block would not be.
+static bool IsSpeculatable(Instruction *I) {
+  switch (I->GetInstructionKind()) {
+  // The division by zero is undefined
+  case Instruction::DIV:
+  case Instruction::DIVU:
+  case Instruction::MOD:
+  case Instruction::MODU:
+  case Instruction::CALL:
+  case Instruction::STORE:
+  case Instruction::MEM_COPY:
+  case Instruction::STACK_ALLOC:
+  case Instruction::JUMP:
+  case Instruction::BRANCH:
+  case Instruction::RET:
+  case Instruction::JUMP_TABLE:
+    return false;
+  case Instruction::LOAD: {
+    // Only the local and global variables are known to be accessible
+    auto Address = I->Get1stUse();
+    if (I->Get2ndUse())
+      return false;
+
+    if (auto Slot = dynamic_cast<StackAllocationInstruction *>(Address))
+      return !Slot->GetType().IsStruct() && !Slot->GetType().IsArray();
+
+    return Address->IsGlobalVar() && !Address->GetTypeRef().IsArray() &&
+           !Address->GetTypeRef().IsStruct();
+  }
+  default:
+    return !I->GetTypeRef().IsVector();
+  }
+}
+
+/// Return true if @V is used in @BB by other instructions than @Except.
+static bool IsUsed(BasicBlock *BB, Value *V, Instruction *Except) {
+  for (auto &I : BB->GetInstructions()) {
+    if (I.get() == Except)
+      continue;
+
+    std::vector<Value *> Uses = {I->Get1stUse(), I->Get2ndUse(),
+                                 I->Get3rdUse()};
+    if (I->IsCall())
+      Uses = ((CallInstruction *)I.get())->GetArgs();
+
+    for (auto Use : Uses)
+      if (Use == V)
+        return true;
+  }
+
+  return false;
+}
+
+template <typename T, typename... Args>
+T *IfConversionPass::Insert(BasicBlock *BB, Args &&...Arguments) {
+  auto I = std::make_unique<T>(std::forward<Args>(Arguments)..., BB);
+  auto InstPtr = I.get();
+
+  if (I->IsDef())
+    I->SetID(NextID++);
+
+  BB->Insert(std::move(I));
+  return InstPtr;
+}
+
+StoreInstruction *IfConversionPass::MatchSide(Function &F, BasicBlock *BB,
+                                              BasicBlock *Head,
+                                              BasicBlock *Next,
+                                              LoopAnalysis &LA) {
+  auto &Preds = LA.GetPredecessors(BB);
+  if (Preds.size() != 1 || Preds[0] != Head)
+    return nullptr;
+
+  auto &Instructions = BB->GetInstructions();
+  auto CF = GetControlFlow(BB);
+  size_t Size = Instructions.size();
+
+  // The side either jumps to @Next or falls through into it
+  if (CF) {
+    if (CF != Instructions.back().get() || !CF->IsJump() ||
+        ((JumpInstruction *)CF)->GetTargetBB() != Next)
+      return nullptr;
+    Size--;
+  } else {
+    auto &Blocks = F.GetBasicBlocks();
+    size_t i = 0;
+    while (i < Blocks.size() && Blocks[i].get() != BB)
+      i++;
+    if (i + 1 >= Blocks.size() || Blocks[i + 1].get() != Next)
+      return nullptr;
+  }
+
+  if (Size == 0 || Size > MaxSideSize)
+    return nullptr;
+
+  auto Store = dynamic_cast<StoreInstruction *>(Instructions[Size - 1].get());
+  if (!Store)
+    return nullptr;
+
+  auto Slot =
+      dynamic_cast<StackAllocationInstruction *>(Store->GetMemoryLocation());
+  auto Saved = Store->GetSavedValue();
+  if (!Slot || LA.IsAddressTaken(Slot) || !Saved->GetTypeRef().IsScalar() ||
+      Saved->GetTypeRef().IsVector())
+    return nullptr;
+
+  // The floating point constants would need to be materialized in registers
+  if (Saved->IsConstant() && Saved->IsFPType())
+    return nullptr;
+
+  for (size_t i = 0; i + 1 < Size; i++)
+    if (!IsSpeculatable(Instructions[i].get()))
+      return nullptr;
+
+  return Store;
+}
+
+bool IfConversionPass::RunOnBlock(Function &F, size_t Index,
+                                  LoopAnalysis &LA) {
+  auto &Blocks = F.GetBasicBlocks();
+  auto Head = Blocks[Index].get();
+  auto &HeadInstructions = Head->GetInstructions();
+
+  if (Index + 2 >= Blocks.size() || HeadInstructions.empty() ||
+      GetControlFlow(Head) != HeadInstructions.back().get())
+    return false;
+
+  auto Br = dynamic_cast<BranchInstruction *>(HeadInstructions.back().get());
+  if (!Br || Br->HasFalseLabel())
+    return false;
+
+  // The branch skips the fall through side, when the condition holds
+  auto Then = Blocks[Index + 1].get();
+  auto Else = Blocks[Index + 2].get();
+  if (Br->GetTrueTarget() != Else)
+    return false;
+
+  auto ThenStore = MatchSide(F, Then, Head, Else, LA);
+  StoreInstruction *ElseStore = nullptr;
+  BasicBlock *End = Else;
+
+  if (!ThenStore) {
+    auto ThenJump = GetControlFlow(Then);
+    if (!ThenJump || !ThenJump->IsJump())
+      return false;
+
+    End = ((JumpInstruction *)ThenJump)->GetTargetBB();
+    if (End == Head || End == Then || End == Else)
+      return false;
+
+    ThenStore = MatchSide(F, Then, Head, End, LA);
+    ElseStore = MatchSide(F, Else, Head, End, LA);
+    if (!ThenStore || !ElseStore ||
+        ThenStore->GetMemoryLocation() != ElseStore->GetMemoryLocation())
+      return false;
+  }
+
+  auto Slot = ThenStore->GetMemoryLocation();
+  auto Condition = Br->GetCondition();
+  HeadInstructions.pop_back();
+
+  // The condition is moved next to the select, if nothing else uses it
+  std::unique_ptr<Instruction> Compare;
+  if (dynamic_cast<CompareInstruction *>(Condition) &&
+      !IsUsed(Head, Condition, nullptr))
+    for (auto It = HeadInstructions.begin(); It != HeadInstructions.end();
+         It++)
+      if (It->get() == Condition) {
+        Compare = std::move(*It);
+        HeadInstructions.erase(It);
+        break;
+      }
+
+  // On the skipped side of a triangle the variable keeps its value
+  Value *ElseValue = nullptr;
+  if (!ElseStore) {
+    auto Type = Slot->GetType();
+    ElseValue = Insert<LoadInstruction>(Head, Type, Slot);
+  }
+
+  std::vector<BasicBlock *> Sides = {Then};
+  if (ElseStore)
+    Sides.push_back(Else);
+
+  for (auto Side : Sides) {
+    auto &Instructions = Side->GetInstructions();
+    for (auto &I : Instructions) {
+      if (I->IsStore() || I->IsJump())
+        break;
+      I->SetParent(Head);
+      HeadInstructions.push_back(std::move(I));
+    }
+  }
+
+  if (Compare)
+    HeadInstructions.push_back(std::move(Compare));
+
+  Value *ThenValue = ThenStore->GetSavedValue();
+  if (ElseStore)
+    ElseValue = ElseStore->GetSavedValue();
+
+  // The select has the type of the variable, the stored constants might be
+  // unsigned
+  auto Select =
+      Insert<SelectInstruction>(Head, Condition, ElseValue, ThenValue);
+  Select->GetTypeRef() = Slot->GetType();
+  Select->GetTypeRef().DecrementPointerLevel();
+
+  Insert<StoreInstruction>(Head, Select, Slot);
+  Insert<JumpInstruction>(Head, End);
+
+  if (ElseStore)
+    Blocks.erase(Blocks.begin() + Index + 2);
+  Blocks.erase(Blocks.begin() + Index + 1);
+
+  // The end is usually reached only from here now
+  MergeBlocks(F, Index, std::min(Index + 2, Blocks.size()));
+  return true;
+}
+
+bool IfConversionPass::RunOnFunction(Function &F) {
+  if (F.GetBasicBlocks().empty())
+    return false;
+
+  NextID = GetNextID(F);
+
+  // The analysis is recomputed after each conversion, since blocks are
+  // removed. The inner conditionals are converted first, which might make
+  // the outer ones convertible.
+  bool Changed = false;
+  for (bool BlockChanged = true; BlockChanged;) {
+    BlockChanged = false;
+    LoopAnalysis LA(F);
+
+    for (size_t i = F.GetBasicBlocks().size(); i-- > 0;)
+      if (RunOnBlock(F, i, LA)) {
+        BlockChanged = Changed = true;
+        break;
+      }
+  }
+
+  return Changed;
+}
@@ -0,0 +1,60 @@
+#ifndef IF_CONVERSION_PASS_HPP
+#define IF_CONVERSION_PASS_HPP
+
+#include "FunctionPass.hpp"
+#include "LoopAnalysis.hpp"
+
+/// Replace the short conditionally executed blocks, which only assign a local
+/// variable, with a select. For example the ternary
+///
+/// 	cmp.le	$6<i1>, $4<i32>, $5<i32>
+/// 	br	$6<i1>, <ternary_false0>
+/// .ternary_true0:
+/// 	ld	$7<i32>, [$0<*i32>]
+/// 	str	[$8<*i32>], $7<i32>
+/// 	j	<ternary_end0>
+/// .ternary_false0:
+/// 	ld	$9<i32>, [$2<*i32>]
+/// 	str	[$8<*i32>], $9<i32>
+/// 	j	<ternary_end0>
+///
+/// becomes
+///
+/// 	ld	$7<i32>, [$0<*i32>]
+/// 	ld	$9<i32>, [$2<*i32>]
+/// 	cmp.le	$6<i1>, $4<i32>, $5<i32>
+/// 	sel	$10<i32>, $6<i1>, $9<i32>, $7<i32>
+/// 	str	[$8<*i32>], $10<i32>
+/// 	j	<ternary_end0>
+///
+/// Both sides of an if-else (diamond) or the single side of an if (triangle)
+/// are executed unconditionally, therefore they must not have side effects,
+/// apart from the final store, and must not trap. The comparison is moved
+/// right before the select, so the targets can select both of them together.
+class IfConversionPass : public FunctionPass {
+public:
+  bool RunOnFunction(Function &F) override;
+
+private:
+  /// Convert the branch ending the block at @Index of @F. Return false if the
+  /// blocks after it do not form a diamond or a triangle.
+  bool RunOnBlock(Function &F, size_t Index, LoopAnalysis &LA);
+
+  /// Return the store ending @BB, which is reached only from @Head and
+  /// continues in @Next, if everything else in it can be speculated, or
+  /// nullptr.
+  StoreInstruction *MatchSide(Function &F, BasicBlock *BB, BasicBlock *Head,
+                              BasicBlock *Next, LoopAnalysis &LA);
+
+  /// Create an instruction with a new ID and insert it to the end of @BB.
+  template <typename T, typename... Args>
+  T *Insert(BasicBlock *BB, Args &&...Arguments);
+
+  /// Longer sides are left as branches, since their instructions would be
+  /// executed in vain too often.
+  static constexpr unsigned MaxSideSize = 8;
+
+  unsigned NextID = 0;
+};
+
+#endif // IF_CONVERSION_PASS_HPP
@@ -0,0 +1,482 @@
+#include "LoopAnalysis.hpp"
+#include "../IR/Function.hpp"
+#include <algorithm>
+
+InductionVariable *Loop::GetInductionVariable(Value *Slot) {
+  for (auto &IV : IVs)
+    if (IV.Slot == Slot)
+      return &IV;
+
+  return nullptr;
+}
+
+LoopAnalysis::LoopAnalysis(Function &F) : F(F) {
+  ComputeCFG();
+  ComputeDominators();
+
+  for (auto &BB : F.GetBasicBlocks())
+    for (auto &I : BB->GetInstructions()) {
+      std::vector<Value *> Uses = {I->Get1stUse(), I->Get2ndUse(),
+                                   I->Get3rdUse()};
+
+      // The address operand of loads and stores does not let the slot escape
+      if (I->IsLoad())
+        Uses[0] = nullptr;
+      else if (I->IsStore())
+        Uses[1] = nullptr;
+      else if (I->IsCall())
+        Uses = ((CallInstruction *)I.get())->GetArgs();
+
+      for (auto Use : Uses)
+        if (dynamic_cast<StackAllocationInstruction *>(Use))
+          AddressTaken.insert(Use);
+    }
+
+  FindLoops();
+
+  for (auto L : LoopOrder) {
+    FindInductionVariables(L);
+    ComputeTripCount(L);
+  }
+}
+
+void LoopAnalysis::ComputeCFG() {
+  for (auto &BB : F.GetBasicBlocks()) {
+    Index[BB.get()] = Blocks.size();
+    Blocks.push_back(BB.get());
+  }
+
+  Successors.resize(Blocks.size());
+  Predecessors.resize(Blocks.size());
+
+  for (size_t i = 0; i < Blocks.size(); i++) {
+    std::vector<BasicBlock *> Targets;
+    bool FallsThrough = true;
+
+    // The first control flow instruction ends the block, without one the
+    // execution continues in the next block. A jump after a branch is taken
+    // when the branch is not.
+    for (auto &I : Blocks[i]->GetInstructions()) {
+      if (auto Jump = dynamic_cast<JumpInstruction *>(I.get())) {
+        Targets.push_back(Jump->GetTargetBB());
+        FallsThrough = false;
+      } else if (auto Br = dynamic_cast<BranchInstruction *>(I.get())) {
+        Targets.push_back(Br->GetTrueTarget());
+        if (!Br->HasFalseLabel())
+          continue;
+
+        Targets.push_back(Br->GetFalseTarget());
+        FallsThrough = false;
+      } else if (auto JT = dynamic_cast<JumpTableInstruction *>(I.get())) {
+        // The bounds check before the table branches to the default
+        auto &TableTargets = JT->GetTargets();
+        Targets.insert(Targets.end(), TableTargets.begin(), TableTargets.end());
+        FallsThrough = false;
+      } else if (I->IsReturn())
+        FallsThrough = false;
+      else
+        continue;
+
+      break;
+    }
+
+    if (FallsThrough && i + 1 < Blocks.size())
+      Targets.push_back(Blocks[i + 1]);
+
+    for (auto Target : Targets) {
+      auto &Succs = Successors[i];
+      if (!Target || std::count(Succs.begin(), Succs.end(), Target) != 0)
+        continue;
+
+      Succs.push_back(Target);
+      Predecessors[Index[Target]].push_back(Blocks[i]);
+    }
+  }
+}
+
+void LoopAnalysis::ComputeDominators() {
+  const auto N = Blocks.size();
+
+  Reachable.assign(N, false);
+  std::vector<BasicBlock *> WorkList = {Blocks[0]};
+  Reachable[0] = true;
+  while (!WorkList.empty()) {
+    auto BB = WorkList.back();
+    WorkList.pop_back();
+
+    for (auto Succ : Successors[Index[BB]])
+      if (!Reachable[Index[Succ]]) {
+        Reachable[Index[Succ]] = true;
+        WorkList.push_back(Succ);
+      }
+  }
+
+  // Unreachable blocks are dominated by nothing, the reachable ones are
+  // initially dominated by every block
+  Dom.assign(N, std::vector<bool>(N, false));
+  for (size_t i = 1; i < N; i++)
+    if (Reachable[i])
+      Dom[i].assign(N, true);
+  Dom[0][0] = true;
+
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+
+    for (size_t i = 1; i < N; i++) {
+      if (!Reachable[i])
+        continue;
+
+      std::vector<bool> NewDom(N, true);
+      for (auto Pred : Predecessors[i]) {
+        if (!Reachable[Index[Pred]])
+          continue;
+
+        for (size_t j = 0; j < N; j++)
+          NewDom[j] = NewDom[j] && Dom[Index[Pred]][j];
+      }
+      NewDom[i] = true;
+
+      if (NewDom != Dom[i]) {
+        Dom[i] = std::move(NewDom);
+        Changed = true;
+      }
+    }
+  }
+}
+
+void LoopAnalysis::FindLoops() {
+  std::map<BasicBlock *, Loop *> LoopOfHeader;
+
+  for (auto BB : Blocks) {
+    if (!Reachable[Index[BB]])
+      continue;
+
+    for (auto Succ : Successors[Index[BB]]) {
+      if (!Dominates(Succ, BB))
+        continue;
+
+      // A back edge, loops with the same header are merged
+      if (LoopOfHeader.count(Succ) == 0) {
+        Loops.push_back(std::make_unique<Loop>(Succ));
+        LoopOfHeader[Succ] = Loops.back().get();
+        LoopOfHeader[Succ]->Blocks.insert(Succ);
+      }
+
+      auto L = LoopOfHeader[Succ];
+      L->Latches.push_back(BB);
+
+      std::vector<BasicBlock *> WorkList = {BB};
+      while (!WorkList.empty()) {
+        auto Current = WorkList.back();
+        WorkList.pop_back();
+
+        if (!L->Blocks.insert(Current).second)
+          continue;
+
+        for (auto Pred : Predecessors[Index[Current]])
+          if (Reachable[Index[Pred]])
+            WorkList.push_back(Pred);
+      }
+    }
+  }
+
+  for (auto &L : Loops)
+    LoopOrder.push_back(L.get());
+
+  // An enclosing loop contains more blocks than the enclosed one
+  std::stable_sort(LoopOrder.begin(), LoopOrder.end(), [](Loop *A, Loop *B) {
+    return A->Blocks.size() < B->Blocks.size();
+  });
+
+  for (size_t i = 0; i < LoopOrder.size(); i++) {
+    auto L = LoopOrder[i];
+
+    for (size_t j = i + 1; j < LoopOrder.size(); j++)
+      if (LoopOrder[j]->Contains(L->Header)) {
+        L->Parent = LoopOrder[j];
+        LoopOrder[j]->SubLoops.push_back(L);
+        break;
+      }
+
+    if (!L->Parent)
+      TopLevelLoops.push_back(L);
+
+    std::vector<BasicBlock *> OutsidePreds;
+    for (auto Pred : Predecessors[Index[L->Header]])
+      if (!L->Contains(Pred))
+        OutsidePreds.push_back(Pred);
+
+    if (OutsidePreds.size() == 1 &&
+        Successors[Index[OutsidePreds[0]]].size() == 1)
+      L->Preheader = OutsidePreds[0];
+  }
+}
+
+Loop *LoopAnalysis::GetLoopFor(BasicBlock *BB) {
+  for (auto L : LoopOrder)
+    if (L->Contains(BB))
+      return L;
+
+  return nullptr;
+}
+
+std::vector<BasicBlock *> &LoopAnalysis::GetSuccessors(BasicBlock *BB) {
+  return Successors[Index[BB]];
+}
+
+std::vector<BasicBlock *> &LoopAnalysis::GetPredecessors(BasicBlock *BB) {
+  return Predecessors[Index[BB]];
+}
+
+bool LoopAnalysis::Dominates(BasicBlock *A, BasicBlock *B) {
+  return Dom[Index[B]][Index[A]];
+}
+
+bool LoopAnalysis::IsLoopInvariant(Loop *L, Value *V) {
+  if (V->IsConstant() || V->IsGlobalVar() || V->IsParameter() ||
+      dynamic_cast<StackAllocationInstruction *>(V))
+    return true;
+
+  auto Load = dynamic_cast<LoadInstruction *>(V);
+  if (!Load || Load->Get2ndUse())
+    return false;
+
+  auto Slot = Load->GetMemoryLocation();
+  return dynamic_cast<StackAllocationInstruction *>(Slot) &&
+         !IsAddressTaken(Slot) && CountStores(L, Slot) == 0;
+}
+
+unsigned LoopAnalysis::CountStores(Loop *L, Value *Slot) {
+  unsigned Count = 0;
+
+  for (auto BB : L->Blocks)
+    for (auto &I : BB->GetInstructions())
+      if (I->IsStore() && I->Get2ndUse() == Slot)
+        Count++;
+
+  return Count;
+}
+
+static int64_t SignExtend(uint64_t Value, unsigned BitWidth) {
+  const unsigned Shift = 64 - BitWidth;
+  return (int64_t)(Value << Shift) >> Shift;
+}
+
+/// Find the variables updated in the latch as
+///   ld  $i, [$slot]
+///   add $next, $i, step    # or sub
+///   str [$slot], $next
+/// where no other store modifies the slot in the loop. Every load of the slot
+/// in the loop, except the ones following the update in the latch, reads the
+/// value the variable had at the start of the iteration.
+void LoopAnalysis::FindInductionVariables(Loop *L) {
+  auto Latch = L->GetLatch();
+  if (!Latch || Latch == L->Header)
+    return;
+
+  auto &Instructions = Latch->GetInstructions();
+  for (size_t i = 0; i < Instructions.size(); i++) {
+    if (!Instructions[i]->IsStore())
+      continue;
+
+    auto Store = (StoreInstruction *)Instructions[i].get();
+    auto Slot = dynamic_cast<StackAllocationInstruction *>(
+        Store->GetMemoryLocation());
+    if (!Slot || IsAddressTaken(Slot) || CountStores(L, Slot) != 1)
+      continue;
+
+    auto Update = dynamic_cast<BinaryInstruction *>(Store->GetSavedValue());
+    if (!Update || !Update->IsIntType() ||
+        (Update->GetInstructionKind() != Instruction::ADD &&
+         Update->GetInstructionKind() != Instruction::SUB))
+      continue;
+
+    auto Load = dynamic_cast<LoadInstruction *>(Update->GetLHS());
+    auto StepValue = dynamic_cast<Constant *>(Update->GetRHS());
+    if (!Load || Load->GetMemoryLocation() != Slot || Load->Get2ndUse() ||
+        !StepValue)
+      continue;
+
+    auto Step = SignExtend(StepValue->GetIntValue(), Update->GetBitWidth());
+    if (Update->GetInstructionKind() == Instruction::SUB)
+      Step = -Step;
+
+    // The loaded value must be the one preceding the update
+    bool LoadInLatch = false;
+    for (size_t j = 0; j < i; j++)
+      if (Instructions[j].get() == Load)
+        LoadInLatch = true;
+
+    if (LoadInLatch && Step != 0)
+      L->IVs.push_back({Slot, Step, Store});
+  }
+}
+
+static CompareInstruction::CompRel GetInverse(unsigned Relation) {
+  switch (Relation) {
+  case CompareInstruction::EQ:
+    return CompareInstruction::NE;
+  case CompareInstruction::NE:
+    return CompareInstruction::EQ;
+  case CompareInstruction::LT:
+    return CompareInstruction::GE;
+  case CompareInstruction::GE:
+    return CompareInstruction::LT;
+  case CompareInstruction::GT:
+    return CompareInstruction::LE;
+  case CompareInstruction::LE:
+    return CompareInstruction::GT;
+  default:
+    assert(!"Invalid relation");
+    return CompareInstruction::INVALID;
+  }
+}
+
+/// Return the relation R', for which -a R' -b holds if and only if a R b.
+static CompareInstruction::CompRel GetMirrored(unsigned Relation) {
+  switch (Relation) {
+  case CompareInstruction::LT:
+    return CompareInstruction::GT;
+  case CompareInstruction::GT:
+    return CompareInstruction::LT;
+  case CompareInstruction::LE:
+    return CompareInstruction::GE;
+  case CompareInstruction::GE:
+    return CompareInstruction::LE;
+  default:
+    return (CompareInstruction::CompRel)Relation;
+  }
+}
+
+/// Find the exit test in the header and if it compares an induction variable
+/// against a loop invariant bound, then record the variable as the counter of
+/// the loop. If the bound and the initial value of the counter are constants,
+/// then compute the number of iterations too.
+void LoopAnalysis::ComputeTripCount(Loop *L) {
+  auto &Succs = Successors[Index[L->Header]];
+  BranchInstruction *Br = nullptr;
+  for (auto &I : L->Header->GetInstructions())
+    if ((Br = dynamic_cast<BranchInstruction *>(I.get())) || I->IsTerminator())
+      break;
+
+  if (!Br || Succs.size() != 2 ||
+      L->Contains(Succs[0]) == L->Contains(Succs[1]))
+    return;
+
+  auto Cmp = dynamic_cast<CompareInstruction *>(Br->GetCondition());
+  if (!Cmp || Cmp->GetInstructionKind() != Instruction::CMP)
+    return;
+
+  bool CmpInHeader = false;
+  for (auto &I : L->Header->GetInstructions())
+    if (I.get() == Cmp)
+      CmpInHeader = true;
+
+  if (!CmpInHeader)
+    return;
+
+  L->ExitCondition = Cmp;
+  L->ExitOnTrue = !L->Contains(Br->GetTrueTarget());
+
+  // The counter might be extended to the width of the comparison
+  auto Counter = Cmp->GetLHS();
+  auto Ext = dynamic_cast<UnaryInstruction *>(Counter);
+  if (Ext && (Ext->GetInstructionKind() == Instruction::SEXT ||
+              Ext->GetInstructionKind() == Instruction::ZEXT))
+    Counter = Ext->GetOperand();
+  else
+    Ext = nullptr;
+
+  auto Load = dynamic_cast<LoadInstruction *>(Counter);
+  if (!Load || !IsLoopInvariant(L, Cmp->GetRHS()))
+    return;
+
+  auto IV = L->GetInductionVariable(Load->GetMemoryLocation());
+  if (!IV)
+    return;
+
+  L->Counter = IV;
+
+  auto Bound = dynamic_cast<Constant *>(Cmp->GetRHS());
+  if (!Bound || !L->Preheader)
+    return;
+
+  // The initial value is the last one stored in the preheader
+  Constant *Init = nullptr;
+  for (auto &I : L->Preheader->GetInstructions())
+    if (I->IsStore() && I->Get2ndUse() == IV->Slot)
+      Init = dynamic_cast<Constant *>(I->Get1stUse());
+
+  if (!Init)
+    return;
+
+  // The comparisons are signed, so an unsigned counter compared without
+  // zero extension must stay below the largest signed value.
+  const uint64_t BitWidth = IV->Slot->GetBitWidth();
+  const bool IsSigned =
+      Ext ? Ext->GetInstructionKind() == Instruction::SEXT
+          : IV->Slot->GetTypeRef().IsSInt();
+  const bool IsZeroExtended =
+      Ext && Ext->GetInstructionKind() == Instruction::ZEXT;
+  const int64_t Min = IsSigned ? SignExtend(1ull << (BitWidth - 1), BitWidth)
+                               : 0;
+  const int64_t Max = IsZeroExtended && BitWidth < 64
+                          ? (int64_t)((1ull << BitWidth) - 1)
+                          : (int64_t)(~0ull >> (65 - BitWidth));
+
+  const uint64_t Mask = ~0ull >> (64 - BitWidth);
+  int64_t I = IsSigned ? SignExtend(Init->GetIntValue(), BitWidth)
+                       : (int64_t)(Init->GetIntValue() & Mask);
+  int64_t B = (int64_t)Bound->GetIntValue();
+  int64_t S = IV->Step;
+  if (I < Min || I > Max)
+    return;
+
+  auto Relation = L->ExitOnTrue ? (CompareInstruction::CompRel)
+                                      Cmp->GetRelation()
+                                : GetInverse(Cmp->GetRelation());
+
+  // Count a decrementing variable as an incrementing one with negated values
+  if (S < 0) {
+    I = -I;
+    B = -B;
+    S = -S;
+    Relation = GetMirrored(Relation);
+  }
+
+  int64_t Trips;
+  switch (Relation) {
+  case CompareInstruction::GE:
+    Trips = I >= B ? 0 : (B - I + S - 1) / S;
+    break;
+  case CompareInstruction::GT:
+    Trips = I > B ? 0 : (B - I) / S + 1;
+    break;
+  case CompareInstruction::EQ:
+    if (I > B || (B - I) % S != 0)
+      return;
+    Trips = (B - I) / S;
+    break;
+  case CompareInstruction::NE:
+    // Staying in the loop means the variable equals the bound
+    Trips = I != B ? 0 : 1;
+    break;
+  case CompareInstruction::LT:
+  case CompareInstruction::LE:
+    // Leaving the loop later would need the variable to overflow
+    if (Relation == CompareInstruction::LT ? I >= B : I > B)
+      return;
+    Trips = 0;
+    break;
+  default:
+    return;
+  }
+
+  // The variable must not overflow before the exit test fails
+  const int64_t Last = IV->Step * Trips + (IV->Step < 0 ? -I : I);
+  if (Last < Min || Last > Max)
+    return;
+
+  L->TripCount = Trips;
+}
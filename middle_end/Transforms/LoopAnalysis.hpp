@@ -0,0 +1,130 @@
+#ifndef LOOP_ANALYSIS_HPP
+#define LOOP_ANALYSIS_HPP
+
+#include "../IR/BasicBlock.hpp"
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <vector>
+
+class Function;
+
+/// A local variable, which is incremented by a constant exactly once in each
+/// iteration. Since the IR has no phi instructions, local variables live in
+/// stack slots, so the variable is identified by its slot.
+struct InductionVariable {
+  StackAllocationInstruction *Slot = nullptr;
+  /// The value added to the variable, negative if it is decremented.
+  int64_t Step = 0;
+  /// The store of the updated value, located in the latch.
+  StoreInstruction *Update = nullptr;
+};
+
+/// A natural loop: the blocks from which the latches can be reached without
+/// going through the header.
+class Loop {
+public:
+  explicit Loop(BasicBlock *Header) : Header(Header) {}
+
+  BasicBlock *GetHeader() { return Header; }
+  /// The single block outside of the loop jumping to the header, or nullptr.
+  BasicBlock *GetPreheader() { return Preheader; }
+  /// The single block jumping back to the header, or nullptr.
+  BasicBlock *GetLatch() { return Latches.size() == 1 ? Latches[0] : nullptr; }
+  std::vector<BasicBlock *> &GetLatches() { return Latches; }
+  std::set<BasicBlock *> &GetBlocks() { return Blocks; }
+  bool Contains(BasicBlock *BB) const { return Blocks.count(BB) != 0; }
+
+  Loop *GetParent() { return Parent; }
+  std::vector<Loop *> &GetSubLoops() { return SubLoops; }
+  unsigned GetDepth() const { return Parent ? Parent->GetDepth() + 1 : 1; }
+
+  std::vector<InductionVariable> &GetInductionVariables() { return IVs; }
+  InductionVariable *GetInductionVariable(Value *Slot);
+
+  /// The comparison in the header deciding whether to leave the loop.
+  CompareInstruction *GetExitCondition() { return ExitCondition; }
+  /// The induction variable, which is compared against a loop invariant
+  /// bound in the exit condition, or nullptr.
+  InductionVariable *GetCounter() { return Counter; }
+  /// True if the loop is left when the exit condition holds.
+  bool ExitsOnTrue() const { return ExitOnTrue; }
+
+  /// The number of times the body is executed, if it is known at compile time.
+  std::optional<uint64_t> GetTripCount() const { return TripCount; }
+
+private:
+  friend class LoopAnalysis;
+
+  BasicBlock *Header;
+  BasicBlock *Preheader = nullptr;
+  std::vector<BasicBlock *> Latches;
+  std::set<BasicBlock *> Blocks;
+
+  Loop *Parent = nullptr;
+  std::vector<Loop *> SubLoops;
+
+  std::vector<InductionVariable> IVs;
+  CompareInstruction *ExitCondition = nullptr;
+  InductionVariable *Counter = nullptr;
+  bool ExitOnTrue = false;
+  std::optional<uint64_t> TripCount;
+};
+
+/// Find the loops of a function, their nesting, their induction variables and
+/// their trip counts. Loops are found from the back edges of the control flow
+/// graph, where the target of the edge dominates its source.
+class LoopAnalysis {
+public:
+  explicit LoopAnalysis(Function &F);
+
+  /// The loops of the function, inner loops preceding the outer ones.
+  std::vector<Loop *> &GetLoops() { return LoopOrder; }
+  std::vector<Loop *> &GetTopLevelLoops() { return TopLevelLoops; }
+
+  /// The innermost loop containing @BB, or nullptr.
+  Loop *GetLoopFor(BasicBlock *BB);
+
+  std::vector<BasicBlock *> &GetSuccessors(BasicBlock *BB);
+  std::vector<BasicBlock *> &GetPredecessors(BasicBlock *BB);
+
+  bool Dominates(BasicBlock *A, BasicBlock *B);
+  bool IsReachable(BasicBlock *BB) { return Reachable[Index[BB]]; }
+
+  /// Return true if the stack slot @Slot is used other than as the address of
+  /// a load or store, so it might be modified through a pointer.
+  bool IsAddressTaken(Value *Slot) { return AddressTaken.count(Slot) != 0; }
+
+  /// Return true if @V has the same value everywhere in @L: it is a constant,
+  /// or a load of a local variable, which is not modified in the loop.
+  bool IsLoopInvariant(Loop *L, Value *V);
+
+  /// Return the number of stores to @Slot in @L.
+  unsigned CountStores(Loop *L, Value *Slot);
+
+private:
+  void ComputeCFG();
+  void ComputeDominators();
+  void FindLoops();
+  void FindInductionVariables(Loop *L);
+  void ComputeTripCount(Loop *L);
+
+  Function &F;
+
+  std::vector<BasicBlock *> Blocks;
+  std::map<BasicBlock *, unsigned> Index;
+  std::vector<std::vector<BasicBlock *>> Successors;
+  std::vector<std::vector<BasicBlock *>> Predecessors;
+  std::vector<bool> Reachable;
+  /// Dom[i][j] is true if the block j dominates the block i.
+  std::vector<std::vector<bool>> Dom;
+
+  std::set<Value *> AddressTaken;
+
+  std::vector<std::unique_ptr<Loop>> Loops;
+  std::vector<Loop *> LoopOrder;
+  std::vector<Loop *> TopLevelLoops;
+};
+
+#endif // LOOP_ANALYSIS_HPP
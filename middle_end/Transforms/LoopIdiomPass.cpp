@@ -0,0 +1,349 @@
+#include "LoopIdiomPass.hpp"
+#include "../IR/Function.hpp"
+#include "Util.hpp"
+#include <iterator>
+
+/// Return the type of the elements accessed through @GEP if they are scalars
+/// of an array, otherwise void.
+static IRType GetElementType(GetElementPointerInstruction *GEP) {
+  auto Type = GEP->GetType();
+  if (Type.GetPointerLevel() != 1 || Type.IsArray() ||
+      GEP->GetSource()->GetTypeRef().IsStruct())
+    return IRType(IRType::NONE);
+
+  Type.DecrementPointerLevel();
+  if (!Type.IsScalar())
+    return IRType(IRType::NONE);
+
+  return Type;
+}
+
+/// Return true if every byte of the @Size bytes wide @Value is the same.
+static bool IsByteSplat(uint64_t Value, size_t Size) {
+  for (size_t i = 1; i < Size; i++)
+    if (((Value >> (i * 8)) & 0xff) != (Value & 0xff))
+      return false;
+
+  return true;
+}
+
+template <typename T, typename... Args>
+T *LoopIdiomPass::Insert(BasicBlock *BB, Args &&...Arguments) {
+  auto I = std::make_unique<T>(std::forward<Args>(Arguments)..., BB);
+  auto InstPtr = I.get();
+
+  if (I->IsDef())
+    I->SetID(NextID++);
+
+  BB->Insert(std::move(I));
+  return InstPtr;
+}
+
+bool LoopIdiomPass::Match(Function &F, LoopAnalysis &LA, Loop *L,
+                          size_t Begin, size_t End) {
+  auto &Blocks = F.GetBasicBlocks();
+  auto IV = L->GetCounter();
+  auto UpdateValue = IV->Update->GetSavedValue();
+  LoadInstruction *SrcLoad = nullptr;
+  bool Updated = false;
+
+  Store = nullptr;
+  DestGEP = SrcGEP = nullptr;
+  Counters.clear();
+  ExtendedCounters.clear();
+  Invariants.clear();
+
+  auto IsInvariantArray = [&](Value *V) {
+    if (Invariants.count(V) != 0 || V->IsParameter())
+      return true;
+
+    // The local and global arrays themselves
+    return (V->IsGlobalVar() ||
+            dynamic_cast<StackAllocationInstruction *>(V)) &&
+           V->GetTypeRef().IsArray();
+  };
+
+  for (size_t i = Begin + 1; i < End; i++)
+    for (auto &Ptr : Blocks[i]->GetInstructions()) {
+      auto I = Ptr.get();
+
+      if (I == IV->Update) {
+        Updated = true;
+        continue;
+      }
+
+      if (I == UpdateValue || I->IsJump())
+        continue;
+
+      if (auto Load = dynamic_cast<LoadInstruction *>(I)) {
+        auto Address = Load->GetMemoryLocation();
+        if (Load->Get2ndUse())
+          return false;
+
+        if (Address == IV->Slot) {
+          if (Updated)
+            return false;
+          Counters.insert(Load);
+        } else if (LA.IsLoopInvariant(L, Load))
+          Invariants.insert(Load);
+        else if (!SrcLoad && Address == SrcGEP)
+          SrcLoad = Load;
+        else
+          return false;
+      } else if (auto Ext = dynamic_cast<UnaryInstruction *>(I)) {
+        if (Ext->GetInstructionKind() != Instruction::SEXT ||
+            Counters.count(Ext->GetOperand()) == 0)
+          return false;
+        ExtendedCounters.insert(Ext);
+      } else if (auto GEP = dynamic_cast<GetElementPointerInstruction *>(I)) {
+        auto Index = GEP->GetIndex();
+        if (!IsInvariantArray(GEP->GetSource()) ||
+            (Counters.count(Index) == 0 &&
+             ExtendedCounters.count(Index) == 0) ||
+            GetElementType(GEP).IsVoid())
+          return false;
+
+        // The first address is read, the second one is written
+        if (!SrcGEP)
+          SrcGEP = GEP;
+        else if (!DestGEP)
+          DestGEP = GEP;
+        else
+          return false;
+      } else if (auto S = dynamic_cast<StoreInstruction *>(I)) {
+        if (Store)
+          return false;
+        Store = S;
+      } else
+        return false;
+    }
+
+  // A fill only computes the written address
+  if (SrcGEP && !DestGEP && !SrcLoad)
+    std::swap(SrcGEP, DestGEP);
+
+  if (!Store || !DestGEP || Store->GetMemoryLocation() != DestGEP)
+    return false;
+
+  const auto ElemType = GetElementType(DestGEP);
+  const size_t Size = ElemType.GetByteSize();
+  if (Size == 0)
+    return false;
+
+  if (SrcGEP) {
+    const auto SrcType = GetElementType(SrcGEP);
+    return SrcLoad && Store->GetSavedValue() == SrcLoad &&
+           SrcType.GetByteSize() == Size;
+  }
+
+  auto Fill = dynamic_cast<Constant *>(Store->GetSavedValue());
+  if (!Fill || Fill->IsFPType())
+    return false;
+
+  const uint64_t Value = Fill->GetIntValue();
+  FillByte = Value & 0xff;
+  return IsByteSplat(Value, Size);
+}
+
+Value *LoopIdiomPass::Reload(Value *V, BasicBlock *BB) {
+  auto Load = dynamic_cast<LoadInstruction *>(V);
+  if (!Load)
+    return V;
+
+  auto Copy = Load->Clone();
+  auto CopyPtr = Copy.get();
+  Copy->SetParent(BB);
+  Copy->SetID(NextID++);
+  BB->Insert(std::move(Copy));
+  return CopyPtr;
+}
+
+Value *LoopIdiomPass::EmitStart(GetElementPointerInstruction *GEP,
+                                Value *Counter, Value *Counter64,
+                                BasicBlock *BB) {
+  auto Index = ExtendedCounters.count(GEP->GetIndex()) ? Counter64 : Counter;
+  return Insert<GetElementPointerInstruction>(
+      BB, GEP->GetType(), Reload(GEP->GetSource(), BB), Index);
+}
+
+LoopIdiomPass::Range LoopIdiomPass::EmitRange(Function &F, Loop *L,
+                                              BasicBlock *BB) {
+  auto Cmp = L->GetExitCondition();
+  auto ToInt64 = [&](Value *V) -> Value * {
+    if (V->GetBitWidth() == 64)
+      return V;
+    return Insert<UnaryInstruction>(BB, Instruction::SEXT,
+                                    IRType::CreateInt(64), V);
+  };
+
+  auto Counter = Reload(Cmp->GetLHS(), BB);
+  auto Counter64 = ToInt64(Counter);
+
+  // The loop runs while the counter is less than the bound, or equal to it
+  Value *Count = Insert<BinaryInstruction>(
+      BB, Instruction::SUB, ToInt64(Reload(Cmp->GetRHS(), BB)), Counter64);
+  if (Cmp->GetRelation() == CompareInstruction::GT)
+    Count = Insert<BinaryInstruction>(BB, Instruction::ADD, Count,
+                                      F.GetConstant(1, 64));
+
+  const size_t Size = GetElementType(DestGEP).GetByteSize();
+  Value *Bytes = Count;
+  if (Size > 1)
+    Bytes = Insert<BinaryInstruction>(BB, Instruction::MUL, Count,
+                                      F.GetConstant(Size, 64));
+
+  Range R = {EmitStart(DestGEP, Counter, Counter64, BB), nullptr, Count,
+             Bytes};
+  if (SrcGEP)
+    R.Src = EmitStart(SrcGEP, Counter, Counter64, BB);
+
+  return R;
+}
+
+bool LoopIdiomPass::RunOnLoop(Function &F, LoopAnalysis &LA, Loop *L) {
+  auto &Blocks = F.GetBasicBlocks();
+  auto Header = L->GetHeader();
+  size_t Begin = 0;
+  size_t End = 0;
+  if (Recognized.count(Header) != 0 || !GetLoopRange(F, L, Begin, End))
+    return false;
+
+  auto IV = L->GetCounter();
+  auto Cmp = L->GetExitCondition();
+  if (!IV || IV->Step != 1 || LA.IsAddressTaken(IV->Slot) ||
+      !L->ExitsOnTrue())
+    return false;
+
+  // The counter itself is compared against the bound, which is recomputed
+  // after the header
+  auto Relation = Cmp->GetRelation();
+  auto CounterLoad = dynamic_cast<LoadInstruction *>(Cmp->GetLHS());
+  auto Bound = Cmp->GetRHS();
+  const unsigned BitWidth = Cmp->GetLHS()->GetBitWidth();
+  if ((Relation != CompareInstruction::GE &&
+       Relation != CompareInstruction::GT) ||
+      !CounterLoad || CounterLoad->GetMemoryLocation() != IV->Slot ||
+      (BitWidth != 32 && BitWidth != 64) || Bound->IsGlobalVar() ||
+      dynamic_cast<StackAllocationInstruction *>(Bound))
+    return false;
+
+  auto UpdateValue = dynamic_cast<BinaryInstruction *>(
+      IV->Update->GetSavedValue());
+  if (!UpdateValue || UpdateValue->GetInstructionKind() != Instruction::ADD)
+    return false;
+
+  // The header only decides whether to leave the loop
+  for (auto &I : Header->GetInstructions())
+    if (I->IsStore() || I->IsCall() ||
+        I->GetInstructionKind() == Instruction::MEM_COPY)
+      return false;
+
+  // Each iteration executes every block of the loop
+  for (size_t i = Begin + 1; i < End; i++) {
+    auto Jump = GetControlFlow(Blocks[i].get());
+    auto Next = i + 1 < End ? Blocks[i + 1].get() : Header;
+    if (!Jump || !Jump->IsJump() ||
+        Jump != Blocks[i]->GetInstructions().back().get() ||
+        ((JumpInstruction *)Jump)->GetTargetBB() != Next)
+      return false;
+  }
+
+  if (!Match(F, LA, L, Begin, End))
+    return false;
+
+  auto TripCount = L->GetTripCount();
+  const size_t Size = GetElementType(DestGEP).GetByteSize();
+  if (TripCount && *TripCount * Size < MinBytes)
+    return false;
+
+  NextID = GetNextID(F);
+  auto Exit = ((BranchInstruction *)Header->GetInstructions().back().get())
+                  ->GetTrueTarget();
+  const auto Name = Header->GetName() + "_idiom";
+  std::vector<std::unique_ptr<BasicBlock>> NewBlocks;
+
+  // The copy is done by the original loop if the ranges overlap, the checks
+  // jump to the call if either range ends before the other one starts
+  std::vector<BranchInstruction *> Checks;
+  if (SrcGEP) {
+    for (unsigned k = 0; k < 2; k++) {
+      NewBlocks.push_back(std::make_unique<BasicBlock>(
+          Name + "_check" + std::to_string(k), &F));
+      auto BB = NewBlocks.back().get();
+      auto R = EmitRange(F, L, BB);
+      auto First = k == 0 ? R.Dest : R.Src;
+      auto Second = k == 0 ? R.Src : R.Dest;
+      auto FirstEnd = Insert<GetElementPointerInstruction>(
+          BB, DestGEP->GetType(), First, R.Count);
+      auto Cond = Insert<CompareInstruction>(BB, FirstEnd, Second,
+                                             CompareInstruction::LE);
+      Checks.push_back(
+          Insert<BranchInstruction>(BB, Cond, nullptr, nullptr));
+    }
+
+    NewBlocks.push_back(std::make_unique<BasicBlock>(Name + "_loop", &F));
+    auto Preheader = NewBlocks.back().get();
+
+    std::map<BasicBlock *, BasicBlock *> Map;
+    auto Copies = CloneBlocks(F, Begin, End, "_fallback", Map, NextID);
+    ((JumpInstruction *)Map[L->GetLatch()]->GetInstructions().back().get())
+        ->SetTargetBB(Map[Header]);
+    Insert<JumpInstruction>(Preheader, Map[Header]);
+
+    Recognized.insert(Map[Header]);
+    std::move(Copies.begin(), Copies.end(), std::back_inserter(NewBlocks));
+  }
+
+  NewBlocks.push_back(std::make_unique<BasicBlock>(Name, &F));
+  auto BB = NewBlocks.back().get();
+  auto R = EmitRange(F, L, BB);
+  std::vector<Value *> Args = {R.Dest};
+  if (SrcGEP)
+    Args.push_back(R.Src);
+  else
+    Args.push_back(F.GetConstant(FillByte));
+  Args.push_back(R.Bytes);
+  BB->Insert(std::make_unique<CallInstruction>(
+      SrcGEP ? "memcpy" : "memset", Args, IRType(IRType::NONE), BB, -1));
+
+  // The counter is left at the first value failing the exit test
+  auto Final = Reload(Bound, BB);
+  if (Relation == CompareInstruction::GT)
+    Final = Insert<BinaryInstruction>(BB, Instruction::ADD, Final,
+                                      F.GetConstant(1, BitWidth));
+  Insert<StoreInstruction>(BB, Final, IV->Slot);
+  Insert<JumpInstruction>(BB, Exit);
+
+  for (auto Check : Checks)
+    Check->SetTrueTarget(BB);
+
+  Recognized.insert(Header);
+
+  Blocks.erase(Blocks.begin() + Begin + 1, Blocks.begin() + End);
+  Blocks.insert(Blocks.begin() + Begin + 1,
+                std::make_move_iterator(NewBlocks.begin()),
+                std::make_move_iterator(NewBlocks.end()));
+  return true;
+}
+
+bool LoopIdiomPass::RunOnFunction(Function &F) {
+  if (F.GetBasicBlocks().empty())
+    return false;
+
+  // The analysis is recomputed after each replaced loop, since the blocks of
+  // the enclosing loops change
+  bool Changed = false;
+  for (bool LoopChanged = true; LoopChanged;) {
+    LoopChanged = false;
+    LoopAnalysis LA(F);
+
+    for (auto L : LA.GetLoops())
+      if (RunOnLoop(F, LA, L)) {
+        LoopChanged = Changed = true;
+        break;
+      }
+  }
+
+  Recognized.clear();
+  return Changed;
+}
@@ -0,0 +1,83 @@
+#ifndef LOOP_IDIOM_PASS_HPP
+#define LOOP_IDIOM_PASS_HPP
+
+#include "FunctionPass.hpp"
+#include "LoopAnalysis.hpp"
+#include <set>
+#include <vector>
+
+/// Replace the innermost counted loops, which fill or copy arrays element by
+/// element, with calls to memset and memcpy. For example
+///
+/// .loop_body0:
+/// 	ld	$6<i32>, [$2<*i32>]
+/// 	ld	$7<*i32>, [$0<**i32>]
+/// 	gep	$8<*i32>, $7<*i32>, $6<i32>
+/// 	str	[$8<*i32>], 0<u32>
+/// 	...
+///
+/// becomes a single block after the header, which clears the remaining
+/// elements with memset, sets the counter to its final value and leaves the
+/// loop. The stored constant must consist of identical bytes. A copy is only
+/// done by memcpy if the source and destination ranges do not overlap,
+/// otherwise the elements are copied by the original loop. The calls need the
+/// C library and 64 bit pointers.
+class LoopIdiomPass : public FunctionPass {
+public:
+  bool RunOnFunction(Function &F) override;
+
+private:
+  bool RunOnLoop(Function &F, LoopAnalysis &LA, Loop *L);
+
+  /// Find the store of the loop body in [@Begin, @End) and the load it copies,
+  /// if any. Return false if the body does anything else apart from computing
+  /// their addresses and updating the counter.
+  bool Match(Function &F, LoopAnalysis &LA, Loop *L, size_t Begin,
+             size_t End);
+
+  /// The values computed at the start of each inserted block.
+  struct Range {
+    /// The address of the first element written and read
+    Value *Dest;
+    Value *Src;
+    /// The number of elements and bytes left
+    Value *Count;
+    Value *Bytes;
+  };
+
+  /// Compute the range of the remaining iterations at the end of @BB.
+  Range EmitRange(Function &F, Loop *L, BasicBlock *BB);
+
+  /// Return the address of the first remaining element accessed by @GEP,
+  /// indexed by @Counter or by its extension @Counter64.
+  Value *EmitStart(GetElementPointerInstruction *GEP, Value *Counter,
+                   Value *Counter64, BasicBlock *BB);
+
+  /// Return a copy of @V at the end of @BB if it is a load, otherwise @V.
+  Value *Reload(Value *V, BasicBlock *BB);
+
+  /// Create an instruction with a new ID and insert it to the end of @BB.
+  template <typename T, typename... Args>
+  T *Insert(BasicBlock *BB, Args &&...Arguments);
+
+  /// Loops with a known trip count, which access fewer bytes than this, are
+  /// left to the unrolling, since the straight stores are cheaper than a call.
+  static constexpr unsigned MinBytes = 128;
+
+  unsigned NextID = 0;
+  /// The store of the body, the addresses it writes and reads, and the
+  /// constant it fills with
+  StoreInstruction *Store = nullptr;
+  GetElementPointerInstruction *DestGEP = nullptr;
+  GetElementPointerInstruction *SrcGEP = nullptr;
+  uint64_t FillByte = 0;
+  /// The values of the counter in the body, the ones extended to 64 bit and
+  /// the loaded loop invariant values
+  std::set<Value *> Counters;
+  std::set<Value *> ExtendedCounters;
+  std::set<Value *> Invariants;
+  /// The headers of the replaced loops and their fallback copies.
+  std::set<BasicBlock *> Recognized;
+};
+
+#endif // LOOP_IDIOM_PASS_HPP
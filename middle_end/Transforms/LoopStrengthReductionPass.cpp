@@ -0,0 +1,290 @@
+#include "LoopStrengthReductionPass.hpp"
+#include "../IR/Function.hpp"
+#include "Util.hpp"
+#include <map>
+
+/// The GEPs indexed by the same induction variable from the same base.
+struct AddressGroup {
+  InductionVariable *IV;
+  /// The base address, or the local variable holding it
+  Value *Base;
+  std::vector<std::pair<BasicBlock *, GetElementPointerInstruction *>> GEPs;
+};
+
+static size_t GetPosition(BasicBlock *BB, Instruction *I) {
+  auto &Instructions = BB->GetInstructions();
+  for (size_t i = 0; i < Instructions.size(); i++)
+    if (Instructions[i].get() == I)
+      return i;
+
+  return Instructions.size();
+}
+
+static void Erase(BasicBlock *BB, Instruction *I) {
+  auto &Instructions = BB->GetInstructions();
+  Instructions.erase(Instructions.begin() + GetPosition(BB, I));
+}
+
+static Instruction *GetTerminator(BasicBlock *BB) {
+  for (auto &I : BB->GetInstructions())
+    if (I->IsTerminator() || I->GetInstructionKind() == Instruction::BRANCH)
+      return I.get();
+
+  return nullptr;
+}
+
+static void ReplaceAllUses(Function &F, Value *From, Value *To) {
+  for (auto &BB : F.GetBasicBlocks())
+    for (auto &I : BB->GetInstructions()) {
+      if (I->Get1stUse() == From)
+        I->Set1stUse(To);
+      if (I->Get2ndUse() == From)
+        I->Set2ndUse(To);
+      if (I->Get3rdUse() == From)
+        I->Set3rdUse(To);
+
+      if (I->IsCall())
+        for (auto &Arg : ((CallInstruction *)I.get())->GetArgs())
+          if (Arg == From)
+            Arg = To;
+    }
+}
+
+static std::map<Value *, std::vector<Instruction *>> GetUsers(Function &F) {
+  std::map<Value *, std::vector<Instruction *>> Users;
+
+  for (auto &BB : F.GetBasicBlocks())
+    for (auto &I : BB->GetInstructions()) {
+      std::vector<Value *> Uses = {I->Get1stUse(), I->Get2ndUse(),
+                                   I->Get3rdUse()};
+      if (I->IsCall())
+        Uses = ((CallInstruction *)I.get())->GetArgs();
+
+      for (auto Use : Uses)
+        if (Use)
+          Users[Use].push_back(I.get());
+    }
+
+  return Users;
+}
+
+template <typename T, typename... Args>
+T *LoopStrengthReductionPass::Insert(BasicBlock *BB, Instruction *Position,
+                                     Args &&...Arguments) {
+  auto I = std::make_unique<T>(std::forward<Args>(Arguments)..., BB);
+  auto InstPtr = I.get();
+
+  if (I->IsDef())
+    I->SetID(NextID++);
+
+  if (I->IsStackAllocation())
+    BB->InsertSA(std::move(I));
+  else if (Position)
+    BB->InsertBefore(std::move(I), Position);
+  else
+    BB->Insert(std::move(I));
+
+  return InstPtr;
+}
+
+bool LoopStrengthReductionPass::RunOnLoop(Function &F, LoopAnalysis &LA,
+                                          Loop *L) {
+  auto Preheader = L->GetPreheader();
+  auto Latch = L->GetLatch();
+  if (!Preheader || !Latch || L->GetInductionVariables().empty())
+    return false;
+
+  // The new instructions are inserted before the jumps of these blocks
+  auto PreheaderEnd = GetTerminator(Preheader);
+  auto LatchEnd = dynamic_cast<JumpInstruction *>(GetTerminator(Latch));
+  if ((PreheaderEnd && !PreheaderEnd->IsJump()) || !LatchEnd)
+    return false;
+
+  std::vector<AddressGroup> Groups;
+  for (auto &BB : F.GetBasicBlocks()) {
+    if (!L->Contains(BB.get()))
+      continue;
+
+    for (auto &I : BB->GetInstructions()) {
+      auto GEP = dynamic_cast<GetElementPointerInstruction *>(I.get());
+      if (!GEP)
+        continue;
+
+      // The index must be the value of the variable in the current iteration
+      auto Index = dynamic_cast<LoadInstruction *>(GEP->GetIndex());
+      if (!Index || Index->Get2ndUse() ||
+          GetPosition(BB.get(), Index) >= GetPosition(BB.get(), GEP))
+        continue;
+
+      // The pointer is advanced by the constant added to the variable
+      auto IV = L->GetInductionVariable(Index->GetMemoryLocation());
+      if (!IV || IV->Step < 0 ||
+          ((Instruction *)IV->Update->GetSavedValue())->GetInstructionKind() !=
+              Instruction::ADD ||
+          (BB.get() == Latch &&
+           GetPosition(Latch, GEP) > GetPosition(Latch, IV->Update)))
+        continue;
+
+      // Advancing the pointer by the step must add the same amount as
+      // incrementing the index
+      auto Source = GEP->GetSource();
+      auto ResultType = GEP->GetType();
+      if (!LA.IsLoopInvariant(L, Source) || Source->GetTypeRef().IsStruct() ||
+          !ResultType.IsScalar() || ResultType.GetPointerLevel() != 1 ||
+          ResultType.IsArray() ||
+          Source->GetTypeRef().CalcElemSize(0) != ResultType.CalcElemSize(0))
+        continue;
+
+      Value *Base = Source;
+      if (auto Load = dynamic_cast<LoadInstruction *>(Source))
+        Base = Load->GetMemoryLocation();
+
+      AddressGroup *Group = nullptr;
+      for (auto &G : Groups)
+        if (G.IV == IV && G.Base == Base)
+          Group = &G;
+
+      if (!Group) {
+        Groups.push_back({IV, Base, {}});
+        Group = &Groups.back();
+      }
+
+      Group->GEPs.push_back({BB.get(), GEP});
+    }
+  }
+
+  if (Groups.empty())
+    return false;
+
+  NextID = GetNextID(F);
+
+  auto Entry = F.GetBasicBlocks()[0].get();
+  auto Header = L->GetHeader();
+  std::set<InductionVariable *> ReducedIVs;
+  std::string Name;
+
+  for (auto &Group : Groups) {
+    auto IV = Group.IV;
+    auto PtrType = Group.GEPs[0].second->GetType();
+    auto PtrSlot =
+        Insert<StackAllocationInstruction>(Entry, nullptr, Name, PtrType);
+
+    // Set the pointer to the address of the first accessed element
+    Value *Base = Group.Base;
+    if (Group.GEPs[0].second->GetSource() != Base)
+      Base = Insert<LoadInstruction>(Preheader, PreheaderEnd, Base->GetType(),
+                                     Base);
+
+    auto Index = Insert<LoadInstruction>(Preheader, PreheaderEnd,
+                                         IV->Slot->GetType(), IV->Slot);
+    auto First = Insert<GetElementPointerInstruction>(Preheader, PreheaderEnd,
+                                                      PtrType, Base, Index);
+    Insert<StoreInstruction>(Preheader, PreheaderEnd, First, PtrSlot);
+
+    // Advance it at the end of each iteration
+    auto Ptr = Insert<LoadInstruction>(Latch, LatchEnd, PtrSlot->GetType(),
+                                       PtrSlot);
+    auto Step = ((Instruction *)IV->Update->GetSavedValue())->Get2ndUse();
+    auto Next = Insert<GetElementPointerInstruction>(Latch, LatchEnd, PtrType,
+                                                     Ptr, Step);
+    Insert<StoreInstruction>(Latch, LatchEnd, Next, PtrSlot);
+
+    for (auto &[BB, GEP] : Group.GEPs) {
+      auto Load =
+          Insert<LoadInstruction>(BB, GEP, PtrSlot->GetType(), PtrSlot);
+      ReplaceAllUses(F, GEP, Load);
+      Erase(BB, GEP);
+    }
+
+    // Rewrite the exit test only once for each variable
+    auto Cmp = L->GetExitCondition();
+    if (!Cmp || ReducedIVs.count(IV) != 0 || !IV->Slot->GetTypeRef().IsSInt())
+      continue;
+
+    auto Counter = dynamic_cast<LoadInstruction *>(Cmp->GetLHS());
+    auto Bound = Cmp->GetRHS();
+    if (!Counter || Counter->GetMemoryLocation() != IV->Slot ||
+        GetPosition(Header, Counter) == Header->GetInstructions().size() ||
+        !LA.IsLoopInvariant(L, Bound) ||
+        !(Bound->IsConstant() || dynamic_cast<LoadInstruction *>(Bound)))
+      continue;
+
+    // The variable must be initialized in the preheader and must not be read
+    // anywhere else than in the exit test, in its own update or in the
+    // preheader after the initialization
+    auto Update = dynamic_cast<Instruction *>(IV->Update->GetSavedValue());
+    size_t InitPosition = 0;
+    bool Initialized = false;
+    auto &PreheaderInstructions = Preheader->GetInstructions();
+    for (size_t i = 0; i < PreheaderInstructions.size(); i++)
+      if (PreheaderInstructions[i]->IsStore() &&
+          PreheaderInstructions[i]->Get2ndUse() == IV->Slot) {
+        InitPosition = i;
+        Initialized = true;
+      }
+
+    auto Users = GetUsers(F);
+    bool OnlyUsedByExitTest = Initialized && Users[Update].size() == 1;
+    for (auto &BB : F.GetBasicBlocks())
+      for (auto &I : BB->GetInstructions()) {
+        if (!I->IsLoad() || I->Get1stUse() != IV->Slot ||
+            (BB.get() == Preheader &&
+             GetPosition(Preheader, I.get()) > InitPosition))
+          continue;
+
+        for (auto User : Users[I.get()])
+          if (User != Cmp && User != Update)
+            OnlyUsedByExitTest = false;
+      }
+
+    if (!OnlyUsedByExitTest)
+      continue;
+
+    auto EndSlot =
+        Insert<StackAllocationInstruction>(Entry, nullptr, Name, PtrType);
+    if (auto BoundLoad = dynamic_cast<LoadInstruction *>(Bound)) {
+      auto BoundSlot = BoundLoad->GetMemoryLocation();
+      Bound = Insert<LoadInstruction>(Preheader, PreheaderEnd,
+                                      BoundSlot->GetType(), BoundSlot);
+    }
+
+    auto End = Insert<GetElementPointerInstruction>(Preheader, PreheaderEnd,
+                                                    PtrType, Base, Bound);
+    Insert<StoreInstruction>(Preheader, PreheaderEnd, End, EndSlot);
+
+    auto CurrentPtr =
+        Insert<LoadInstruction>(Header, Cmp, PtrSlot->GetType(), PtrSlot);
+    auto EndPtr =
+        Insert<LoadInstruction>(Header, Cmp, EndSlot->GetType(), EndSlot);
+    Cmp->Set1stUse(CurrentPtr);
+    Cmp->Set2ndUse(EndPtr);
+
+    // The variable is not needed in the loop anymore
+    Erase(Latch, IV->Update);
+    Erase(Latch, Update);
+    ReducedIVs.insert(IV);
+  }
+
+  return true;
+}
+
+bool LoopStrengthReductionPass::RunOnFunction(Function &F) {
+  if (F.GetBasicBlocks().empty())
+    return false;
+
+  // The analysis is recomputed after each transformed loop, since the
+  // transformation changes the induction variables of the enclosing loops
+  bool Changed = false;
+  for (bool LoopChanged = true; LoopChanged;) {
+    LoopChanged = false;
+    LoopAnalysis LA(F);
+
+    for (auto L : LA.GetLoops())
+      if (RunOnLoop(F, LA, L)) {
+        LoopChanged = Changed = true;
+        break;
+      }
+  }
+
+  return Changed;
+}
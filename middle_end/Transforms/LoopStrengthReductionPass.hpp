@@ -0,0 +1,41 @@
+#ifndef LOOP_STRENGTH_REDUCTION_PASS_HPP
+#define LOOP_STRENGTH_REDUCTION_PASS_HPP
+
+#include "FunctionPass.hpp"
+#include "LoopAnalysis.hpp"
+
+/// Replace the addresses computed from an induction variable in each
+/// iteration with a pointer induction variable. For example
+///
+/// .loop_header0:
+/// 	ld	$6<i32>, [$5<*i32>]
+/// 	cmp.ge	$7<i1>, $6<i32>, 10<u32>
+/// 	br	$7<i1>, <loop_end0>
+/// .loop_body0:
+/// 	ld	$8<i32>, [$5<*i32>]
+/// 	ld	$9<*i32>, [$0<**i32>]
+/// 	gep	$10<*i32>, $9<*i32>, $8<i32>
+/// 	...
+///
+/// becomes a load of a new local variable, which is set to the address of the
+/// first element in the preheader and advanced by the step of the induction
+/// variable at the end of each iteration. If the original variable was only
+/// needed for the exit test, then the test is rewritten to compare the pointer
+/// against the address of the last element precomputed in the preheader, and
+/// the update of the variable is deleted.
+class LoopStrengthReductionPass : public FunctionPass {
+public:
+  bool RunOnFunction(Function &F) override;
+
+private:
+  bool RunOnLoop(Function &F, LoopAnalysis &LA, Loop *L);
+
+  /// Create an instruction with a new ID and insert it before @Position, or
+  /// to the end of @BB if @Position is nullptr.
+  template <typename T, typename... Args>
+  T *Insert(BasicBlock *BB, Instruction *Position, Args &&...Arguments);
+
+  unsigned NextID = 0;
+};
+
+#endif // LOOP_STRENGTH_REDUCTION_PASS_HPP
@@ -0,0 +1,176 @@
+#include "LoopUnrollPass.hpp"
+#include "../IR/Function.hpp"
+#include "Util.hpp"
+#include <algorithm>
+#include <iterator>
+
+void LoopUnrollPass::FullyUnroll(Function &F, Loop *L, size_t Begin,
+                                 size_t End, uint64_t TripCount) {
+  auto &Blocks = F.GetBasicBlocks();
+  auto Header = L->GetHeader();
+  auto Exit = ((BranchInstruction *)GetControlFlow(Header))->GetTrueTarget();
+
+  std::vector<std::unique_ptr<BasicBlock>> Copies;
+  std::vector<BasicBlock *> Headers;
+  std::vector<BasicBlock *> Latches;
+
+  for (uint64_t k = 0; k < TripCount; k++) {
+    BlockMap Map;
+    auto Copy = CloneBlocks(F, Begin, End, "_unroll" + std::to_string(k), Map,
+                            NextID);
+
+    // Every iteration passes the exit test
+    Map[Header]->GetInstructions().pop_back();
+    Headers.push_back(Map[Header]);
+    Latches.push_back(Map[L->GetLatch()]);
+
+    std::move(Copy.begin(), Copy.end(), std::back_inserter(Copies));
+  }
+
+  // Each iteration continues in the next one, the last one leaves the loop
+  for (size_t k = 0; k < Latches.size(); k++) {
+    auto Jump = (JumpInstruction *)Latches[k]->GetInstructions().back().get();
+    Jump->SetTargetBB(k + 1 < Headers.size() ? Headers[k + 1] : Exit);
+  }
+
+  auto PreheaderJump = (JumpInstruction *)GetControlFlow(L->GetPreheader());
+  PreheaderJump->SetTargetBB(Headers.empty() ? Exit : Headers[0]);
+
+  const size_t NewEnd = Begin + Copies.size();
+  Blocks.erase(Blocks.begin() + Begin, Blocks.begin() + End);
+  Blocks.insert(Blocks.begin() + Begin, std::make_move_iterator(Copies.begin()),
+                std::make_move_iterator(Copies.end()));
+
+  MergeBlocks(F, Begin, NewEnd);
+}
+
+bool LoopUnrollPass::PartiallyUnroll(Function &F, Loop *L, size_t Begin,
+                                     size_t End, unsigned Count) {
+  auto &Blocks = F.GetBasicBlocks();
+  auto Header = L->GetHeader();
+  auto Preheader = L->GetPreheader();
+  auto Cmp = L->GetExitCondition();
+  bool NeedsGuard = false;
+  int64_t Limit = 0;
+  if (!CanTestAhead(L, Count, NeedsGuard, Limit))
+    return false;
+
+  // The unrolled loop is placed between the guard and the original loop
+  if (NeedsGuard && (Begin == 0 || Blocks[Begin - 1].get() != Preheader))
+    return false;
+
+  // The first copy tests the counter advanced by Count - 1 steps
+  const int64_t Step = L->GetCounter()->Step;
+  const unsigned BitWidth = Cmp->GetLHS()->GetBitWidth();
+  const int64_t Distance = (Count - 1) * (Step > 0 ? Step : -Step);
+
+  size_t CmpIndex = 0;
+  while (Header->GetInstructions()[CmpIndex].get() != Cmp)
+    CmpIndex++;
+
+  std::vector<std::unique_ptr<BasicBlock>> Copies;
+  std::vector<BasicBlock *> Headers;
+  std::vector<BasicBlock *> Latches;
+
+  for (unsigned k = 0; k < Count; k++) {
+    BlockMap Map;
+    auto Copy = CloneBlocks(F, Begin, End, "_unroll" + std::to_string(k), Map,
+                            NextID);
+    auto HeaderCopy = Map[Header];
+
+    if (k == 0) {
+      // Continue in the original loop if the last copy would leave the loop
+      auto CmpCopy = HeaderCopy->GetInstructions()[CmpIndex].get();
+      auto Last = std::make_unique<BinaryInstruction>(
+          Step > 0 ? Instruction::ADD : Instruction::SUB, CmpCopy->Get1stUse(),
+          F.GetConstant(Distance, BitWidth), HeaderCopy);
+      Last->SetID(NextID++);
+      CmpCopy->Set1stUse(HeaderCopy->InsertBefore(std::move(Last), CmpCopy));
+
+      auto Br = (BranchInstruction *)HeaderCopy->GetInstructions().back().get();
+      Br->SetTrueTarget(Header);
+    } else
+      HeaderCopy->GetInstructions().pop_back();
+
+    Headers.push_back(HeaderCopy);
+    Latches.push_back(Map[L->GetLatch()]);
+    std::move(Copy.begin(), Copy.end(), std::back_inserter(Copies));
+  }
+
+  for (size_t k = 0; k < Latches.size(); k++) {
+    auto Jump = (JumpInstruction *)Latches[k]->GetInstructions().back().get();
+    Jump->SetTargetBB(Headers[(k + 1) % Headers.size()]);
+  }
+
+  auto &PreheaderInstructions = Preheader->GetInstructions();
+  if (NeedsGuard) {
+    // Skip the unrolled loop if the counter could overflow in its exit test,
+    // otherwise fall through into it
+    InsertGuard(F, L, Preheader, PreheaderInstructions.back().get(), Limit,
+                NextID);
+    PreheaderInstructions.pop_back();
+  } else
+    ((JumpInstruction *)PreheaderInstructions.back().get())
+        ->SetTargetBB(Headers[0]);
+
+  Unrolled.insert(Header);
+  Unrolled.insert(Headers[0]);
+
+  const size_t NewEnd = Begin + Copies.size();
+  Blocks.insert(Blocks.begin() + Begin, std::make_move_iterator(Copies.begin()),
+                std::make_move_iterator(Copies.end()));
+
+  MergeBlocks(F, Begin, NewEnd);
+  return true;
+}
+
+bool LoopUnrollPass::RunOnLoop(Function &F, Loop *L) {
+  size_t Begin = 0;
+  size_t End = 0;
+  if (Unrolled.count(L->GetHeader()) != 0 || !GetLoopRange(F, L, Begin, End))
+    return false;
+
+  // The copies execute the header once less than the loop, so it must only
+  // decide whether to leave the loop
+  for (auto &I : L->GetHeader()->GetInstructions())
+    if (I->IsStore() || I->IsCall() ||
+        I->GetInstructionKind() == Instruction::MEM_COPY)
+      return false;
+
+  size_t Size = 0;
+  for (auto BB : L->GetBlocks())
+    Size += BB->GetInstructions().size();
+
+  NextID = GetNextID(F);
+
+  auto TripCount = L->GetTripCount();
+  if (TripCount && *TripCount <= SizeBudget / Size) {
+    FullyUnroll(F, L, Begin, End, *TripCount);
+    return true;
+  }
+
+  const unsigned Count = std::min<size_t>(Factor, SizeBudget / Size);
+  return Count >= 2 && PartiallyUnroll(F, L, Begin, End, Count);
+}
+
+bool LoopUnrollPass::RunOnFunction(Function &F) {
+  if (F.GetBasicBlocks().empty())
+    return false;
+
+  // The analysis is recomputed after each unrolled loop, since the unrolling
+  // changes the blocks of the enclosing loops
+  bool Changed = false;
+  for (bool LoopChanged = true; LoopChanged;) {
+    LoopChanged = false;
+    LoopAnalysis LA(F);
+
+    for (auto L : LA.GetLoops())
+      if (RunOnLoop(F, L)) {
+        LoopChanged = Changed = true;
+        break;
+      }
+  }
+
+  Unrolled.clear();
+  return Changed;
+}
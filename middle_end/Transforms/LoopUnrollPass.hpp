@@ -0,0 +1,55 @@
+#ifndef LOOP_UNROLL_PASS_HPP
+#define LOOP_UNROLL_PASS_HPP
+
+#include "FunctionPass.hpp"
+#include "LoopAnalysis.hpp"
+#include <map>
+#include <set>
+#include <string>
+
+/// Unroll the innermost counted loops. If the trip count is a known constant
+/// and the unrolled loop fits into the size budget, then the loop is replaced
+/// with that many copies of its body, without the exit tests. For example
+///
+/// .loop_header0:
+/// 	ld	$5<i32>, [$1<*i32>]
+/// 	cmp.ge	$6<i1>, $5<i32>, 4<u32>
+/// 	br	$6<i1>, <loop_end0>
+/// .loop_body0:
+/// 	...
+/// .loop_increment0:
+/// 	...
+/// 	j	<loop_header0>
+///
+/// becomes four copies of the header, body and increment blocks, which are
+/// merged into a single block. Otherwise the loop is unrolled by the factor:
+/// the copies of the body are placed before the loop and the test in the first
+/// copy checks if the counter still passes the exit test after factor - 1
+/// steps. When it does not, the remaining iterations are executed by the
+/// original loop.
+class LoopUnrollPass : public FunctionPass {
+public:
+  explicit LoopUnrollPass(unsigned Factor = 4) : Factor(Factor) {}
+
+  bool RunOnFunction(Function &F) override;
+
+private:
+  using BlockMap = std::map<BasicBlock *, BasicBlock *>;
+
+  bool RunOnLoop(Function &F, Loop *L);
+  void FullyUnroll(Function &F, Loop *L, size_t Begin, size_t End,
+                   uint64_t TripCount);
+  bool PartiallyUnroll(Function &F, Loop *L, size_t Begin, size_t End,
+                       unsigned Count);
+
+  /// The maximum number of instructions in an unrolled loop.
+  static constexpr size_t SizeBudget = 200;
+
+  unsigned Factor;
+  unsigned NextID = 0;
+  /// The headers of the loops created by the partial unrolling, these must
+  /// not be unrolled again.
+  std::set<BasicBlock *> Unrolled;
+};
+
+#endif // LOOP_UNROLL_PASS_HPP
@@ -0,0 +1,522 @@
+#include "LoopVectorizePass.hpp"
+#include "../IR/Function.hpp"
+#include "Util.hpp"
+#include <iterator>
+#include <tuple>
+
+/// Return true if @V is a 32 bit scalar, which can be a lane of a vector.
+static bool IsLaneType(Value *V) {
+  auto &Type = V->GetTypeRef();
+  return Type.IsScalar() && !Type.IsPTR() && !Type.IsArray() &&
+         !Type.IsVector() && Type.GetBitSize() == 32;
+}
+
+/// Return the address of the 32 bit elements of an array, which is a parameter,
+/// a global array or a local variable, or nullptr.
+static Value *GetArrayBase(GetElementPointerInstruction *GEP) {
+  auto Type = GEP->GetType();
+  auto Source = GEP->GetSource();
+  if (Type.GetPointerLevel() != 1 || Type.IsArray() ||
+      Source->GetTypeRef().IsStruct())
+    return nullptr;
+
+  Type.DecrementPointerLevel();
+  if (!Type.IsScalar() || Type.GetBitSize() != 32)
+    return nullptr;
+
+  if (Source->IsParameter())
+    return Source;
+
+  if (Source->IsGlobalVar())
+    return Source->GetTypeRef().IsArray() ? Source : nullptr;
+
+  auto Load = dynamic_cast<LoadInstruction *>(Source);
+  if (Load && !Load->Get2ndUse() &&
+      dynamic_cast<StackAllocationInstruction *>(Load->GetMemoryLocation()))
+    return Load->GetMemoryLocation();
+
+  return nullptr;
+}
+
+static unsigned CountUses(Function &F, size_t Begin, size_t End, Value *V) {
+  auto &Blocks = F.GetBasicBlocks();
+  unsigned Count = 0;
+
+  for (size_t i = Begin; i < End; i++)
+    for (auto &I : Blocks[i]->GetInstructions()) {
+      std::vector<Value *> Uses = {I->Get1stUse(), I->Get2ndUse(),
+                                   I->Get3rdUse()};
+      if (I->IsCall())
+        Uses = ((CallInstruction *)I.get())->GetArgs();
+
+      for (auto Use : Uses)
+        if (Use == V)
+          Count++;
+    }
+
+  return Count;
+}
+
+template <typename T, typename... Args>
+T *LoopVectorizePass::Insert(BasicBlock *BB, Instruction *Position,
+                             Args &&...Arguments) {
+  auto I = std::make_unique<T>(std::forward<Args>(Arguments)..., BB);
+  auto InstPtr = I.get();
+
+  if (I->IsDef())
+    I->SetID(NextID++);
+
+  if (Position)
+    BB->InsertBefore(std::move(I), Position);
+  else
+    BB->Insert(std::move(I));
+
+  return InstPtr;
+}
+
+LoopVectorizePass::Shape LoopVectorizePass::GetShape(Value *V) {
+  if (Shapes.count(V) != 0)
+    return Shapes[V];
+
+  if (V->IsConstant() || V->IsParameter() || V->IsGlobalVar())
+    return UNIFORM;
+
+  return UNKNOWN;
+}
+
+bool LoopVectorizePass::Classify(Function &F, LoopAnalysis &LA, Loop *L,
+                                 size_t Begin, size_t End) {
+  auto &Blocks = F.GetBasicBlocks();
+  auto Header = L->GetHeader();
+  auto Cmp = L->GetExitCondition();
+  auto IV = L->GetCounter();
+  auto UpdateValue = IV->Update->GetSavedValue();
+
+  Shapes.clear();
+  Arrays.clear();
+  ArrayOf.clear();
+  ReductionSlots.clear();
+  ReductionAdds.clear();
+
+  // Find the local variables, which are only loaded to be added to and then
+  // stored back
+  for (size_t i = Begin; i < End; i++)
+    for (auto &I : Blocks[i]->GetInstructions()) {
+      auto Store = dynamic_cast<StoreInstruction *>(I.get());
+      if (!Store)
+        continue;
+
+      auto Slot = Store->GetMemoryLocation();
+      auto Add = dynamic_cast<BinaryInstruction *>(Store->GetSavedValue());
+      if (Slot == IV->Slot ||
+          !dynamic_cast<StackAllocationInstruction *>(Slot) ||
+          LA.IsAddressTaken(Slot) || LA.CountStores(L, Slot) != 1 || !Add ||
+          Add->GetInstructionKind() != Instruction::ADD || !Add->IsIntType() ||
+          !IsLaneType(Add))
+        continue;
+
+      Value *Accumulator = nullptr;
+      unsigned Loads = 0;
+      for (size_t j = Begin; j < End; j++)
+        for (auto &J : Blocks[j]->GetInstructions())
+          if (J->IsLoad() && J->Get1stUse() == Slot) {
+            Accumulator = J.get();
+            Loads++;
+          }
+
+      if (Loads != 1 ||
+          (Add->GetLHS() != Accumulator && Add->GetRHS() != Accumulator) ||
+          CountUses(F, Begin, End, Accumulator) != 1 ||
+          CountUses(F, Begin, End, Add) != 1)
+        continue;
+
+      ReductionSlots.insert(Slot);
+      ReductionAdds.insert(Add);
+    }
+
+  bool Updated = false;
+  bool LoadsGlobals = false;
+  for (size_t i = Begin; i < End; i++) {
+    auto BB = Blocks[i].get();
+
+    for (auto &Ptr : BB->GetInstructions()) {
+      auto I = Ptr.get();
+      auto Kind = I->GetInstructionKind();
+      auto S = UNKNOWN;
+
+      // The header is executed once more than the body, so it must only
+      // decide whether to leave the loop
+      if (BB == Header && I->IsStore())
+        return false;
+
+      if (I == IV->Update) {
+        Updated = true;
+        continue;
+      }
+
+      if (I == UpdateValue || I->IsJump() ||
+          I == Header->GetInstructions().back().get())
+        continue;
+
+      if (I == Cmp) {
+        if (GetShape(Cmp->GetLHS()) != INDEX ||
+            GetShape(Cmp->GetRHS()) != UNIFORM)
+          return false;
+        continue;
+      }
+
+      if (auto Store = dynamic_cast<StoreInstruction *>(I)) {
+        auto Address = Store->GetMemoryLocation();
+        auto Saved = Store->GetSavedValue();
+        auto SavedShape = GetShape(Saved);
+
+        if (ReductionSlots.count(Address) != 0) {
+          if (SavedShape != REDUCTION)
+            return false;
+        } else if (GetShape(Address) == POINTER &&
+                   (SavedShape == VECTOR ||
+                    (SavedShape == UNIFORM && IsLaneType(Saved))))
+          Arrays[ArrayOf[Address]].Stored = true;
+        else
+          return false;
+
+        continue;
+      }
+
+      if (auto Load = dynamic_cast<LoadInstruction *>(I)) {
+        auto Address = Load->GetMemoryLocation();
+        auto Slot = dynamic_cast<StackAllocationInstruction *>(Address);
+
+        if (Load->Get2ndUse())
+          S = UNKNOWN;
+        else if (Address == IV->Slot)
+          S = Updated ? UNKNOWN : INDEX;
+        else if (ReductionSlots.count(Address) != 0)
+          S = ACCUMULATOR;
+        else if (Slot && !LA.IsAddressTaken(Slot) &&
+                 LA.CountStores(L, Slot) == 0)
+          S = UNIFORM;
+        else if (Address->IsGlobalVar() && !Address->GetTypeRef().IsArray() &&
+                 !Address->GetTypeRef().IsStruct()) {
+          S = UNIFORM;
+          LoadsGlobals = true;
+        } else if (GetShape(Address) == POINTER && IsLaneType(Load))
+          S = VECTOR;
+      } else if (auto Unary = dynamic_cast<UnaryInstruction *>(I)) {
+        auto OperandShape = GetShape(Unary->GetOperand());
+
+        // The counter does not overflow in the copy, so the lanes of the
+        // extended counter are still consecutive
+        if (OperandShape == UNIFORM)
+          S = UNIFORM;
+        else if (OperandShape == INDEX && Kind == Instruction::SEXT)
+          S = INDEX;
+      } else if (auto GEP = dynamic_cast<GetElementPointerInstruction *>(I)) {
+        auto SourceShape = GetShape(GEP->GetSource());
+        auto IndexShape = GetShape(GEP->GetIndex());
+        auto Base = GetArrayBase(GEP);
+
+        if (SourceShape == UNIFORM && IndexShape == UNIFORM)
+          S = UNIFORM;
+        else if (SourceShape == UNIFORM && IndexShape == INDEX && Base) {
+          size_t Index = 0;
+          while (Index < Arrays.size() && Arrays[Index].Base != Base)
+            Index++;
+
+          if (Index == Arrays.size())
+            Arrays.push_back({Base, GEP->GetType()});
+
+          ArrayOf[GEP] = Index;
+          S = POINTER;
+        }
+      } else if (auto Binary = dynamic_cast<BinaryInstruction *>(I)) {
+        auto LHS = Binary->GetLHS();
+        auto RHS = Binary->GetRHS();
+        auto LHSShape = GetShape(LHS);
+        auto RHSShape = GetShape(RHS);
+        auto IsLane = [&](Value *V, Shape VS) {
+          return (VS == VECTOR || VS == UNIFORM) && IsLaneType(V);
+        };
+
+        const bool Vectorizable =
+            Kind == Instruction::ADD || Kind == Instruction::SUB ||
+            Kind == Instruction::MUL || Kind == Instruction::AND ||
+            Kind == Instruction::OR || Kind == Instruction::XOR ||
+            Kind == Instruction::ADDF || Kind == Instruction::SUBF ||
+            Kind == Instruction::MULF || Kind == Instruction::DIVF;
+
+        if (LHSShape == UNIFORM && RHSShape == UNIFORM)
+          S = UNIFORM;
+        else if (ReductionAdds.count(Binary) != 0) {
+          if ((LHSShape == ACCUMULATOR && RHSShape == VECTOR &&
+               IsLaneType(RHS)) ||
+              (LHSShape == VECTOR && RHSShape == ACCUMULATOR &&
+               IsLaneType(LHS)))
+            S = REDUCTION;
+        } else if (Vectorizable && IsLaneType(Binary) &&
+                   IsLane(LHS, LHSShape) && IsLane(RHS, RHSShape) &&
+                   (LHSShape == VECTOR || RHSShape == VECTOR))
+          S = VECTOR;
+      } else if (auto Compare = dynamic_cast<CompareInstruction *>(I)) {
+        auto LHS = Compare->GetLHS();
+        auto RHS = Compare->GetRHS();
+        auto LHSShape = GetShape(LHS);
+        auto RHSShape = GetShape(RHS);
+        auto Relation = Compare->GetRelation();
+
+        // The lanes are compared as signed integers
+        auto IsLane = [&](Value *V, Shape VS) {
+          return (VS == VECTOR || VS == UNIFORM) && IsLaneType(V) &&
+                 V->IsIntType() &&
+                 (Relation == CompareInstruction::EQ || V->IsConstant() ||
+                  V->GetTypeRef().IsSInt());
+        };
+
+        if (LHSShape == UNIFORM && RHSShape == UNIFORM)
+          S = UNIFORM;
+        else if (Kind == Instruction::CMP &&
+                 Relation != CompareInstruction::NE && IsLane(LHS, LHSShape) &&
+                 IsLane(RHS, RHSShape) &&
+                 (LHSShape == VECTOR || RHSShape == VECTOR))
+          S = VECTOR;
+      }
+
+      if (S == UNKNOWN || (BB == Header && S != UNIFORM && S != INDEX))
+        return false;
+
+      Shapes[I] = S;
+    }
+  }
+
+  // The global variables are only known to be unchanged, if the loop stores
+  // to global arrays only
+  if (LoadsGlobals)
+    for (auto &A : Arrays)
+      if (A.Stored && !A.Base->IsGlobalVar())
+        return false;
+
+  return true;
+}
+
+BranchInstruction *LoopVectorizePass::InsertAliasCheck(
+    Function &F, Array &A, Array &B, BasicBlock *Fallback,
+    std::vector<std::unique_ptr<BasicBlock>> &Blocks) {
+  auto GetAddress = [&](Array &Arr, BasicBlock *BB, unsigned Index) {
+    Value *Base = Arr.Base;
+    if (auto Slot = dynamic_cast<StackAllocationInstruction *>(Base))
+      Base = Insert<LoadInstruction>(BB, nullptr, Slot->GetType(), Slot);
+
+    if (Index == 0 && !Base->IsGlobalVar())
+      return Base;
+
+    return (Value *)Insert<GetElementPointerInstruction>(
+        BB, nullptr, Arr.ElemPtrType, Base, F.GetConstant(Index));
+  };
+
+  const auto Name = Fallback->GetName() + "_vec_check" +
+                    std::to_string(Blocks.size());
+  auto Before = std::make_unique<BasicBlock>(Name, &F);
+  auto After = std::make_unique<BasicBlock>(Name + "_", &F);
+
+  // Either the lanes of A end before B, or the lanes of B end before A
+  auto BeforeCmp = Insert<CompareInstruction>(
+      Before.get(), nullptr, GetAddress(A, Before.get(), 0),
+      GetAddress(B, Before.get(), VF), CompareInstruction::GE);
+  auto Skip = Insert<BranchInstruction>(Before.get(), nullptr, BeforeCmp,
+                                        Fallback, nullptr);
+
+  auto AfterCmp = Insert<CompareInstruction>(
+      After.get(), nullptr, GetAddress(B, After.get(), 0),
+      GetAddress(A, After.get(), VF), CompareInstruction::LT);
+  Insert<BranchInstruction>(After.get(), nullptr, AfterCmp, Fallback, nullptr);
+
+  Blocks.push_back(std::move(Before));
+  Blocks.push_back(std::move(After));
+  return Skip;
+}
+
+bool LoopVectorizePass::RunOnLoop(Function &F, LoopAnalysis &LA, Loop *L) {
+  auto &Blocks = F.GetBasicBlocks();
+  auto Header = L->GetHeader();
+  size_t Begin = 0;
+  size_t End = 0;
+  if (Vectorized.count(Header) != 0 || !GetLoopRange(F, L, Begin, End))
+    return false;
+
+  auto IV = L->GetCounter();
+  bool NeedsGuard = false;
+  int64_t Limit = 0;
+  auto TripCount = L->GetTripCount();
+  if (!IV || IV->Step != 1 || LA.IsAddressTaken(IV->Slot) ||
+      (TripCount && *TripCount < VF) ||
+      !CanTestAhead(L, VF, NeedsGuard, Limit))
+    return false;
+
+  auto UpdateValue = dynamic_cast<BinaryInstruction *>(
+      IV->Update->GetSavedValue());
+  if (!UpdateValue || UpdateValue->GetInstructionKind() != Instruction::ADD)
+    return false;
+
+  // Each iteration executes every block of the loop
+  for (size_t i = Begin + 1; i < End; i++) {
+    auto Jump = GetControlFlow(Blocks[i].get());
+    auto Next = i + 1 < End ? Blocks[i + 1].get() : Header;
+    if (!Jump || !Jump->IsJump() ||
+        Jump != Blocks[i]->GetInstructions().back().get() ||
+        ((JumpInstruction *)Jump)->GetTargetBB() != Next)
+      return false;
+  }
+
+  if (!Classify(F, LA, L, Begin, End))
+    return false;
+
+  // The arrays written by the loop must not overlap with the other arrays
+  // within the lanes. Distinct global arrays never overlap.
+  std::vector<std::pair<size_t, size_t>> AliasChecks;
+  for (size_t a = 0; a < Arrays.size(); a++)
+    for (size_t b = a + 1; b < Arrays.size(); b++)
+      if ((Arrays[a].Stored || Arrays[b].Stored) &&
+          !(Arrays[a].Base->IsGlobalVar() && Arrays[b].Base->IsGlobalVar()))
+        AliasChecks.push_back({a, b});
+
+  if (AliasChecks.size() > MaxAliasChecks)
+    return false;
+
+  NextID = GetNextID(F);
+
+  std::map<BasicBlock *, BasicBlock *> Map;
+  auto Copies = CloneBlocks(F, Begin, End, "_vec", Map, NextID);
+
+  std::vector<std::tuple<Instruction *, Instruction *, BasicBlock *>> Pairs;
+  for (size_t i = Begin; i < End; i++) {
+    auto &Instructions = Blocks[i]->GetInstructions();
+    auto Copy = Map[Blocks[i].get()];
+
+    for (size_t j = 0; j < Instructions.size(); j++)
+      Pairs.push_back({Instructions[j].get(),
+                       Copy->GetInstructions()[j].get(), Copy});
+  }
+
+  // Widen the values of the copy, the uniform operands of the vectors are
+  // copied into each lane
+  std::map<Instruction *, Instruction *> CopyOf;
+  for (auto &[I, Copy, BB] : Pairs) {
+    CopyOf[I] = Copy;
+    auto S = GetShape(I);
+
+    std::vector<unsigned> SplattedUses;
+    if (S == VECTOR) {
+      auto LaneType = dynamic_cast<CompareInstruction *>(I)
+                          ? IRType::CreateInt()
+                          : I->GetType();
+      Copy->GetTypeRef() = IRType::CreateVector(LaneType, VF);
+
+      if (!I->IsLoad()) {
+        if (GetShape(I->Get1stUse()) == UNIFORM)
+          SplattedUses.push_back(1);
+        if (GetShape(I->Get2ndUse()) == UNIFORM)
+          SplattedUses.push_back(2);
+      }
+    } else if (I->IsStore() && GetShape(I->Get2ndUse()) == POINTER &&
+               GetShape(I->Get1stUse()) == UNIFORM)
+      SplattedUses.push_back(1);
+
+    for (auto Use : SplattedUses) {
+      auto Operand = Use == 1 ? Copy->Get1stUse() : Copy->Get2ndUse();
+      auto Splatted = Insert<UnaryInstruction>(
+          BB, Copy, Instruction::SPLAT,
+          IRType::CreateVector(Operand->GetType(), VF), Operand);
+
+      if (Use == 1)
+        Copy->Set1stUse(Splatted);
+      else
+        Copy->Set2ndUse(Splatted);
+    }
+
+    // Sum up the lanes before adding them to the accumulator
+    if (S == REDUCTION) {
+      const bool LHSIsVector = GetShape(I->Get1stUse()) == VECTOR;
+      auto Vector = LHSIsVector ? Copy->Get1stUse() : Copy->Get2ndUse();
+      auto Sum = Insert<UnaryInstruction>(BB, Copy, Instruction::REDUCE_ADD,
+                                          I->GetType(), Vector);
+
+      if (LHSIsVector)
+        Copy->Set1stUse(Sum);
+      else
+        Copy->Set2ndUse(Sum);
+    }
+  }
+
+  // The copy is left if the counter advanced by VF - 1 steps would leave the
+  // loop, then the original loop executes the remaining iterations
+  auto HeaderCopy = Map[Header];
+  auto Cmp = L->GetExitCondition();
+  auto CmpCopy = CopyOf[Cmp];
+  const unsigned BitWidth = Cmp->GetLHS()->GetBitWidth();
+  auto Last =
+      Insert<BinaryInstruction>(HeaderCopy, CmpCopy, Instruction::ADD,
+                                CmpCopy->Get1stUse(),
+                                F.GetConstant(VF - 1, BitWidth));
+  CmpCopy->Set1stUse(Last);
+  ((BranchInstruction *)HeaderCopy->GetInstructions().back().get())
+      ->SetTrueTarget(Header);
+
+  auto UpdateCopy = CopyOf[UpdateValue];
+  UpdateCopy->Set2ndUse(F.GetConstant(VF, UpdateCopy->GetBitWidth()));
+  ((JumpInstruction *)Map[L->GetLatch()]->GetInstructions().back().get())
+      ->SetTargetBB(HeaderCopy);
+
+  std::vector<std::unique_ptr<BasicBlock>> NewBlocks;
+  if (NeedsGuard) {
+    NewBlocks.push_back(
+        std::make_unique<BasicBlock>(Header->GetName() + "_vec_guard", &F));
+    InsertGuard(F, L, NewBlocks.back().get(), nullptr, Limit, NextID);
+  }
+
+  // Each check passing skips the next block, which checks the other order
+  std::vector<std::pair<BranchInstruction *, size_t>> Skips;
+  for (auto &[a, b] : AliasChecks) {
+    auto Skip = InsertAliasCheck(F, Arrays[a], Arrays[b], Header, NewBlocks);
+    Skips.push_back({Skip, NewBlocks.size()});
+  }
+
+  std::move(Copies.begin(), Copies.end(), std::back_inserter(NewBlocks));
+  for (auto &[Skip, Index] : Skips)
+    Skip->SetTrueTarget(NewBlocks[Index].get());
+
+  ((JumpInstruction *)GetControlFlow(L->GetPreheader()))
+      ->SetTargetBB(NewBlocks[0].get());
+
+  Vectorized.insert(Header);
+  Vectorized.insert(HeaderCopy);
+
+  const size_t NewEnd = Begin + NewBlocks.size();
+  Blocks.insert(Blocks.begin() + Begin,
+                std::make_move_iterator(NewBlocks.begin()),
+                std::make_move_iterator(NewBlocks.end()));
+
+  MergeBlocks(F, Begin > 0 ? Begin - 1 : 0, NewEnd);
+  return true;
+}
+
+bool LoopVectorizePass::RunOnFunction(Function &F) {
+  if (F.GetBasicBlocks().empty())
+    return false;
+
+  // The analysis is recomputed after each vectorized loop, since the new
+  // blocks change the enclosing loops
+  bool Changed = false;
+  for (bool LoopChanged = true; LoopChanged;) {
+    LoopChanged = false;
+    LoopAnalysis LA(F);
+
+    for (auto L : LA.GetLoops())
+      if (RunOnLoop(F, LA, L)) {
+        LoopChanged = Changed = true;
+        break;
+      }
+  }
+
+  Vectorized.clear();
+  return Changed;
+}
@@ -0,0 +1,97 @@
+#ifndef LOOP_VECTORIZE_PASS_HPP
+#define LOOP_VECTORIZE_PASS_HPP
+
+#include "FunctionPass.hpp"
+#include "LoopAnalysis.hpp"
+#include <map>
+#include <set>
+#include <vector>
+
+/// Vectorize the innermost counted loops, which access 32 bit elements of
+/// arrays at the counter. For example
+///
+/// .loop_body0:
+/// 	ld	$12<i32>, [$8<*i32>]
+/// 	ld	$13<*i32>, [$2<**i32>]
+/// 	gep	$14<*i32>, $13<*i32>, $12<i32>
+/// 	ld	$15<i32>, [$14<*i32>]
+/// 	...
+///
+/// is copied before the loop with the loaded and computed values widened to
+/// <4 x i32>, the loop invariant operands splatted into every lane and the
+/// counter advanced by 4. The copy is left when the counter advanced by 3 more
+/// steps would leave the loop, then the remaining iterations are executed by
+/// the original loop. The sums of array elements are accumulated by adding up
+/// the lanes in each iteration. If the arrays written by the loop might
+/// overlap with the other arrays accessed, then the copy is only entered if
+/// their addresses are at least 4 elements apart.
+class LoopVectorizePass : public FunctionPass {
+public:
+  bool RunOnFunction(Function &F) override;
+
+private:
+  /// How a value of the loop is computed in the vectorized copy.
+  enum Shape {
+    /// Not computed in the loop, or computed in a way it cannot be vectorized
+    UNKNOWN,
+    /// The same value in every lane, it stays scalar
+    UNIFORM,
+    /// The counter, which is the index of the first lane
+    INDEX,
+    /// The address of the element at the counter in an array
+    POINTER,
+    /// A different value in each lane
+    VECTOR,
+    /// A scalar variable summing up vectors
+    ACCUMULATOR,
+    /// The addition of a vector to an accumulator
+    REDUCTION,
+  };
+
+  /// An array accessed in the loop, identified by the parameter, the global
+  /// or the local variable holding its address.
+  struct Array {
+    Value *Base;
+    /// The type of the address of its elements
+    IRType ElemPtrType;
+    bool Stored = false;
+  };
+
+  bool RunOnLoop(Function &F, LoopAnalysis &LA, Loop *L);
+
+  /// Compute the shape of the values of @L in [@Begin, @End) and collect the
+  /// accessed arrays. Return false if the loop cannot be vectorized.
+  bool Classify(Function &F, LoopAnalysis &LA, Loop *L, size_t Begin,
+                size_t End);
+
+  Shape GetShape(Value *V);
+
+  /// Append two blocks to @Blocks, which jump to @Fallback if the arrays @A
+  /// and @B are closer than the number of lanes. The first block skips the
+  /// second one with the returned branch, its target is set by the caller.
+  BranchInstruction *
+  InsertAliasCheck(Function &F, Array &A, Array &B, BasicBlock *Fallback,
+                   std::vector<std::unique_ptr<BasicBlock>> &Blocks);
+
+  /// Create an instruction with a new ID and insert it before @Position, or
+  /// to the end of @BB if @Position is nullptr.
+  template <typename T, typename... Args>
+  T *Insert(BasicBlock *BB, Instruction *Position, Args &&...Arguments);
+
+  static constexpr unsigned VF = 4;
+  /// The maximum number of array pairs checked for overlapping.
+  static constexpr unsigned MaxAliasChecks = 6;
+
+  unsigned NextID = 0;
+  std::map<Value *, Shape> Shapes;
+  std::vector<Array> Arrays;
+  /// The array accessed through each address of POINTER shape
+  std::map<Value *, size_t> ArrayOf;
+  /// The local variables summing up vectors and the additions to them
+  std::set<Value *> ReductionSlots;
+  std::set<Value *> ReductionAdds;
+  /// The headers of the vectorized loops and their copies.
+  std::set<BasicBlock *> Vectorized;
+};
+
+#endif // LOOP_VECTORIZE_PASS_HPP
@@ -7,9 +7,51 @@ bool PassManager::RunAll() {
   auto CopyProp = std::make_unique<CopyPropagationPass>();
   auto ValNum = std::make_unique<ValueNumberingPass>();
   auto LoopHoist = std::make_unique<LoopHoistingPass>();
+  auto LSR = std::make_unique<LoopStrengthReductionPass>();
+  auto Unroll = std::make_unique<LoopUnrollPass>(UnrollFactor);
+  auto Vectorize = std::make_unique<LoopVectorizePass>();
+  auto Idiom = std::make_unique<LoopIdiomPass>();
+  auto BitIdiom = std::make_unique<BitIdiomPass>();
+  auto IfConvert = std::make_unique<IfConversionPass>();
   auto DCE = std::make_unique<DeadCodeEliminationPass>();
+  auto Placement = std::make_unique<BlockPlacementPass>();
+  auto SimplifyCFG = std::make_unique<SimplifyCFGPass>();
 
   for (auto &F : IRModule->GetFunctions()) {
+    // The blocks left behind by the lowering of the statements are cleaned
+    // up first, so the later passes see fewer and larger blocks
+    if (Optimizations.count(Optimization::SimplifyCFG) != 0)
+      SimplifyCFG->RunOnFunction(F);
+
+    // Vectorizing and unrolling first, so the copies of the loop body are
+    // optimized together. The exit tests dropped from the copies leave dead
+    // computations behind. The scalar loop left after the vectorized one is
+    // not unrolled, since it has no preheader anymore. The loops replaced by
+    // library calls are recognized before they are transformed.
+    const bool IdiomChanged =
+        Optimizations.count(Optimization::LoopIdiom) != 0 &&
+        Idiom->RunOnFunction(F);
+    const bool VectorizeChanged =
+        Optimizations.count(Optimization::LoopVectorize) != 0 &&
+        Vectorize->RunOnFunction(F);
+    const bool UnrollChanged =
+        Optimizations.count(Optimization::LoopUnroll) != 0 &&
+        Unroll->RunOnFunction(F);
+
+    if (IdiomChanged || VectorizeChanged || UnrollChanged) {
+      size_t InstNumAtStart;
+
+      do {
+        InstNumAtStart = F.GetNumberOfInstructions();
+        DCE->RunOnFunction(F);
+      } while (InstNumAtStart != F.GetNumberOfInstructions());
+    }
+
+    // The selects are formed before the copy propagation, so the loads of
+    // the converted blocks are merged with the ones of the block before them
+    if (Optimizations.count(Optimization::IfConversion) != 0)
+      IfConvert->RunOnFunction(F);
+
     if (Optimizations.count(Optimization::CopyPropagation) != 0 &&
         Optimizations.count(Optimization::CSE) == 0) {
       CopyProp->RunOnFunction(F);
@@ -32,9 +74,32 @@ bool PassManager::RunAll() {
       } while (InstNumAtStart != F.GetNumberOfInstructions());
     }
 
+    // The bit manipulations are recognized after the fully unrolled loops are
+    // cleaned up, so the steps of the CRC-32 loops follow each other directly
+    if (Optimizations.count(Optimization::BitIdiom) != 0 &&
+        BitIdiom->RunOnFunction(F)) {
+      size_t InstNumAtStart;
+
+      do {
+        InstNumAtStart = F.GetNumberOfInstructions();
+        DCE->RunOnFunction(F);
+      } while (InstNumAtStart != F.GetNumberOfInstructions());
+    }
+
+    if (Optimizations.count(Optimization::LoopStrengthReduction) != 0)
+      LSR->RunOnFunction(F);
+
     ValNum->RunOnFunction(F);
     LoopHoist->RunOnFunction(F);
     DCE->RunOnFunction(F);
+
+    // The blocks are placed once they do not change anymore. The loop and
+    // if-conversion passes might leave forwarding blocks behind.
+    if (Optimizations.count(Optimization::SimplifyCFG) != 0)
+      SimplifyCFG->RunOnFunction(F);
+
+    if (Optimizations.count(Optimization::BlockPlacement) != 0)
+      Placement->RunOnFunction(F);
   }
 
   return true;
@@ -1,10 +1,18 @@
 #ifndef PASS_MANAGER_HPP
 #define PASS_MANAGER_HPP
 
+#include "BitIdiomPass.hpp"
+#include "BlockPlacementPass.hpp"
 #include "CSEPass.hpp"
 #include "CopyPropagationPass.hpp"
 #include "DeadCodeEliminationPass.hpp"
+#include "IfConversionPass.hpp"
 #include "LoopHoistingPass.hpp"
+#include "LoopIdiomPass.hpp"
+#include "LoopStrengthReductionPass.hpp"
+#include "LoopUnrollPass.hpp"
+#include "LoopVectorizePass.hpp"
+#include "SimplifyCFGPass.hpp"
 #include "ValueNumberingPass.hpp"
 #include <set>
 
@@ -14,18 +22,28 @@ enum Optimization {
   NONE,
   CopyPropagation,
   CSE,
+  LoopStrengthReduction,
+  LoopUnroll,
+  LoopVectorize,
+  LoopIdiom,
+  BitIdiom,
+  IfConversion,
+  BlockPlacement,
+  SimplifyCFG,
 };
 
 class PassManager {
 public:
-  explicit PassManager(Module *m, std::set<Optimization> &opts)
-      : IRModule(m), Optimizations(opts) {}
+  explicit PassManager(Module *m, std::set<Optimization> &opts,
+                       unsigned UnrollFactor = 4)
+      : IRModule(m), Optimizations(opts), UnrollFactor(UnrollFactor) {}
 
   bool RunAll();
 
 private:
   Module *IRModule;
   std::set<Optimization> &Optimizations;
+  unsigned UnrollFactor;
 };
 
 #endif // PASS_MANAGER_HPP
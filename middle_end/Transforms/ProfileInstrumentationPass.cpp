@@ -0,0 +1,73 @@
+#include "ProfileInstrumentationPass.hpp"
+#include "../IR/BasicBlock.hpp"
+#include "../IR/Function.hpp"
+#include "../IR/Module.hpp"
+#include "Util.hpp"
+
+template <typename T, typename... Args>
+T *ProfileInstrumentationPass::Insert(BasicBlock *BB, Instruction *Position,
+                                      Args &&...Arguments) {
+  auto I = std::make_unique<T>(std::forward<Args>(Arguments)..., BB);
+  auto InstPtr = I.get();
+
+  if (I->IsDef())
+    I->SetID(NextID++);
+
+  if (Position)
+    BB->InsertBefore(std::move(I), Position);
+  else
+    BB->Insert(std::move(I));
+  return InstPtr;
+}
+
+bool ProfileInstrumentationPass::RunOnFunction(Function &F) {
+  auto &BBs = F.GetBasicBlocks();
+  if (F.IsDeclarationOnly() || BBs.empty())
+    return false;
+
+  NextID = GetNextID(F);
+
+  // The names are packed into the double words in little endian order
+  std::string Names = F.GetName() + '\0';
+  for (auto &BB : BBs)
+    Names += BB->GetName() + '\0';
+  const size_t NameWords = (Names.size() + 7) / 8;
+
+  std::vector<uint64_t> Record = {BBs.size(), NameWords};
+  Record.resize(2 + NameWords + BBs.size(), 0);
+  for (size_t i = 0; i < Names.size(); i++)
+    Record[2 + i / 8] |= (uint64_t)(uint8_t)Names[i] << (i % 8 * 8);
+
+  auto Type = IRType::CreateInt(64);
+  Type.SetDimensions({(unsigned)Record.size()});
+  std::string Name = "__minicc_prof_" + F.GetName();
+  auto Counters = new GlobalVariable(Name, Type, std::move(Record));
+  Counters->SetSection(SectionName);
+  IRModule->AddGlobalVar(std::unique_ptr<Value>(Counters));
+
+  auto CounterPtrType = IRType::CreateInt(64);
+  CounterPtrType.IncrementPointerLevel();
+
+  for (size_t i = 0; i < BBs.size(); i++) {
+    auto BB = BBs[i].get();
+
+    // In the entry block the counter is incremented after the allocations
+    Instruction *Position = nullptr;
+    for (auto &I : BB->GetInstructions())
+      if (!I->IsStackAllocation()) {
+        Position = I.get();
+        break;
+      }
+
+    auto Index = F.GetConstant(2 + NameWords + i);
+    auto Counter = Insert<GetElementPointerInstruction>(
+        BB, Position, CounterPtrType, Counters, Index);
+    auto Count = Insert<LoadInstruction>(BB, Position, IRType::CreateInt(64),
+                                         Counter);
+    auto NewCount = Insert<BinaryInstruction>(BB, Position, Instruction::ADD,
+                                              Count, F.GetConstant(1, 64));
+    Insert<StoreInstruction>(BB, Position, NewCount, Counter);
+  }
+
+  return true;
+}
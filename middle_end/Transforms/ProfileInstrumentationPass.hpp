@@ -0,0 +1,46 @@
+#ifndef PROFILE_INSTRUMENTATION_PASS_HPP
+#define PROFILE_INSTRUMENTATION_PASS_HPP
+
+#include "FunctionPass.hpp"
+
+class BasicBlock;
+class Instruction;
+class Module;
+
+/// Count the executions of each basic block for the profile guided
+/// optimizations. The counters of a function are part of a record placed into
+/// the minicc_prof section, which the profile runtime walks at exit. The
+/// records are arrays of double words:
+///
+///   the number of the blocks
+///   the number of the double words holding the names
+///   the zero terminated names of the function and its blocks, zero padded
+///   the counter of each block
+///
+/// Each block increments its counter at its start, like
+///
+/// 	gep	$10<*i64>, @__minicc_prof_gcd<[9 x i64]>, 6<u32>
+/// 	ld	$11<i64>, [$10<*i64>]
+/// 	add	$12<i64>, $11<i64>, 1<u64>
+/// 	str	[$10<*i64>], $12<i64>
+class ProfileInstrumentationPass : public FunctionPass {
+public:
+  explicit ProfileInstrumentationPass(Module *M) : IRModule(M) {}
+
+  bool RunOnFunction(Function &F) override;
+
+  /// The section holding the records, the runtime finds it with the
+  /// __start_ and __stop_ symbols of the linker.
+  static constexpr const char *SectionName = "minicc_prof";
+
+private:
+  /// Create an instruction with a new ID and insert it before @Position or to
+  /// the end of @BB if it is nullptr.
+  template <typename T, typename... Args>
+  T *Insert(BasicBlock *BB, Instruction *Position, Args &&...Arguments);
+
+  Module *IRModule;
+  unsigned NextID = 0;
+};
+
+#endif // PROFILE_INSTRUMENTATION_PASS_HPP
@@ -0,0 +1,320 @@
+#include "SimplifyCFGPass.hpp"
+#include "../IR/BasicBlock.hpp"
+#include "../IR/Function.hpp"
+#include "Util.hpp"
+#include <algorithm>
+#include <cassert>
+#include <set>
+
+/// Return the position of the first jump, return or jump table of @BB, or the
+/// number of its instructions if it falls through into the next block.
+static size_t GetTerminatorIndex(BasicBlock *BB) {
+  auto &Instructions = BB->GetInstructions();
+  size_t i = 0;
+  while (i < Instructions.size() && !Instructions[i]->IsTerminator())
+    i++;
+
+  return i;
+}
+
+static size_t GetIndex(Function &F, BasicBlock *BB) {
+  auto &Blocks = F.GetBasicBlocks();
+  size_t i = 0;
+  while (i < Blocks.size() && Blocks[i].get() != BB)
+    i++;
+
+  return i;
+}
+
+/// Return the block, which @BB continues in if its branches are not taken:
+/// the target of the jump ending it or the next block. Return nullptr if it
+/// ends otherwise or it is the last block and falls through.
+static BasicBlock *GetContinuation(Function &F, BasicBlock *BB) {
+  auto &Instructions = BB->GetInstructions();
+  const size_t End = GetTerminatorIndex(BB);
+
+  if (End < Instructions.size()) {
+    auto Jump = dynamic_cast<JumpInstruction *>(Instructions[End].get());
+    return Jump ? Jump->GetTargetBB() : nullptr;
+  }
+
+  auto &Blocks = F.GetBasicBlocks();
+  const size_t i = GetIndex(F, BB);
+  return i + 1 < Blocks.size() ? Blocks[i + 1].get() : nullptr;
+}
+
+/// Make @BB continue in @Target, instead of where it continued so far.
+static void SetContinuation(Function &F, BasicBlock *BB, BasicBlock *Target) {
+  auto &Instructions = BB->GetInstructions();
+  const size_t End = GetTerminatorIndex(BB);
+
+  if (End < Instructions.size()) {
+    ((JumpInstruction *)Instructions[End].get())->SetTargetBB(Target);
+    return;
+  }
+
+  auto &Blocks = F.GetBasicBlocks();
+  const size_t i = GetIndex(F, BB);
+  if (i + 1 >= Blocks.size() || Blocks[i + 1].get() != Target)
+    BB->Insert(std::make_unique<JumpInstruction>(Target, BB));
+}
+
+static bool IsLoopHeader(BasicBlock *BB, LoopAnalysis &LA) {
+  for (auto L : LA.GetLoops())
+    if (L->GetHeader() == BB)
+      return true;
+
+  return false;
+}
+
+bool SimplifyCFGPass::RemoveUnreachableBlocks(Function &F, LoopAnalysis &LA) {
+  auto &Blocks = F.GetBasicBlocks();
+  const size_t Size = Blocks.size();
+
+  // The functions, which never return, keep their unreachable return, since
+  // the epilogue is inserted before it
+  bool Returns = false;
+  for (auto &BB : Blocks)
+    if (LA.IsReachable(BB.get()))
+      for (auto &I : BB->GetInstructions())
+        Returns = Returns || I->IsReturn();
+
+  if (!Returns)
+    return false;
+
+  // The targets of the jump tables in the reachable blocks are never deleted,
+  // since the tables keep referring to them
+  std::set<BasicBlock *> TableTargets;
+  for (auto &BB : Blocks)
+    if (LA.IsReachable(BB.get()))
+      for (auto &I : BB->GetInstructions())
+        if (auto JT = dynamic_cast<JumpTableInstruction *>(I.get()))
+          for (auto Target : JT->GetTargets()) {
+            assert(LA.IsReachable(Target) && "Jump table target unreachable");
+            TableTargets.insert(Target);
+          }
+
+  // The unreachable blocks only jump to each other or to reachable blocks, so
+  // nothing refers to them after they are deleted. The block falling through
+  // into the first deleted one of a range is unreachable as well.
+  Blocks.erase(std::remove_if(Blocks.begin() + 1, Blocks.end(),
+                              [&](std::unique_ptr<BasicBlock> &BB) {
+                                return !LA.IsReachable(BB.get()) &&
+                                       !TableTargets.count(BB.get());
+                              }),
+               Blocks.end());
+
+  return Blocks.size() != Size;
+}
+
+bool SimplifyCFGPass::RemoveForwardingBlocks(Function &F, LoopAnalysis &LA) {
+  auto &Blocks = F.GetBasicBlocks();
+  bool Changed = false;
+
+  for (size_t i = 1; i < Blocks.size();) {
+    auto BB = Blocks[i].get();
+    auto &Instructions = BB->GetInstructions();
+
+    if (GetTerminatorIndex(BB) != 0) {
+      i++;
+      continue;
+    }
+
+    auto Target = GetContinuation(F, BB);
+    if (!Target || Target == BB || Target == Blocks[0].get()) {
+      i++;
+      continue;
+    }
+
+    // The block entering a loop is kept, so the loop has a preheader
+    bool Enters = false;
+    for (auto L : LA.GetLoops())
+      if (L->GetHeader() == Target && !L->Contains(BB))
+        Enters = true;
+
+    if (Enters || (!Instructions.empty() && !Instructions[0]->IsJump())) {
+      i++;
+      continue;
+    }
+
+    std::map<BasicBlock *, BasicBlock *> Map = {{BB, Target}};
+    for (auto &Block : Blocks)
+      for (auto &I : Block->GetInstructions())
+        Retarget(I.get(), Map);
+
+    // The previous block might have fallen through into the removed one
+    auto Prev = Blocks[i - 1].get();
+    const bool FallsThrough =
+        GetTerminatorIndex(Prev) == Prev->GetInstructions().size();
+    Blocks.erase(Blocks.begin() + i);
+
+    if (FallsThrough)
+      SetContinuation(F, Prev, Target);
+
+    Changed = true;
+  }
+
+  return Changed;
+}
+
+BasicBlock *SimplifyCFGPass::GetThreadedTarget(Function &F, BasicBlock *BB,
+                                               BasicBlock *Succ,
+                                               LoopAnalysis &LA) {
+  // Jumping past a loop header would enter the loop elsewhere
+  if (Succ == F.GetBasicBlocks()[0].get() || IsLoopHeader(Succ, LA))
+    return nullptr;
+
+  // The successor must consist of the test only
+  auto &SuccInstructions = Succ->GetInstructions();
+  if (SuccInstructions.size() != 3 && SuccInstructions.size() != 4)
+    return nullptr;
+
+  auto Load = dynamic_cast<LoadInstruction *>(SuccInstructions[0].get());
+  auto CMP = dynamic_cast<CompareInstruction *>(SuccInstructions[1].get());
+  auto Br = dynamic_cast<BranchInstruction *>(SuccInstructions[2].get());
+  if (!Load || !CMP || !Br || Load->Get2ndUse() || Br->HasFalseLabel() ||
+      Br->GetCondition() != CMP || CMP->GetLHS() != Load ||
+      CMP->GetInstructionKind() != Instruction::CMP)
+    return nullptr;
+
+  // Only the equality is decided, which does not depend on the signedness
+  auto Relation = CMP->GetRelation();
+  auto Limit = dynamic_cast<Constant *>(CMP->GetRHS());
+  auto &Type = Load->GetTypeRef();
+  if ((Relation != CompareInstruction::EQ &&
+       Relation != CompareInstruction::NE) ||
+      !Limit || Limit->IsFPConst() || !Type.IsINT() || Type.IsPTR() ||
+      Type.IsVector())
+    return nullptr;
+
+  auto Slot = dynamic_cast<StackAllocationInstruction *>(Load->Get1stUse());
+  if (!Slot || LA.IsAddressTaken(Slot))
+    return nullptr;
+
+  // Where the execution continues, if the branch is not taken
+  BasicBlock *NotTaken = nullptr;
+  if (SuccInstructions.size() == 4) {
+    auto Jump = dynamic_cast<JumpInstruction *>(SuccInstructions[3].get());
+    if (!Jump)
+      return nullptr;
+    NotTaken = Jump->GetTargetBB();
+  } else
+    NotTaken = GetContinuation(F, Succ);
+
+  // The value last stored to the variable before leaving @BB
+  auto &Instructions = BB->GetInstructions();
+  Constant *Stored = nullptr;
+  for (size_t i = GetTerminatorIndex(BB); i-- > 0;)
+    if (auto Store = dynamic_cast<StoreInstruction *>(Instructions[i].get());
+        Store && Store->GetMemoryLocation() == Slot) {
+      Stored = dynamic_cast<Constant *>(Store->GetSavedValue());
+      if (!Stored || Stored->IsFPConst())
+        return nullptr;
+      break;
+    }
+
+  if (!Stored)
+    return nullptr;
+
+  const auto BitWidth = Type.GetBitSize();
+  const uint64_t Mask = BitWidth >= 64 ? ~0ull : (1ull << BitWidth) - 1;
+  const bool Equal =
+      (Stored->GetIntValue() & Mask) == (Limit->GetIntValue() & Mask);
+  auto Target = Equal == (Relation == CompareInstruction::EQ)
+                    ? Br->GetTrueTarget()
+                    : NotTaken;
+
+  return Target != Succ ? Target : nullptr;
+}
+
+bool SimplifyCFGPass::ThreadJumps(Function &F, LoopAnalysis &LA) {
+  bool Changed = false;
+
+  for (auto &BB : F.GetBasicBlocks()) {
+    auto Succ = GetContinuation(F, BB.get());
+    if (!Succ || Succ == BB.get())
+      continue;
+
+    if (auto Target = GetThreadedTarget(F, BB.get(), Succ, LA)) {
+      SetContinuation(F, BB.get(), Target);
+      Changed = true;
+    }
+  }
+
+  return Changed;
+}
+
+bool SimplifyCFGPass::MergeBlocks(Function &F, LoopAnalysis &LA) {
+  auto &Blocks = F.GetBasicBlocks();
+  bool Changed = false;
+
+  for (size_t i = 0; i < Blocks.size(); i++) {
+    auto BB = Blocks[i].get();
+    auto &Instructions = BB->GetInstructions();
+    const size_t End = GetTerminatorIndex(BB);
+
+    // The predecessors are not updated, but a merge only replaces a block
+    // with the one it is merged into, so their number stays the same
+    auto Succ = GetContinuation(F, BB);
+    if (!Succ || Succ == BB || Succ == Blocks[0].get() ||
+        LA.GetPredecessors(Succ).size() != 1)
+      continue;
+
+    bool HasBranch = false;
+    for (size_t j = 0; j < End; j++)
+      if (Instructions[j]->GetInstructionKind() == Instruction::BRANCH)
+        HasBranch = true;
+
+    if (HasBranch)
+      continue;
+
+    // The successor continues where it did, so if it falls through into the
+    // next block, that must follow it
+    const size_t SuccIndex = GetIndex(F, Succ);
+    auto SuccEnd = GetTerminatorIndex(Succ);
+    auto &SuccInstructions = Succ->GetInstructions();
+    BasicBlock *SuccNext = nullptr;
+    if (SuccEnd == SuccInstructions.size()) {
+      if (SuccIndex + 1 == Blocks.size())
+        continue;
+      SuccNext = Blocks[SuccIndex + 1].get();
+    }
+
+    Instructions.erase(Instructions.begin() + End, Instructions.end());
+    for (auto &I : SuccInstructions) {
+      I->SetParent(BB);
+      Instructions.push_back(std::move(I));
+    }
+
+    Blocks.erase(Blocks.begin() + SuccIndex);
+    if (SuccNext)
+      SetContinuation(F, BB, SuccNext);
+
+    // The merged block might continue in a block, which can be merged too
+    if (SuccIndex < i)
+      i--;
+    i--;
+    Changed = true;
+  }
+
+  return Changed;
+}
+
+bool SimplifyCFGPass::RunOnFunction(Function &F) {
+  if (F.GetBasicBlocks().empty())
+    return false;
+
+  // The analysis is recomputed after each step changing the graph, since the
+  // steps open up opportunities for each other
+  bool Changed = false;
+  for (bool StepChanged = true; StepChanged;) {
+    LoopAnalysis LA(F);
+
+    StepChanged = RemoveUnreachableBlocks(F, LA) ||
+                  RemoveForwardingBlocks(F, LA) || ThreadJumps(F, LA) ||
+                  MergeBlocks(F, LA);
+    Changed = Changed || StepChanged;
+  }
+
+  return Changed;
+}
@@ -0,0 +1,48 @@
+#ifndef SIMPLIFY_CFG_PASS_HPP
+#define SIMPLIFY_CFG_PASS_HPP
+
+#include "FunctionPass.hpp"
+#include "LoopAnalysis.hpp"
+
+/// Clean up the control flow graph left behind by the lowering of the
+/// statements. The blocks, which cannot be reached from the entry, are
+/// deleted. The empty blocks and the ones starting with a jump only forward
+/// the control, so their predecessors are redirected to where they lead,
+/// except for the blocks entering a loop, which are kept as preheaders.
+/// The jumps to a block testing a local variable, which was just set to a
+/// constant, are threaded to the block decided by the test. For example the
+/// result of a logical and
+///
+/// .true0:
+/// 	str	[$5<*i1>], 1<u32>
+/// 	j	<final0>
+/// .false0:
+/// 	str	[$5<*i1>], 0<u32>
+/// .final0:
+/// 	ld	$10<i1>, [$5<*i1>]
+/// 	cmp.eq	$11<i1>, $10<i1>, 0<u32>
+/// 	br	$11<i1>, <if_end0>
+///
+/// is not tested anymore, .true0 jumps to the block after .final0 and .false0
+/// to .if_end0. Finally a block is merged into its single predecessor, if
+/// that continues only in it.
+class SimplifyCFGPass : public FunctionPass {
+public:
+  bool RunOnFunction(Function &F) override;
+
+private:
+  /// Each of them returns true if it changed @F. The analysis @LA is not
+  /// updated, so they only rely on the parts of it, which their own changes
+  /// keep valid.
+  bool RemoveUnreachableBlocks(Function &F, LoopAnalysis &LA);
+  bool RemoveForwardingBlocks(Function &F, LoopAnalysis &LA);
+  bool ThreadJumps(Function &F, LoopAnalysis &LA);
+  bool MergeBlocks(Function &F, LoopAnalysis &LA);
+
+  /// Return the block, where the execution continues after @BB reached its
+  /// end in @Succ, if @Succ only tests a constant stored by @BB, or nullptr.
+  BasicBlock *GetThreadedTarget(Function &F, BasicBlock *BB, BasicBlock *Succ,
+                                LoopAnalysis &LA);
+};
+
+#endif // SIMPLIFY_CFG_PASS_HPP
@@ -1,4 +1,8 @@
 #include "Util.hpp"
+#include "../IR/Function.hpp"
+#include "LoopAnalysis.hpp"
+#include <algorithm>
+#include <set>
 
 void RenameRegisters(std::map<Value *, Value *> &Renameables,
                      BasicBlock::InstructionList &InstrList) {
@@ -11,5 +15,328 @@ void RenameRegisters(std::map<Value *, Value *> &Renameables,
 
     if (I->Get2ndUse() && Renameables.count(I->Get2ndUse()))
       I->Set2ndUse(Renameables[I->Get2ndUse()]);
+
+    if (I->Get3rdUse() && Renameables.count(I->Get3rdUse()))
+      I->Set3rdUse(Renameables[I->Get3rdUse()]);
+  }
+}
+
+unsigned GetNextID(Function &F) {
+  unsigned NextID = 0;
+
+  for (auto &Param : F.GetParameters())
+    NextID = std::max(NextID, Param->GetID() + 1);
+
+  for (auto &BB : F.GetBasicBlocks())
+    for (auto &I : BB->GetInstructions())
+      if (I->IsDef())
+        NextID = std::max(NextID, I->GetID() + 1);
+
+  return NextID;
+}
+
+int64_t SignExtend(uint64_t Value, unsigned BitWidth) {
+  const unsigned Shift = 64 - BitWidth;
+  return (int64_t)(Value << Shift) >> Shift;
+}
+
+Instruction *GetControlFlow(BasicBlock *BB) {
+  for (auto &I : BB->GetInstructions())
+    if (I->IsTerminator() || I->GetInstructionKind() == Instruction::BRANCH)
+      return I.get();
+
+  return nullptr;
+}
+
+std::vector<BasicBlock *> GetTargets(Instruction *I) {
+  if (auto Jump = dynamic_cast<JumpInstruction *>(I))
+    return {Jump->GetTargetBB()};
+
+  if (auto Br = dynamic_cast<BranchInstruction *>(I))
+    return {Br->GetTrueTarget(), Br->GetFalseTarget()};
+
+  if (auto JT = dynamic_cast<JumpTableInstruction *>(I))
+    return JT->GetTargets();
+
+  return {};
+}
+
+void Retarget(Instruction *I, std::map<BasicBlock *, BasicBlock *> &Map) {
+  if (auto Jump = dynamic_cast<JumpInstruction *>(I)) {
+    if (Map.count(Jump->GetTargetBB()) != 0)
+      Jump->SetTargetBB(Map[Jump->GetTargetBB()]);
+  } else if (auto Br = dynamic_cast<BranchInstruction *>(I)) {
+    if (Map.count(Br->GetTrueTarget()) != 0)
+      Br->SetTrueTarget(Map[Br->GetTrueTarget()]);
+    if (Br->HasFalseLabel() && Map.count(Br->GetFalseTarget()) != 0)
+      Br->SetFalseTarget(Map[Br->GetFalseTarget()]);
+  } else if (auto JT = dynamic_cast<JumpTableInstruction *>(I)) {
+    for (auto &Target : JT->GetTargets())
+      if (Map.count(Target) != 0)
+        Target = Map[Target];
+  }
+}
+
+static unsigned CountJumpsTo(Function &F, BasicBlock *Target) {
+  unsigned Count = 0;
+
+  for (auto &BB : F.GetBasicBlocks())
+    for (auto &I : BB->GetInstructions())
+      for (auto BBTarget : GetTargets(I.get()))
+        if (BBTarget == Target)
+          Count++;
+
+  return Count;
+}
+
+void MergeBlocks(Function &F, size_t Begin, size_t End) {
+  auto &Blocks = F.GetBasicBlocks();
+
+  for (size_t i = Begin; i + 1 < End;) {
+    auto BB = Blocks[i].get();
+    auto Next = Blocks[i + 1].get();
+    auto &Instructions = BB->GetInstructions();
+
+    auto CF = GetControlFlow(BB);
+    const bool JumpsToNext =
+        CF && CF->IsJump() && CF == Instructions.back().get() &&
+        ((JumpInstruction *)CF)->GetTargetBB() == Next;
+    if ((CF && !JumpsToNext) || CountJumpsTo(F, Next) != (CF ? 1 : 0)) {
+      i++;
+      continue;
+    }
+
+    if (CF)
+      Instructions.pop_back();
+
+    for (auto &I : Next->GetInstructions()) {
+      I->SetParent(BB);
+      Instructions.push_back(std::move(I));
+    }
+
+    Blocks.erase(Blocks.begin() + i + 1);
+    End--;
+  }
+}
+
+std::vector<std::unique_ptr<BasicBlock>>
+CloneBlocks(Function &F, size_t Begin, size_t End, const std::string &Suffix,
+            std::map<BasicBlock *, BasicBlock *> &Copies, unsigned &NextID) {
+  auto &Blocks = F.GetBasicBlocks();
+  std::vector<std::unique_ptr<BasicBlock>> Clones;
+  std::map<Value *, Value *> Values;
+
+  for (size_t i = Begin; i < End; i++) {
+    auto BB = Blocks[i].get();
+    auto Clone = std::make_unique<BasicBlock>(BB->GetName() + Suffix, &F);
+
+    for (auto &I : BB->GetInstructions()) {
+      auto InstClone = I->Clone();
+      InstClone->SetParent(Clone.get());
+
+      if (InstClone->IsDef()) {
+        InstClone->SetID(NextID++);
+        Values[I.get()] = InstClone.get();
+      }
+
+      Clone->Insert(std::move(InstClone));
+    }
+
+    Copies[BB] = Clone.get();
+    Clones.push_back(std::move(Clone));
+  }
+
+  // The jumps to the first block are the back edges, which are set by the
+  // caller
+  auto Targets = Copies;
+  Targets.erase(Blocks[Begin].get());
+
+  for (auto &Clone : Clones) {
+    RenameRegisters(Values, Clone->GetInstructions());
+
+    for (auto &I : Clone->GetInstructions()) {
+      if (I->IsCall())
+        for (auto &Arg : ((CallInstruction *)I.get())->GetArgs())
+          if (Values.count(Arg) != 0)
+            Arg = Values[Arg];
+
+      Retarget(I.get(), Targets);
+    }
+  }
+
+  return Clones;
+}
+
+bool GetLoopRange(Function &F, Loop *L, size_t &Begin, size_t &End) {
+  auto Header = L->GetHeader();
+  auto Preheader = L->GetPreheader();
+  auto Latch = L->GetLatch();
+  if (!L->GetSubLoops().empty() || !Preheader || !Latch)
+    return false;
+
+  auto PreheaderJump = GetControlFlow(Preheader);
+  auto LatchJump = GetControlFlow(Latch);
+  if (!PreheaderJump || !PreheaderJump->IsJump() ||
+      PreheaderJump != Preheader->GetInstructions().back().get() ||
+      !LatchJump || !LatchJump->IsJump() ||
+      LatchJump != Latch->GetInstructions().back().get())
+    return false;
+
+  // The loop must be laid out as a contiguous range starting with the header
+  auto &Blocks = F.GetBasicBlocks();
+  Begin = 0;
+  while (Blocks[Begin].get() != Header)
+    Begin++;
+
+  End = Begin + L->GetBlocks().size();
+  if (End > Blocks.size())
+    return false;
+
+  for (size_t i = Begin; i < End; i++)
+    if (!L->Contains(Blocks[i].get()))
+      return false;
+
+  auto HeaderBranch = dynamic_cast<BranchInstruction *>(GetControlFlow(Header));
+  if (!HeaderBranch || HeaderBranch->HasFalseLabel() ||
+      HeaderBranch != Header->GetInstructions().back().get() ||
+      L->Contains(HeaderBranch->GetTrueTarget()) || Begin + 1 == End)
+    return false;
+
+  // Otherwise a copy of the loop would fall through into the next block
+  auto LastControlFlow = GetControlFlow(Blocks[End - 1].get());
+  if (!LastControlFlow || !LastControlFlow->IsTerminator())
+    return false;
+
+  std::set<Value *> Defs;
+  for (auto BB : L->GetBlocks())
+    for (auto &I : BB->GetInstructions()) {
+      if (I->IsStackAllocation())
+        return false;
+
+      Defs.insert(I.get());
+    }
+
+  for (auto &BB : Blocks) {
+    if (L->Contains(BB.get()))
+      continue;
+
+    for (auto &I : BB->GetInstructions()) {
+      for (auto Target : GetTargets(I.get()))
+        if (L->Contains(Target) && I.get() != PreheaderJump)
+          return false;
+
+      std::vector<Value *> Uses = {I->Get1stUse(), I->Get2ndUse(),
+                                   I->Get3rdUse()};
+      if (I->IsCall())
+        Uses = ((CallInstruction *)I.get())->GetArgs();
+
+      for (auto Use : Uses)
+        if (Defs.count(Use) != 0)
+          return false;
+    }
+  }
+
+  return true;
+}
+
+bool CanTestAhead(Loop *L, unsigned Count, bool &NeedsGuard, int64_t &Limit) {
+  auto Cmp = L->GetExitCondition();
+  auto IV = L->GetCounter();
+  NeedsGuard = false;
+  if (!Cmp || !IV || !L->ExitsOnTrue() || !L->GetPreheader())
+    return false;
+
+  // The loop is left when the counter steps over the bound
+  const int64_t Step = IV->Step;
+  const auto Relation = Cmp->GetRelation();
+  if (Step > 0 ? Relation != CompareInstruction::GE &&
+                     Relation != CompareInstruction::GT
+               : Relation != CompareInstruction::LE &&
+                     Relation != CompareInstruction::LT)
+    return false;
+
+  // The comparisons are signed, so the advanced counter must not overflow
+  const unsigned BitWidth = Cmp->GetLHS()->GetBitWidth();
+  if (BitWidth != 32 && BitWidth != 64)
+    return false;
+
+  const int64_t Max = (int64_t)(~0ull >> (65 - BitWidth));
+  const int64_t Min = -Max - 1;
+  const uint64_t AbsStep = Step > 0 ? Step : -(uint64_t)Step;
+  if (AbsStep > (uint64_t)Max / Count)
+    return false;
+
+  const int64_t Distance = (Count - 1) * AbsStep;
+  Limit = Step > 0 ? Max - Count * AbsStep : Min + Count * AbsStep;
+
+  if (auto Ext = dynamic_cast<UnaryInstruction *>(Cmp->GetLHS())) {
+    // The narrower counter cannot reach the limits of the comparison
+    const unsigned CounterWidth = Ext->GetOperand()->GetBitWidth();
+    const bool IsZeroExtended = Ext->GetInstructionKind() == Instruction::ZEXT;
+    if (CounterWidth >= BitWidth)
+      return false;
+
+    const int64_t CounterMax = IsZeroExtended
+                                   ? (int64_t)(1ull << CounterWidth) - 1
+                                   : (int64_t)(1ull << (CounterWidth - 1)) - 1;
+    const int64_t CounterMin =
+        IsZeroExtended ? 0 : -(int64_t)(1ull << (CounterWidth - 1));
+    return Step > 0 ? CounterMax <= Max - Distance
+                    : CounterMin >= Min + Distance;
   }
+
+  // The counter starts from a constant and it is compared against a bound
+  // which leaves room for the extra steps. The bound has to be checked before
+  // the loop if it is not known at compile time.
+  Constant *Init = nullptr;
+  for (auto &I : L->GetPreheader()->GetInstructions())
+    if (I->IsStore() && I->Get2ndUse() == IV->Slot)
+      Init = dynamic_cast<Constant *>(I->Get1stUse());
+
+  if (!Init)
+    return false;
+
+  const int64_t I0 = SignExtend(Init->GetIntValue(), BitWidth);
+  if (Step > 0 ? I0 > Max - Distance : I0 < Min + Distance)
+    return false;
+
+  if (auto Bound = dynamic_cast<Constant *>(Cmp->GetRHS())) {
+    const int64_t B = SignExtend(Bound->GetIntValue(), BitWidth);
+    return Step > 0 ? B <= Limit : B >= Limit;
+  }
+
+  NeedsGuard = true;
+  return Cmp->GetRHS()->IsParameter() ||
+         dynamic_cast<LoadInstruction *>(Cmp->GetRHS());
+}
+
+void InsertGuard(Function &F, Loop *L, BasicBlock *BB, Instruction *Position,
+                 int64_t Limit, unsigned &NextID) {
+  auto Cmp = L->GetExitCondition();
+  const unsigned BitWidth = Cmp->GetLHS()->GetBitWidth();
+  auto Insert = [&](std::unique_ptr<Instruction> I) {
+    return Position ? BB->InsertBefore(std::move(I), Position)
+                    : BB->Insert(std::move(I));
+  };
+
+  Value *Bound = Cmp->GetRHS();
+  if (auto Load = dynamic_cast<LoadInstruction *>(Bound)) {
+    auto Slot = Load->GetMemoryLocation();
+    auto BoundCopy =
+        std::make_unique<LoadInstruction>(Slot->GetType(), Slot, BB);
+    BoundCopy->SetID(NextID++);
+    Bound = Insert(std::move(BoundCopy));
+  }
+
+  const uint64_t Mask = ~0ull >> (64 - BitWidth);
+  auto Guard = std::make_unique<CompareInstruction>(
+      Bound, F.GetConstant((uint64_t)Limit & Mask, BitWidth),
+      L->GetCounter()->Step > 0 ? CompareInstruction::GT
+                                : CompareInstruction::LT,
+      BB);
+  Guard->SetID(NextID++);
+  auto GuardPtr = Insert(std::move(Guard));
+
+  Insert(std::make_unique<BranchInstruction>(GuardPtr, L->GetHeader(), nullptr,
+                                             BB));
 }
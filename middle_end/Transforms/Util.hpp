@@ -3,6 +3,12 @@
 
 #include "../IR/BasicBlock.hpp"
 #include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Function;
+class Loop;
 
 /// Containing helper functions, which has uses in multiple
 /// locations.
@@ -13,4 +19,50 @@
 void RenameRegisters(std::map<Value *, Value *> &Renameables,
                      BasicBlock::InstructionList &InstrList);
 
+/// Return the smallest ID, which is greater than the ID of every parameter and
+/// instruction in @F, so it can be given to a new instruction.
+unsigned GetNextID(Function &F);
+
+int64_t SignExtend(uint64_t Value, unsigned BitWidth);
+
+/// Return the first control flow instruction of @BB, which ends the block, or
+/// nullptr if the execution continues in the next block.
+Instruction *GetControlFlow(BasicBlock *BB);
+
+/// Return the blocks, which @I might jump to.
+std::vector<BasicBlock *> GetTargets(Instruction *I);
+
+/// Redirect the jumps of @I to the blocks in @Map.
+void Retarget(Instruction *I, std::map<BasicBlock *, BasicBlock *> &Map);
+
+/// Merge each block in [@Begin, @End) of @F into the preceding one, if that
+/// continues only in it and the block is not reached from anywhere else.
+void MergeBlocks(Function &F, size_t Begin, size_t End);
+
+/// Copy the blocks [@Begin, @End) of @F with new IDs starting from @NextID and
+/// with @Suffix appended to their names. The jumps between the copied blocks
+/// are redirected to the copies, except the ones to the first block. The copy
+/// of each block is recorded in @Copies.
+std::vector<std::unique_ptr<BasicBlock>>
+CloneBlocks(Function &F, size_t Begin, size_t End, const std::string &Suffix,
+            std::map<BasicBlock *, BasicBlock *> &Copies, unsigned &NextID);
+
+/// Return true if @L is an innermost loop, which is laid out as the contiguous
+/// range of blocks [@Begin, @End) of @F starting with its header. The loop
+/// must be entered only through the jump ending its preheader, its header must
+/// end with a branch leaving the loop and its last block must not fall through.
+/// The values computed in the loop must not be used outside of it.
+bool GetLoopRange(Function &F, Loop *L, size_t &Begin, size_t &End);
+
+/// Return true if the exit test of the counted loop @L can be evaluated on its
+/// counter advanced by @Count - 1 more steps, without the signed comparison
+/// overflowing. If this only holds while the bound of the test does not step
+/// over @Limit, which is not known at compile time, then @NeedsGuard is set.
+bool CanTestAhead(Loop *L, unsigned Count, bool &NeedsGuard, int64_t &Limit);
+
+/// Insert a test before @Position in @BB, or to its end if @Position is
+/// nullptr, which jumps to the header of @L if its bound steps over @Limit.
+void InsertGuard(Function &F, Loop *L, BasicBlock *BB, Instruction *Position,
+                 int64_t Limit, unsigned &NextID);
+
 #endif // IR_UTIL_HPP
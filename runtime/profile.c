@@ -0,0 +1,55 @@
+/* The runtime of the programs compiled with -fprofile-generate. It writes
+ * the block counters to default.profdata or to the file named by the
+ * MINICC_PROFILE_FILE environment variable when the program exits. The file
+ * can be given to the compiler with -fprofile-use=<file>.
+ *
+ * It is compiled with the C compiler of the target and linked to the
+ * instrumented objects, for example:
+ *
+ *   miniCC test.c -fprofile-generate > test.s
+ *   aarch64-linux-gnu-gcc test.s runtime/profile.c -o test
+ *
+ * The compiler places a record for each function into the minicc_prof
+ * section, the linker provides the bounds of the section. See
+ * ProfileInstrumentationPass for the layout of the records.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern long long __start_minicc_prof[] __attribute__((weak));
+extern long long __stop_minicc_prof[] __attribute__((weak));
+
+__attribute__((destructor)) static void WriteProfile(void) {
+  const char *Path = getenv("MINICC_PROFILE_FILE");
+  FILE *File = fopen(Path ? Path : "default.profdata", "w");
+  if (!File) {
+    fprintf(stderr, "profile: cannot write %s\n",
+            Path ? Path : "default.profdata");
+    return;
+  }
+
+  long long *Record = __start_minicc_prof;
+  while (Record && Record < __stop_minicc_prof) {
+    /* Skip the padding between the sections of the objects */
+    if (Record[0] == 0) {
+      Record++;
+      continue;
+    }
+
+    long long BlocksNum = Record[0];
+    long long NameWords = Record[1];
+    const char *Name = (const char *)(Record + 2);
+    const long long *Counters = Record + 2 + NameWords;
+
+    fprintf(File, "%s %lld\n", Name, BlocksNum);
+    for (long long i = 0; i < BlocksNum; i++) {
+      Name += strlen(Name) + 1;
+      fprintf(File, "%s %lld\n", Name, Counters[i]);
+    }
+
+    Record += 2 + NameWords + BlocksNum;
+  }
+
+  fclose(File);
+}
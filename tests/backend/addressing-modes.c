@@ -0,0 +1,16 @@
+// COMPILE-TEST
+
+// Address computations are folded into the addressing mode of the access.
+// CHECK: load_scaled:
+// CHECK: ldr	w0, [x3, w2, sxtw #2]
+// CHECK: store_scaled:
+// CHECK: str	x3, [x5, w4, sxtw #3]
+// CHECK: load_byte:
+// CHECK: ldrb	w0, [x3, w2, sxtw #0]
+// CHECK: load_next:
+// CHECK: ldr	w0, [x2, w3, sxtw #2]
+// CHECK-NOT: madd
+int load_scaled(int *a, int i) { return a[i]; }
+void store_scaled(long *a, int i, long v) { a[i] = v; }
+char load_byte(char *a, int i) { return a[i]; }
+int load_next(int *a, int i) { return a[i + 1]; }
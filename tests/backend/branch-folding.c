@@ -0,0 +1,20 @@
+// COMPILE-TEST
+// EXTRA-FLAGS: -branch-folding
+
+// The block of the continue only jumps to the increment, so the branch over
+// it is inverted to go there directly. The break is handled the same way.
+// CHECK: 	b.eq	.L0_loop_increment0
+// CHECK: 	b.gt	.L0_loop_end0
+// CHECK-NOT: b.ne	.L0_if_end
+// CHECK-NOT: b.le	.L0_if_end
+int test(int n) {
+  int s = 0;
+  for (int i = 0; i < n; i++) {
+    if (i == 3)
+      continue;
+    s = s + i;
+    if (s > 100)
+      break;
+  }
+  return s;
+}
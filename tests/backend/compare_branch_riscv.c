@@ -0,0 +1,21 @@
+// COMPILE-TEST
+// EXTRA-FLAGS: -arch=riscv32
+
+// The compares feeding the branches are selected into compare and branch
+// instructions, so no boolean is materialized.
+// CHECK-NOT: slt
+// CHECK-NOT: bnez
+// CHECK: bge	t0, t1,
+// CHECK: bge	t1, t0,
+// CHECK: beq	t0, zero,
+int test(int a, int b) {
+  int r = 0;
+  while (a < b) {
+    if (a > b)
+      r = r + 1;
+    a = a + 1;
+  }
+  if (a)
+    r = r + 2;
+  return r;
+}
@@ -0,0 +1,35 @@
+// COMPILE-TEST
+
+// Constants are materialized by the shortest sequence.
+// CHECK: bitmask:
+// CHECK: orr	x0, xzr, #6148914691236517205
+// CHECK: patched_bitmask:
+// CHECK: orr	x0, xzr, #71777214294589695
+// CHECK: movk	x0, #4660, lsl #0
+// CHECK: zero_halfwords:
+// CHECK: mov	x0, #4660
+// CHECK: movk	x0, #65534, lsl #48
+// CHECK: ones_halfwords:
+// CHECK: mov	x0, #-43400
+// CHECK: movk	x0, #4660, lsl #32
+// CHECK-NOT: movk	x0, #0,
+// CHECK-NOT: movk	x0, #65535,
+long bitmask() { return (0x55555555ll << 32) | 0x55555555; }
+long patched_bitmask() { return (0x00ff00ffll << 32) | 0x00ff1234; }
+long zero_halfwords() { return (0xfffell << 48) | 0x1234; }
+long ones_halfwords() { return 0ll - ((0xedcbll << 32) | 0xa988); }
+
+// 5 is not a logical immediate, so it is materialized, but only once.
+// CHECK: not_bitmask:
+// CHECK: mov	w3, #5
+// CHECK: and	w4, w2, w3
+// CHECK: and	w5, w2, w3
+int not_bitmask(int a, int b) { return (a & 5) + (b & 5); }
+
+// The call clobbers the register of the constant, so it is materialized again.
+// CHECK: across_call:
+// CHECK: bl	g
+// CHECK: mov	w2, #22136
+// CHECK: movk	w2, #4660, lsl #16
+int g(int);
+int across_call(int a) { return g(a ^ 0x12345678) ^ 0x12345678; }
@@ -0,0 +1,19 @@
+// COMPILE-TEST
+
+struct S {
+  int a;
+  int b;
+};
+
+// The multiplication is folded into the addition, the shift into the operand
+// of the next addition and the member offset into the load and store.
+// CHECK: madd
+// CHECK: , lsl #3
+// CHECK: , #4]
+// CHECK: , #4]
+int test(int x, int y, int z, struct S *s) {
+  int r = z + x * y;
+  r = r + (y << 3);
+  s->b = s->b + r;
+  return r;
+}
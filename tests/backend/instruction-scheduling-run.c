@@ -0,0 +1,52 @@
+// RUN: AArch64
+// EXTRA-FLAGS: -schedule
+
+// FUNC-DECL: int dot(int)
+// FUNC-DECL: int overwrite(int)
+// FUNC-DECL: int divide(int, int, int)
+// FUNC-DECL: int compare(int, int, int)
+// FUNC-DECL: long pair(long, long)
+
+// TEST-CASE: dot(3) -> 32
+// TEST-CASE: dot(1) -> 4
+// TEST-CASE: overwrite(1) -> 9
+// TEST-CASE: divide(100, 7, 3) -> 16
+// TEST-CASE: compare(3, 4, 5) -> 9
+// TEST-CASE: compare(5, 4, 3) -> 5
+// TEST-CASE: pair(7, 9) -> 79
+
+int dot(int n) {
+  int a[3] = {1, 2, 3};
+  int b[3] = {4, 5, 6};
+  int s = 0;
+  for (int i = 0; i < n; i++)
+    s = s + a[i] * b[i];
+  return s;
+}
+
+// The loads after the stores must see the new values.
+int overwrite(int x) {
+  int a[3] = {0, 2, 3};
+  a[0] = x;
+  a[1] = x + 5;
+  a[0] = a[1] + a[2];
+  return a[0] + a[0] - a[1] - a[2];
+}
+
+int divide(int a, int b, int c) {
+  int q = a / b;
+  int r = a % c;
+  return q + r * 2 + b - 7;
+}
+
+int compare(int a, int b, int c) {
+  int x = (a < b) ? a + c : b;
+  return x + 1;
+}
+
+long pair(long a, long b) {
+  long t[2];
+  t[0] = a;
+  t[1] = b;
+  return t[0] * 10 + t[1];
+}
@@ -0,0 +1,14 @@
+// COMPILE-TEST
+// EXTRA-FLAGS: -peephole -schedule
+
+// The second element is loaded while the first one is still on its way, and
+// the multiplication waits for it after that.
+// CHECK: ldr	w2, [x1, #0]
+// CHECK: ldr	x5, [sp, #0]
+// CHECK: mul	w4, w2, w3
+// CHECK: ldr	w6, [x5, #8]
+int test(int *a) {
+  int x = a[0] * 3;
+  int y = a[2] + 7;
+  return x - y;
+}
@@ -0,0 +1,39 @@
+// COMPILE-TEST
+// EXTRA-FLAGS: -peephole
+
+struct S {
+  int a;
+  int b;
+  int c;
+  int d;
+  int e;
+};
+
+// Copies use the widest chunks in pairs, then narrower ones for the rest
+// CHECK: ldp	x2, x3, [x1, #0]
+// CHECK: stp	x2, x3, [sp, #8]
+// CHECK: ldr	w2, [x1, #16]
+// CHECK: str	w2, [sp, #24]
+int copy(struct S *p) {
+  struct S s;
+  s = *p;
+  return s.a + s.e;
+}
+
+// Small zero initialized arrays are filled inline with the zero register,
+// large ones by memset
+// CHECK: stp	xzr, xzr, [sp, #0]
+// CHECK: stp	xzr, xzr, [sp, #16]
+// CHECK: bl	memset
+// CHECK-NOT: memcpy
+int zero_small(int k) {
+  int a[8] = {0};
+  a[k] = 5;
+  return a[0] + a[7];
+}
+
+int zero_large(int k) {
+  int a[64] = {0};
+  a[k] = 5;
+  return a[0] + a[63];
+}
@@ -0,0 +1,17 @@
+// COMPILE-TEST
+// EXTRA-FLAGS: -peephole
+
+// The compare result is not materialized for the loop branch and the value
+// stored into a variable is not reloaded right after.
+// CHECK-NOT: cset
+// CHECK-NOT: cmp	w2, #0
+// CHECK: b.le
+int test(int n) {
+  int i = 0;
+  int s = 0;
+  do {
+    s = s + i;
+    i = s;
+  } while (i <= n);
+  return s;
+}
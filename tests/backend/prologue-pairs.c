@@ -0,0 +1,36 @@
+// COMPILE-TEST
+
+// The callee saved registers are saved in pairs and the save area is allocated
+// by the first pair. Without stack objects the link register alone is pushed.
+// CHECK: stp	x19, x20, [sp, #-32]!
+// CHECK: str	x21, [sp, #16]
+// CHECK: ldr	x21, [sp, #16]
+// CHECK: ldp	x19, x20, [sp], #32
+// CHECK: str	x30, [sp, #-16]!
+// CHECK: ldr	x30, [sp], #16
+int many_live(int x) {
+  int a0 = x + 0;
+  int a1 = x + 1;
+  int a2 = x + 2;
+  int a3 = x + 3;
+  int a4 = x + 4;
+  int a5 = x + 5;
+  int a6 = x + 6;
+  int a7 = x + 7;
+  int a8 = x + 8;
+  int a9 = x + 9;
+  int a10 = x + 10;
+  int a11 = x + 11;
+  int a12 = x + 12;
+  int a13 = x + 13;
+  int a14 = x + 14;
+  return a0 * (a1 * (a2 * (a3 * (a4 * (a5 * (a6 * (a7 * (a8 * (a9 *
+         (a10 * (a11 * (a12 * (a13 * (a14 * x))))))))))))));
+}
+
+void callee() {}
+
+int caller() {
+  callee();
+  return 1;
+}
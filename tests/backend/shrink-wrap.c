@@ -0,0 +1,16 @@
+// COMPILE-TEST
+
+int g;
+void callee();
+
+// The link register is only saved on the path doing the call.
+// CHECK: call_if_set:
+// CHECK: cmp
+// CHECK: str	x30, [sp, #-16]!
+// CHECK: bl	callee
+// CHECK: ldr	x30, [sp], #16
+// CHECK: ret
+void call_if_set() {
+  if (g != 0)
+    callee();
+}
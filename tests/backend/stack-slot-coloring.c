@@ -0,0 +1,26 @@
+// COMPILE-TEST
+// EXTRA-FLAGS: -stack-slot-coloring
+
+// The locals of the branches are never live at the same time, so they share
+// the memory of the parameter, which is dead after its last read. Without
+// sharing the six slots would need a 32 byte frame.
+// CHECK: disjoint:
+// CHECK: sub	sp, sp, #16
+// CHECK: add	sp, sp, #16
+int disjoint(int x) {
+  int r = 0;
+  if (x > 10) {
+    int a = x * 2;
+    r = a;
+  } else if (x > 5) {
+    int b = x + 3;
+    r = b;
+  } else if (x > 0) {
+    int c = x - 1;
+    r = c;
+  } else {
+    int d = x * x;
+    r = d;
+  }
+  return r;
+}
@@ -0,0 +1,39 @@
+// COMPILE-TEST
+// EXTRA-FLAGS: -store-merging
+
+// The adjacent fields are initialized by a single 64 bit store of their
+// combined value and the four bytes of the array by a 32 bit one.
+// CHECK: fields:
+// CHECK: mov	x1, #1
+// CHECK: movk	x1, #2, lsl #32
+// CHECK: str	x1, [sp, #0]
+// CHECK-NOT: strb
+struct S {
+  int a;
+  int b;
+  char c[4];
+};
+
+int fields() {
+  struct S s;
+  s.a = 1;
+  s.b = 2;
+  s.c[0] = 0;
+  s.c[1] = 0;
+  s.c[2] = 0;
+  s.c[3] = 0;
+  return s.a + s.b + s.c[3];
+}
+
+// The store in between might overwrite the first one, so they are not merged.
+// CHECK: aliased:
+// CHECK: strh
+// CHECK: strh
+// CHECK: strh
+short g[2];
+
+void aliased(short *p) {
+  g[0] = 1;
+  *p = 3;
+  g[1] = 2;
+}
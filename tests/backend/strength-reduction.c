@@ -0,0 +1,43 @@
+// RUN: AArch64
+// EXTRA-FLAGS: -strength-reduction
+
+// Multiplications, divisions and remainders by constants are computed without
+// mul and div instructions, or by multiplying with a magic number.
+
+// FUNC-DECL: int div_pow2(int)
+// TEST-CASE: div_pow2(100) -> 12
+// TEST-CASE: div_pow2(-100) -> -12
+// TEST-CASE: div_pow2(-2147483648) -> -268435456
+
+// FUNC-DECL: int div_signed(int)
+// TEST-CASE: div_signed(100) -> 14
+// TEST-CASE: div_signed(-100) -> -14
+// TEST-CASE: div_signed(2147483647) -> 306783378
+
+// FUNC-DECL: int mod_signed(int)
+// TEST-CASE: mod_signed(1234) -> 34
+// TEST-CASE: mod_signed(-1234) -> -34
+
+// FUNC-DECL: unsigned div_unsigned(unsigned)
+// TEST-CASE: div_unsigned(4294967295) -> 613566756
+// TEST-CASE: div_unsigned(13) -> 1
+
+// FUNC-DECL: unsigned mod_unsigned(unsigned)
+// TEST-CASE: mod_unsigned(4294967295) -> 295
+// TEST-CASE: mod_unsigned(641) -> 641
+
+// FUNC-DECL: long div_long(long)
+// TEST-CASE: div_long(-1000000000000) -> -333333333333
+// TEST-CASE: div_long(1000000000001) -> 333333333333
+
+// FUNC-DECL: int mul_shift_add(int)
+// TEST-CASE: mul_shift_add(-3) -> -27
+// TEST-CASE: mul_shift_add(1000) -> 9000
+
+int div_pow2(int x) { return x / 8; }
+int div_signed(int x) { return x / 7; }
+int mod_signed(int x) { return x % 100; }
+unsigned div_unsigned(unsigned x) { return x / 7u; }
+unsigned mod_unsigned(unsigned x) { return x % 1000u; }
+long div_long(long x) { return x / 3; }
+int mul_shift_add(int x) { return x * 9; }
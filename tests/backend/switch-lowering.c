@@ -0,0 +1,102 @@
+// RUN: AArch64
+
+// FUNC-DECL: int test(int, int)
+// TEST-CASE: test(0, 0) -> -1
+// TEST-CASE: test(0, 2) -> 20
+// TEST-CASE: test(0, 4) -> -1
+// TEST-CASE: test(0, 6) -> 60
+// TEST-CASE: test(0, 7) -> -1
+// TEST-CASE: test(0, 8) -> 80
+// TEST-CASE: test(1, 7) -> 2
+// TEST-CASE: test(1, 8) -> 9
+// TEST-CASE: test(1, 5000) -> 5
+// TEST-CASE: test(1, 90000) -> 7
+// TEST-CASE: test(1, -5) -> 9
+// TEST-CASE: test(2, 97) -> 1
+// TEST-CASE: test(2, 99) -> 2
+// TEST-CASE: test(2, 100) -> 0
+// TEST-CASE: test(2, 117) -> 1
+// TEST-CASE: test(2, 118) -> 0
+// TEST-CASE: test(3, 69999) -> -1
+// TEST-CASE: test(3, 70000) -> 1
+// TEST-CASE: test(3, 70003) -> 12
+// TEST-CASE: test(3, 70005) -> 25
+// TEST-CASE: test(3, 70006) -> -1
+// TEST-CASE: test(4, 2147483639) -> 0
+// TEST-CASE: test(4, 2147483640) -> 1
+// TEST-CASE: test(4, 2147483643) -> 2
+// TEST-CASE: test(4, 2147483647) -> 3
+
+// jump table
+int dense(int x) {
+  switch (x) {
+  case 1: return 10;
+  case 2: return 20;
+  case 3: return 30;
+  case 5: return 50;
+  case 6: return 60;
+  case 8: return 80;
+  default: return -1;
+  }
+}
+
+// jump table, the index is relative to a bias not fitting into an immediate
+int high(int x) {
+  switch (x) {
+  case 70000: return 1;
+  case 70001: return 4;
+  case 70002: return 9;
+  case 70003: return 12;
+  case 70004: return 16;
+  case 70005: return 25;
+  default: return -1;
+  }
+}
+
+int top(int x) {
+  switch (x) {
+  case 2147483640: case 2147483641: case 2147483642: return 1;
+  case 2147483643: case 2147483644: return 2;
+  case 2147483645: case 2147483646: case 2147483647: return 3;
+  }
+  return 0;
+}
+
+// binary search
+int sparse(int x) {
+  int r = 0;
+  switch (x) {
+  case 100: r = 1; break;
+  case 7: r = 2; break;
+  case 300: r = 3; break;
+  case 1000: r = 4; break;
+  case 5000: r = 5; break;
+  case 70000: r = 6; break;
+  case 90000: r = 7; break;
+  default: r = 9;
+  }
+  return r;
+}
+
+// bit tests
+int vowel(char c) {
+  switch (c) {
+  case 97: case 101: case 105: case 111: case 117:
+    return 1;
+  case 98: case 99:
+    return 2;
+  }
+  return 0;
+}
+
+int test(int select, int x) {
+  if (select == 0)
+    return dense(x);
+  if (select == 1)
+    return sparse(x);
+  if (select == 2)
+    return vowel(x);
+  if (select == 3)
+    return high(x);
+  return top(x);
+}
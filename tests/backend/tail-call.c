@@ -0,0 +1,22 @@
+// COMPILE-TEST
+
+int sum_to(int n, int acc) {
+  if (n == 0)
+    return acc;
+  return sum_to(n - 1, acc + n);
+}
+
+void use(int *p);
+
+// A call returning to the caller is replaced by a jump after the frame is
+// torn down, unless a pointer into the frame might be used by the callee.
+// CHECK: sum_to:
+// CHECK: add	sp, sp, #16
+// CHECK: b	sum_to
+// CHECK: escaping:
+// CHECK: bl	use
+// CHECK: ret
+void escaping() {
+  int x = 0;
+  use(&x);
+}
@@ -0,0 +1,75 @@
+// RUN: AArch64
+
+// FUNC-DECL: int test_clz(int)
+// FUNC-DECL: int test_ctz(int)
+// FUNC-DECL: int test_popcount(int)
+// FUNC-DECL: int test_popcountll(int)
+// FUNC-DECL: int test_rotl(int, int)
+// FUNC-DECL: int test_rotr(int)
+// FUNC-DECL: int test_bswap(int)
+// FUNC-DECL: int test_bswap16(int)
+// FUNC-DECL: int test_bswap64(int)
+// FUNC-DECL: int test_crc32b(int)
+// FUNC-DECL: int test_crc32h(int)
+// FUNC-DECL: int test_crc32w(int)
+// FUNC-DECL: int test_crc32d(int)
+// FUNC-DECL: int test_constant()
+
+// TEST-CASE: test_clz(1) -> 31
+// TEST-CASE: test_clz(15728640) -> 8
+// TEST-CASE: test_ctz(8) -> 3
+// TEST-CASE: test_ctz(1048576) -> 20
+// TEST-CASE: test_popcount(255) -> 8
+// TEST-CASE: test_popcount(-1) -> 32
+// TEST-CASE: test_popcountll(7) -> 6
+// TEST-CASE: test_rotl(305419896, 8) -> 878082066
+// TEST-CASE: test_rotl(-2147483647, 1) -> 3
+// TEST-CASE: test_rotl(5, 0) -> 5
+// TEST-CASE: test_rotr(305419896) -> -2128394905
+// TEST-CASE: test_bswap(305419896) -> 2018915346
+// TEST-CASE: test_bswap16(463412) -> 13330
+// TEST-CASE: test_bswap64(305419896) -> 2018915346
+// TEST-CASE: test_crc32b(97) -> -390611389
+// TEST-CASE: test_crc32h(1000) -> 1316436641
+// TEST-CASE: test_crc32w(305419896) -> -1351776302
+// TEST-CASE: test_crc32d(305419896) -> 101685917
+// TEST-CASE: test_constant() -> 31
+
+int test_clz(int x) { return __builtin_clz(x); }
+
+int test_ctz(int x) { return __builtin_ctz(x); }
+
+int test_popcount(int x) { return __builtin_popcount(x); }
+
+int test_popcountll(int x) {
+  unsigned long long v = x;
+  return __builtin_popcountll(v << 32 | v);
+}
+
+int test_rotl(int x, int n) { return __builtin_rotateleft32(x, n); }
+
+int test_rotr(int x) { return __builtin_rotateright32(x, 4); }
+
+int test_bswap(int x) { return __builtin_bswap32(x); }
+
+int test_bswap16(int x) { return __builtin_bswap16(x); }
+
+int test_bswap64(int x) {
+  unsigned long long v = x;
+  return __builtin_bswap64(v) >> 32;
+}
+
+int test_crc32b(int x) { return ~__builtin_arm_crc32b(0xffffffff, x); }
+
+int test_crc32h(int x) { return ~__builtin_arm_crc32h(0xffffffff, x); }
+
+int test_crc32w(int x) { return ~__builtin_arm_crc32w(0xffffffff, x); }
+
+int test_crc32d(int x) {
+  unsigned long long v = x;
+  return ~__builtin_arm_crc32d(0xffffffff, v * 16 + 9);
+}
+
+int test_constant() {
+  return __builtin_clz(256) + __builtin_popcount(0xf0f0);
+}
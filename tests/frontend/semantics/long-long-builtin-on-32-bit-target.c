@@ -0,0 +1,4 @@
+// COMPILE-FAIL
+// EXTRA-FLAGS: -arch=riscv32
+
+int test(unsigned long long a) { return __builtin_popcountll(a); }
@@ -0,0 +1,60 @@
+// RUN: AArch64
+// EXTRA-FLAGS: -bit-idiom -loop-unroll -cse
+
+// FUNC-DECL: unsigned rotate_left(unsigned)
+// FUNC-DECL: unsigned rotate_right(unsigned, unsigned)
+// FUNC-DECL: unsigned byte_swap(unsigned)
+// FUNC-DECL: unsigned short byte_swap16(unsigned short)
+// FUNC-DECL: int count_bits(unsigned)
+// FUNC-DECL: unsigned crc_byte(unsigned, unsigned char)
+// FUNC-DECL: unsigned crc_half(unsigned)
+
+// TEST-CASE: rotate_left(305419896) -> 878082066
+// TEST-CASE: rotate_right(305419896, 4) -> 2166572391
+// TEST-CASE: rotate_right(1, 31) -> 2
+// TEST-CASE: byte_swap(305419896) -> 2018915346
+// TEST-CASE: byte_swap16(4660) -> 13330
+// TEST-CASE: count_bits(0) -> 0
+// TEST-CASE: count_bits(255) -> 8
+// TEST-CASE: count_bits(-1) -> 32
+// TEST-CASE: crc_byte(-1, 97) -> 390611388
+// TEST-CASE: crc_half(4660) -> 1217626815
+
+unsigned rotate_left(unsigned x) { return (x << 8) | (x >> 24); }
+
+unsigned rotate_right(unsigned x, unsigned n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+unsigned byte_swap(unsigned x) {
+  return (x << 24) | ((x & 65280) << 8) | ((x >> 8) & 65280) | (x >> 24);
+}
+
+unsigned short byte_swap16(unsigned short x) { return (x << 8) | (x >> 8); }
+
+int count_bits(unsigned x) {
+  int c = 0;
+  while (x) {
+    x &= x - 1;
+    c++;
+  }
+  return c;
+}
+
+unsigned crc_byte(unsigned crc, unsigned char byte) {
+  crc = crc ^ byte;
+  for (unsigned char j = 8; j > 0; --j)
+    crc = (crc >> 1) ^ (0xEDB88320 & (-(crc & 1)));
+  return crc;
+}
+
+#define STEP(c) c = (c >> 1) ^ (0xEDB88320 & (-(c & 1)))
+#define STEP4(c) STEP(c); STEP(c); STEP(c); STEP(c)
+
+unsigned crc_half(unsigned crc) {
+  STEP4(crc);
+  STEP4(crc);
+  STEP4(crc);
+  STEP4(crc);
+  return crc;
+}
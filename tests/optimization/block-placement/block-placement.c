@@ -0,0 +1,59 @@
+// RUN: AArch64
+// EXTRA-FLAGS: -block-placement
+
+// FUNC-DECL: int sum_to(int)
+// FUNC-DECL: int collatz(int)
+// FUNC-DECL: int is_set(long)
+// FUNC-DECL: int grid(int)
+
+// TEST-CASE: sum_to(10) -> 45
+// TEST-CASE: sum_to(2000) -> -1001
+// TEST-CASE: collatz(27) -> 111
+// TEST-CASE: collatz(1) -> 0
+// TEST-CASE: is_set(4294967296) -> 1
+// TEST-CASE: is_set(0) -> 0
+// TEST-CASE: grid(6) -> 4
+
+int fail(int x) { return -x; }
+
+int sum_to(int n) {
+  int s = 0;
+  for (int i = 0; i < n; i = i + 1) {
+    if (__builtin_expect(i > 1000, 0))
+      return fail(i);
+    s = s + i;
+  }
+  return s;
+}
+
+int collatz(int n) {
+  int steps = 0;
+  while (n != 1) {
+    if (n % 2 == 0)
+      n = n / 2;
+    else
+      n = 3 * n + 1;
+    steps = steps + 1;
+  }
+  return steps;
+}
+
+int is_set(long x) {
+  if (__builtin_expect(x, 1))
+    return 1;
+  return 0;
+}
+
+int grid(int n) {
+  int c = 0;
+  int i = 0;
+  do {
+    for (int j = 0; j < i; j = j + 1)
+      if ((j & 1) == 0)
+        c = c + j;
+      else
+        c = c - 1;
+    i = i + 1;
+  } while (i < n);
+  return c;
+}
@@ -0,0 +1,27 @@
+// COMPILE-TEST
+// EXTRA-FLAGS: -block-placement
+
+int fail(int x);
+
+// The loop is rotated, so each iteration ends with a single branch back to
+// its aligned top. The unlikely error path is moved to the end.
+// CHECK: b	.L0_loop_header0
+// CHECK: .p2align 4
+// CHECK: .L0_loop_body0:
+// CHECK: b.ne	.L0_if_true0
+// CHECK: .L0_if_end0:
+// CHECK: .L0_loop_header0:
+// CHECK: b.lt	.L0_loop_body0
+// CHECK: .L0_loop_end0:
+// CHECK: ret
+// CHECK: .L0_if_true0:
+// CHECK: b	fail
+int checked_sum(int *a, int n) {
+  int s = 0;
+  for (int i = 0; i < n; i = i + 1) {
+    if (__builtin_expect(a[i] < 0, 0))
+      return fail(i);
+    s = s + a[i];
+  }
+  return s;
+}
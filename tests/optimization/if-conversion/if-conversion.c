@@ -0,0 +1,51 @@
+// RUN: AArch64
+// EXTRA-FLAGS: -if-convert -cse
+
+// FUNC-DECL: int max(int, int)
+// FUNC-DECL: int clamp_zero(int)
+// FUNC-DECL: int is_negative(int)
+// FUNC-DECL: long long pick(int, long long, long long)
+// FUNC-DECL: int no_div(int, int)
+
+// TEST-CASE: max(3, 7) -> 7
+// TEST-CASE: max(-2, -5) -> -2
+// TEST-CASE: clamp_zero(-9) -> 0
+// TEST-CASE: clamp_zero(12) -> 12
+// TEST-CASE: is_negative(-1) -> 1
+// TEST-CASE: is_negative(0) -> 0
+// TEST-CASE: pick(1, 4294967296, 5) -> 4294967296
+// TEST-CASE: pick(0, 4294967296, 5) -> 5
+// TEST-CASE: no_div(7, 0) -> 0
+// TEST-CASE: no_div(7, 2) -> 3
+
+int max(int a, int b) { return (a > b) ? a : b; }
+
+int clamp_zero(int x) {
+  if (x < 0)
+    x = 0;
+  return x;
+}
+
+int is_negative(int x) {
+  int r;
+  if (x < 0)
+    r = 1;
+  else
+    r = 0;
+  return r;
+}
+
+long long pick(int c, long long a, long long b) {
+  long long r = b;
+  if (c)
+    r = a;
+  return r;
+}
+
+// The division must not be speculated
+int no_div(int a, int b) {
+  int r = 0;
+  if (b != 0)
+    r = a / b;
+  return r;
+}
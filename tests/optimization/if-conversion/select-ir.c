@@ -0,0 +1,11 @@
+// COMPILE-TEST
+// EXTRA-FLAGS: -if-convert -dump-ir
+
+// Both sides of the ternary are loaded unconditionally and the branch is
+// replaced with a select of them, which picks the else side when the
+// branch would have been taken
+// CHECK: cmp.le	$6<i1>, $4<i32>, $5<i32>
+// CHECK: sel	$11<i32>, $6<i1>, $9<i32>, $7<i32>
+// CHECK-NOT: br
+
+int max(int a, int b) { return (a > b) ? a : b; }
@@ -0,0 +1,93 @@
+// RUN: AArch64
+// EXTRA-FLAGS: -loop-idiom
+
+// FUNC-DECL: int test_zero(int)
+// FUNC-DECL: int test_fill(int)
+// FUNC-DECL: int test_copy(int)
+// FUNC-DECL: int test_overlap(int)
+// FUNC-DECL: int test_counter(int)
+
+// TEST-CASE: test_zero(0) -> 2016
+// TEST-CASE: test_zero(10) -> 1971
+// TEST-CASE: test_zero(64) -> 0
+// TEST-CASE: test_fill(5) -> -12
+// TEST-CASE: test_fill(40) -> -82
+// TEST-CASE: test_copy(1) -> 0
+// TEST-CASE: test_copy(33) -> 528
+// TEST-CASE: test_overlap(20) -> 40
+// TEST-CASE: test_counter(-3) -> -3
+// TEST-CASE: test_counter(12) -> 12
+
+int a[64];
+char c[64];
+
+void init() {
+  for (int i = 0; i < 64; i++) {
+    a[i] = i;
+    c[i] = 1;
+  }
+}
+
+int sum(int *x) {
+  int s = 0;
+  for (int i = 0; i < 64; i++)
+    s += x[i];
+  return s;
+}
+
+void zero(int *x, int n) {
+  for (int i = 0; i < n; i++)
+    x[i] = 0;
+}
+
+void fill(char *x, int n) {
+  for (int i = 0; i <= n; i++)
+    x[i] = -1;
+}
+
+void copy(int *x, int *y, long n) {
+  for (long i = 0; i < n; i++)
+    x[i] = y[i];
+}
+
+int test_zero(int n) {
+  init();
+  zero(a, n);
+  return sum(a);
+}
+
+int test_fill(int n) {
+  init();
+  fill(c, n);
+  int s = 0;
+  for (int i = 0; i < 64; i++)
+    s += c[i];
+  return s - 64;
+}
+
+int test_copy(int n) {
+  int b[64];
+  init();
+  for (int i = 0; i < 64; i++)
+    b[i] = 0;
+  copy(b, a, n);
+  return sum(b);
+}
+
+// The ranges overlap, so each copied element is copied again
+int test_overlap(int n) {
+  init();
+  int *p = a;
+  p[0] = 2;
+  copy(p + 1, p, n);
+  return a[n] * n;
+}
+
+int test_counter(int n) {
+  int i;
+  for (i = 0; i < n; i++)
+    a[i] = 0;
+  if (i == 0)
+    return n;
+  return i;
+}
@@ -0,0 +1,26 @@
+// COMPILE-TEST
+// EXTRA-FLAGS: -loop-strength-reduction -dump-ir
+
+// The address of a[i] is computed once before the loop and then advanced by
+// one element in each iteration. Since i is only used for the exit test, the
+// test compares the pointer against the precomputed address of a[n].
+
+// CHECK: gep	$21<*i32>, $19<*i32>, $20<i32>
+// CHECK: str	[$18<**i32>], $21<*i32>
+// CHECK: gep	$27<*i32>, $19<*i32>, $26<i32>
+// CHECK: str	[$25<**i32>], $27<*i32>
+// CHECK: .loop_header0:
+// CHECK: cmp.ge	$8<i1>, $28<*i32>, $29<*i32>
+// CHECK: .loop_body0:
+// CHECK: ld	$24<*i32>, [$18<**i32>]
+// CHECK: ld	$12<i32>, [$24<*i32>]
+// CHECK: .loop_increment0:
+// CHECK: gep	$23<*i32>, $22<*i32>, 1<u32>
+// CHECK: str	[$18<**i32>], $23<*i32>
+// CHECK: .loop_end0:
+int sum(int *a, int n) {
+  int s = 0;
+  for (int i = 0; i < n; i++)
+    s += a[i];
+  return s;
+}
@@ -0,0 +1,66 @@
+// RUN: AArch64
+// EXTRA-FLAGS: -loop-strength-reduction
+
+// FUNC-DECL: int test_sum(int)
+// FUNC-DECL: int test_step(int)
+// FUNC-DECL: int test_nested()
+// FUNC-DECL: long test_long(int)
+
+// TEST-CASE: test_sum(10) -> 285
+// TEST-CASE: test_sum(0) -> 0
+// TEST-CASE: test_sum(-3) -> 0
+// TEST-CASE: test_step(9) -> 2010
+// TEST-CASE: test_nested() -> 675
+// TEST-CASE: test_long(5) -> 12345
+
+int arr[10];
+long larr[5];
+
+int test_sum(int n) {
+  int s = 0;
+  for (int i = 0; i < 10; i++)
+    arr[i] = i * i;
+  for (int i = 0; i < n; i++)
+    s += arr[i];
+  return s;
+}
+
+// The counter is needed after the loop, so the exit test is kept
+int test_step(int n) {
+  int a[10];
+  int i = 0;
+  for (int j = 0; j < 10; j++)
+    a[j] = j;
+  int s = 0;
+  while (i <= n) {
+    s += a[i];
+    i += 2;
+  }
+  return s * 100 + i;
+}
+
+int test_nested() {
+  int a[5];
+  int b[10];
+  int s = 0;
+  for (int i = 0; i < 5; i++)
+    a[i] = i + 1;
+  for (int j = 0; j < 10; j++)
+    b[j] = j;
+  for (int i = 0; i < 5; i++)
+    for (int j = 0; j < 10; j++)
+      s += a[i] * b[j];
+  return s;
+}
+
+long test_long(int n) {
+  long v = 1;
+  for (int i = 0; i < n; i++) {
+    larr[i] = v;
+    v = v * 10 + 1;
+  }
+  long s = 0;
+  for (int i = 0; i < n; i++)
+    s += larr[i];
+  return s;
+}
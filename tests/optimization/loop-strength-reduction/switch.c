@@ -0,0 +1,71 @@
+// RUN: AArch64
+// EXTRA-FLAGS: -O
+
+// The default of the jump table is only reached through the bounds check
+// before it, so it must stay a successor of the switch.
+
+// FUNC-DECL: int pick(int)
+// FUNC-DECL: int sum_picks(int)
+
+// TEST-CASE: pick(0) -> 1
+// TEST-CASE: pick(3) -> 13
+// TEST-CASE: pick(5) -> 21
+// TEST-CASE: pick(6) -> -1
+// TEST-CASE: pick(-1) -> -1
+// TEST-CASE: sum_picks(8) -> 64
+
+int pick(int x) {
+  int r = 0;
+  switch (x) {
+  case 0:
+    r = 1;
+    break;
+  case 1:
+    r = 5;
+    break;
+  case 2:
+    r = 9;
+    break;
+  case 3:
+    r = 13;
+    break;
+  case 4:
+    r = 17;
+    break;
+  case 5:
+    r = 21;
+    break;
+  default:
+    r = -1;
+  }
+  return r;
+}
+
+int sum_picks(int n) {
+  int s = 0;
+  for (int i = 0; i < n; i++) {
+    switch (i) {
+    case 0:
+      s = s + 1;
+      break;
+    case 1:
+      s = s + 5;
+      break;
+    case 2:
+      s = s + 9;
+      break;
+    case 3:
+      s = s + 13;
+      break;
+    case 4:
+      s = s + 17;
+      break;
+    case 5:
+      s = s + 21;
+      break;
+    default:
+      s = s - 1;
+    }
+  }
+  return s;
+}
@@ -0,0 +1,22 @@
+// COMPILE-TEST
+// EXTRA-FLAGS: -loop-unroll -dump-ir
+
+// The loop runs three times, so it is replaced by three copies of its body
+// merged into a single block without the exit tests.
+
+// CHECK: j	<loop_header0_unroll0>
+// CHECK: .loop_header0_unroll0:
+// CHECK: str	[$3<*i32>], $24<i32>
+// CHECK: str	[$3<*i32>], $34<i32>
+// CHECK: str	[$3<*i32>], $44<i32>
+// CHECK: j	<loop_end0>
+// CHECK: .loop_end0:
+// CHECK-NOT: cmp.ge
+// CHECK-NOT: .loop_body0
+
+int sum(int *a) {
+  int s = 0;
+  for (int i = 0; i < 3; i++)
+    s += a[i];
+  return s;
+}
@@ -0,0 +1,59 @@
+// RUN: AArch64
+// EXTRA-FLAGS: -loop-unroll
+
+// FUNC-DECL: unsigned test_full(unsigned)
+// FUNC-DECL: int test_partial(int)
+// FUNC-DECL: int test_down(int)
+// FUNC-DECL: int test_near_max(int)
+// FUNC-DECL: int test_break(int)
+
+// TEST-CASE: test_full(1) -> 1996959894
+// TEST-CASE: test_full(97) -> 984961486
+// TEST-CASE: test_partial(0) -> 0
+// TEST-CASE: test_partial(1) -> 0
+// TEST-CASE: test_partial(3) -> 5
+// TEST-CASE: test_partial(4) -> 14
+// TEST-CASE: test_partial(10) -> 285
+// TEST-CASE: test_down(5) -> 195
+// TEST-CASE: test_down(25) -> 0
+// TEST-CASE: test_near_max(2147483647) -> 7
+// TEST-CASE: test_break(3) -> 3
+// TEST-CASE: test_break(100) -> 45
+
+unsigned test_full(unsigned crc) {
+  for (unsigned char j = 8; j > 0; --j)
+    crc = (crc >> 1) ^ (0xEDB88320 & (-(crc & 1)));
+  return crc;
+}
+
+int test_partial(int n) {
+  int s = 0;
+  for (int i = 0; i < n; i++)
+    s += i * i;
+  return s;
+}
+
+int test_down(int n) {
+  int s = 0;
+  for (int i = 20; i > n; i--)
+    s += i;
+  return s;
+}
+
+// The unrolled exit test would overflow, so only the remainder loop runs
+int test_near_max(int n) {
+  int c = 0;
+  for (int i = 2147483640; i < n; i++)
+    c++;
+  return c;
+}
+
+int test_break(int n) {
+  int s = 0;
+  for (int i = 0; i < 10; i++) {
+    if (i == n)
+      break;
+    s += i;
+  }
+  return s;
+}
@@ -0,0 +1,23 @@
+// COMPILE-TEST
+// EXTRA-FLAGS: -loop-vectorize
+
+// The loop invariant factor is copied into each lane of a vector, then four
+// elements are scaled in each iteration of the vectorized loop. The remaining
+// elements are scaled by the original loop.
+
+// CHECK: .L0_loop_header0_vec:
+// CHECK: add	w4, w1, #3
+// CHECK: b.ge	.L0_loop_header0
+// CHECK: ld1	{v16.4s}, [x1]
+// CHECK: fmov	w1, s0
+// CHECK: dup	v17.4s, w1
+// CHECK: fmul	v18.4s, v16.4s, v17.4s
+// CHECK: st1	{v18.4s}, [x1]
+// CHECK: add	w3, w1, #4
+// CHECK: b	.L0_loop_header0_vec
+// CHECK: .L0_loop_header0:
+
+void scale(float *a, float k, int n) {
+  for (int i = 0; i < n; i++)
+    a[i] = a[i] * k;
+}
@@ -0,0 +1,110 @@
+// RUN: AArch64
+// EXTRA-FLAGS: -loop-vectorize
+
+// FUNC-DECL: int test_add(int)
+// FUNC-DECL: int test_sum(int)
+// FUNC-DECL: int test_greater(int)
+// FUNC-DECL: int test_mask(int)
+// FUNC-DECL: int test_overlap(int)
+// FUNC-DECL: int test_distance(int)
+
+// TEST-CASE: test_add(0) -> 0
+// TEST-CASE: test_add(3) -> -242
+// TEST-CASE: test_add(4) -> -390
+// TEST-CASE: test_add(7) -> -980
+// TEST-CASE: test_add(64) -> 85280
+// TEST-CASE: test_sum(1) -> 2500
+// TEST-CASE: test_sum(7) -> 12019
+// TEST-CASE: test_sum(64) -> 323296
+// TEST-CASE: test_greater(20) -> 90
+// TEST-CASE: test_greater(64) -> 1960
+// TEST-CASE: test_mask(7) -> 19104
+// TEST-CASE: test_mask(64) -> 145728
+// TEST-CASE: test_overlap(7) -> 158374
+// TEST-CASE: test_overlap(60) -> -1212895
+// TEST-CASE: test_distance(7) -> 157422
+// TEST-CASE: test_distance(60) -> -422800
+
+int a[64];
+int b[64];
+int c[64];
+int k;
+
+void fill() {
+  for (int i = 0; i < 64; i++) {
+    a[i] = i * 3 - 50;
+    b[i] = 7 - i;
+    c[i] = 0;
+  }
+}
+
+int checksum(int *x) {
+  int s = 0;
+  for (int i = 0; i < 64; i++)
+    s += x[i] * (i + 1);
+  return s;
+}
+
+void add(int *x, int *y, int *z, int n) {
+  for (int i = 0; i < n; i++)
+    x[i] = y[i] + z[i];
+}
+
+int sum(int *x, int n) {
+  int s = 0;
+  for (int i = 0; i < n; i++)
+    s += x[i] * x[i];
+  return s;
+}
+
+void greater(int *x, int *y, int *z, int n) {
+  for (int i = 0; i < n; i++)
+    z[i] = x[i] > y[i];
+}
+
+void mask() {
+  for (int i = 0; i < 64; i++)
+    c[i] = (a[i] & 12) ^ k;
+}
+
+void add_shifted(int *x, int *y, int d, int n) {
+  add(&x[d], x, y, n);
+}
+
+int test_add(int n) {
+  fill();
+  add(c, a, b, n);
+  return checksum(c);
+}
+
+int test_sum(int n) {
+  fill();
+  return sum(a, n);
+}
+
+int test_greater(int n) {
+  fill();
+  greater(a, b, c, n);
+  return checksum(c);
+}
+
+int test_mask(int n) {
+  fill();
+  k = n;
+  mask();
+  return checksum(c);
+}
+
+// The arrays overlap within the lanes, so only the scalar loop runs
+int test_overlap(int n) {
+  fill();
+  add_shifted(a, b, 1, n);
+  return checksum(a);
+}
+
+// The arrays are 4 elements apart, which the lanes do not reach
+int test_distance(int n) {
+  fill();
+  add_shifted(a, b, 4, n);
+  return checksum(a);
+}
@@ -0,0 +1,19 @@
+// COMPILE-TEST
+// EXTRA-FLAGS: -fprofile-generate -dump-ir
+
+// The record holds the number of blocks, the number of double words of the
+// names, the names and then the counters
+// CHECK: __minicc_prof_max in minicc_prof = { 3, 4,
+// CHECK: .entry_max:
+// CHECK: gep	$11<*i64>, @__minicc_prof_max<[9 x i64]>, 6<u32>
+// CHECK: add	$13<i64>, $12<i64>, 1<u64>
+// CHECK: .if_true0:
+// CHECK: gep	$14<*i64>, @__minicc_prof_max<[9 x i64]>, 7<u32>
+// CHECK: .section minicc_prof,"aw"
+
+int max(int a, int b) {
+  int r = b;
+  if (a > b)
+    r = a;
+  return r;
+}
@@ -0,0 +1,31 @@
+// RUN: AArch64
+// EXTRA-FLAGS: -fprofile-generate -O
+
+// FUNC-DECL: int sum(int)
+// FUNC-DECL: int classify(int)
+
+// TEST-CASE: sum(32) -> 740
+// TEST-CASE: classify(7) -> 70
+// TEST-CASE: classify(3) -> 0
+
+int classify(int x) {
+  int r;
+  switch (x) {
+  case 1: r = 10; break;
+  case 2: r = 20; break;
+  case 7: r = 70; break;
+  default: r = 0;
+  }
+  return r;
+}
+
+int sum(int n) {
+  int s = 0;
+  for (int i = 0; i < n; i++) {
+    if (i % 16 == 15)
+      s += classify(7);
+    else
+      s += classify(2);
+  }
+  return s;
+}
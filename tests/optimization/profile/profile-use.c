@@ -0,0 +1,29 @@
+// COMPILE-TEST
+// EXTRA-FLAGS: -fprofile-use=optimization/profile/profile-use.profdata -dump-ir
+
+// The compares of the switch are ordered by the counts of the cases and the
+// hottest case is placed right after the dispatch, falling through to the
+// end, the never executed ones are placed last
+// CHECK: cmp.eq	$5<i1>, $3<i32>, 2<u32>
+// CHECK: cmp.eq	$6<i1>, $3<i32>, 7<u32>
+// CHECK: cmp.eq	$4<i1>, $3<i32>, 1<u32>
+// CHECK: j	<switch_default0>
+// CHECK: .switch_case1:
+// CHECK: .switch_end0:
+// CHECK: ret	$7<i32>
+// CHECK: .L0_switch_case1:
+// CHECK: .L0_switch_end0:
+// CHECK: .L0_switch_case2:
+// CHECK: .L0_switch_case0:
+// CHECK: .L0_switch_default0:
+
+int classify(int x) {
+  int r;
+  switch (x) {
+  case 1: r = 10; break;
+  case 2: r = 20; break;
+  case 7: r = 70; break;
+  default: r = 0;
+  }
+  return r;
+}
@@ -0,0 +1,56 @@
+// RUN: AArch64
+// EXTRA-FLAGS: -simplify-cfg
+
+// FUNC-DECL: int both(int, int)
+// FUNC-DECL: int skip_odd(int)
+// FUNC-DECL: int first_over(int)
+// FUNC-DECL: int classify(int)
+
+// TEST-CASE: both(1, 2) -> 3
+// TEST-CASE: both(1, 0) -> -1
+// TEST-CASE: both(0, 5) -> -1
+// TEST-CASE: skip_odd(10) -> 20
+// TEST-CASE: first_over(50) -> 51
+// TEST-CASE: classify(1) -> 11
+// TEST-CASE: classify(2) -> 12
+// TEST-CASE: classify(7) -> 0
+
+int both(int a, int b) {
+  if (a > 0 && b > 0)
+    return a + b;
+  return -1;
+}
+
+int skip_odd(int n) {
+  int s = 0;
+  for (int i = 0; i < n; i++) {
+    if (i % 2)
+      continue;
+    s += i;
+  }
+  return s;
+}
+
+int first_over(int n) {
+  int i = 0;
+  while (1) {
+    if (i > n)
+      break;
+    i++;
+  }
+  return i;
+}
+
+int classify(int c) {
+  int r = 0;
+  switch (c) {
+  case 1:
+    r = 11;
+    break;
+  case 2:
+    r = 12;
+  default:
+    break;
+  }
+  return r;
+}
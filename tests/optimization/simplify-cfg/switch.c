@@ -0,0 +1,62 @@
+// RUN: AArch64
+// EXTRA-FLAGS: -simplify-cfg
+
+// The cases of the dense switches are reached through a jump table and the
+// default through the bounds check before it, none of them is deleted.
+
+// FUNC-DECL: int pick(int)
+// FUNC-DECL: int fall(int)
+
+// TEST-CASE: pick(0) -> 1
+// TEST-CASE: pick(4) -> 17
+// TEST-CASE: pick(5) -> 21
+// TEST-CASE: pick(9) -> -1
+// TEST-CASE: fall(0) -> 7
+// TEST-CASE: fall(2) -> 6
+// TEST-CASE: fall(4) -> 4
+// TEST-CASE: fall(-3) -> 0
+
+int pick(int x) {
+  int r = 0;
+  switch (x) {
+  case 0:
+    r = 1;
+    break;
+  case 1:
+    r = 5;
+    break;
+  case 2:
+    r = 9;
+    break;
+  case 3:
+    r = 13;
+    break;
+  case 4:
+    r = 17;
+    break;
+  case 5:
+    r = 21;
+    break;
+  default:
+    r = -1;
+  }
+  return r;
+}
+
+int fall(int x) {
+  int r = 0;
+  switch (x) {
+  case 0:
+    r = r + 1;
+  case 1:
+  case 2:
+    r = r + 2;
+  case 3:
+  case 4:
+    r = r + 4;
+    break;
+  default:
+    break;
+  }
+  return r;
+}
@@ -0,0 +1,25 @@
+// COMPILE-TEST
+// EXTRA-FLAGS: -simplify-cfg -dump-ir
+
+// The result of the logical and is not tested anymore, the paths setting it
+// continue in the blocks decided by the test.
+
+// CHECK: 	br	$8<i1>, <false0>
+// CHECK: .true0:
+// CHECK: 	str	[$4<*i1>], 1<u32>
+// CHECK: 	call	g()
+// CHECK: 	j	<if_end0>
+// CHECK: .false0:
+// CHECK: 	str	[$4<*i1>], 0<u32>
+// CHECK: 	j	<if_end0>
+// CHECK: .if_end0:
+// CHECK: 	ret
+// CHECK-NOT: final0
+// CHECK-NOT: if_true0
+
+void g();
+
+void f(int a, int b) {
+  if (a > 0 && b > 0)
+    g();
+}